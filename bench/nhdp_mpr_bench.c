@@ -0,0 +1,682 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * Benchmark of the RFC 7181 MPR selection on dense synthetic
+ * neighborhoods.
+ *
+ * Nodes are placed randomly into a unit square and connected if they
+ * are close enough (random geometric graph). Every node calculates
+ * its flooding MPRs in turn with its neighbors and two-hop neighbors
+ * in the nhdp database. Afterwards messages are flooded from random
+ * sources, once with every node retransmitting and once with only
+ * the flooding MPRs of the sender retransmitting.
+ *
+ * The incremental update is measured by changing the metric of a
+ * random two-hop link of the local node and changing it back again,
+ * and by processing a neighbor without any change.
+ */
+
+#define _GNU_SOURCE
+
+#include <getopt.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "common/avl.h"
+#include "common/avl_comp.h"
+#include "common/common_types.h"
+#include "common/list.h"
+#include "common/netaddr.h"
+#include "rfc5444/rfc5444_iana.h"
+
+#include "nhdp/nhdp.h"
+#include "nhdp/nhdp_addr_id.h"
+#include "nhdp/nhdp_db.h"
+#include "nhdp/nhdp_domain.h"
+#include "nhdp/nhdp_interfaces.h"
+
+#include "mpr/mpr_selection.h"
+
+/* a node of the synthetic network */
+struct _bench_node {
+  /* position in the unit square */
+  double x, y;
+
+  /* address of the node and its interned id */
+  struct netaddr addr;
+  uint32_t addr_id;
+
+  /* indices of the neighbors of the node and the link costs to them */
+  uint32_t *neighbors;
+  uint32_t *costs;
+  uint32_t count, size;
+
+  /* indices of the flooding MPRs selected by the node */
+  uint32_t *mprs;
+  uint32_t mpr_count;
+};
+
+/* bench representation of a nhdp two-hop neighbor */
+struct _bench_l2hop {
+  struct nhdp_l2hop l2hop;
+
+  /* domain data, normally a class extension behind the l2hop */
+  struct nhdp_l2hop_domaindata l2data;
+};
+
+/* bench representation of a nhdp neighbor */
+struct _bench_neighbor {
+  struct nhdp_neighbor neigh;
+
+  /* domain data, normally a class extension behind the neighbor */
+  struct nhdp_neighbor_domaindata neighdata;
+
+  struct nhdp_link link;
+  struct nhdp_naddr naddr;
+
+  /* array of two-hop neighbors */
+  struct _bench_l2hop *l2hops;
+};
+
+static int _create_network(uint32_t nodes, double degree);
+static int _add_link(uint32_t n1, uint32_t n2);
+static int _calculate_mprs(uint32_t idx);
+static int _update_mprs(void);
+static int _fill_database(uint32_t idx);
+static void _clear_database(void);
+static void _flood(uint32_t source, uint64_t *blind, uint64_t *mpr,
+    uint64_t *covered, uint64_t *reachable);
+static uint32_t _random(void);
+static uint64_t _get_time_ns(void);
+static void _usage(const char *name);
+
+/* nodes of the synthetic network */
+static struct _bench_node *_nodes;
+static uint32_t _node_count;
+
+/* true if links should have random costs instead of hopcount */
+static bool _random_costs = false;
+
+/* number of incremental updates per node */
+static uint32_t _runs = 1;
+
+/* state of the pseudo random number generator */
+static uint64_t _random_state = 88172645463325252ull;
+
+/* nhdp domain used for the calculation */
+static struct nhdp_domain _domain;
+
+/* neighbors of the current local node */
+static struct _bench_neighbor *_bench_neighbors;
+static uint32_t _bench_neighbor_count;
+
+/* local interface address of the current local node */
+static struct nhdp_interface_addr _local_addr;
+
+/* sums of the MPR calculation results */
+static uint64_t _sum_n1, _sum_n2, _sum_mprs, _calc_ns;
+
+/* sums of the incremental updates */
+static uint64_t _updates, _update_ns, _update_checked;
+static uint64_t _refreshes, _refresh_ns;
+
+/* replacement for the nhdp database */
+struct list_entity nhdp_neigh_list;
+struct avl_tree nhdp_naddr_tree;
+struct avl_tree nhdp_ifaddr_tree;
+
+/**
+ * Main program
+ */
+int
+main(int argc, char **argv) {
+  uint64_t blind, mpr, covered, reachable;
+  uint32_t nodes, sources, i;
+  double degree;
+  uint64_t links;
+  int opt;
+
+  degree = 30;
+  sources = 100;
+  while ((opt = getopt(argc, argv, "d:cr:s:h")) != -1) {
+    switch (opt) {
+      case 'd':
+        degree = strtod(optarg, NULL);
+        break;
+      case 'c':
+        _random_costs = true;
+        break;
+      case 'r':
+        _runs = strtoul(optarg, NULL, 10);
+        break;
+      case 's':
+        sources = strtoul(optarg, NULL, 10);
+        break;
+      default:
+        _usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if (argc - optind != 1 || degree < 1 || _runs < 1 || sources < 1) {
+    _usage(argv[0]);
+    return 1;
+  }
+
+  nodes = strtoul(argv[optind], NULL, 10);
+  if (nodes < 2) {
+    _usage(argv[0]);
+    return 1;
+  }
+
+  list_init_head(&nhdp_neigh_list);
+  avl_init(&nhdp_naddr_tree, avl_comp_uint32, false);
+  avl_init(&nhdp_ifaddr_tree, avl_comp_netaddr, true);
+
+  /* point the domain data accessors to the bench storage */
+  _domain._neigh_ext._offset = offsetof(struct _bench_neighbor, neighdata)
+      - offsetof(struct _bench_neighbor, neigh);
+  _domain._l2hop_ext._offset = offsetof(struct _bench_l2hop, l2data)
+      - offsetof(struct _bench_l2hop, l2hop);
+
+  if (_create_network(nodes, degree)) {
+    fprintf(stderr, "Could not create network\n");
+    return 1;
+  }
+
+  /* every node calculates its flooding MPRs */
+  for (i=0; i<_node_count; i++) {
+    if (_calculate_mprs(i)) {
+      fprintf(stderr, "Could not calculate MPRs\n");
+      return 1;
+    }
+  }
+
+  /* flood messages from random sources */
+  blind = mpr = covered = reachable = 0;
+  for (i=0; i<sources; i++) {
+    _flood(_random() % _node_count, &blind, &mpr, &covered, &reachable);
+  }
+
+  links = 0;
+  for (i=0; i<_node_count; i++) {
+    links += _nodes[i].count;
+  }
+
+  printf("nodes=%u links=%" PRIu64 " average degree=%.1f costs=%s\n",
+      _node_count, links / 2, (double)links / _node_count,
+      _random_costs ? "random" : "hopcount");
+  printf("mpr: %.1f neighbors, %.1f two-hop neighbors, %.1f mprs\n",
+      (double)_sum_n1 / _node_count, (double)_sum_n2 / _node_count,
+      (double)_sum_mprs / _node_count);
+  printf("calculation: %" PRIu64 " ns/node\n", _calc_ns / _node_count);
+  if (_updates > 0) {
+    printf("incremental update: %" PRIu64 " ns/update, %.1f two-hop"
+        " neighbors checked, unchanged neighbor: %" PRIu64 " ns\n",
+        _update_ns / _updates, (double)_update_checked / _updates,
+        _refresh_ns / _refreshes);
+  }
+  printf("flooding: %.1f transmissions, mpr flooding: %.1f transmissions"
+      " (%.1f%%)\n", (double)blind / sources, (double)mpr / sources,
+      100.0 * mpr / blind);
+  printf("mpr flooding coverage: %.2f%%\n", 100.0 * covered / reachable);
+
+  /* cleanup */
+  for (i=0; i<_node_count; i++) {
+    nhdp_addr_id_release(_nodes[i].addr_id);
+    free(_nodes[i].neighbors);
+    free(_nodes[i].costs);
+    free(_nodes[i].mprs);
+  }
+  free(_nodes);
+  mpr_selection_cleanup();
+  nhdp_addr_id_cleanup();
+  return 0;
+}
+
+/**
+ * Create a random geometric network
+ * @param nodes number of nodes
+ * @param degree average number of neighbors of a node
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_create_network(uint32_t nodes, double degree) {
+  struct _bench_node *node;
+  double radius, dx, dy;
+  uint8_t binary[4];
+  uint32_t i, j;
+
+  _nodes = calloc(nodes, sizeof(*_nodes));
+  if (_nodes == NULL) {
+    return -1;
+  }
+  _node_count = nodes;
+
+  for (i=0; i<nodes; i++) {
+    node = &_nodes[i];
+    node->x = _random() / (double)UINT32_MAX;
+    node->y = _random() / (double)UINT32_MAX;
+
+    binary[0] = 10;
+    binary[1] = ((i+1) >> 16) & 255;
+    binary[2] = ((i+1) >> 8) & 255;
+    binary[3] = (i+1) & 255;
+    netaddr_from_binary(&node->addr, binary, sizeof(binary), AF_INET);
+
+    node->addr_id = nhdp_addr_id_acquire(&node->addr);
+    if (node->addr_id == NHDP_ADDR_ID_NONE) {
+      return -1;
+    }
+  }
+
+  /* degree = nodes * pi * radius^2 */
+  radius = sqrt(degree / (M_PI * nodes));
+
+  for (i=0; i<nodes; i++) {
+    for (j=i+1; j<nodes; j++) {
+      dx = _nodes[i].x - _nodes[j].x;
+      dy = _nodes[i].y - _nodes[j].y;
+      if (dx*dx + dy*dy <= radius*radius && _add_link(i, j)) {
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Add a symmetric link between two nodes
+ * @param n1 index of first node
+ * @param n2 index of second node
+ * @return -1 if out of memory, 0 otherwise
+ */
+static int
+_add_link(uint32_t n1, uint32_t n2) {
+  struct _bench_node *node;
+  uint32_t cost, idx[2], i, *ptr;
+
+  cost = NHDP_METRIC_DEFAULT;
+  if (_random_costs) {
+    cost = NHDP_METRIC_DEFAULT + _random() % (4 * NHDP_METRIC_DEFAULT);
+  }
+
+  idx[0] = n1;
+  idx[1] = n2;
+  for (i=0; i<2; i++) {
+    node = &_nodes[idx[i]];
+    if (node->count == node->size) {
+      node->size = node->size ? node->size * 2 : 16;
+
+      ptr = realloc(node->neighbors, node->size * sizeof(*ptr));
+      if (ptr == NULL) {
+        return -1;
+      }
+      node->neighbors = ptr;
+
+      ptr = realloc(node->costs, node->size * sizeof(*ptr));
+      if (ptr == NULL) {
+        return -1;
+      }
+      node->costs = ptr;
+    }
+
+    node->neighbors[node->count] = idx[1-i];
+    node->costs[node->count] = cost;
+    node->count++;
+  }
+  return 0;
+}
+
+/**
+ * Calculate the flooding MPRs of a node
+ * @param idx index of node
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_calculate_mprs(uint32_t idx) {
+  struct mpr_selection_result result;
+  struct _bench_node *node;
+  uint64_t start;
+  uint32_t i;
+
+  if (_fill_database(idx)) {
+    return -1;
+  }
+
+  start = _get_time_ns();
+  if (mpr_selection_calculate(&result, &_domain, true)) {
+    return -1;
+  }
+  _calc_ns += _get_time_ns() - start;
+
+  _sum_n1 += result.n1;
+  _sum_n2 += result.n2;
+  _sum_mprs += result.mprs;
+
+  /* remember the selected MPRs for the flooding simulation */
+  node = &_nodes[idx];
+  node->mprs = calloc(result.mprs + 1, sizeof(*node->mprs));
+  if (node->mprs == NULL) {
+    return -1;
+  }
+  for (i=0; i<_bench_neighbor_count; i++) {
+    if (_bench_neighbors[i].neigh.neigh_is_flooding_mpr) {
+      node->mprs[node->mpr_count++] = node->neighbors[i];
+    }
+  }
+
+  if (_bench_neighbor_count > 0 && _update_mprs()) {
+    return -1;
+  }
+
+  /* the stored MPR sets point to the neighbors of this node */
+  mpr_selection_cleanup();
+  _clear_database();
+  return 0;
+}
+
+/**
+ * Change the metric of random two-hop links of the current local
+ * node and update the flooding MPRs incrementally
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_update_mprs(void) {
+  struct mpr_selection_result result;
+  struct nhdp_l2hop_domaindata *l2data;
+  struct _bench_neighbor *bench;
+  uint32_t run, i, metric, twohops;
+  uint64_t start;
+
+  for (run=0; run<_runs; run++) {
+    bench = &_bench_neighbors[_random() % _bench_neighbor_count];
+    twohops = bench->link._2hop.count;
+    if (twohops == 0) {
+      continue;
+    }
+
+    l2data = nhdp_domain_get_l2hopdata(&_domain,
+        &bench->l2hops[_random() % twohops].l2hop);
+    metric = l2data->metric.out;
+
+    /* worse metric and back again */
+    for (i=0; i<2; i++) {
+      l2data->metric.out = i == 0 ? metric * 3 : metric;
+
+      start = _get_time_ns();
+      if (mpr_selection_update_neighbor(&result, &_domain, true,
+          &bench->neigh)) {
+        return -1;
+      }
+      _update_ns += _get_time_ns() - start;
+      _update_checked += result.checked;
+      _updates++;
+    }
+
+    /* HELLO without changes */
+    start = _get_time_ns();
+    if (mpr_selection_update_neighbor(&result, &_domain, true,
+        &bench->neigh)) {
+      return -1;
+    }
+    _refresh_ns += _get_time_ns() - start;
+    _refreshes++;
+  }
+  return 0;
+}
+
+/**
+ * Put the neighbors and two-hop neighbors of a node into the
+ * nhdp database
+ * @param idx index of local node
+ * @return -1 if out of memory, 0 otherwise
+ */
+static int
+_fill_database(uint32_t idx) {
+  struct nhdp_neighbor_domaindata *neighdata;
+  struct nhdp_l2hop_domaindata *l2data;
+  struct _bench_neighbor *bench;
+  struct _bench_node *node, *neighbor, *twohop;
+  struct nhdp_l2hop *l2hop;
+  uint32_t i, j;
+
+  node = &_nodes[idx];
+
+  _bench_neighbors = calloc(node->count + 1, sizeof(*_bench_neighbors));
+  if (_bench_neighbors == NULL) {
+    return -1;
+  }
+  _bench_neighbor_count = node->count;
+
+  memcpy(&_local_addr.if_addr, &node->addr, sizeof(node->addr));
+  _local_addr._global_node.key = &_local_addr.if_addr;
+  avl_insert(&nhdp_ifaddr_tree, &_local_addr._global_node);
+
+  for (i=0; i<node->count; i++) {
+    bench = &_bench_neighbors[i];
+    neighbor = &_nodes[node->neighbors[i]];
+
+    /* one symmetric link per neighbor */
+    bench->neigh.symmetric = 1;
+    bench->neigh.flooding_willingness = RFC5444_WILLINGNESS_DEFAULT;
+    list_init_head(&bench->neigh._links);
+    list_add_tail(&nhdp_neigh_list, &bench->neigh._global_node);
+
+    neighdata = nhdp_domain_get_neighbordata(&_domain, &bench->neigh);
+    neighdata->metric.in = node->costs[i];
+    neighdata->metric.out = node->costs[i];
+    neighdata->willingness = RFC5444_WILLINGNESS_DEFAULT;
+
+    bench->link.status = NHDP_LINK_SYMMETRIC;
+    bench->link.neigh = &bench->neigh;
+    avl_init(&bench->link._2hop, avl_comp_uint32, false);
+    list_add_tail(&bench->neigh._links, &bench->link._neigh_node);
+
+    bench->naddr.neigh_addr_id = neighbor->addr_id;
+    bench->naddr.neigh = &bench->neigh;
+    bench->naddr._global_node.key = &bench->naddr.neigh_addr_id;
+    avl_insert(&nhdp_naddr_tree, &bench->naddr._global_node);
+
+    avl_init(&bench->neigh._neigh_addresses, avl_comp_uint32, false);
+    bench->naddr._neigh_node.key = &bench->naddr.neigh_addr_id;
+    avl_insert(&bench->neigh._neigh_addresses, &bench->naddr._neigh_node);
+
+    /* the neighbors of the neighbor are two-hop neighbors */
+    bench->l2hops = calloc(neighbor->count + 1, sizeof(*bench->l2hops));
+    if (bench->l2hops == NULL) {
+      return -1;
+    }
+
+    for (j=0; j<neighbor->count; j++) {
+      twohop = &_nodes[neighbor->neighbors[j]];
+      l2hop = &bench->l2hops[j].l2hop;
+
+      l2hop->twohop_addr_id = twohop->addr_id;
+      l2hop->link = &bench->link;
+
+      l2data = nhdp_domain_get_l2hopdata(&_domain, l2hop);
+      l2data->metric.in = neighbor->costs[j];
+      l2data->metric.out = neighbor->costs[j];
+
+      l2hop->_link_node.key = &l2hop->twohop_addr_id;
+      avl_insert(&bench->link._2hop, &l2hop->_link_node);
+    }
+  }
+  return 0;
+}
+
+/**
+ * Remove the neighbors of the last local node from the nhdp database
+ */
+static void
+_clear_database(void) {
+  uint32_t i;
+
+  for (i=0; i<_bench_neighbor_count; i++) {
+    avl_remove(&nhdp_naddr_tree, &_bench_neighbors[i].naddr._global_node);
+    list_remove(&_bench_neighbors[i].neigh._global_node);
+    free(_bench_neighbors[i].l2hops);
+  }
+  avl_remove(&nhdp_ifaddr_tree, &_local_addr._global_node);
+
+  free(_bench_neighbors);
+  _bench_neighbors = NULL;
+  _bench_neighbor_count = 0;
+}
+
+/**
+ * Flood a message through the network
+ * @param source index of originator
+ * @param blind number of transmissions if every node retransmits
+ * @param mpr number of transmissions if only MPRs retransmit
+ * @param covered number of nodes reached by MPR flooding
+ * @param reachable number of nodes reached by blind flooding
+ */
+static void
+_flood(uint32_t source, uint64_t *blind, uint64_t *mpr,
+    uint64_t *covered, uint64_t *reachable) {
+  struct _bench_node *node;
+  uint32_t *queue, *received, *sent;
+  uint32_t head, tail, i, idx;
+
+  queue = calloc(_node_count, sizeof(*queue));
+  received = calloc(_node_count, sizeof(*received));
+  sent = calloc(_node_count, sizeof(*sent));
+  if (queue == NULL || received == NULL || sent == NULL) {
+    free(queue);
+    free(received);
+    free(sent);
+    return;
+  }
+
+  /* every node retransmits the message once */
+  head = tail = 0;
+  queue[tail++] = source;
+  sent[source] = 1;
+  while (head < tail) {
+    node = &_nodes[queue[head++]];
+    for (i=0; i<node->count; i++) {
+      idx = node->neighbors[i];
+      if (!sent[idx]) {
+        sent[idx] = 1;
+        queue[tail++] = idx;
+      }
+    }
+  }
+  *blind += tail;
+  *reachable += tail;
+
+  /* only the MPRs of the sender retransmit the message */
+  memset(sent, 0, _node_count * sizeof(*sent));
+  head = tail = 0;
+  queue[tail++] = source;
+  sent[source] = 1;
+  received[source] = 1;
+  while (head < tail) {
+    node = &_nodes[queue[head++]];
+    for (i=0; i<node->count; i++) {
+      received[node->neighbors[i]] = 1;
+    }
+    for (i=0; i<node->mpr_count; i++) {
+      idx = node->mprs[i];
+      if (!sent[idx]) {
+        sent[idx] = 1;
+        queue[tail++] = idx;
+      }
+    }
+  }
+  *mpr += tail;
+
+  for (i=0; i<_node_count; i++) {
+    *covered += received[i];
+  }
+
+  free(queue);
+  free(received);
+  free(sent);
+}
+
+/**
+ * @return next value of the xorshift pseudo random number generator
+ */
+static uint32_t
+_random(void) {
+  _random_state ^= _random_state >> 12;
+  _random_state ^= _random_state << 25;
+  _random_state ^= _random_state >> 27;
+  return (uint32_t)((_random_state * 2685821657736338717ull) >> 32);
+}
+
+/**
+ * @return monotonic time in nanoseconds
+ */
+static uint64_t
+_get_time_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+ * Print command line help
+ * @param name name of executable
+ */
+static void
+_usage(const char *name) {
+  fprintf(stderr, "Usage: %s [-d degree] [-c] [-r runs] [-s sources] <nodes>\n"
+      "\t-d: average number of neighbors (default 30)\n"
+      "\t-c: random link costs instead of hopcount\n"
+      "\t-r: number of incremental updates per node (default 1)\n"
+      "\t-s: number of flooded messages (default 100)\n", name);
+}
+
+/* replacement for the nhdp domain code */
+
+size_t
+nhdp_domain_get_count(void) {
+  return 1;
+}
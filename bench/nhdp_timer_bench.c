@@ -0,0 +1,325 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * Benchmark of the NHDP timer wheel against a timer tree sorted by
+ * expiration time (the data structure of oonf_timer).
+ *
+ * Every timer is a validity time re-armed by a periodic message
+ * from its neighbor, some messages are lost. Time is simulated,
+ * so a minute of protocol activity runs as fast as possible.
+ */
+
+#define _GNU_SOURCE
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "common/avl.h"
+#include "common/common_types.h"
+
+#include "nhdp/nhdp_timer_wheel.h"
+
+/* timer in a tree sorted by expiration time */
+struct _tree_timer {
+  /* absolute expiration time, 0 if not running */
+  uint64_t clock;
+
+  /* node for tree of running timers */
+  struct avl_node _node;
+};
+
+static void _run_wheel(void);
+static void _run_tree(void);
+static bool _message_received(void);
+static int _avl_comp_timer(const void *k1, const void *k2);
+static void _cb_wheel_timer(void *);
+static uint64_t _get_time_ns(void);
+static void _usage(const char *name);
+
+/* simulated time step in milliseconds */
+#define BENCH_STEP 10
+
+/* start of simulated time, similar to a system uptime */
+#define BENCH_START 1000000
+
+/* parameters of benchmark */
+static uint32_t _timer_count = 100000;
+static uint32_t _duration = 60000;
+static uint32_t _interval = 2000;
+static uint32_t _vtime = 6000;
+static uint32_t _loss = 10;
+
+/* state of the pseudo random number generator */
+static uint64_t _random_state;
+
+/* number of fired timers */
+static uint64_t _fired;
+
+/* number of timer set operations */
+static uint64_t _rearms;
+
+/* timer class of wheel timers */
+static struct nhdp_timer_info _wheel_timer_info = {
+  .name = "bench timer",
+  .callback = _cb_wheel_timer,
+};
+
+/**
+ * Main program
+ */
+int
+main(int argc, char **argv) {
+  struct rusage usage;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:d:i:v:l:h")) != -1) {
+    switch (opt) {
+      case 'n':
+        _timer_count = strtoul(optarg, NULL, 10);
+        break;
+      case 'd':
+        _duration = strtoul(optarg, NULL, 10);
+        break;
+      case 'i':
+        _interval = strtoul(optarg, NULL, 10);
+        break;
+      case 'v':
+        _vtime = strtoul(optarg, NULL, 10);
+        break;
+      case 'l':
+        _loss = strtoul(optarg, NULL, 10);
+        break;
+      default:
+        _usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if (optind != argc || _timer_count == 0 || _interval < BENCH_STEP
+      || _loss > 100) {
+    _usage(argv[0]);
+    return 1;
+  }
+
+  printf("timers=%u duration=%u ms interval=%u ms vtime=%u ms loss=%u%%\n",
+      _timer_count, _duration, _interval, _vtime, _loss);
+
+  _run_wheel();
+  _run_tree();
+
+  getrusage(RUSAGE_SELF, &usage);
+  printf("peak rss: %ld kbyte\n", usage.ru_maxrss);
+  return 0;
+}
+
+/**
+ * Run the re-arm pattern on the timer wheel
+ */
+static void
+_run_wheel(void) {
+  struct nhdp_timer_entry *timers;
+  struct nhdp_timer_wheel wheel;
+  uint64_t now, start, elapsed;
+  uint32_t i, phase;
+
+  timers = calloc(_timer_count, sizeof(*timers));
+  if (timers == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    return;
+  }
+
+  for (i=0; i<_timer_count; i++) {
+    timers[i].info = &_wheel_timer_info;
+  }
+
+  _random_state = 88172645463325252ull;
+  _fired = 0;
+  _rearms = 0;
+
+  start = _get_time_ns();
+  nhdp_timer_wheel_init(&wheel, BENCH_START);
+  for (now = BENCH_START; now < BENCH_START + _duration; now += BENCH_STEP) {
+    /* timers with the current phase receive a message */
+    phase = ((now - BENCH_START) % _interval) / BENCH_STEP;
+    for (i = phase; i < _timer_count; i += _interval / BENCH_STEP) {
+      if (_message_received()) {
+        nhdp_timer_wheel_set(&wheel, &timers[i], now, now + _vtime);
+        _rearms++;
+      }
+    }
+
+    nhdp_timer_wheel_process(&wheel, now);
+  }
+  elapsed = _get_time_ns() - start;
+
+  printf("wheel: %" PRIu64 " ms, %" PRIu64 " ns/re-arm, %" PRIu64 " re-arms,"
+      " %" PRIu64 " fired, %u lazy re-arms, %u moves, %u cascades,"
+      " %zu byte/timer\n",
+      elapsed / 1000000, elapsed / (_rearms ? _rearms : 1), _rearms, _fired,
+      wheel.lazy_rearms, wheel.moves, wheel.cascades,
+      sizeof(struct nhdp_timer_entry));
+
+  free(timers);
+}
+
+/**
+ * Run the re-arm pattern on a tree of timers sorted by expiration time
+ */
+static void
+_run_tree(void) {
+  struct _tree_timer *timers, *timer;
+  struct avl_tree tree;
+  uint64_t now, start, elapsed;
+  uint32_t i, phase;
+
+  timers = calloc(_timer_count, sizeof(*timers));
+  if (timers == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    return;
+  }
+
+  _random_state = 88172645463325252ull;
+  _fired = 0;
+  _rearms = 0;
+
+  start = _get_time_ns();
+  avl_init(&tree, _avl_comp_timer, true);
+  for (now = BENCH_START; now < BENCH_START + _duration; now += BENCH_STEP) {
+    phase = ((now - BENCH_START) % _interval) / BENCH_STEP;
+    for (i = phase; i < _timer_count; i += _interval / BENCH_STEP) {
+      if (_message_received()) {
+        /* every re-arm moves the timer inside the tree */
+        if (timers[i].clock != 0) {
+          avl_remove(&tree, &timers[i]._node);
+        }
+        timers[i].clock = now + _vtime;
+        timers[i]._node.key = &timers[i].clock;
+        avl_insert(&tree, &timers[i]._node);
+        _rearms++;
+      }
+    }
+
+    while (!avl_is_empty(&tree)) {
+      timer = avl_first_element(&tree, timer, _node);
+      if (timer->clock > now) {
+        break;
+      }
+
+      avl_remove(&tree, &timer->_node);
+      timer->clock = 0;
+      _fired++;
+    }
+  }
+  elapsed = _get_time_ns() - start;
+
+  printf("tree: %" PRIu64 " ms, %" PRIu64 " ns/re-arm, %" PRIu64 " re-arms,"
+      " %" PRIu64 " fired, %zu byte/timer\n",
+      elapsed / 1000000, elapsed / (_rearms ? _rearms : 1), _rearms, _fired,
+      sizeof(struct _tree_timer));
+
+  free(timers);
+}
+
+/**
+ * @return true if the next message of a neighbor was not lost
+ */
+static bool
+_message_received(void) {
+  _random_state ^= _random_state >> 12;
+  _random_state ^= _random_state << 25;
+  _random_state ^= _random_state >> 27;
+  return ((_random_state * 2685821657736338717ull) >> 32) % 100 >= _loss;
+}
+
+/**
+ * Compare two timer expiration times
+ * @param k1 pointer to first expiration time
+ * @param k2 pointer to second expiration time
+ * @return -1 if k1 is earlier, 1 if k1 is later, 0 if equal
+ */
+static int
+_avl_comp_timer(const void *k1, const void *k2) {
+  const uint64_t *c1 = k1, *c2 = k2;
+
+  if (*c1 < *c2) {
+    return -1;
+  }
+  return *c1 > *c2 ? 1 : 0;
+}
+
+/**
+ * Callback for fired wheel timers
+ * @param ptr unused
+ */
+static void
+_cb_wheel_timer(void *ptr __attribute__((unused))) {
+  _fired++;
+}
+
+/**
+ * @return monotonic time in nanoseconds
+ */
+static uint64_t
+_get_time_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+ * Print command line help
+ * @param name name of executable
+ */
+static void
+_usage(const char *name) {
+  fprintf(stderr, "Usage: %s [-n timers] [-d duration] [-i interval]"
+      " [-v vtime] [-l loss]\n"
+      "\t-n: number of timers (default 100000)\n"
+      "\t-d: simulated time in ms (default 60000)\n"
+      "\t-i: message interval in ms (default 2000)\n"
+      "\t-v: validity time set by a message in ms (default 6000)\n"
+      "\t-l: message loss in percent (default 10)\n", name);
+}
@@ -0,0 +1,853 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * Benchmark of the OLSRv2 Dijkstra on synthetic topologies.
+ *
+ * The tc database is filled through the public olsrv2_tc API, the
+ * parts of the daemon the routing code depends on (nhdp database,
+ * originator set, configuration and kernel routing) are replaced
+ * by the minimal implementations below.
+ */
+
+#define _GNU_SOURCE
+
+#include <getopt.h>
+#include <malloc.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "common/avl.h"
+#include "common/avl_comp.h"
+#include "common/common_types.h"
+#include "common/list.h"
+#include "common/netaddr.h"
+#include "common/netaddr_acl.h"
+#include "core/oonf_logging.h"
+#include "core/oonf_subsystem.h"
+#include "core/os_core.h"
+#include "subsystems/oonf_class.h"
+#include "subsystems/oonf_clock.h"
+#include "subsystems/oonf_timer.h"
+#include "subsystems/os_clock.h"
+#include "subsystems/os_routing.h"
+#include "rfc5444/rfc5444.h"
+
+#include "app_data.h"
+
+#include "nhdp/nhdp_db.h"
+#include "nhdp/nhdp_domain.h"
+#include "nhdp/nhdp_timer_wheel.h"
+
+#include "olsrv2/olsrv2.h"
+#include "olsrv2/olsrv2_originator.h"
+#include "olsrv2/olsrv2_routing.h"
+#include "olsrv2/olsrv2_tc.h"
+
+/* a link of the synthetic topology */
+struct _bench_link {
+  /* index of source and destination node */
+  uint32_t src, dst;
+
+  /* link cost in both directions */
+  uint32_t cost;
+};
+
+/* topology generator */
+struct _bench_generator {
+  /* name of generator on the command line */
+  const char *name;
+
+  /* callback to create the links of a topology with a number of nodes */
+  int (*create)(uint32_t nodes);
+};
+
+static int _create_grid(uint32_t nodes);
+static int _create_geometric(uint32_t nodes);
+static int _create_scalefree(uint32_t nodes);
+static int _create_chain(uint32_t nodes);
+static int _add_link(uint32_t src, uint32_t dst);
+static uint32_t _random(void);
+static void _get_node_addr(struct netaddr *addr, uint32_t idx);
+static void _get_network_addr(struct netaddr *addr, uint32_t idx);
+static int _fill_database(uint32_t nodes);
+static int _add_neighbor(struct olsrv2_tc_edge *edge, uint32_t cost);
+static void _clear_database(void);
+static uint64_t _get_time_ns(void);
+static size_t _get_heap_usage(void);
+static void _usage(const char *name);
+
+/* list of topology generators */
+static struct _bench_generator _generators[] = {
+  { .name = "grid", .create = _create_grid },
+  { .name = "geometric", .create = _create_geometric },
+  { .name = "scalefree", .create = _create_scalefree },
+  { .name = "chain", .create = _create_chain },
+};
+
+/* framework subsystems used by the routing code */
+static struct oonf_subsystem *_subsystems[] = {
+  &oonf_os_core_subsystem,
+  &oonf_class_subsystem,
+  &oonf_os_clock_subsystem,
+  &oonf_clock_subsystem,
+  &oonf_timer_subsystem,
+};
+
+/* number of attached networks per node of the chain topology */
+#define BENCH_CHAIN_NETWORKS 16
+
+/* average number of links per node of the geometric topology */
+#define BENCH_GEOMETRIC_DEGREE 8
+
+/* links of the synthetic topology */
+static struct _bench_link *_links;
+static size_t _link_count, _link_size;
+
+/* number of attached networks per node */
+static uint32_t _networks_per_node;
+
+/* state of the pseudo random number generator */
+static uint64_t _random_state = 88172645463325252ull;
+
+/* nhdp domains and neighbors of the local node */
+static struct nhdp_domain _domains[NHDP_MAXIMUM_DOMAINS];
+static size_t _domain_count = 1;
+static struct list_entity _bench_neighbors;
+
+/* originator of the local node, node index 0 */
+static struct netaddr _originator;
+
+/* empty routable ACL */
+static struct netaddr_acl _routable;
+
+/* true if triggered runs should use the incremental dijkstra */
+static bool _use_incremental = false;
+
+/* current value of the incremental dijkstra setting */
+static bool _incremental = false;
+
+/* number of stubbed kernel route operations */
+static uint64_t _kernel_calls = 0;
+
+/* replacement for the nhdp database */
+struct list_entity nhdp_domain_list;
+struct list_entity nhdp_neigh_list;
+struct avl_tree nhdp_neigh_originator_tree;
+
+/* bench representation of a nhdp neighbor */
+struct _bench_neighbor {
+  struct nhdp_neighbor neigh;
+
+  /* domain data, normally class extensions behind the neighbor */
+  struct nhdp_neighbor_domaindata neighdata[NHDP_MAXIMUM_DOMAINS];
+
+  struct nhdp_link link;
+  struct list_entity _node;
+};
+
+/**
+ * Main program
+ */
+int
+main(int argc, char **argv) {
+  const struct _bench_generator *generator;
+  const struct olsrv2_routing_statistics *stats;
+  struct olsrv2_routing_domain parameter;
+  struct olsrv2_tc_node *node;
+  struct olsrv2_tc_edge *edge;
+  uint64_t start, initial_ns, full_ns, triggered_ns;
+  size_t heap_start, heap_used, routes, i;
+  uint32_t nodes, targets, runs, run;
+  struct rusage usage;
+  int opt, result;
+
+  runs = 10;
+  while ((opt = getopt(argc, argv, "d:ir:h")) != -1) {
+    switch (opt) {
+      case 'd':
+        _domain_count = strtoul(optarg, NULL, 10);
+        break;
+      case 'i':
+        _use_incremental = true;
+        break;
+      case 'r':
+        runs = strtoul(optarg, NULL, 10);
+        break;
+      default:
+        _usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if (argc - optind != 2 || _domain_count < 1
+      || _domain_count > NHDP_MAXIMUM_DOMAINS || runs < 1) {
+    _usage(argv[0]);
+    return 1;
+  }
+
+  generator = NULL;
+  for (i=0; i<ARRAYSIZE(_generators); i++) {
+    if (strcmp(_generators[i].name, argv[optind]) == 0) {
+      generator = &_generators[i];
+    }
+  }
+  nodes = strtoul(argv[optind+1], NULL, 10);
+  if (generator == NULL || nodes < 2) {
+    _usage(argv[0]);
+    return 1;
+  }
+
+  /* initialize framework */
+  if (oonf_log_init(oonf_appdata_get(), LOG_SEVERITY_WARN)) {
+    return 1;
+  }
+  for (i=0; i<ARRAYSIZE(_subsystems); i++) {
+    if (_subsystems[i]->init != NULL && _subsystems[i]->init()) {
+      fprintf(stderr, "Could not initialize '%s' submodule\n",
+          _subsystems[i]->name);
+      return 1;
+    }
+  }
+
+  /* initialize nhdp replacement */
+  nhdp_timer_init();
+  list_init_head(&nhdp_domain_list);
+  list_init_head(&nhdp_neigh_list);
+  list_init_head(&_bench_neighbors);
+  avl_init(&nhdp_neigh_originator_tree, avl_comp_uint32, false);
+
+  memset(&_routable, 0, sizeof(_routable));
+  _get_node_addr(&_originator, 0);
+
+  memset(&parameter, 0, sizeof(parameter));
+  parameter.protocol = 100;
+  parameter.table = 254;
+  parameter.distance = 2;
+
+  olsrv2_tc_init();
+  olsrv2_routing_init();
+
+  for (i=0; i<_domain_count; i++) {
+    _domains[i].index = i;
+    _domains[i]._neigh_ext._offset =
+        offsetof(struct _bench_neighbor, neighdata[i])
+        - offsetof(struct _bench_neighbor, neigh);
+    list_add_tail(&nhdp_domain_list, &_domains[i]._node);
+    olsrv2_routing_set_domain_parameter(&_domains[i], &parameter);
+  }
+
+  /* create synthetic topology */
+  heap_start = _get_heap_usage();
+  result = generator->create(nodes);
+  if (result == 0) {
+    result = _fill_database(nodes);
+  }
+  free(_links);
+  _links = NULL;
+
+  if (result) {
+    fprintf(stderr, "Could not create topology\n");
+    return 1;
+  }
+
+  /* first run creates all routing entries and kernel routes */
+  start = _get_time_ns();
+  olsrv2_routing_force_update(true);
+  initial_ns = _get_time_ns() - start;
+
+  /* full runs on an unchanged topology */
+  start = _get_time_ns();
+  for (run = 0; run < runs; run++) {
+    olsrv2_routing_force_update(true);
+  }
+  full_ns = (_get_time_ns() - start) / runs;
+
+  /* runs triggered by a single changed link cost */
+  _incremental = _use_incremental;
+  triggered_ns = 0;
+  for (run = 0; run < runs; run++) {
+    node = avl_first_element(&olsrv2_tc_tree, node, _originator_node);
+    for (i = _random() % olsrv2_tc_tree.count; i > 0; i--) {
+      node = avl_next_element(node, _originator_node);
+    }
+    if (avl_is_empty(&node->_edges)) {
+      continue;
+    }
+
+    edge = avl_first_element(&node->_edges, edge, _node);
+    olsrv2_tc_edge_set_cost(edge, &_domains[0], 1000 + _random() % 3000);
+
+    start = _get_time_ns();
+    olsrv2_routing_force_update(true);
+    triggered_ns += _get_time_ns() - start;
+  }
+  triggered_ns /= runs;
+
+  heap_used = _get_heap_usage() - heap_start;
+  getrusage(RUSAGE_SELF, &usage);
+
+  routes = 0;
+  for (i=0; i<_domain_count; i++) {
+    routes += olsrv2_routing_tree[i].count;
+  }
+
+  targets = olsrv2_tc_tree.count + olsrv2_tc_endpoint_tree.count;
+  stats = olsrv2_routing_get_statistics();
+
+  printf("generator=%s nodes=%u targets=%u domains=%zu incremental=%s\n",
+      generator->name, olsrv2_tc_tree.count, targets, _domain_count,
+      _use_incremental ? "yes" : "no");
+  printf("initial: %" PRIu64 " us, %" PRIu64 " ns/node\n",
+      initial_ns / 1000, initial_ns / targets);
+  printf("full: %" PRIu64 " us, %" PRIu64 " ns/node\n",
+      full_ns / 1000, full_ns / targets);
+  printf("triggered: %" PRIu64 " us, %" PRIu64 " ns/node\n",
+      triggered_ns / 1000, triggered_ns / targets);
+  printf("routes: %zu, kernel calls: %" PRIu64 ", dijkstra runs: %u\n",
+      routes, _kernel_calls, stats->spf_runs);
+  printf("heap: %zu kbyte (%zu byte/node), peak rss: %ld kbyte\n",
+      heap_used / 1024, heap_used / targets, usage.ru_maxrss);
+
+  /* cleanup */
+  olsrv2_routing_initiate_shutdown(false);
+  olsrv2_routing_cleanup();
+  olsrv2_tc_cleanup();
+  _clear_database();
+  nhdp_timer_cleanup();
+
+  for (i=ARRAYSIZE(_subsystems); i>0; i--) {
+    if (_subsystems[i-1]->cleanup != NULL) {
+      _subsystems[i-1]->cleanup();
+    }
+  }
+  oonf_log_cleanup();
+  return 0;
+}
+
+/**
+ * Create a square grid topology
+ * @param nodes number of nodes
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_create_grid(uint32_t nodes) {
+  uint32_t width, i;
+
+  width = (uint32_t)sqrt(nodes);
+  if (width * width < nodes) {
+    width++;
+  }
+
+  for (i=0; i<nodes; i++) {
+    if ((i % width) + 1 < width && i + 1 < nodes && _add_link(i, i + 1)) {
+      return -1;
+    }
+    if (i + width < nodes && _add_link(i, i + width)) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Create a random geometric topology in the unit square, the radio
+ * range is chosen for an average number of links per node
+ * @param nodes number of nodes
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_create_geometric(uint32_t nodes) {
+  uint32_t *cell_head, *cell_next;
+  uint32_t cells, cx, cy, x, y, i, j;
+  double *pos, range, dx, dy;
+  int result;
+
+  range = sqrt(BENCH_GEOMETRIC_DEGREE / (M_PI * nodes));
+  cells = (uint32_t)(1.0 / range);
+  if (cells < 1) {
+    cells = 1;
+  }
+
+  pos = calloc(nodes * 2, sizeof(*pos));
+  cell_head = calloc(cells * cells, sizeof(*cell_head));
+  cell_next = calloc(nodes, sizeof(*cell_next));
+  result = -1;
+  if (pos == NULL || cell_head == NULL || cell_next == NULL) {
+    goto create_geometric_cleanup;
+  }
+
+  /* place nodes into a grid of cells as large as the radio range */
+  for (i=0; i<nodes; i++) {
+    if (i == 0) {
+      /* local node is in the center to avoid a small partition */
+      pos[0] = 0.5;
+      pos[1] = 0.5;
+    }
+    else {
+      pos[2*i] = (double)_random() / UINT32_MAX;
+      pos[2*i + 1] = (double)_random() / UINT32_MAX;
+    }
+
+    cx = (uint32_t)(pos[2*i] * cells) % cells;
+    cy = (uint32_t)(pos[2*i + 1] * cells) % cells;
+
+    /* cell lists are stored with an offset of one, 0 is the end */
+    cell_next[i] = cell_head[cy * cells + cx];
+    cell_head[cy * cells + cx] = i + 1;
+  }
+
+  /* connect all nodes within range, only neighbor cells are checked */
+  for (i=0; i<nodes; i++) {
+    cx = (uint32_t)(pos[2*i] * cells) % cells;
+    cy = (uint32_t)(pos[2*i + 1] * cells) % cells;
+
+    for (y = cy > 0 ? cy - 1 : 0; y <= cy + 1 && y < cells; y++) {
+      for (x = cx > 0 ? cx - 1 : 0; x <= cx + 1 && x < cells; x++) {
+        for (j = cell_head[y * cells + x]; j != 0; j = cell_next[j - 1]) {
+          if (j - 1 <= i) {
+            continue;
+          }
+
+          dx = pos[2*i] - pos[2*(j-1)];
+          dy = pos[2*i + 1] - pos[2*(j-1) + 1];
+          if (dx*dx + dy*dy <= range*range && _add_link(i, j - 1)) {
+            goto create_geometric_cleanup;
+          }
+        }
+      }
+    }
+  }
+  result = 0;
+
+create_geometric_cleanup:
+  free(pos);
+  free(cell_head);
+  free(cell_next);
+  return result;
+}
+
+/**
+ * Create a scale-free topology with preferential attachment
+ * (Barabasi-Albert), each new node connects to two existing nodes
+ * @param nodes number of nodes
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_create_scalefree(uint32_t nodes) {
+  uint32_t i, first, second;
+
+  if (_add_link(0, 1)) {
+    return -1;
+  }
+
+  for (i=2; i<nodes; i++) {
+    /* a random end of a random link prefers nodes with many links */
+    first = _links[_random() % _link_count].src;
+    if (_random() & 1) {
+      first = _links[_random() % _link_count].dst;
+    }
+
+    do {
+      second = _links[_random() % _link_count].dst;
+    } while (second == first && i > 2);
+
+    if (_add_link(i, first) || (second != first && _add_link(i, second))) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Create a chain of nodes with many attached networks each
+ * @param nodes number of nodes
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_create_chain(uint32_t nodes) {
+  uint32_t i;
+
+  for (i=0; i+1<nodes; i++) {
+    if (_add_link(i, i + 1)) {
+      return -1;
+    }
+  }
+
+  _networks_per_node = BENCH_CHAIN_NETWORKS;
+  return 0;
+}
+
+/**
+ * Add a bidirectional link with a random cost to the topology
+ * @param src index of first node
+ * @param dst index of second node
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_add_link(uint32_t src, uint32_t dst) {
+  struct _bench_link *ptr;
+
+  if (_link_count == _link_size) {
+    ptr = realloc(_links, (_link_size * 2 + 64) * sizeof(*_links));
+    if (ptr == NULL) {
+      return -1;
+    }
+    _links = ptr;
+    _link_size = _link_size * 2 + 64;
+  }
+
+  _links[_link_count].src = src;
+  _links[_link_count].dst = dst;
+  _links[_link_count].cost = 1000 + _random() % 3000;
+  _link_count++;
+  return 0;
+}
+
+/**
+ * @return next value of the xorshift pseudo random number generator
+ */
+static uint32_t
+_random(void) {
+  _random_state ^= _random_state >> 12;
+  _random_state ^= _random_state << 25;
+  _random_state ^= _random_state >> 27;
+  return (uint32_t)((_random_state * 2685821657736338717ull) >> 32);
+}
+
+/**
+ * Generate the originator address of a node
+ * @param addr pointer to output buffer
+ * @param idx index of node
+ */
+static void
+_get_node_addr(struct netaddr *addr, uint32_t idx) {
+  uint8_t binary[4];
+
+  idx++;
+  binary[0] = 10;
+  binary[1] = (idx >> 16) & 255;
+  binary[2] = (idx >> 8) & 255;
+  binary[3] = idx & 255;
+
+  netaddr_from_binary(addr, binary, sizeof(binary), AF_INET);
+}
+
+/**
+ * Generate the prefix of an attached network
+ * @param addr pointer to output buffer
+ * @param idx index of network
+ */
+static void
+_get_network_addr(struct netaddr *addr, uint32_t idx) {
+  uint8_t binary[4];
+
+  binary[0] = 64 + ((idx >> 16) & 63);
+  binary[1] = (idx >> 8) & 255;
+  binary[2] = idx & 255;
+  binary[3] = 0;
+
+  netaddr_from_binary_prefix(addr, binary, sizeof(binary), AF_INET, 24);
+}
+
+/**
+ * Put the synthetic topology into the tc database, the neighbors
+ * of node 0 become nhdp neighbors
+ * @param nodes number of nodes
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_fill_database(uint32_t nodes) {
+  struct olsrv2_tc_attachment *attachment;
+  struct olsrv2_tc_edge *edge;
+  struct olsrv2_tc_node *src, *dst;
+  struct netaddr addr;
+  uint32_t i, n;
+  size_t d;
+
+  for (i=0; i<nodes; i++) {
+    _get_node_addr(&addr, i);
+    if (olsrv2_tc_node_add(&addr, 3600000, 1) == NULL) {
+      return -1;
+    }
+  }
+
+  for (i=0; i<_link_count; i++) {
+    _get_node_addr(&addr, _links[i].src);
+    src = olsrv2_tc_node_get(&addr);
+    _get_node_addr(&addr, _links[i].dst);
+    dst = olsrv2_tc_node_get(&addr);
+
+    /* both nodes advertise the link in their tc */
+    edge = olsrv2_tc_edge_add(src, olsrv2_tc_target_get_netaddr(&dst->target));
+    if (edge == NULL) {
+      return -1;
+    }
+    for (d=0; d<_domain_count; d++) {
+      olsrv2_tc_edge_set_cost(edge, &_domains[d], _links[i].cost);
+    }
+    if (_links[i].src == 0 && _add_neighbor(edge, _links[i].cost)) {
+      return -1;
+    }
+
+    edge = olsrv2_tc_edge_add(dst, olsrv2_tc_target_get_netaddr(&src->target));
+    if (edge == NULL) {
+      return -1;
+    }
+    for (d=0; d<_domain_count; d++) {
+      olsrv2_tc_edge_set_cost(edge, &_domains[d], _links[i].cost);
+    }
+    if (_links[i].dst == 0 && _add_neighbor(edge, _links[i].cost)) {
+      return -1;
+    }
+  }
+
+  for (i=0; i<nodes; i++) {
+    _get_node_addr(&addr, i);
+    src = olsrv2_tc_node_get(&addr);
+
+    for (n=0; n<_networks_per_node; n++) {
+      _get_network_addr(&addr, i * _networks_per_node + n);
+      attachment = olsrv2_tc_endpoint_add(src, &addr, false);
+      if (attachment == NULL) {
+        return -1;
+      }
+      for (d=0; d<_domain_count; d++) {
+        olsrv2_tc_endpoint_set_cost(attachment, &_domains[d],
+            1000 + _random() % 3000, 0);
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Create a nhdp neighbor for a tc edge of the local node
+ * @param edge tc edge from local node to neighbor
+ * @param cost link cost to neighbor
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_add_neighbor(struct olsrv2_tc_edge *edge, uint32_t cost) {
+  struct _bench_neighbor *bench;
+  size_t d;
+
+  bench = calloc(1, sizeof(*bench));
+  if (bench == NULL) {
+    return -1;
+  }
+
+  /* the tc node holds the reference on the address id */
+  bench->neigh.originator_id = edge->dst->target.addr_id;
+  bench->link.if_addr_id = edge->dst->target.addr_id;
+  bench->neigh.symmetric = 1;
+
+  list_init_head(&bench->neigh._links);
+  avl_init(&bench->neigh._neigh_addresses, avl_comp_uint32, false);
+
+  for (d=0; d<_domain_count; d++) {
+    bench->neighdata[d].metric.in = cost;
+    bench->neighdata[d].metric.out = cost;
+    bench->neighdata[d].best_link = &bench->link;
+    bench->neighdata[d].best_link_ifindex = 1;
+  }
+
+  bench->neigh._originator_node.key = &bench->neigh.originator_id;
+  avl_insert(&nhdp_neigh_originator_tree, &bench->neigh._originator_node);
+  list_add_tail(&nhdp_neigh_list, &bench->neigh._global_node);
+  list_add_tail(&_bench_neighbors, &bench->_node);
+  return 0;
+}
+
+/**
+ * Remove all nhdp neighbors
+ */
+static void
+_clear_database(void) {
+  struct _bench_neighbor *bench, *b_it;
+
+  list_for_each_element_safe(&_bench_neighbors, bench, _node, b_it) {
+    avl_remove(&nhdp_neigh_originator_tree, &bench->neigh._originator_node);
+    list_remove(&bench->neigh._global_node);
+    list_remove(&bench->_node);
+    free(bench);
+  }
+}
+
+/**
+ * @return monotonic time in nanoseconds
+ */
+static uint64_t
+_get_time_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+ * @return number of bytes allocated on the heap
+ */
+static size_t
+_get_heap_usage(void) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  return mallinfo2().uordblks;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * Print command line help
+ * @param name name of executable
+ */
+static void
+_usage(const char *name) {
+  size_t i;
+
+  fprintf(stderr, "Usage: %s [-d domains] [-r runs] [-i] <generator> <nodes>\n"
+      "\t-d: number of nhdp domains (1-%d)\n"
+      "\t-r: number of timed runs (default 10)\n"
+      "\t-i: use incremental dijkstra for triggered runs\n"
+      "Generators:", name, NHDP_MAXIMUM_DOMAINS);
+  for (i=0; i<ARRAYSIZE(_generators); i++) {
+    fprintf(stderr, " %s", _generators[i].name);
+  }
+  fprintf(stderr, "\n");
+}
+
+/* replacement for the nhdp domain code */
+
+size_t
+nhdp_domain_get_count(void) {
+  return _domain_count;
+}
+
+uint32_t
+nhdp_domain_get_best_link_generation(void) {
+  return 0;
+}
+
+void
+nhdp_domain_listener_add(struct nhdp_domain_listener *listener
+    __attribute__((unused))) {
+}
+
+void
+nhdp_domain_listener_remove(struct nhdp_domain_listener *listener
+    __attribute__((unused))) {
+}
+
+/* replacement for the olsrv2 originator set and configuration */
+
+const struct netaddr *
+olsrv2_originator_get(int af_type) {
+  static struct netaddr unspec;
+
+  return af_type == AF_INET ? &_originator : &unspec;
+}
+
+bool
+olsrv2_originator_is_local(const struct netaddr *addr) {
+  return netaddr_cmp(addr, &_originator) == 0;
+}
+
+const struct netaddr_acl *
+olsrv2_get_routable(void) {
+  return &_routable;
+}
+
+bool
+olsrv2_get_spf_incremental(void) {
+  return _incremental;
+}
+
+bool
+olsrv2_get_spf_verify(void) {
+  return false;
+}
+
+uint64_t
+olsrv2_get_spf_initial_delay(void) {
+  return 0;
+}
+
+uint64_t
+olsrv2_get_spf_secondary_wait(void) {
+  return 0;
+}
+
+uint64_t
+olsrv2_get_spf_max_hold(void) {
+  return 0;
+}
+
+int
+olsrv2_get_routing_window(void) {
+  return 0;
+}
+
+/* kernel routing is replaced by an immediate success */
+
+int
+os_routing_set(struct os_route *route,
+    bool set __attribute__((unused)),
+    bool del_similar __attribute__((unused))) {
+  _kernel_calls++;
+  if (route->cb_finished) {
+    route->cb_finished(route, 0);
+  }
+  return 0;
+}
+
+void
+os_routing_interrupt(struct os_route *route __attribute__((unused))) {
+}
+
+const char *
+os_routing_to_string(struct os_route_str *buf __attribute__((unused)),
+    const struct os_route *route __attribute__((unused))) {
+  return "";
+}
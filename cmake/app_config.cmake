@@ -61,6 +61,18 @@ set (OONF_CUSTOM_STATIC_PLUGINS "" CACHE STRING
 set (OONF_FRAMEWORD_DYNAMIC false CACHE BOOL
      "Compile the application with dynamic libraries instead of linking everything static")
 
+# select datastructure for the Dijkstra working queue (avl, heap)
+set (OLSRV2_DIJKSTRA_QUEUE heap CACHE STRING
+     "Priority queue used by the OLSRv2 Dijkstra (avl, heap)")
+
+# calculate the Dijkstra of multiple domains in parallel threads
+set (OLSRV2_SPF_THREADS false CACHE BOOL
+     "Calculate the OLSRv2 Dijkstra of the domains in a pool of worker threads")
+
+# build the Dijkstra and timer wheel benchmarks
+set (OLSRV2_BENCHMARK false CACHE BOOL
+     "Compile the olsrv2_spf_bench, nhdp_timer_bench and nhdp_mpr_bench executables")
+
 # set to true to stop application running without root privileges (true/false)
 set (OONF_NEED_ROOT true)
 
@@ -73,7 +85,7 @@ set (OONF_NEED_PACKETBB true)
 
 # use default static plugins if custom variable not set
 IF (NOT OONF_CUSTOM_STATIC_PLUGINS OR OONF_CUSTOM_STATIC_PLUGINS STREQUAL "")
-	set (OONF_STATIC_PLUGINS "cfgparser_compact cfgio_file ff_etx neighbor_probing nl80211_listener")
+	set (OONF_STATIC_PLUGINS "cfgparser_compact cfgio_file ff_etx mpr neighbor_probing nl80211_listener")
 ELSE ()
 	set (OONF_STATIC_PLUGINS "${OONF_CUSTOM_STATIC_PLUGINS}")
 ENDIF ()
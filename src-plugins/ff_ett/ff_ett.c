@@ -348,11 +348,12 @@ _get_linkspeed(struct nhdp_link *lnk) {
 #endif
 
   OONF_DEBUG(LOG_FF_ETT, "Query linkspeed for link %s",
-      netaddr_to_string(&nbuf, &lnk->if_addr));
+      netaddr_to_string(&nbuf, nhdp_db_link_get_ifaddr(lnk)));
 
   /* look for link configuration with originator address */
   linkdata = oonf_linkconfig_get(
-      nhdp_interface_get_name(lnk->local_if), &lnk->neigh->originator);
+      nhdp_interface_get_name(lnk->local_if),
+      nhdp_db_neighbor_get_originator(lnk->neigh));
   if (linkdata != NULL
       && linkdata->tx_bitrate != oonf_linkconfig_default.tx_bitrate) {
     OONF_DEBUG(LOG_FF_ETT, "Found IP configured linkspeed");
@@ -362,7 +363,7 @@ _get_linkspeed(struct nhdp_link *lnk) {
   if (lnk->dualstack_partner) {
     linkdata = oonf_linkconfig_get(
         nhdp_interface_get_name(lnk->local_if),
-        &lnk->dualstack_partner->neigh->originator);
+        nhdp_db_neighbor_get_originator(lnk->dualstack_partner->neigh));
     if (linkdata != NULL
         && linkdata->tx_bitrate != oonf_linkconfig_default.tx_bitrate) {
       OONF_DEBUG(LOG_FF_ETT, "Found IP configured linkspeed");
@@ -477,7 +478,8 @@ _cb_ett_sampling(void *ptr __attribute__((unused))) {
 
     OONF_DEBUG(LOG_FF_ETT, "New sampling rate for link %s (%s):"
         " %d/%d = %" PRIu64 " (w=%d, speed=%"PRIu64 ")\n",
-        netaddr_to_string(&buf, &avl_first_element(&lnk->_addresses, laddr, _link_node)->link_addr),
+        netaddr_to_string(&buf, nhdp_db_link_addr_get_netaddr(
+            avl_first_element(&lnk->_addresses, laddr, _link_node))),
         nhdp_interface_get_name(lnk->local_if),
         received, total, metric, ldata->window_size, tx_bitrate);
 
@@ -398,7 +398,8 @@ _cb_etx_sampling(void *ptr __attribute__((unused))) {
     nhdp_domain_set_incoming_metric(_etxff_handler.domain, lnk, metric);
 
     OONF_DEBUG(LOG_FF_ETX, "New sampling rate for link %s (%s): %d/%d = %" PRIu64 " (w=%d)\n",
-        netaddr_to_string(&buf, &avl_first_element(&lnk->_addresses, laddr, _link_node)->link_addr),
+        netaddr_to_string(&buf, nhdp_db_link_addr_get_netaddr(
+            avl_first_element(&lnk->_addresses, laddr, _link_node))),
         nhdp_interface_get_name(lnk->local_if),
         received, total, metric, ldata->window_size);
 
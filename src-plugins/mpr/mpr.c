@@ -0,0 +1,266 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#include "common/common_types.h"
+#include "common/autobuf.h"
+#include "rfc5444/rfc5444_iana.h"
+#include "rfc5444/rfc5444.h"
+
+#include "config/cfg_schema.h"
+#include "core/oonf_cfg.h"
+#include "core/oonf_logging.h"
+#include "core/oonf_plugins.h"
+#include "subsystems/oonf_class.h"
+
+#include "nhdp/nhdp.h"
+#include "nhdp/nhdp_db.h"
+#include "nhdp/nhdp_domain.h"
+
+#include "mpr/mpr.h"
+#include "mpr/mpr_selection.h"
+
+/* Configuration settings of MPR plugin */
+struct _config {
+  /* willingness to become routing and flooding MPR */
+  int willingness;
+
+  /* TLV extension of the domain transporting the flooding MPRs */
+  int flooding_ext;
+};
+
+/* prototypes */
+static int _init(void);
+static void _cleanup(void);
+
+static void _cb_update_routing_mpr(struct nhdp_domain *);
+static void _cb_update_flooding_mpr(struct nhdp_domain *);
+static void _cb_update_neighbor_routing_mpr(
+    struct nhdp_domain *, struct nhdp_neighbor *);
+static void _cb_update_neighbor_flooding_mpr(
+    struct nhdp_domain *, struct nhdp_neighbor *);
+static void _update_mpr(struct nhdp_domain *, bool flooding,
+    struct nhdp_neighbor *);
+static void _cb_neigh_removed(void *);
+
+static void _cb_cfg_changed(void);
+
+/* plugin declaration */
+static struct cfg_schema_entry _mpr_entries[] = {
+  CFG_MAP_INT_MINMAX(_config, willingness, "willingness", "7",
+      "Willingness of the local router to become routing and flooding MPR",
+      RFC5444_WILLINGNESS_NEVER + 1, RFC5444_WILLINGNESS_ALWAYS),
+  CFG_MAP_INT_MINMAX(_config, flooding_ext, "flooding_ext", "0",
+      "TLV extension of the NHDP domain whose metric is used to"
+      " calculate the flooding MPRs", 0, 255),
+};
+
+static struct cfg_schema_section _mpr_section = {
+  .type = OONF_PLUGIN_GET_NAME(),
+  .cb_delta_handler = _cb_cfg_changed,
+  .entries = _mpr_entries,
+  .entry_count = ARRAYSIZE(_mpr_entries),
+};
+
+static struct _config _mpr_config = { 0,0 };
+
+struct oonf_subsystem nhdp_mpr_subsystem = {
+  .name = OONF_PLUGIN_GET_NAME(),
+  .descr = "RFC7181 Appendix B MPR Plugin",
+  .author = "Henning Rogge",
+
+  .cfg_section = &_mpr_section,
+
+  .init = _init,
+  .cleanup = _cleanup,
+};
+DECLARE_OONF_PLUGIN(nhdp_mpr_subsystem);
+
+/* nhdp MPR handler */
+static struct nhdp_domain_mpr _mpr_handler = {
+  .name = OONF_PLUGIN_GET_NAME(),
+
+  .update_mpr = _cb_update_routing_mpr,
+  .update_flooding_mpr = _cb_update_flooding_mpr,
+  .update_neighbor_mpr = _cb_update_neighbor_routing_mpr,
+  .update_neighbor_flooding_mpr = _cb_update_neighbor_flooding_mpr,
+
+  .willingness = RFC5444_WILLINGNESS_DEFAULT,
+  .mpr_start = false,
+  .mprs_start = false,
+};
+
+/* listener for removal of NHDP neighbors */
+static struct oonf_class_extension _neigh_listener = {
+  .name = "mpr",
+  .class_name = NHDP_CLASS_NEIGHBOR,
+
+  .cb_remove = _cb_neigh_removed,
+};
+
+/**
+ * Initialize plugin
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_init(void) {
+  if (nhdp_domain_mpr_add(&_mpr_handler)) {
+    return -1;
+  }
+  if (oonf_class_extension_add(&_neigh_listener)) {
+    nhdp_domain_mpr_remove(&_mpr_handler);
+    return -1;
+  }
+  nhdp_domain_set_flooding_mpr(&_mpr_handler, 0);
+  return 0;
+}
+
+/**
+ * Cleanup plugin
+ */
+static void
+_cleanup(void) {
+  nhdp_domain_set_flooding_mpr(NULL, 0);
+  nhdp_domain_mpr_remove(&_mpr_handler);
+  oonf_class_extension_remove(&_neigh_listener);
+  mpr_selection_cleanup();
+}
+
+/**
+ * Callback triggered when the routing MPRs of a domain have to
+ * be recalculated
+ * @param domain pointer to nhdp domain
+ */
+static void
+_cb_update_routing_mpr(struct nhdp_domain *domain) {
+  _update_mpr(domain, false, NULL);
+}
+
+/**
+ * Callback triggered when the flooding MPRs have to be recalculated
+ * @param domain pointer to nhdp domain transporting the flooding MPRs
+ */
+static void
+_cb_update_flooding_mpr(struct nhdp_domain *domain) {
+  _update_mpr(domain, true, NULL);
+}
+
+/**
+ * Callback triggered when a single neighbor of a domain changed
+ * @param domain pointer to nhdp domain
+ * @param neigh pointer to changed neighbor
+ */
+static void
+_cb_update_neighbor_routing_mpr(struct nhdp_domain *domain,
+    struct nhdp_neighbor *neigh) {
+  _update_mpr(domain, false, neigh);
+}
+
+/**
+ * Callback triggered when a single neighbor changed
+ * @param domain pointer to nhdp domain transporting the flooding MPRs
+ * @param neigh pointer to changed neighbor
+ */
+static void
+_cb_update_neighbor_flooding_mpr(struct nhdp_domain *domain,
+    struct nhdp_neighbor *neigh) {
+  _update_mpr(domain, true, neigh);
+}
+
+/**
+ * Recalculate a MPR set
+ * @param domain pointer to nhdp domain
+ * @param flooding true for flooding MPRs, false for routing MPRs
+ * @param neigh pointer to changed neighbor, NULL to check
+ *   all neighbors
+ */
+static void
+_update_mpr(struct nhdp_domain *domain, bool flooding,
+    struct nhdp_neighbor *neigh) {
+  struct mpr_selection_result result;
+  int error;
+
+  if (neigh != NULL) {
+    error = mpr_selection_update_neighbor(&result, domain, flooding, neigh);
+  }
+  else {
+    error = mpr_selection_calculate(&result, domain, flooding);
+  }
+
+  if (error) {
+    OONF_WARN(LOG_MPR, "Out of memory error for %s MPR calculation",
+        flooding ? "flooding" : "routing");
+    return;
+  }
+
+  if (result.changed) {
+    OONF_DEBUG(LOG_MPR, "Domain %u %s MPRs: %u of %u neighbors cover"
+        " %u two-hop neighbors", domain->ext,
+        flooding ? "flooding" : "routing", result.mprs, result.n1, result.n2);
+  }
+}
+
+/**
+ * Callback triggered when a nhdp neighbor is removed
+ * @param ptr nhdp neighbor
+ */
+static void
+_cb_neigh_removed(void *ptr) {
+  mpr_selection_remove_neighbor(ptr);
+}
+
+/**
+ * Callback triggered when configuration changes
+ */
+static void
+_cb_cfg_changed(void) {
+  if (cfg_schema_tobin(&_mpr_config, _mpr_section.post,
+      _mpr_entries, ARRAYSIZE(_mpr_entries))) {
+    OONF_WARN(LOG_MPR, "Cannot convert configuration for %s",
+        OONF_PLUGIN_GET_NAME());
+    return;
+  }
+
+  _mpr_handler.willingness = _mpr_config.willingness;
+  nhdp_domain_set_flooding_mpr(&_mpr_handler, _mpr_config.flooding_ext);
+
+  /* recalculate all MPR sets */
+  nhdp_domain_neighborhood_changed();
+}
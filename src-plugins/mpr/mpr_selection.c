@@ -0,0 +1,1189 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#include <stdlib.h>
+
+#include "common/avl.h"
+#include "common/avl_comp.h"
+#include "common/common_types.h"
+#include "common/list.h"
+#include "common/netaddr.h"
+#include "rfc5444/rfc5444.h"
+#include "rfc5444/rfc5444_iana.h"
+
+#include "nhdp/nhdp_addr_id.h"
+#include "nhdp/nhdp_db.h"
+#include "nhdp/nhdp_domain.h"
+#include "nhdp/nhdp_interfaces.h"
+
+#include "mpr/mpr_selection.h"
+
+/*
+ * MPR selection heuristic of RFC 7181 Appendix B.
+ *
+ * N1 is the set of symmetric neighbors with a willingness other than
+ * 'never', N2 the set of two-hop addresses reachable through them
+ * which are not better reached directly. Each element x of N2 has to
+ * be covered by a MPR y with d1(y) + d2(y,x) = d(x), the shortest
+ * distance to x over any element of N1.
+ *
+ * Routing MPRs use the incoming metrics (the direction of traffic
+ * towards the local router), flooding MPRs the outgoing ones.
+ *
+ * The sets and the number of MPRs covering each element of N2 are
+ * kept between calculations. A change of a single neighbor only
+ * updates its own connections and repairs the coverage of the
+ * two-hop neighbors it affected. The nhdp database has already
+ * removed outdated two-hop entries at this point, so the changes
+ * are found by comparing the neighbor with its stored connections.
+ */
+
+/* connection of an element of N1 to an element of N2 */
+struct _n1_link {
+  /* element of N2 */
+  struct _n2_entry *x;
+
+  /* d(y,x) */
+  uint64_t d;
+};
+
+/* connection of an element of N2 to an element of N1 */
+struct _n2_link {
+  /* element of N1 */
+  struct _n1_entry *y;
+
+  /* d(y,x) */
+  uint64_t d;
+};
+
+/* symmetric neighbor, element of N1 if willing */
+struct _n1_entry {
+  /* pointer to nhdp neighbor */
+  struct nhdp_neighbor *neigh;
+
+  /* d1(y) */
+  uint64_t d1;
+
+  /* willingness of neighbor */
+  uint8_t willingness;
+
+  /* true if neighbor is an element of N1 */
+  bool willing;
+
+  /* true if neighbor has been selected as MPR */
+  bool mpr;
+
+  /* connections to two-hop neighbors, sorted by address id */
+  struct _n1_link *links;
+  uint32_t link_count, link_size;
+
+  /* true if the MPR flag of the neighbor might have changed */
+  bool _touched;
+
+  /* member of list of touched neighbors */
+  struct list_entity _touched_node;
+
+  /* member of tree of neighbors, key is the neighbor pointer */
+  struct avl_node _node;
+};
+
+/* two-hop neighbor, element of N2 if required */
+struct _n2_entry {
+  /* interned address of two-hop neighbor */
+  uint32_t addr_id;
+
+  /* d(x) */
+  uint64_t d;
+
+  /* true if the two-hop neighbor has to be covered by a MPR */
+  bool required;
+
+  /* number of elements of N1 with d(y,x) = d(x) */
+  uint32_t candidates;
+
+  /* number of selected MPRs with d(y,x) = d(x) */
+  uint32_t covered;
+
+  /* connections to neighbors, unsorted */
+  struct _n2_link *links;
+  uint32_t link_count, link_size;
+
+  /* true if the coverage of the two-hop neighbor has to be checked */
+  bool _affected;
+
+  /* member of list of affected two-hop neighbors */
+  struct list_entity _affected_node;
+
+  /* member of tree of two-hop neighbors, key is addr_id */
+  struct avl_node _node;
+};
+
+/* MPR selection state of one routing or flooding MPR set */
+struct _mpr_set {
+  /* domain of the MPR set */
+  struct nhdp_domain *domain;
+
+  /* true for the flooding MPR set */
+  bool flooding;
+
+  /* true if a complete selection has been done */
+  bool calculated;
+
+  /* tree of symmetric neighbors */
+  struct avl_tree n1;
+
+  /* tree of two-hop neighbors */
+  struct avl_tree n2;
+
+  /* two-hop neighbors changed by the current update */
+  struct list_entity affected;
+
+  /* neighbors whose MPR flag might have changed */
+  struct list_entity touched;
+
+  /* size of N1 */
+  uint32_t willing;
+
+  /* size of N2 */
+  uint32_t required;
+
+  /* number of elements of N2 without MPR */
+  uint32_t uncovered;
+
+  /* number of selected MPRs */
+  uint32_t mprs;
+};
+
+/* address id and distance of a new two-hop connection */
+struct _connection {
+  uint32_t addr_id;
+  uint64_t d;
+};
+
+static struct _mpr_set *_get_set(struct nhdp_domain *domain, bool flooding);
+static void _reset_set(struct _mpr_set *set);
+static int _update_neighbor(struct _mpr_set *set,
+    struct nhdp_neighbor *neigh, bool removed);
+static int _collect_connections(struct _mpr_set *set,
+    struct nhdp_neighbor *neigh, uint64_t d1);
+static bool _has_same_connections(struct _n1_entry *y);
+static struct _n2_entry *_add_n2_entry(struct _mpr_set *set, uint32_t addr_id);
+static void _remove_n2_link(struct _n2_entry *x, struct _n1_entry *y);
+static void _recount(struct _mpr_set *set, struct _n2_entry *x);
+static bool _is_required(struct _mpr_set *set, struct _n2_entry *x);
+static void _select_all(struct _mpr_set *set);
+static void _repair(struct _mpr_set *set);
+static bool _is_better(struct _n1_entry *y, uint32_t reachability,
+    struct _n1_entry *best, uint32_t best_reachability);
+static uint32_t _get_reachability(struct _n1_entry *y);
+static uint32_t _get_degree(struct _n1_entry *y);
+static bool _is_redundant(struct _n1_entry *y);
+static void _set_mpr(struct _mpr_set *set, struct _n1_entry *y, bool mpr);
+static void _mark_affected(struct _mpr_set *set, struct _n2_entry *x);
+static void _finish(struct _mpr_set *set,
+    struct mpr_selection_result *result);
+static uint64_t _get_neighbor_distance(struct _mpr_set *set,
+    struct nhdp_neighbor *neigh);
+static int _avl_comp_pointer(const void *k1, const void *k2);
+static int _compare_connections(const void *p1, const void *p2);
+static int _grow(void **array, uint32_t *size, uint32_t count, size_t elem);
+
+/* MPR sets of all domains, the flooding set follows the routing set */
+static struct _mpr_set **_sets;
+static uint32_t _set_count, _set_size;
+
+/* working memory for the connections of a changed neighbor */
+static struct _connection *_connections;
+static uint32_t _connection_count, _connection_size;
+
+/* neighbor which is currently removed from the nhdp database */
+static struct nhdp_neighbor *_removed_neighbor;
+
+/**
+ * Calculate the routing or flooding MPR set of a domain and store
+ * it in the nhdp database. The complete selection is only done
+ * again if the neighborhood changed.
+ * @param result pointer to result of calculation
+ * @param domain pointer to nhdp domain
+ * @param flooding true to calculate the flooding MPRs, false for
+ *   the routing MPRs of the domain
+ * @return -1 if out of memory, 0 otherwise
+ */
+int
+mpr_selection_calculate(struct mpr_selection_result *result,
+    struct nhdp_domain *domain, bool flooding) {
+  struct _mpr_set *set;
+  struct nhdp_neighbor *neigh;
+  bool changed;
+  int update;
+
+  memset(result, 0, sizeof(*result));
+  set = _get_set(domain, flooding);
+  if (set == NULL) {
+    return -1;
+  }
+
+  changed = !set->calculated;
+  list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
+    update = _update_neighbor(set, neigh, false);
+    if (update < 0) {
+      _reset_set(set);
+      return -1;
+    }
+    if (update > 0) {
+      changed = true;
+    }
+  }
+
+  if (changed) {
+    _select_all(set);
+    set->calculated = true;
+  }
+
+  _finish(set, result);
+  return 0;
+}
+
+/**
+ * Update the routing or flooding MPR set of a domain after a
+ * change of a single neighbor and store it in the nhdp database
+ * @param result pointer to result of calculation
+ * @param domain pointer to nhdp domain
+ * @param flooding true for the flooding MPRs, false for
+ *   the routing MPRs of the domain
+ * @param neigh pointer to changed neighbor
+ * @return -1 if out of memory, 0 otherwise
+ */
+int
+mpr_selection_update_neighbor(struct mpr_selection_result *result,
+    struct nhdp_domain *domain, bool flooding, struct nhdp_neighbor *neigh) {
+  struct _mpr_set *set;
+  int update;
+
+  set = _get_set(domain, flooding);
+  if (set == NULL) {
+    memset(result, 0, sizeof(*result));
+    return -1;
+  }
+  if (!set->calculated) {
+    return mpr_selection_calculate(result, domain, flooding);
+  }
+
+  memset(result, 0, sizeof(*result));
+
+  update = _update_neighbor(set, neigh, false);
+  if (update < 0) {
+    _reset_set(set);
+    return -1;
+  }
+  if (update > 0) {
+    _repair(set);
+  }
+
+  _finish(set, result);
+  return 0;
+}
+
+/**
+ * Remove a neighbor from all MPR sets before it is removed from
+ * the nhdp database
+ * @param neigh pointer to nhdp neighbor
+ */
+void
+mpr_selection_remove_neighbor(struct nhdp_neighbor *neigh) {
+  struct mpr_selection_result result;
+  struct _mpr_set *set;
+  struct _n1_entry *y;
+  uint32_t i;
+
+  _removed_neighbor = neigh;
+  for (i=0; i<_set_count; i++) {
+    set = _sets[i];
+    if (set == NULL || !set->calculated) {
+      continue;
+    }
+
+    y = avl_find_element(&set->n1, neigh, y, _node);
+    if (y == NULL) {
+      continue;
+    }
+
+    /* removing the connections needs no memory */
+    memset(&result, 0, sizeof(result));
+    _update_neighbor(set, neigh, true);
+    _repair(set);
+    _finish(set, &result);
+
+    avl_remove(&set->n1, &y->_node);
+    free(y->links);
+    free(y);
+  }
+  _removed_neighbor = NULL;
+}
+
+/**
+ * Free all stored MPR sets and the working memory of the selection
+ */
+void
+mpr_selection_cleanup(void) {
+  uint32_t i;
+
+  for (i=0; i<_set_count; i++) {
+    if (_sets[i] != NULL) {
+      _reset_set(_sets[i]);
+      free(_sets[i]);
+    }
+  }
+  free(_sets);
+  _sets = NULL;
+  _set_count = _set_size = 0;
+
+  free(_connections);
+  _connections = NULL;
+  _connection_count = _connection_size = 0;
+}
+
+/**
+ * Get the stored MPR set of a domain, the array of sets grows
+ * with the number of nhdp domains
+ * @param domain pointer to nhdp domain
+ * @param flooding true for flooding MPRs
+ * @return pointer to stored MPR set, NULL if out of memory
+ */
+static struct _mpr_set *
+_get_set(struct nhdp_domain *domain, bool flooding) {
+  struct _mpr_set *set;
+  uint32_t idx, count;
+
+  idx = domain->index * 2 + (flooding ? 1 : 0);
+  if (idx >= _set_count) {
+    count = nhdp_domain_get_count() * 2;
+    if (count <= idx) {
+      count = idx + 1;
+    }
+    if (_grow((void **)&_sets, &_set_size, count, sizeof(*_sets))) {
+      return NULL;
+    }
+    memset(&_sets[_set_count], 0, (count - _set_count) * sizeof(*_sets));
+    _set_count = count;
+  }
+
+  set = _sets[idx];
+  if (set == NULL) {
+    set = calloc(1, sizeof(*set));
+    if (set == NULL) {
+      return NULL;
+    }
+    avl_init(&set->n1, _avl_comp_pointer, false);
+    avl_init(&set->n2, avl_comp_uint32, false);
+    list_init_head(&set->affected);
+    list_init_head(&set->touched);
+    _sets[idx] = set;
+  }
+  set->domain = domain;
+  set->flooding = flooding;
+  return set;
+}
+
+/**
+ * Remove all neighbors and two-hop neighbors from a MPR set,
+ * the next calculation will be a complete one.
+ * @param set pointer to MPR set
+ */
+static void
+_reset_set(struct _mpr_set *set) {
+  struct _n1_entry *y, *y_it;
+  struct _n2_entry *x, *x_it;
+
+  avl_for_each_element_safe(&set->n1, y, _node, y_it) {
+    avl_remove(&set->n1, &y->_node);
+    free(y->links);
+    free(y);
+  }
+  avl_for_each_element_safe(&set->n2, x, _node, x_it) {
+    avl_remove(&set->n2, &x->_node);
+    nhdp_addr_id_release(x->addr_id);
+    free(x->links);
+    free(x);
+  }
+
+  list_init_head(&set->affected);
+  list_init_head(&set->touched);
+  set->calculated = false;
+  set->willing = 0;
+  set->required = 0;
+  set->uncovered = 0;
+  set->mprs = 0;
+}
+
+/**
+ * Compare a neighbor with its stored state and update the
+ * connections of the MPR set if it changed. All two-hop neighbors
+ * whose coverage might have changed are marked as affected.
+ * @param set pointer to MPR set
+ * @param neigh pointer to nhdp neighbor
+ * @param removed true if the neighbor is removed from the database
+ * @return -1 if out of memory, 0 if the neighbor did not change,
+ *   1 if it changed
+ */
+static int
+_update_neighbor(struct _mpr_set *set,
+    struct nhdp_neighbor *neigh, bool removed) {
+  struct nhdp_naddr *naddr;
+  struct _n1_entry *y;
+  struct _n2_entry *x;
+  uint8_t willingness;
+  uint64_t d1;
+  bool willing, was_mpr;
+  uint32_t i;
+
+  y = avl_find_element(&set->n1, neigh, y, _node);
+  if (y == NULL) {
+    if (removed || neigh->symmetric == 0) {
+      return 0;
+    }
+
+    y = calloc(1, sizeof(*y));
+    if (y == NULL) {
+      return -1;
+    }
+    y->neigh = neigh;
+    y->d1 = RFC5444_METRIC_INFINITE;
+    y->_node.key = neigh;
+    avl_insert(&set->n1, &y->_node);
+  }
+
+  willingness = RFC5444_WILLINGNESS_NEVER;
+  d1 = RFC5444_METRIC_INFINITE;
+  _connection_count = 0;
+
+  if (!removed && neigh->symmetric > 0) {
+    willingness = set->flooding ? neigh->flooding_willingness
+        : nhdp_domain_get_neighbordata(set->domain, neigh)->willingness;
+    d1 = _get_neighbor_distance(set, neigh);
+    if (_collect_connections(set, neigh, d1)) {
+      return -1;
+    }
+  }
+  willing = willingness != RFC5444_WILLINGNESS_NEVER
+      && d1 < RFC5444_METRIC_INFINITE;
+
+  if (willing == y->willing && willingness == y->willingness
+      && d1 == y->d1 && _has_same_connections(y)) {
+    /* the usual case, a HELLO without changes */
+    return 0;
+  }
+
+  if (_grow((void **)&y->links, &y->link_size,
+      _connection_count, sizeof(*y->links))) {
+    return -1;
+  }
+
+  was_mpr = y->mpr;
+  _set_mpr(set, y, false);
+
+  /* remove old connections */
+  for (i=0; i<y->link_count; i++) {
+    _mark_affected(set, y->links[i].x);
+    _remove_n2_link(y->links[i].x, y);
+  }
+
+  if (y->willing != willing) {
+    if (willing) {
+      set->willing++;
+    }
+    else {
+      set->willing--;
+    }
+  }
+  y->willing = willing;
+  y->willingness = willingness;
+  y->d1 = d1;
+
+  /* add new connections */
+  y->link_count = 0;
+  for (i=0; i<_connection_count; i++) {
+    x = avl_find_element(&set->n2, &_connections[i].addr_id, x, _node);
+    if (x == NULL) {
+      x = _add_n2_entry(set, _connections[i].addr_id);
+    }
+    if (x == NULL || _grow((void **)&x->links, &x->link_size,
+        x->link_count + 1, sizeof(*x->links))) {
+      return -1;
+    }
+
+    x->links[x->link_count].y = y;
+    x->links[x->link_count].d = _connections[i].d;
+    x->link_count++;
+
+    y->links[y->link_count].x = x;
+    y->links[y->link_count].d = _connections[i].d;
+    y->link_count++;
+
+    _mark_affected(set, x);
+  }
+
+  /* the addresses of the neighbor might need a MPR now or not anymore */
+  avl_for_each_element(&neigh->_neigh_addresses, naddr, _neigh_node) {
+    x = avl_find_element(&set->n2, &naddr->neigh_addr_id, x, _node);
+    if (x != NULL) {
+      _mark_affected(set, x);
+    }
+  }
+
+  list_for_each_element(&set->affected, x, _affected_node) {
+    _recount(set, x);
+  }
+
+  if (willing && (was_mpr || willingness == RFC5444_WILLINGNESS_ALWAYS)) {
+    /* keep the MPR, the repair will remove it if it is redundant */
+    _set_mpr(set, y, true);
+  }
+  return 1;
+}
+
+/**
+ * Collect the sorted connections of a neighbor to its two-hop
+ * neighbors in the working memory
+ * @param set pointer to MPR set
+ * @param neigh pointer to nhdp neighbor
+ * @param d1 d1(y) of the neighbor
+ * @return -1 if out of memory, 0 otherwise
+ */
+static int
+_collect_connections(struct _mpr_set *set,
+    struct nhdp_neighbor *neigh, uint64_t d1) {
+  struct nhdp_link *lnk;
+  struct nhdp_l2hop *l2hop;
+  struct nhdp_l2hop_domaindata *l2data;
+  uint32_t count, i;
+  uint64_t d2;
+
+  if (d1 >= RFC5444_METRIC_INFINITE) {
+    return 0;
+  }
+
+  count = 0;
+  list_for_each_element(&neigh->_links, lnk, _neigh_node) {
+    count += lnk->_2hop.count;
+  }
+  if (_grow((void **)&_connections, &_connection_size,
+      count, sizeof(*_connections))) {
+    return -1;
+  }
+
+  list_for_each_element(&neigh->_links, lnk, _neigh_node) {
+    if (lnk->status != NHDP_LINK_SYMMETRIC) {
+      continue;
+    }
+
+    avl_for_each_element(&lnk->_2hop, l2hop, _link_node) {
+      l2data = nhdp_domain_get_l2hopdata(set->domain, l2hop);
+      d2 = set->flooding ? l2data->metric.out : l2data->metric.in;
+      if (d2 >= RFC5444_METRIC_INFINITE) {
+        continue;
+      }
+
+      _connections[_connection_count].addr_id = l2hop->twohop_addr_id;
+      _connections[_connection_count].d = d1 + d2;
+      _connection_count++;
+    }
+  }
+
+  if (_connection_count < 2) {
+    return 0;
+  }
+
+  /* sort by address and keep the best connection over multiple links */
+  qsort(_connections, _connection_count, sizeof(*_connections),
+      _compare_connections);
+
+  count = 1;
+  for (i=1; i<_connection_count; i++) {
+    if (_connections[i].addr_id != _connections[count-1].addr_id) {
+      _connections[count++] = _connections[i];
+    }
+    else if (_connections[i].d < _connections[count-1].d) {
+      _connections[count-1].d = _connections[i].d;
+    }
+  }
+  _connection_count = count;
+  return 0;
+}
+
+/**
+ * @param y pointer to neighbor
+ * @return true if the stored connections of the neighbor are the
+ *   same as the ones in the working memory
+ */
+static bool
+_has_same_connections(struct _n1_entry *y) {
+  uint32_t i;
+
+  if (y->link_count != _connection_count) {
+    return false;
+  }
+  for (i=0; i<_connection_count; i++) {
+    if (y->links[i].x->addr_id != _connections[i].addr_id
+        || y->links[i].d != _connections[i].d) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Add a new two-hop neighbor to a MPR set
+ * @param set pointer to MPR set
+ * @param addr_id interned address of two-hop neighbor
+ * @return pointer to new two-hop neighbor, NULL if out of memory
+ */
+static struct _n2_entry *
+_add_n2_entry(struct _mpr_set *set, uint32_t addr_id) {
+  struct _n2_entry *x;
+
+  x = calloc(1, sizeof(*x));
+  if (x == NULL) {
+    return NULL;
+  }
+
+  /* keep the address id even if the nhdp database drops it */
+  x->addr_id = nhdp_addr_id_acquire(nhdp_addr_id_get_netaddr(addr_id));
+  if (x->addr_id == NHDP_ADDR_ID_NONE) {
+    free(x);
+    return NULL;
+  }
+
+  x->d = UINT64_MAX;
+  x->_node.key = &x->addr_id;
+  avl_insert(&set->n2, &x->_node);
+  return x;
+}
+
+/**
+ * Remove the connection of a two-hop neighbor to a neighbor
+ * @param x pointer to two-hop neighbor
+ * @param y pointer to neighbor
+ */
+static void
+_remove_n2_link(struct _n2_entry *x, struct _n1_entry *y) {
+  uint32_t i;
+
+  for (i=0; i<x->link_count; i++) {
+    if (x->links[i].y == y) {
+      x->links[i] = x->links[--x->link_count];
+      return;
+    }
+  }
+}
+
+/**
+ * Calculate d(x) of a two-hop neighbor, check if it has to be
+ * covered and count its candidates and MPRs
+ * @param set pointer to MPR set
+ * @param x pointer to two-hop neighbor
+ */
+static void
+_recount(struct _mpr_set *set, struct _n2_entry *x) {
+  struct _n2_link *l;
+  uint32_t i;
+  uint64_t d;
+
+  if (x->required) {
+    set->required--;
+    if (x->covered == 0) {
+      set->uncovered--;
+    }
+  }
+
+  d = UINT64_MAX;
+  for (i=0; i<x->link_count; i++) {
+    l = &x->links[i];
+    if (l->y->willing && l->d < d) {
+      d = l->d;
+    }
+  }
+
+  x->d = d;
+  x->candidates = 0;
+  x->covered = 0;
+  x->required = d != UINT64_MAX && _is_required(set, x);
+  if (!x->required) {
+    return;
+  }
+
+  for (i=0; i<x->link_count; i++) {
+    l = &x->links[i];
+    if (l->y->willing && l->d == d) {
+      x->candidates++;
+      if (l->y->mpr) {
+        x->covered++;
+      }
+    }
+  }
+
+  set->required++;
+  if (x->covered == 0) {
+    set->uncovered++;
+  }
+}
+
+/**
+ * @param set pointer to MPR set
+ * @param x pointer to two-hop neighbor with calculated d(x)
+ * @return true if the two-hop neighbor is an element of N2
+ */
+static bool
+_is_required(struct _mpr_set *set, struct _n2_entry *x) {
+  const struct netaddr *addr;
+  struct nhdp_naddr *naddr;
+
+  addr = nhdp_addr_id_get_netaddr(x->addr_id);
+
+  /* local addresses need no MPR */
+  if (nhdp_interface_addr_global_get(addr) != NULL) {
+    return false;
+  }
+
+  /* symmetric neighbors need no MPR if the direct link is better */
+  naddr = avl_find_element(&nhdp_naddr_tree, &x->addr_id, naddr, _global_node);
+  if (naddr != NULL && !nhdp_db_neighbor_addr_is_lost(naddr)
+      && naddr->neigh != _removed_neighbor
+      && naddr->neigh->symmetric > 0
+      && _get_neighbor_distance(set, naddr->neigh) <= x->d) {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Select the MPRs out of the complete N1
+ * @param set pointer to MPR set
+ */
+static void
+_select_all(struct _mpr_set *set) {
+  struct _n1_entry *y, *best;
+  struct _n2_entry *x;
+  uint32_t i, reachability, best_reachability;
+  uint8_t w;
+
+  avl_for_each_element(&set->n1, y, _node) {
+    _set_mpr(set, y, false);
+  }
+
+  /* neighbors which are always willing */
+  avl_for_each_element(&set->n1, y, _node) {
+    if (y->willing && y->willingness == RFC5444_WILLINGNESS_ALWAYS) {
+      _set_mpr(set, y, true);
+    }
+  }
+
+  /* neighbors which are the only option for a two-hop neighbor */
+  avl_for_each_element(&set->n2, x, _node) {
+    if (x->required && x->covered == 0 && x->candidates == 1) {
+      for (i=0; i<x->link_count; i++) {
+        if (x->links[i].y->willing && x->links[i].d == x->d) {
+          _set_mpr(set, x->links[i].y, true);
+        }
+      }
+    }
+  }
+
+  /* greedy cover of the rest of N2 */
+  while (set->uncovered > 0) {
+    best = NULL;
+    best_reachability = 0;
+
+    avl_for_each_element(&set->n1, y, _node) {
+      if (!y->willing || y->mpr) {
+        continue;
+      }
+
+      reachability = _get_reachability(y);
+      if (_is_better(y, reachability, best, best_reachability)) {
+        best = y;
+        best_reachability = reachability;
+      }
+    }
+
+    if (best == NULL) {
+      /* cannot happen, every required element has a candidate */
+      break;
+    }
+    _set_mpr(set, best, true);
+  }
+
+  /* remove redundant MPRs, least willing first */
+  for (w=RFC5444_WILLINGNESS_NEVER+1; w<RFC5444_WILLINGNESS_ALWAYS; w++) {
+    avl_for_each_element(&set->n1, y, _node) {
+      if (y->mpr && y->willingness == w && _is_redundant(y)) {
+        _set_mpr(set, y, false);
+      }
+    }
+  }
+}
+
+/**
+ * Restore the coverage of the affected two-hop neighbors after
+ * a change of a neighbor
+ * @param set pointer to MPR set
+ */
+static void
+_repair(struct _mpr_set *set) {
+  struct _n1_entry *y, *best;
+  struct _n2_entry *x;
+  uint32_t i, reachability, best_reachability;
+
+  /* neighbors which are the only option for a two-hop neighbor */
+  list_for_each_element(&set->affected, x, _affected_node) {
+    if (x->required && x->covered == 0 && x->candidates == 1) {
+      for (i=0; i<x->link_count; i++) {
+        if (x->links[i].y->willing && x->links[i].d == x->d) {
+          _set_mpr(set, x->links[i].y, true);
+        }
+      }
+    }
+  }
+
+  /* greedy cover, only the candidates of uncovered elements matter */
+  while (set->uncovered > 0) {
+    best = NULL;
+    best_reachability = 0;
+
+    list_for_each_element(&set->affected, x, _affected_node) {
+      if (!x->required || x->covered > 0) {
+        continue;
+      }
+
+      for (i=0; i<x->link_count; i++) {
+        y = x->links[i].y;
+        if (!y->willing || y->mpr || x->links[i].d != x->d || y == best) {
+          continue;
+        }
+
+        reachability = _get_reachability(y);
+        if (_is_better(y, reachability, best, best_reachability)) {
+          best = y;
+          best_reachability = reachability;
+        }
+      }
+    }
+
+    if (best == NULL) {
+      /* cannot happen, every required element has a candidate */
+      break;
+    }
+    _set_mpr(set, best, true);
+  }
+
+  /* remove MPRs which are not necessary anymore around the change */
+  list_for_each_element(&set->affected, x, _affected_node) {
+    for (i=0; i<x->link_count; i++) {
+      y = x->links[i].y;
+      if (y->mpr && y->willingness != RFC5444_WILLINGNESS_ALWAYS
+          && _is_redundant(y)) {
+        _set_mpr(set, y, false);
+      }
+    }
+  }
+}
+
+/**
+ * Compare a MPR candidate with the best one so far, by willingness,
+ * R(y) and D(y)
+ * @param y pointer to candidate
+ * @param reachability R(y) of candidate
+ * @param best pointer to best candidate, NULL if none
+ * @param best_reachability R(y) of best candidate
+ * @return true if the candidate is better
+ */
+static bool
+_is_better(struct _n1_entry *y, uint32_t reachability,
+    struct _n1_entry *best, uint32_t best_reachability) {
+  if (reachability == 0) {
+    return false;
+  }
+  if (best == NULL || y->willingness != best->willingness) {
+    return best == NULL || y->willingness > best->willingness;
+  }
+  if (reachability != best_reachability) {
+    return reachability > best_reachability;
+  }
+  return _get_degree(y) > _get_degree(best);
+}
+
+/**
+ * @param y pointer to element of N1
+ * @return R(y), number of uncovered elements of N2 y would cover
+ */
+static uint32_t
+_get_reachability(struct _n1_entry *y) {
+  struct _n1_link *l;
+  uint32_t i, reachability;
+
+  reachability = 0;
+  for (i=0; i<y->link_count; i++) {
+    l = &y->links[i];
+    if (l->x->required && l->x->covered == 0 && l->d == l->x->d) {
+      reachability++;
+    }
+  }
+  return reachability;
+}
+
+/**
+ * @param y pointer to element of N1
+ * @return D(y), number of elements of N2 y is a candidate for
+ */
+static uint32_t
+_get_degree(struct _n1_entry *y) {
+  struct _n1_link *l;
+  uint32_t i, degree;
+
+  degree = 0;
+  for (i=0; i<y->link_count; i++) {
+    l = &y->links[i];
+    if (l->x->required && l->d == l->x->d) {
+      degree++;
+    }
+  }
+  return degree;
+}
+
+/**
+ * @param y pointer to element of N1 selected as MPR
+ * @return true if all elements of N2 covered by y are covered
+ *   by another MPR too
+ */
+static bool
+_is_redundant(struct _n1_entry *y) {
+  struct _n1_link *l;
+  uint32_t i;
+
+  for (i=0; i<y->link_count; i++) {
+    l = &y->links[i];
+    if (l->x->required && l->d == l->x->d && l->x->covered < 2) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Select or unselect a neighbor as MPR and update the coverage
+ * of its two-hop neighbors
+ * @param set pointer to MPR set
+ * @param y pointer to neighbor
+ * @param mpr true to select neighbor as MPR
+ */
+static void
+_set_mpr(struct _mpr_set *set, struct _n1_entry *y, bool mpr) {
+  struct _n1_link *l;
+  uint32_t i;
+
+  if (y->mpr == mpr) {
+    return;
+  }
+
+  y->mpr = mpr;
+  if (mpr) {
+    set->mprs++;
+  }
+  else {
+    set->mprs--;
+  }
+
+  for (i=0; i<y->link_count; i++) {
+    l = &y->links[i];
+    if (!l->x->required || l->d != l->x->d) {
+      continue;
+    }
+
+    if (mpr) {
+      if (l->x->covered++ == 0) {
+        set->uncovered--;
+      }
+    }
+    else if (--l->x->covered == 0) {
+      set->uncovered++;
+    }
+  }
+
+  if (!y->_touched) {
+    y->_touched = true;
+    list_add_tail(&set->touched, &y->_touched_node);
+  }
+}
+
+/**
+ * Mark a two-hop neighbor as affected by the current update
+ * @param set pointer to MPR set
+ * @param x pointer to two-hop neighbor
+ */
+static void
+_mark_affected(struct _mpr_set *set, struct _n2_entry *x) {
+  if (!x->_affected) {
+    x->_affected = true;
+    list_add_tail(&set->affected, &x->_affected_node);
+  }
+}
+
+/**
+ * Store the MPR flags of all touched neighbors in the nhdp database,
+ * remove unused two-hop neighbors and fill the result of the update
+ * @param set pointer to MPR set
+ * @param result pointer to result
+ */
+static void
+_finish(struct _mpr_set *set, struct mpr_selection_result *result) {
+  struct _n1_entry *y, *y_it;
+  struct _n2_entry *x, *x_it;
+  bool *flag;
+
+  list_for_each_element_safe(&set->touched, y, _touched_node, y_it) {
+    list_remove(&y->_touched_node);
+    y->_touched = false;
+
+    if (set->flooding) {
+      flag = &y->neigh->neigh_is_flooding_mpr;
+    }
+    else {
+      flag = &nhdp_domain_get_neighbordata(set->domain, y->neigh)->neigh_is_mpr;
+    }
+    if (*flag != y->mpr) {
+      *flag = y->mpr;
+      result->changed = true;
+    }
+  }
+
+  list_for_each_element_safe(&set->affected, x, _affected_node, x_it) {
+    list_remove(&x->_affected_node);
+    x->_affected = false;
+    result->checked++;
+
+    if (x->link_count == 0) {
+      avl_remove(&set->n2, &x->_node);
+      nhdp_addr_id_release(x->addr_id);
+      free(x->links);
+      free(x);
+    }
+  }
+
+  result->n1 = set->willing;
+  result->n2 = set->required;
+  result->mprs = set->mprs;
+}
+
+/**
+ * @param set pointer to MPR set
+ * @param neigh pointer to nhdp neighbor
+ * @return d1 of the neighbor
+ */
+static uint64_t
+_get_neighbor_distance(struct _mpr_set *set, struct nhdp_neighbor *neigh) {
+  struct nhdp_neighbor_domaindata *data;
+
+  data = nhdp_domain_get_neighbordata(set->domain, neigh);
+  return set->flooding ? data->metric.out : data->metric.in;
+}
+
+/**
+ * AVL comparator for pointers
+ * @param k1 first pointer
+ * @param k2 second pointer
+ * @return -1 if k1 < k2, 1 if k1 > k2, 0 otherwise
+ */
+static int
+_avl_comp_pointer(const void *k1, const void *k2) {
+  if (k1 < k2) {
+    return -1;
+  }
+  return k1 > k2 ? 1 : 0;
+}
+
+/**
+ * qsort comparator for connections, sorted by address id
+ * @param p1 pointer to first connection
+ * @param p2 pointer to second connection
+ * @return -1 if p1 < p2, 1 if p1 > p2, 0 otherwise
+ */
+static int
+_compare_connections(const void *p1, const void *p2) {
+  const struct _connection *c1 = p1, *c2 = p2;
+
+  if (c1->addr_id < c2->addr_id) {
+    return -1;
+  }
+  return c1->addr_id > c2->addr_id ? 1 : 0;
+}
+
+/**
+ * Make sure an array has room for a number of elements
+ * @param array pointer to array pointer
+ * @param size pointer to number of allocated elements
+ * @param count number of necessary elements
+ * @param elem size of an element
+ * @return -1 if out of memory, 0 otherwise
+ */
+static int
+_grow(void **array, uint32_t *size, uint32_t count, size_t elem) {
+  void *ptr;
+  uint32_t new_size;
+
+  if (count <= *size) {
+    return 0;
+  }
+
+  /* grow geometrically, neighbor connections are updated often */
+  new_size = *size * 2;
+  if (new_size < count) {
+    new_size = count;
+  }
+
+  ptr = realloc(*array, new_size * elem);
+  if (ptr == NULL) {
+    return -1;
+  }
+
+  *array = ptr;
+  *size = new_size;
+  return 0;
+}
@@ -0,0 +1,74 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#ifndef MPR_SELECTION_H_
+#define MPR_SELECTION_H_
+
+#include "common/common_types.h"
+
+#include "nhdp/nhdp_domain.h"
+
+/* result of a MPR calculation */
+struct mpr_selection_result {
+  /* number of symmetric neighbors willing to become MPR */
+  uint32_t n1;
+
+  /* number of two-hop neighbors which have to be covered */
+  uint32_t n2;
+
+  /* number of selected MPRs */
+  uint32_t mprs;
+
+  /* number of two-hop neighbors whose coverage has been checked */
+  uint32_t checked;
+
+  /* true if the MPR set changed */
+  bool changed;
+};
+
+int mpr_selection_calculate(struct mpr_selection_result *result,
+    struct nhdp_domain *domain, bool flooding);
+int mpr_selection_update_neighbor(struct mpr_selection_result *result,
+    struct nhdp_domain *domain, bool flooding, struct nhdp_neighbor *neigh);
+void mpr_selection_remove_neighbor(struct nhdp_neighbor *neigh);
+void mpr_selection_cleanup(void);
+
+#endif /* MPR_SELECTION_H_ */
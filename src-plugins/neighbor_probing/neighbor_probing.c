@@ -226,6 +226,7 @@ _cb_probe_link(void *ptr __attribute__((unused))) {
 
   struct oonf_interface *interf;
   struct oonf_layer2_neighbor *l2neigh;
+  struct netaddr dst;
 
   uint64_t points, best_points;
   uint64_t last_tx_packets;
@@ -277,7 +278,7 @@ _cb_probe_link(void *ptr __attribute__((unused))) {
       points = oonf_clock_getNow() - ldata->last_probe_check;
 
       OONF_DEBUG(LOG_PROBING, "Link %s has %" PRIu64 " points",
-          netaddr_to_string(&nbuf, &lnk->if_addr), points);
+          netaddr_to_string(&nbuf, nhdp_db_link_get_ifaddr(lnk)), points);
 
       if (points > best_points) {
         best_points = points;
@@ -291,9 +292,10 @@ _cb_probe_link(void *ptr __attribute__((unused))) {
     best_ldata->last_probe_check = oonf_clock_getNow();
 
     if (best_ldata->target == NULL
-        && netaddr_get_address_family(&best_lnk->if_addr) != AF_UNSPEC) {
+        && best_lnk->if_addr_id != NHDP_ADDR_ID_NONE) {
+      memcpy(&dst, nhdp_db_link_get_ifaddr(best_lnk), sizeof(dst));
       best_ldata->target = oonf_rfc5444_add_target(
-          best_lnk->local_if->rfc5444_if.interface, &best_lnk->if_addr);
+          best_lnk->local_if->rfc5444_if.interface, &dst);
     }
 
     if (best_ldata->target) {
@@ -49,10 +49,12 @@
 #include "subsystems/oonf_telnet.h"
 #endif
 
+#include "nhdp/nhdp_addr_id.h"
 #include "nhdp/nhdp_hysteresis.h"
 #include "nhdp/nhdp_interfaces.h"
 #include "nhdp/nhdp_domain.h"
 #include "nhdp/nhdp_reader.h"
+#include "nhdp/nhdp_timer_wheel.h"
 #include "nhdp/nhdp_writer.h"
 #include "nhdp/nhdp.h"
 
@@ -76,6 +78,7 @@ static enum oonf_telnet_result _telnet_nhdp_neighbor(struct oonf_telnet_data *co
 static enum oonf_telnet_result _telnet_nhdp_neighlink(struct oonf_telnet_data *con);
 static enum oonf_telnet_result _telnet_nhdp_iflink(struct oonf_telnet_data *con);
 static enum oonf_telnet_result _telnet_nhdp_interface(struct oonf_telnet_data *con);
+static enum oonf_telnet_result _telnet_nhdp_stats(struct oonf_telnet_data *con);
 #endif
 
 static void _cb_cfg_domain_changed(void);
@@ -91,7 +94,8 @@ static struct oonf_telnet_command _cmds[] = {
         "\"nhdp iflink\": shows all nhdp links sorted by interfaces including interface and 2-hop neighbor addresses\n"
         "\"nhdp neighlink\": shows all nhdp links sorted by neighbors including interface and 2-hop neighbor addresses\n"
         "\"nhdp neighbor\": shows all nhdp neighbors including addresses\n"
-        "\"nhdp interface\": shows all local nhdp interfaces including addresses\n"),
+        "\"nhdp interface\": shows all local nhdp interfaces including addresses\n"
+        "\"nhdp stats\": shows statistics of the HELLO processing\n"),
 };
 #endif
 
@@ -188,6 +192,7 @@ _init(void) {
     return -1;
   }
 
+  nhdp_timer_init();
   nhdp_db_init();
   nhdp_reader_init(_protocol);
   nhdp_interfaces_init(_protocol);
@@ -226,6 +231,8 @@ _cleanup(void) {
   nhdp_domain_cleanup();
   nhdp_interfaces_cleanup();
   nhdp_db_cleanup();
+  nhdp_addr_id_cleanup();
+  nhdp_timer_cleanup();
 }
 
 /**
@@ -301,6 +308,9 @@ _cb_nhdp(struct oonf_telnet_data *con) {
   if ((next = str_hasnextword(con->parameter, "interface"))) {
     return _telnet_nhdp_interface(con);
   }
+  if ((next = str_hasnextword(con->parameter, "stats"))) {
+    return _telnet_nhdp_stats(con);
+  }
 
   if (con->parameter == NULL || *con->parameter == 0) {
     abuf_puts(con->out, "Error, 'nhdp' needs a parameter\n");
@@ -326,14 +336,14 @@ _telnet_nhdp_neighbor(struct oonf_telnet_data *con) {
 
     avl_for_each_element(&neigh->_neigh_addresses, naddr, _neigh_node) {
       if (!nhdp_db_neighbor_addr_is_lost(naddr)) {
-        abuf_appendf(con->out, "\tAddress: %s\n", netaddr_to_string(&nbuf, &naddr->neigh_addr));
+        abuf_appendf(con->out, "\tAddress: %s\n", netaddr_to_string(&nbuf, nhdp_db_neighbor_addr_get_netaddr(naddr)));
       }
     }
     avl_for_each_element(&neigh->_neigh_addresses, naddr, _neigh_node) {
       if (nhdp_db_neighbor_addr_is_lost(naddr)) {
         abuf_appendf(con->out, "\tLost address: %s (vtime=%s)\n",
-            netaddr_to_string(&nbuf, &naddr->neigh_addr),
-            oonf_clock_toIntervalString(&tbuf, oonf_timer_get_due(&naddr->_lost_vtime)));
+            netaddr_to_string(&nbuf, nhdp_db_neighbor_addr_get_netaddr(naddr)),
+            oonf_clock_toIntervalString(&tbuf, nhdp_timer_get_due(&naddr->_lost_vtime)));
       }
     }
   }
@@ -385,31 +395,31 @@ _print_link(struct oonf_telnet_data *con, struct nhdp_link *lnk,
       nhdp_db_link_is_ipv6_dualstack(lnk)  ? "     " : "Link:",
       status,
       nhdp_interface_get_name(lnk->local_if),
-      oonf_clock_toIntervalString(&tbuf1, oonf_timer_get_due(&lnk->vtime)),
-      oonf_clock_toIntervalString(&tbuf2, oonf_timer_get_due(&lnk->heard_time)),
-      oonf_clock_toIntervalString(&tbuf3, oonf_timer_get_due(&lnk->sym_time)),
+      oonf_clock_toIntervalString(&tbuf1, nhdp_timer_get_due(&lnk->vtime)),
+      oonf_clock_toIntervalString(&tbuf2, nhdp_timer_get_due(&lnk->heard_time)),
+      oonf_clock_toIntervalString(&tbuf3, nhdp_timer_get_due(&lnk->sym_time)),
       lnk->dualstack_partner != NULL ? "dualstack " : "",
       nhdp_hysteresis_to_string(&hbuf, lnk));
-  if (netaddr_get_address_family(&lnk->neigh->originator) != AF_UNSPEC) {
+  if (lnk->neigh->originator_id != NHDP_ADDR_ID_NONE) {
     abuf_appendf(con->out, "%s\tOriginator: %s\n", prefix,
-        netaddr_to_string(&nbuf, &lnk->neigh->originator));
+        netaddr_to_string(&nbuf, nhdp_db_neighbor_get_originator(lnk->neigh)));
   }
 
   avl_for_each_element(&lnk->_addresses, laddr, _link_node) {
     abuf_appendf(con->out, "%s\tLink addresses: %s\n",
-        prefix, netaddr_to_string(&nbuf, &laddr->link_addr));
+        prefix, netaddr_to_string(&nbuf, nhdp_db_link_addr_get_netaddr(laddr)));
   }
   if (other_addr) {
     avl_for_each_element(&lnk->neigh->_neigh_addresses, naddr, _neigh_node) {
-      if (!nhdp_db_neighbor_addr_is_lost(naddr) && avl_find(&lnk->_addresses, &naddr->neigh_addr) == NULL) {
+      if (!nhdp_db_neighbor_addr_is_lost(naddr) && avl_find(&lnk->_addresses, &naddr->neigh_addr_id) == NULL) {
         abuf_appendf(con->out, "%s\tOther addresses: %s\n",
-            prefix, netaddr_to_string(&nbuf, &naddr->neigh_addr));
+            prefix, netaddr_to_string(&nbuf, nhdp_db_neighbor_addr_get_netaddr(naddr)));
       }
     }
   }
   avl_for_each_element(&lnk->_2hop, twohop, _link_node) {
     abuf_appendf(con->out, "%s\t2-Hop addresses: %s\n",
-        prefix, netaddr_to_string(&nbuf, &twohop->twohop_addr));
+        prefix, netaddr_to_string(&nbuf, nhdp_db_link_2hop_get_netaddr(twohop)));
   }
 }
 
@@ -450,9 +460,9 @@ _print_neigh(struct oonf_telnet_data *con, struct nhdp_neighbor *neigh) {
   }
 
   avl_for_each_element(&neigh->_neigh_addresses, naddr, _neigh_node) {
-    if (avl_find(&neigh->_link_addresses, &naddr->neigh_addr) == NULL) {
+    if (avl_find(&neigh->_link_addresses, &naddr->neigh_addr_id) == NULL) {
       abuf_appendf(con->out, "\tAddress on other interface: %s",
-          netaddr_to_string(&nbuf, &naddr->neigh_addr));
+          netaddr_to_string(&nbuf, nhdp_db_neighbor_addr_get_netaddr(naddr)));
     }
   }
 }
@@ -546,6 +556,29 @@ _telnet_nhdp_interface(struct oonf_telnet_data *con) {
   }
   return TELNET_RESULT_ACTIVE;
 }
+
+/**
+ * Handle the "nhdp stats" telnet command
+ * @param con telnet data connection
+ * @return always TELNET_RESULT_ACTIVE
+ */
+static enum oonf_telnet_result
+_telnet_nhdp_stats(struct oonf_telnet_data *con) {
+  const struct nhdp_reader_statistics *stats;
+  uint32_t percent;
+
+  stats = nhdp_reader_get_statistics();
+
+  percent = 0;
+  if (stats->hellos > 0) {
+    percent = (uint32_t)((uint64_t)stats->hello_refreshes * 100 / stats->hellos);
+  }
+
+  abuf_appendf(con->out, "Processed HELLOs: %u\n", stats->hellos);
+  abuf_appendf(con->out, "Unchanged HELLOs (refresh only): %u (%u%%)\n",
+      stats->hello_refreshes, percent);
+  return TELNET_RESULT_ACTIVE;
+}
 #endif
 
 /**
@@ -634,5 +667,12 @@ _cb_validate_domain_section(const char *section_name,
         section_name);
     return -1;
   }
+
+  if (!nhdp_domain_can_add(ext)) {
+    /* per domain data of the nhdp database is fixed at runtime */
+    abuf_appendf(out, "section '%s' cannot be added while NHDP is running,"
+        " a restart is necessary for a new domain", section_name);
+    return -1;
+  }
   return 0;
 }
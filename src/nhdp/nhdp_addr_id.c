@@ -0,0 +1,208 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/common_types.h"
+#include "common/container_of.h"
+#include "common/netaddr.h"
+
+#include "nhdp/nhdp_addr_id.h"
+#include "nhdp/nhdp_netaddr_hash.h"
+
+/* number of entries of a table page */
+#define NHDP_ADDR_ID_PAGE_SIZE (1u << NHDP_ADDR_ID_PAGE_BITS)
+
+static struct nhdp_addr_id_entry *_get_entry(uint32_t id);
+static void _free_entry(struct nhdp_addr_id_entry *entry);
+static int _add_page(void);
+
+/* global interning table, usable without initialization */
+struct nhdp_addr_id_table nhdp_addr_id_table;
+
+/**
+ * Free the interning table. All ids become invalid.
+ */
+void
+nhdp_addr_id_cleanup(void) {
+  uint32_t i;
+
+  for (i=0; i<nhdp_addr_id_table._page_count; i++) {
+    free(nhdp_addr_id_table._pages[i]);
+  }
+  free(nhdp_addr_id_table._pages);
+  nhdp_netaddr_hash_cleanup(&nhdp_addr_id_table._index);
+  memset(&nhdp_addr_id_table, 0, sizeof(nhdp_addr_id_table));
+}
+
+/**
+ * Get the id of an address and take a reference on it.
+ * The address is interned if it has no id yet.
+ * @param addr pointer to address
+ * @return id of address, NHDP_ADDR_ID_NONE if out of memory
+ */
+uint32_t
+nhdp_addr_id_acquire(const struct netaddr *addr) {
+  struct nhdp_addr_id_table *table = &nhdp_addr_id_table;
+  struct nhdp_addr_id_entry *entry;
+  uint32_t id;
+
+  entry = nhdp_netaddr_hash_get_element(&table->_index, addr, entry, addr);
+  if (entry != NULL) {
+    entry->refcount++;
+    return entry->id;
+  }
+
+  if (table->_free_id != NHDP_ADDR_ID_NONE) {
+    /* recycle released id */
+    id = table->_free_id;
+    entry = _get_entry(id);
+    table->_free_id = entry->_next_free;
+  }
+  else {
+    if (table->_high_water == table->_page_count * NHDP_ADDR_ID_PAGE_SIZE
+        && _add_page()) {
+      return NHDP_ADDR_ID_NONE;
+    }
+    id = table->_high_water++;
+    entry = _get_entry(id);
+    entry->id = id;
+  }
+
+  memcpy(&entry->addr, addr, sizeof(*addr));
+  if (nhdp_netaddr_hash_add(&table->_index, &entry->addr)) {
+    _free_entry(entry);
+    return NHDP_ADDR_ID_NONE;
+  }
+
+  entry->refcount = 1;
+  return id;
+}
+
+/**
+ * Release a reference on an address id
+ * @param id address id, NHDP_ADDR_ID_NONE is ignored
+ */
+void
+nhdp_addr_id_release(uint32_t id) {
+  struct nhdp_addr_id_entry *entry;
+
+  if (id == NHDP_ADDR_ID_NONE) {
+    return;
+  }
+
+  entry = _get_entry(id);
+  if (--entry->refcount > 0) {
+    return;
+  }
+
+  nhdp_netaddr_hash_remove(&nhdp_addr_id_table._index, &entry->addr);
+  _free_entry(entry);
+}
+
+/**
+ * Lookup the id of an address without taking a reference
+ * @param addr pointer to address
+ * @return id of address, NHDP_ADDR_ID_NONE if address is not interned
+ */
+uint32_t
+nhdp_addr_id_lookup(const struct netaddr *addr) {
+  struct nhdp_addr_id_entry *entry;
+
+  entry = nhdp_netaddr_hash_get_element(
+      &nhdp_addr_id_table._index, addr, entry, addr);
+  return entry == NULL ? NHDP_ADDR_ID_NONE : entry->id;
+}
+
+/**
+ * @param id address id
+ * @return pointer to table entry of id
+ */
+static struct nhdp_addr_id_entry *
+_get_entry(uint32_t id) {
+  return &nhdp_addr_id_table._pages[id / NHDP_ADDR_ID_PAGE_SIZE]
+      [id % NHDP_ADDR_ID_PAGE_SIZE];
+}
+
+/**
+ * Put an entry that is not in the hash index on the free list
+ * @param entry pointer to table entry
+ */
+static void
+_free_entry(struct nhdp_addr_id_entry *entry) {
+  netaddr_invalidate(&entry->addr);
+  entry->refcount = 0;
+  entry->_next_free = nhdp_addr_id_table._free_id;
+  nhdp_addr_id_table._free_id = entry->id;
+}
+
+/**
+ * Add a page of entries to the table. Existing pages are not moved,
+ * so the addresses of used entries stay valid.
+ * @return -1 if out of memory, 0 otherwise
+ */
+static int
+_add_page(void) {
+  struct nhdp_addr_id_table *table = &nhdp_addr_id_table;
+  struct nhdp_addr_id_entry **pages;
+  struct nhdp_addr_id_entry *page;
+
+  page = calloc(NHDP_ADDR_ID_PAGE_SIZE, sizeof(*page));
+  if (page == NULL) {
+    return -1;
+  }
+
+  pages = realloc(table->_pages, (table->_page_count + 1) * sizeof(*pages));
+  if (pages == NULL) {
+    free(page);
+    return -1;
+  }
+
+  if (table->_page_count == 0) {
+    /* id 0 is never assigned */
+    table->_high_water = 1;
+  }
+
+  pages[table->_page_count++] = page;
+  table->_pages = pages;
+  return 0;
+}
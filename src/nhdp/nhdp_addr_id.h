@@ -0,0 +1,146 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#ifndef NHDP_ADDR_ID_H_
+#define NHDP_ADDR_ID_H_
+
+#include "common/common_types.h"
+#include "common/netaddr.h"
+
+#include "nhdp/nhdp_netaddr_hash.h"
+
+/*
+ * Global table which maps each address used by the NHDP and OLSRv2
+ * databases to a 32 bit id. Two addresses are equal if and only if
+ * their ids are equal, so comparisons of interned addresses are
+ * integer compares.
+ *
+ * Each user of an id holds a reference, the id is recycled when
+ * the last reference is released. The interned address does not
+ * move in memory while the id is referenced, so it can be used
+ * as the key of other data structures.
+ */
+
+/* id of no address, never assigned to an address */
+#define NHDP_ADDR_ID_NONE 0
+
+/* number of entries of a table page is 1 << NHDP_ADDR_ID_PAGE_BITS */
+#define NHDP_ADDR_ID_PAGE_BITS 8
+
+/* interned address */
+struct nhdp_addr_id_entry {
+  /* address of this id, key of the hash index */
+  struct netaddr addr;
+
+  /* id of this entry */
+  uint32_t id;
+
+  /* number of references, 0 if id is unused */
+  uint32_t refcount;
+
+  /* next free id if unused */
+  uint32_t _next_free;
+};
+
+/* interning table */
+struct nhdp_addr_id_table {
+  /* array of pages of entries, indexed by the upper bits of the id */
+  struct nhdp_addr_id_entry **_pages;
+
+  /* number of allocated pages */
+  uint32_t _page_count;
+
+  /* first never used id */
+  uint32_t _high_water;
+
+  /* head of list of released ids, NHDP_ADDR_ID_NONE if empty */
+  uint32_t _free_id;
+
+  /* hash index over the addresses of all used entries */
+  struct nhdp_netaddr_hash _index;
+
+  /* address returned for NHDP_ADDR_ID_NONE, type AF_UNSPEC */
+  struct netaddr _unspec;
+};
+
+EXPORT extern struct nhdp_addr_id_table nhdp_addr_id_table;
+
+void nhdp_addr_id_cleanup(void);
+
+EXPORT uint32_t nhdp_addr_id_acquire(const struct netaddr *addr);
+EXPORT void nhdp_addr_id_release(uint32_t id);
+EXPORT uint32_t nhdp_addr_id_lookup(const struct netaddr *addr);
+
+/**
+ * @param id interned address id
+ * @return pointer to address of id, AF_UNSPEC address
+ *   for NHDP_ADDR_ID_NONE
+ */
+static INLINE const struct netaddr *
+nhdp_addr_id_get_netaddr(uint32_t id) {
+  if (id == NHDP_ADDR_ID_NONE) {
+    return &nhdp_addr_id_table._unspec;
+  }
+  return &nhdp_addr_id_table._pages[id >> NHDP_ADDR_ID_PAGE_BITS]
+      [id & ((1u << NHDP_ADDR_ID_PAGE_BITS) - 1)].addr;
+}
+
+/**
+ * Compare two address ids. NHDP_ADDR_ID_NONE stands for an unset
+ * or unknown address and is never equal to any id, not even itself.
+ * @param id1 first address id
+ * @param id2 second address id
+ * @return true if both ids belong to the same address
+ */
+static INLINE bool
+nhdp_addr_id_is_equal(uint32_t id1, uint32_t id2) {
+  return id1 != NHDP_ADDR_ID_NONE && id1 == id2;
+}
+
+/**
+ * @return number of interned addresses
+ */
+static INLINE uint32_t
+nhdp_addr_id_get_count(void) {
+  return nhdp_addr_id_table._index.count;
+}
+
+#endif /* NHDP_ADDR_ID_H_ */
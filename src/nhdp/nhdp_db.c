@@ -49,9 +49,9 @@
 
 #include "core/oonf_logging.h"
 #include "subsystems/oonf_class.h"
-#include "subsystems/oonf_timer.h"
 
 #include "nhdp/nhdp.h"
+#include "nhdp/nhdp_addr_id.h"
 #include "nhdp/nhdp_hysteresis.h"
 #include "nhdp/nhdp_interfaces.h"
 #include "nhdp/nhdp_domain.h"
@@ -60,6 +60,7 @@
 /* Prototypes of local functions */
 static void _link_status_now_symmetric(struct nhdp_link *lnk);
 static void _link_status_not_symmetric_anymore(struct nhdp_link *lnk);
+static void _reset_hello_hashes(struct nhdp_neighbor *neigh);
 int _nhdp_db_link_calculate_status(struct nhdp_link *lnk);
 
 static void _cb_link_vtime(void *);
@@ -94,27 +95,27 @@ static struct oonf_class _naddr_info = {
   .size = sizeof(struct nhdp_naddr),
 };
 
-static struct oonf_timer_info _link_vtime_info = {
+static struct nhdp_timer_info _link_vtime_info = {
   .name = "NHDP link vtime",
   .callback = _cb_link_vtime,
 };
 
-static struct oonf_timer_info _link_heard_info = {
+static struct nhdp_timer_info _link_heard_info = {
   .name = "NHDP link heard-time",
   .callback = _cb_link_heard,
 };
 
-static struct oonf_timer_info _link_symtime_info = {
+static struct nhdp_timer_info _link_symtime_info = {
   .name = "NHDP link symtime",
   .callback = _cb_link_symtime,
 };
 
-static struct oonf_timer_info _naddr_vtime_info = {
+static struct nhdp_timer_info _naddr_vtime_info = {
   .name = "NHDP neighbor address vtime",
   .callback = _cb_naddr_vtime,
 };
 
-static struct oonf_timer_info _l2hop_vtime_info = {
+static struct nhdp_timer_info _l2hop_vtime_info = {
   .name = "NHDP 2hop vtime",
   .callback = _cb_l2hop_vtime,
 };
@@ -128,6 +129,12 @@ struct list_entity nhdp_neigh_list;
 /* tree of neighbors with originator addresses */
 struct avl_tree nhdp_neigh_originator_tree;
 
+/* number of changes of neighbor addresses and originators */
+static uint32_t _address_generation;
+
+/* true after the first neighbor has been allocated */
+static bool _in_use = false;
+
 /* list of links (to neighbors) */
 struct list_entity nhdp_link_list;
 
@@ -136,9 +143,9 @@ struct list_entity nhdp_link_list;
  */
 void
 nhdp_db_init(void) {
-  avl_init(&nhdp_naddr_tree, avl_comp_netaddr, false);
+  avl_init(&nhdp_naddr_tree, avl_comp_uint32, false);
   list_init_head(&nhdp_neigh_list);
-  avl_init(&nhdp_neigh_originator_tree, avl_comp_netaddr, false);
+  avl_init(&nhdp_neigh_originator_tree, avl_comp_uint32, false);
   list_init_head(&nhdp_link_list);
 
   oonf_class_add(&_neigh_info);
@@ -147,11 +154,11 @@ nhdp_db_init(void) {
   oonf_class_add(&_laddr_info);
   oonf_class_add(&_l2hop_info);
 
-  oonf_timer_add(&_naddr_vtime_info);
-  oonf_timer_add(&_link_vtime_info);
-  oonf_timer_add(&_link_heard_info);
-  oonf_timer_add(&_link_symtime_info);
-  oonf_timer_add(&_l2hop_vtime_info);
+  nhdp_timer_add(&_naddr_vtime_info);
+  nhdp_timer_add(&_link_vtime_info);
+  nhdp_timer_add(&_link_heard_info);
+  nhdp_timer_add(&_link_symtime_info);
+  nhdp_timer_add(&_l2hop_vtime_info);
 }
 
 /**
@@ -167,11 +174,11 @@ nhdp_db_cleanup(void) {
   }
 
   /* cleanup all timers */
-  oonf_timer_remove(&_l2hop_vtime_info);
-  oonf_timer_remove(&_link_symtime_info);
-  oonf_timer_remove(&_link_heard_info);
-  oonf_timer_remove(&_link_vtime_info);
-  oonf_timer_remove(&_naddr_vtime_info);
+  nhdp_timer_remove(&_l2hop_vtime_info);
+  nhdp_timer_remove(&_link_symtime_info);
+  nhdp_timer_remove(&_link_heard_info);
+  nhdp_timer_remove(&_link_vtime_info);
+  nhdp_timer_remove(&_naddr_vtime_info);
 
   /* cleanup all memory cookies */
   oonf_class_remove(&_l2hop_info);
@@ -193,19 +200,20 @@ nhdp_db_neighbor_add(void) {
   if (neigh == NULL) {
     return NULL;
   }
+  _in_use = true;
 
   OONF_DEBUG(LOG_NHDP, "New Neighbor: 0x%0zx", (size_t)neigh);
 
   /* initialize trees and lists */
-  avl_init(&neigh->_neigh_addresses, avl_comp_netaddr, false);
-  avl_init(&neigh->_link_addresses, avl_comp_netaddr, true);
+  avl_init(&neigh->_neigh_addresses, avl_comp_uint32, false);
+  avl_init(&neigh->_link_addresses, avl_comp_uint32, true);
   list_init_head(&neigh->_links);
 
   /* hook into global neighbor list */
   list_add_tail(&nhdp_neigh_list, &neigh->_global_node);
 
   /* initialize originator node */
-  neigh->_originator_node.key = &neigh->originator;
+  neigh->_originator_node.key = &neigh->originator_id;
 
   /* initialize domain data */
   nhdp_domain_init_neighbor(neigh);
@@ -229,6 +237,9 @@ nhdp_db_neighbor_remove(struct nhdp_neighbor *neigh) {
   /* trigger event */
   oonf_class_event(&_neigh_info, neigh, OONF_OBJECT_REMOVED);
 
+  /* forget pending domain updates */
+  nhdp_domain_cleanup_neighbor(neigh);
+
   /* remove all links */
   list_for_each_element_safe(&neigh->_links, lnk, _neigh_node, l_it) {
     nhdp_db_link_remove(lnk);
@@ -240,9 +251,10 @@ nhdp_db_neighbor_remove(struct nhdp_neighbor *neigh) {
   }
 
   /* remove from originator tree if necessary */
-  if (netaddr_get_address_family(&neigh->originator) != AF_UNSPEC) {
+  if (neigh->originator_id != NHDP_ADDR_ID_NONE) {
     avl_remove(&nhdp_neigh_originator_tree, &neigh->_originator_node);
   }
+  nhdp_addr_id_release(neigh->originator_id);
 
   /* remove from global list and free memory */
   list_remove(&neigh->_global_node);
@@ -276,11 +288,11 @@ nhdp_db_neighbor_join(struct nhdp_neighbor *dst, struct nhdp_neighbor *src) {
     }
 
     /* move interface based originator */
-    if (netaddr_get_address_family(&src->originator) != AF_UNSPEC) {
+    if (src->originator_id != NHDP_ADDR_ID_NONE) {
       avl_remove(&lnk->local_if->_link_originators, &lnk->_originator_node);
     }
-    lnk->_originator_node.key = &dst->originator;
-    if (netaddr_get_address_family(&dst->originator) != AF_UNSPEC) {
+    lnk->_originator_node.key = &dst->originator_id;
+    if (dst->originator_id != NHDP_ADDR_ID_NONE) {
       avl_insert(&lnk->local_if->_link_originators, &lnk->_originator_node);
     }
 
@@ -297,7 +309,9 @@ nhdp_db_neighbor_join(struct nhdp_neighbor *dst, struct nhdp_neighbor *src) {
     avl_insert(&dst->_neigh_addresses, &naddr->_neigh_node);
     naddr->neigh = dst;
   }
+  _address_generation++;
 
+  _reset_hello_hashes(dst);
   nhdp_db_neighbor_remove(src);
 }
 
@@ -317,10 +331,15 @@ nhdp_db_neighbor_addr_add(struct nhdp_neighbor *neigh,
     return NULL;
   }
 
+  naddr->neigh_addr_id = nhdp_addr_id_acquire(addr);
+  if (naddr->neigh_addr_id == NHDP_ADDR_ID_NONE) {
+    oonf_class_free(&_naddr_info, naddr);
+    return NULL;
+  }
+
   /* initialize key */
-  memcpy(&naddr->neigh_addr, addr, sizeof(naddr->neigh_addr));
-  naddr->_neigh_node.key = &naddr->neigh_addr;
-  naddr->_global_node.key = &naddr->neigh_addr;
+  naddr->_neigh_node.key = &naddr->neigh_addr_id;
+  naddr->_global_node.key = &naddr->neigh_addr_id;
 
   /* initialize backward link */
   naddr->neigh = neigh;
@@ -332,6 +351,7 @@ nhdp_db_neighbor_addr_add(struct nhdp_neighbor *neigh,
   /* add to trees */
   avl_insert(&nhdp_naddr_tree, &naddr->_global_node);
   avl_insert(&neigh->_neigh_addresses, &naddr->_neigh_node);
+  _address_generation++;
 
   /* trigger event */
   oonf_class_event(&_naddr_info, naddr, OONF_OBJECT_ADDED);
@@ -348,14 +368,18 @@ nhdp_db_neighbor_addr_remove(struct nhdp_naddr *naddr) {
   /* trigger event */
   oonf_class_event(&_naddr_info, naddr, OONF_OBJECT_REMOVED);
 
+  _reset_hello_hashes(naddr->neigh);
+
   /* remove from trees */
   avl_remove(&nhdp_naddr_tree, &naddr->_global_node);
   avl_remove(&naddr->neigh->_neigh_addresses, &naddr->_neigh_node);
+  _address_generation++;
 
   /* stop timer */
-  oonf_timer_stop(&naddr->_lost_vtime);
+  nhdp_timer_stop(&naddr->_lost_vtime);
 
   /* free memory */
+  nhdp_addr_id_release(naddr->neigh_addr_id);
   oonf_class_free(&_naddr_info, naddr);
 }
 
@@ -366,6 +390,9 @@ nhdp_db_neighbor_addr_remove(struct nhdp_naddr *naddr) {
  */
 void
 nhdp_db_neighbor_addr_move(struct nhdp_neighbor *neigh, struct nhdp_naddr *naddr) {
+  _reset_hello_hashes(naddr->neigh);
+  _reset_hello_hashes(neigh);
+
   /* remove from old neighbor */
   avl_remove(&naddr->neigh->_neigh_addresses, &naddr->_neigh_node);
 
@@ -374,6 +401,7 @@ nhdp_db_neighbor_addr_move(struct nhdp_neighbor *neigh, struct nhdp_naddr *naddr
 
   /* set new backlink */
   naddr->neigh = neigh;
+  _address_generation++;
 }
 
 /**
@@ -386,13 +414,20 @@ nhdp_db_neighbor_set_originator(struct nhdp_neighbor *neigh,
     const struct netaddr *originator) {
   struct nhdp_neighbor *neigh2;
   struct nhdp_link *lnk;
+  uint32_t id = NHDP_ADDR_ID_NONE;
+
+  if (netaddr_get_address_family(originator) != AF_UNSPEC) {
+    /* the originator stays unset if the table is out of memory */
+    id = nhdp_addr_id_acquire(originator);
+  }
 
-  if (memcmp(&neigh->originator, originator, sizeof(*originator)) == 0) {
+  if (id == neigh->originator_id) {
     /* same originator, nothing to do */
+    nhdp_addr_id_release(id);
     return;
   }
 
-  if (netaddr_get_address_family(&neigh->originator) != AF_UNSPEC) {
+  if (neigh->originator_id != NHDP_ADDR_ID_NONE) {
     /* different originator, remove from tree */
     avl_remove(&nhdp_neigh_originator_tree, &neigh->_originator_node);
 
@@ -400,33 +435,60 @@ nhdp_db_neighbor_set_originator(struct nhdp_neighbor *neigh,
       /* remove links from interface specific tree */
       avl_remove(&lnk->local_if->_link_originators, &lnk->_originator_node);
     }
+
+    nhdp_addr_id_release(neigh->originator_id);
+    neigh->originator_id = NHDP_ADDR_ID_NONE;
   }
+  _address_generation++;
 
-  neigh2 = nhdp_db_neighbor_get_by_originator(originator);
-  if (neigh2) {
-    /* different neighbor has this originator, invalidate it */
-    avl_remove(&nhdp_neigh_originator_tree, &neigh2->_originator_node);
+  if (id != NHDP_ADDR_ID_NONE) {
+    neigh2 = nhdp_db_neighbor_get_by_originator_id(id);
+    if (neigh2) {
+      /* different neighbor has this originator, invalidate it */
+      avl_remove(&nhdp_neigh_originator_tree, &neigh2->_originator_node);
 
-    list_for_each_element(&neigh2->_links, lnk, _neigh_node) {
-      /* remove links from interface specific tree */
-      avl_remove(&lnk->local_if->_link_originators, &lnk->_originator_node);
-    }
+      list_for_each_element(&neigh2->_links, lnk, _neigh_node) {
+        /* remove links from interface specific tree */
+        avl_remove(&lnk->local_if->_link_originators, &lnk->_originator_node);
+      }
 
-    netaddr_invalidate(&neigh2->originator);
-  }
+      nhdp_addr_id_release(neigh2->originator_id);
+      neigh2->originator_id = NHDP_ADDR_ID_NONE;
 
-  /* copy originator address into neighbor */
-  memcpy(&neigh->originator, originator, sizeof(*originator));
+      /* trigger event */
+      oonf_class_event(&_neigh_info, neigh2, OONF_OBJECT_CHANGED);
+    }
 
-  if (netaddr_get_address_family(originator) != AF_UNSPEC) {
     /* add to tree if new originator is valid */
+    neigh->originator_id = id;
     avl_insert(&nhdp_neigh_originator_tree, &neigh->_originator_node);
 
     list_for_each_element(&neigh->_links, lnk, _neigh_node) {
-      /* remove links from interface specific tree */
+      /* add links to interface specific tree */
       avl_insert(&lnk->local_if->_link_originators, &lnk->_originator_node);
     }
   }
+
+  /* trigger event */
+  oonf_class_event(&_neigh_info, neigh, OONF_OBJECT_CHANGED);
+}
+
+/**
+ * @return true if database objects have been allocated, the memory
+ *   layout of links, neighbors and twohop neighbors is fixed then
+ */
+bool
+nhdp_db_is_in_use(void) {
+  return _in_use;
+}
+
+/**
+ * @return number of changes of the neighbor addresses and originators,
+ *   used to detect modifications between two queries
+ */
+uint32_t
+nhdp_db_neighbor_get_address_generation(void) {
+  return _address_generation;
 }
 
 /**
@@ -487,8 +549,8 @@ nhdp_db_link_add(struct nhdp_neighbor *neigh, struct nhdp_interface *local_if) {
   list_add_tail(&nhdp_link_list, &lnk->_global_node);
 
   /* init local trees */
-  avl_init(&lnk->_addresses, avl_comp_netaddr, false);
-  avl_init(&lnk->_2hop, avl_comp_netaddr, false);
+  avl_init(&lnk->_addresses, avl_comp_uint32, false);
+  avl_init(&lnk->_2hop, avl_comp_uint32, false);
 
   /* init timers */
   lnk->sym_time.info = &_link_symtime_info;
@@ -499,8 +561,8 @@ nhdp_db_link_add(struct nhdp_neighbor *neigh, struct nhdp_interface *local_if) {
   lnk->vtime.cb_context = lnk;
 
   /* add to originator tree if set */
-  lnk->_originator_node.key = &neigh->originator;
-  if (netaddr_get_address_family(&neigh->originator) != AF_UNSPEC) {
+  lnk->_originator_node.key = &neigh->originator_id;
+  if (neigh->originator_id != NHDP_ADDR_ID_NONE) {
     avl_insert(&local_if->_link_originators, &lnk->_originator_node);
   }
 
@@ -530,11 +592,11 @@ nhdp_db_link_remove(struct nhdp_link *lnk) {
   }
 
   /* stop link timers */
-  oonf_timer_stop(&lnk->sym_time);
-  oonf_timer_stop(&lnk->heard_time);
-  oonf_timer_stop(&lnk->vtime);
+  nhdp_timer_stop(&lnk->sym_time);
+  nhdp_timer_stop(&lnk->heard_time);
+  nhdp_timer_stop(&lnk->vtime);
 
-  if (netaddr_get_address_family(&lnk->neigh->originator) != AF_UNSPEC) {
+  if (lnk->neigh->originator_id != NHDP_ADDR_ID_NONE) {
     avl_remove(&lnk->local_if->_link_originators, &lnk->_originator_node);
   }
 
@@ -556,9 +618,26 @@ nhdp_db_link_remove(struct nhdp_link *lnk) {
   list_remove(&lnk->_global_node);
 
   /* free memory */
+  nhdp_addr_id_release(lnk->if_addr_id);
   oonf_class_free(&_link_info, lnk);
 }
 
+/**
+ * Set the interface address a nhdp link was heard from
+ * @param lnk nhdp link
+ * @param addr interface address
+ */
+void
+nhdp_db_link_set_ifaddr(struct nhdp_link *lnk, const struct netaddr *addr) {
+  uint32_t id;
+
+  /* the address stays unset if the table is out of memory */
+  id = nhdp_addr_id_acquire(addr);
+
+  nhdp_addr_id_release(lnk->if_addr_id);
+  lnk->if_addr_id = id;
+}
+
 /**
  * Add a network address as a link address to a nhdp link
  * @param lnk nhpd link
@@ -574,11 +653,16 @@ nhdp_db_link_addr_add(struct nhdp_link *lnk, const struct netaddr *addr) {
     return NULL;
   }
 
+  laddr->link_addr_id = nhdp_addr_id_acquire(addr);
+  if (laddr->link_addr_id == NHDP_ADDR_ID_NONE) {
+    oonf_class_free(&_laddr_info, laddr);
+    return NULL;
+  }
+
   /* initialize key */
-  memcpy(&laddr->link_addr, addr, sizeof(laddr->link_addr));
-  laddr->_link_node.key = &laddr->link_addr;
-  laddr->_neigh_node.key = &laddr->link_addr;
-  laddr->_if_node.key = &laddr->link_addr;
+  laddr->_link_node.key = &laddr->link_addr_id;
+  laddr->_neigh_node.key = &laddr->link_addr_id;
+  laddr->_if_node.key = &laddr->link_addr_id;
 
   /* initialize back link */
   laddr->link = lnk;
@@ -603,12 +687,15 @@ nhdp_db_link_addr_remove(struct nhdp_laddr *laddr) {
   /* trigger event */
   oonf_class_event(&_laddr_info, laddr, OONF_OBJECT_REMOVED);
 
+  laddr->link->hello_hash = 0;
+
   /* remove from trees */
   nhdp_interface_remove_laddr(laddr);
   avl_remove(&laddr->link->_addresses, &laddr->_link_node);
   avl_remove(&laddr->link->neigh->_link_addresses, &laddr->_neigh_node);
 
   /* free memory */
+  nhdp_addr_id_release(laddr->link_addr_id);
   oonf_class_free(&_laddr_info, laddr);
 }
 
@@ -619,6 +706,9 @@ nhdp_db_link_addr_remove(struct nhdp_laddr *laddr) {
  */
 void
 nhdp_db_link_addr_move(struct nhdp_link *lnk, struct nhdp_laddr *laddr) {
+  laddr->link->hello_hash = 0;
+  lnk->hello_hash = 0;
+
   /* remove from old link */
   avl_remove(&laddr->link->_addresses, &laddr->_link_node);
 
@@ -651,9 +741,14 @@ nhdp_db_link_2hop_add(struct nhdp_link *lnk, const struct netaddr *addr) {
     return NULL;
   }
 
+  l2hop->twohop_addr_id = nhdp_addr_id_acquire(addr);
+  if (l2hop->twohop_addr_id == NHDP_ADDR_ID_NONE) {
+    oonf_class_free(&_l2hop_info, l2hop);
+    return NULL;
+  }
+
   /* initialize key */
-  memcpy(&l2hop->twohop_addr, addr, sizeof(l2hop->twohop_addr));
-  l2hop->_link_node.key = &l2hop->twohop_addr;
+  l2hop->_link_node.key = &l2hop->twohop_addr_id;
 
   /* initialize back link */
   l2hop->link = lnk;
@@ -683,13 +778,16 @@ nhdp_db_link_2hop_remove(struct nhdp_l2hop *l2hop) {
   /* trigger event */
   oonf_class_event(&_l2hop_info, l2hop, OONF_OBJECT_REMOVED);
 
+  l2hop->link->hello_hash = 0;
+
   /* remove from tree */
   avl_remove(&l2hop->link->_2hop, &l2hop->_link_node);
 
   /* stop validity timer */
-  oonf_timer_stop(&l2hop->_vtime);
+  nhdp_timer_stop(&l2hop->_vtime);
 
   /* free memory */
+  nhdp_addr_id_release(l2hop->twohop_addr_id);
   oonf_class_free(&_l2hop_info, l2hop);
 }
 
@@ -767,9 +865,9 @@ _nhdp_db_link_calculate_status(struct nhdp_link *lnk) {
     return NHDP_LINK_PENDING;
   if (nhdp_hysteresis_is_lost(lnk))
     return RFC5444_LINKSTATUS_LOST;
-  if (oonf_timer_is_active(&lnk->sym_time))
+  if (nhdp_timer_is_active(&lnk->sym_time))
     return RFC5444_LINKSTATUS_SYMMETRIC;
-  if (oonf_timer_is_active(&lnk->heard_time))
+  if (nhdp_timer_is_active(&lnk->heard_time))
     return RFC5444_LINKSTATUS_HEARD;
   return RFC5444_LINKSTATUS_LOST;
 }
@@ -805,6 +903,8 @@ _link_status_not_symmetric_anymore(struct nhdp_link *lnk) {
     nhdp_db_link_2hop_remove(twohop);
   }
 
+  _reset_hello_hashes(lnk->neigh);
+
   lnk->neigh->symmetric--;
   if (lnk->neigh->symmetric == 0) {
     /* mark all neighbor addresses as lost */
@@ -814,6 +914,20 @@ _link_status_not_symmetric_anymore(struct nhdp_link *lnk) {
   }
 }
 
+/**
+ * Forget the HELLO fingerprints of all links of a neighbor, the next
+ * HELLO of each link will be processed completely
+ * @param neigh nhdp neighbor
+ */
+static void
+_reset_hello_hashes(struct nhdp_neighbor *neigh) {
+  struct nhdp_link *lnk;
+
+  list_for_each_element(&neigh->_links, lnk, _neigh_node) {
+    lnk->hello_hash = 0;
+  }
+}
+
 /**
  * Callback triggered when link validity timer fires
  * @param ptr nhdp link
@@ -47,9 +47,10 @@
 #include "common/list.h"
 #include "common/netaddr.h"
 #include "rfc5444/rfc5444_iana.h"
-#include "subsystems/oonf_timer.h"
 
 #include "nhdp/nhdp.h"
+#include "nhdp/nhdp_addr_id.h"
+#include "nhdp/nhdp_timer_wheel.h"
 
 #define NHDP_CLASS_LINK             "nhdp_link"
 #define NHDP_CLASS_LINK_ADDRESS     "nhdp_laddr"
@@ -76,7 +77,8 @@ struct nhdp_metric {
 };
 
 /**
- * Data for one NHDP domain of a link
+ * Data for one NHDP domain of a link, stored behind the link
+ * as an extension of its memory class (see nhdp_domain_add())
  */
 struct nhdp_link_domaindata {
   /* incoming and outgoing metric cost */
@@ -84,7 +86,8 @@ struct nhdp_link_domaindata {
 };
 
 /**
- * Data for one NHDP domain of a neighbor
+ * Data for one NHDP domain of a neighbor, stored behind the neighbor
+ * as an extension of its memory class (see nhdp_domain_add())
  */
 struct nhdp_neighbor_domaindata {
   /* incoming and outgoing metric cost */
@@ -102,12 +105,16 @@ struct nhdp_neighbor_domaindata {
   /* true if the neighbor has been selected as a MPR by this router */
   bool neigh_is_mpr;
 
+  /* value of neigh_is_mpr after the last MPR calculation */
+  bool _last_neigh_is_mpr;
+
   /* Routing willingness of neighbor */
   uint8_t willingness;
 };
 
 /**
- * Data for one NHDP domain of a 2-hop neighbor
+ * Data for one NHDP domain of a 2-hop neighbor, stored behind the 2-hop neighbor
+ * as an extension of its memory class (see nhdp_domain_add())
  */
 struct nhdp_l2hop_domaindata {
   struct nhdp_metric metric;
@@ -124,13 +131,13 @@ struct nhdp_link {
   /* last received interval time */
   uint64_t itime_value;
   /* timer that fires if this link is not symmetric anymore */
-  struct oonf_timer_entry sym_time;
+  struct nhdp_timer_entry sym_time;
 
   /* timer that fires if the last received neighbor HELLO timed out */
-  struct oonf_timer_entry heard_time;
+  struct nhdp_timer_entry heard_time;
 
   /* timer that fires when the link has to be removed from the database */
-  struct oonf_timer_entry vtime;
+  struct nhdp_timer_entry vtime;
 
   /* cached status of the linked */
   enum nhdp_link_status status;
@@ -144,12 +151,19 @@ struct nhdp_link {
   /* pointer to neighbor entry of the other side of the link */
   struct nhdp_neighbor *neigh;
 
-  /* local interface address heard from the link */
-  struct netaddr if_addr;
+  /* interned id of the interface address heard from the link, NHDP_ADDR_ID_NONE if not set */
+  uint32_t if_addr_id;
 
   /* mac address of remote link end */
   struct netaddr remote_mac;
 
+  /*
+   * fingerprint of the last completely processed HELLO, 0 if unknown.
+   * Reset whenever the addresses of the link or its neighbor change
+   * outside of the HELLO processing.
+   */
+  uint32_t hello_hash;
+
   /* internal field for NHDP processing */
   int _process_count;
 
@@ -170,17 +184,14 @@ struct nhdp_link {
 
   /* optional member node for interface tree of originators */
   struct avl_node _originator_node;
-
-  /* Array of link metrics */
-  struct nhdp_link_domaindata _domaindata[NHDP_MAXIMUM_DOMAINS];
 };
 
 /**
  * nhdp_laddr represents an interface address of a link
  */
 struct nhdp_laddr {
-  /* links interface address */
-  struct netaddr link_addr;
+  /* interned id of links interface address */
+  uint32_t link_addr_id;
 
   /* link entry for address */
   struct nhdp_link *link;
@@ -202,8 +213,8 @@ struct nhdp_laddr {
  * nhdp_l2hop represents an address of a two-hop neighbor
  */
 struct nhdp_l2hop {
-  /* address of two-hop neighbor */
-  struct netaddr twohop_addr;
+  /* interned id of address of two-hop neighbor */
+  uint32_t twohop_addr_id;
 
   /*
    * link entry for two-hop address, might be NULL if only learned as
@@ -212,21 +223,18 @@ struct nhdp_l2hop {
   struct nhdp_link *link;
 
   /* validity time for this address */
-  struct oonf_timer_entry _vtime;
+  struct nhdp_timer_entry _vtime;
 
   /* member entry for two-hop addresses of neighbor link */
   struct avl_node _link_node;
-
-  /* Array of link metrics */
-  struct nhdp_l2hop_domaindata _domaindata[NHDP_MAXIMUM_DOMAINS];
 };
 
 /**
  * nhdp_neighbor represents a neighbor node (with one or multiple interfaces
  */
 struct nhdp_neighbor {
-  /* originator address of this node, might by type AF_UNSPEC */
-  struct netaddr originator;
+  /* interned id of originator address of this node, NHDP_ADDR_ID_NONE if not set */
+  uint32_t originator_id;
 
   /* number of links to this neighbor which are symmetric */
   int symmetric;
@@ -261,8 +269,8 @@ struct nhdp_neighbor {
   /* optional member node for global tree of originators */
   struct avl_node _originator_node;
 
-  /* Array of link metrics */
-  struct nhdp_neighbor_domaindata _domaindata[NHDP_MAXIMUM_DOMAINS];
+  /* member of list of neighbors with pending domain updates */
+  struct list_entity _domain_changed_node;
 };
 
 /**
@@ -270,8 +278,8 @@ struct nhdp_neighbor {
  * or a former (lost) address which will be removed soon
  */
 struct nhdp_naddr {
-  /* neighbor interface address */
-  struct netaddr neigh_addr;
+  /* interned id of neighbor interface address */
+  uint32_t neigh_addr_id;
 
   /* backlink to neighbor */
   struct nhdp_neighbor *neigh;
@@ -280,7 +288,7 @@ struct nhdp_naddr {
   int laddr_count;
 
   /* validity time for this address when its lost */
-  struct oonf_timer_entry _lost_vtime;
+  struct nhdp_timer_entry _lost_vtime;
 
   /* member entry for neighbor address tree */
   struct avl_node _neigh_node;
@@ -299,6 +307,7 @@ EXPORT extern struct avl_tree nhdp_neigh_originator_tree;
 
 void nhdp_db_init(void);
 void nhdp_db_cleanup(void);
+EXPORT bool nhdp_db_is_in_use(void);
 
 EXPORT struct nhdp_neighbor *nhdp_db_neighbor_add(void);
 EXPORT void nhdp_db_neighbor_remove(struct nhdp_neighbor *);
@@ -307,11 +316,13 @@ EXPORT struct nhdp_naddr *nhdp_db_neighbor_addr_add(struct nhdp_neighbor *, cons
 EXPORT void nhdp_db_neighbor_addr_remove(struct nhdp_naddr *);
 EXPORT void nhdp_db_neighbor_addr_move(struct nhdp_neighbor *, struct nhdp_naddr *);
 EXPORT void nhdp_db_neighbor_set_originator(struct nhdp_neighbor *, const struct netaddr *);
+EXPORT uint32_t nhdp_db_neighbor_get_address_generation(void);
 EXPORT void nhdp_db_neighbor_connect_dualstack(struct nhdp_neighbor *, struct nhdp_neighbor *);
 EXPORT void nhdp_db_neigbor_disconnect_dualstack(struct nhdp_neighbor *neigh);
 
 EXPORT struct nhdp_link *nhdp_db_link_add(struct nhdp_neighbor *ipv4, struct nhdp_interface *ipv6);
 EXPORT void nhdp_db_link_remove(struct nhdp_link *);
+EXPORT void nhdp_db_link_set_ifaddr(struct nhdp_link *, const struct netaddr *);
 EXPORT struct nhdp_laddr *nhdp_db_link_addr_add(struct nhdp_link *, const struct netaddr*);
 EXPORT void nhdp_db_link_addr_remove(struct nhdp_laddr *);
 EXPORT void nhdp_db_link_addr_move(struct nhdp_link *, struct nhdp_laddr *);
@@ -331,7 +342,18 @@ EXPORT void nhdp_db_link_update_status(struct nhdp_link *);
 static INLINE struct nhdp_naddr *
 nhdp_db_neighbor_addr_get(const struct netaddr *addr) {
   struct nhdp_naddr *naddr;
-  return avl_find_element(&nhdp_naddr_tree, addr, naddr, _global_node);
+  uint32_t id = nhdp_addr_id_lookup(addr);
+  return avl_find_element(&nhdp_naddr_tree, &id, naddr, _global_node);
+}
+
+/**
+ * @param id interned originator address id
+ * @return corresponding nhdp neighbor, NULL if not found
+ */
+static INLINE struct nhdp_neighbor *
+nhdp_db_neighbor_get_by_originator_id(uint32_t id) {
+  struct nhdp_neighbor *neigh;
+  return avl_find_element(&nhdp_neigh_originator_tree, &id, neigh, _originator_node);
 }
 
 /**
@@ -340,8 +362,7 @@ nhdp_db_neighbor_addr_get(const struct netaddr *addr) {
  */
 static INLINE struct nhdp_neighbor *
 nhdp_db_neighbor_get_by_originator(const struct netaddr *originator) {
-  struct nhdp_neighbor *neigh;
-  return avl_find_element(&nhdp_neigh_originator_tree, originator, neigh, _originator_node);
+  return nhdp_db_neighbor_get_by_originator_id(nhdp_addr_id_lookup(originator));
 }
 
 /**
@@ -352,7 +373,8 @@ nhdp_db_neighbor_get_by_originator(const struct netaddr *originator) {
 static INLINE struct nhdp_laddr *
 nhdp_db_link_addr_get(const struct nhdp_link *lnk, const struct netaddr *addr) {
   struct nhdp_laddr *laddr;
-  return avl_find_element(&lnk->_addresses, addr, laddr, _link_node);
+  uint32_t id = nhdp_addr_id_lookup(addr);
+  return avl_find_element(&lnk->_addresses, &id, laddr, _link_node);
 }
 
 /**
@@ -363,7 +385,54 @@ nhdp_db_link_addr_get(const struct nhdp_link *lnk, const struct netaddr *addr) {
 static INLINE struct nhdp_l2hop *
 ndhp_db_link_2hop_get(const struct nhdp_link *lnk, const struct netaddr *addr) {
   struct nhdp_l2hop *l2hop;
-  return avl_find_element(&lnk->_2hop, addr, l2hop, _link_node);
+  uint32_t id = nhdp_addr_id_lookup(addr);
+  return avl_find_element(&lnk->_2hop, &id, l2hop, _link_node);
+}
+
+/**
+ * @param neigh nhdp neighbor
+ * @return originator address of neighbor, type AF_UNSPEC if not set
+ */
+static INLINE const struct netaddr *
+nhdp_db_neighbor_get_originator(const struct nhdp_neighbor *neigh) {
+  return nhdp_addr_id_get_netaddr(neigh->originator_id);
+}
+
+/**
+ * @param naddr nhdp neighbor address
+ * @return network address of neighbor address
+ */
+static INLINE const struct netaddr *
+nhdp_db_neighbor_addr_get_netaddr(const struct nhdp_naddr *naddr) {
+  return nhdp_addr_id_get_netaddr(naddr->neigh_addr_id);
+}
+
+/**
+ * @param lnk nhdp link
+ * @return interface address the link was heard from,
+ *   type AF_UNSPEC if not set
+ */
+static INLINE const struct netaddr *
+nhdp_db_link_get_ifaddr(const struct nhdp_link *lnk) {
+  return nhdp_addr_id_get_netaddr(lnk->if_addr_id);
+}
+
+/**
+ * @param laddr nhdp link address
+ * @return network address of link address
+ */
+static INLINE const struct netaddr *
+nhdp_db_link_addr_get_netaddr(const struct nhdp_laddr *laddr) {
+  return nhdp_addr_id_get_netaddr(laddr->link_addr_id);
+}
+
+/**
+ * @param l2hop nhdp link two-hop neighbor
+ * @return network address of two-hop neighbor
+ */
+static INLINE const struct netaddr *
+nhdp_db_link_2hop_get_netaddr(const struct nhdp_l2hop *l2hop) {
+  return nhdp_addr_id_get_netaddr(l2hop->twohop_addr_id);
 }
 
 /**
@@ -374,7 +443,7 @@ ndhp_db_link_2hop_get(const struct nhdp_link *lnk, const struct netaddr *addr) {
 static INLINE void
 nhdp_db_link_set_vtime(
     struct nhdp_link *lnk, uint64_t vtime) {
-  oonf_timer_set(&lnk->vtime, vtime);
+  nhdp_timer_set(&lnk->vtime, vtime);
 }
 
 /**
@@ -385,7 +454,7 @@ nhdp_db_link_set_vtime(
 static INLINE void
 nhdp_db_link_set_heardtime(
     struct nhdp_link *lnk, uint64_t htime) {
-  oonf_timer_set(&lnk->heard_time, htime);
+  nhdp_timer_set(&lnk->heard_time, htime);
 }
 
 /**
@@ -396,7 +465,7 @@ nhdp_db_link_set_heardtime(
 static INLINE void
 nhdp_db_link_set_symtime(
     struct nhdp_link *lnk, uint64_t stime) {
-  oonf_timer_set(&lnk->sym_time, stime);
+  nhdp_timer_set(&lnk->sym_time, stime);
   nhdp_db_link_update_status(lnk);
 }
 
@@ -408,7 +477,7 @@ nhdp_db_link_set_symtime(
 static INLINE void
 nhdp_db_link_2hop_set_vtime(
     struct nhdp_l2hop *l2hop, uint64_t vtime) {
-  oonf_timer_set(&l2hop->_vtime, vtime);
+  nhdp_timer_set(&l2hop->_vtime, vtime);
 }
 
 /**
@@ -418,7 +487,7 @@ nhdp_db_link_2hop_set_vtime(
  */
 static INLINE void
 nhdp_db_neighbor_addr_set_lost(struct nhdp_naddr *naddr, uint64_t vtime) {
-  oonf_timer_set(&naddr->_lost_vtime, vtime);
+  nhdp_timer_set(&naddr->_lost_vtime, vtime);
 }
 
 /**
@@ -427,7 +496,7 @@ nhdp_db_neighbor_addr_set_lost(struct nhdp_naddr *naddr, uint64_t vtime) {
  */
 static INLINE void
 nhdp_db_neighbor_addr_not_lost(struct nhdp_naddr *naddr) {
-  oonf_timer_stop(&naddr->_lost_vtime);
+  nhdp_timer_stop(&naddr->_lost_vtime);
 }
 
 /**
@@ -436,7 +505,7 @@ nhdp_db_neighbor_addr_not_lost(struct nhdp_naddr *naddr) {
  */
 static INLINE bool
 nhdp_db_neighbor_addr_is_lost(const struct nhdp_naddr *naddr) {
-  return oonf_timer_is_active(&naddr->_lost_vtime);
+  return nhdp_timer_is_active(&naddr->_lost_vtime);
 }
 
 /**
@@ -448,7 +517,7 @@ nhdp_db_neighbor_addr_is_lost(const struct nhdp_naddr *naddr) {
 static INLINE bool
 nhdp_db_link_is_dualstack_type(const struct nhdp_link *lnk, int af_type) {
   return lnk->dualstack_partner != NULL
-      && netaddr_get_address_family(&lnk->neigh->originator) == af_type;
+      && netaddr_get_address_family(nhdp_db_neighbor_get_originator(lnk->neigh)) == af_type;
 }
 
 /**
@@ -478,7 +547,7 @@ nhdp_db_link_is_ipv6_dualstack(const struct nhdp_link *lnk) {
 static INLINE bool
 nhdp_db_neighbor_is_dualstack_type(const struct nhdp_neighbor *neigh, int af_type) {
   return neigh->dualstack_partner != NULL
-      && netaddr_get_address_family(&neigh->originator) == af_type;
+      && netaddr_get_address_family(nhdp_db_neighbor_get_originator(neigh)) == af_type;
 }
 
 /**
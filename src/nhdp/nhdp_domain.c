@@ -51,6 +51,7 @@
 #include "core/oonf_cfg.h"
 #include "core/oonf_logging.h"
 #include "subsystems/oonf_class.h"
+#include "subsystems/oonf_timer.h"
 
 #include "nhdp/nhdp.h"
 #include "nhdp/nhdp_db.h"
@@ -64,6 +65,12 @@ static void _remove_mpr(struct nhdp_domain *);
 
 static void _recalculate_neighbor_metric(struct nhdp_domain *domain,
     struct nhdp_neighbor *neigh);
+static void _schedule_changes(void);
+static void _cb_process_changes(void *);
+static void _update_mprs(bool all);
+static void _check_mpr_changes(void);
+static int _add_domain_extensions(struct nhdp_domain *domain);
+static void _remove_domain_extensions(struct nhdp_domain *domain);
 static const char *_to_string(struct nhdp_metric_str *, uint32_t);
 
 /* domain class */
@@ -101,6 +108,9 @@ struct list_entity nhdp_domain_listener_list;
 
 static size_t _domain_counter = 0;
 
+/* number of changes of the best link of a neighbor in any domain */
+static uint32_t _best_link_generation;
+
 /* tree of known routing metrics/mpr-algorithms */
 struct avl_tree nhdp_domain_metrics;
 struct avl_tree nhdp_domain_mprs;
@@ -112,6 +122,27 @@ uint8_t _flooding_ext = 0;
 /* NHDP RFC5444 protocol */
 static struct oonf_rfc5444_protocol *_protocol;
 
+/*
+ * delay until changes of the neighborhood are processed, collects
+ * all changes of the messages received in one scheduler iteration
+ */
+#define NHDP_DOMAIN_CHANGE_DELAY 1
+
+/* neighbors which changed since the last processing */
+static struct list_entity _changed_neighbors;
+
+/* true if the whole neighborhood changed since the last processing */
+static bool _neighborhood_changed = false;
+
+static struct oonf_timer_info _change_timer_info = {
+  .name = "NHDP domain change processing",
+  .callback = _cb_process_changes,
+};
+
+static struct oonf_timer_entry _change_timer = {
+  .info = &_change_timer_info,
+};
+
 /**
  * Initialize nhdp metric core
  * @param p pointer to rfc5444 protocol
@@ -121,8 +152,10 @@ nhdp_domain_init(struct oonf_rfc5444_protocol *p) {
   _protocol = p;
 
   oonf_class_add(&_domain_class);
+  oonf_timer_add(&_change_timer_info);
   list_init_head(&nhdp_domain_list);
   list_init_head(&nhdp_domain_listener_list);
+  list_init_head(&_changed_neighbors);
 
   avl_init(&nhdp_domain_metrics, avl_comp_strcasecmp, false);
   avl_init(&nhdp_domain_mprs, avl_comp_strcasecmp, false);
@@ -135,8 +168,15 @@ void
 nhdp_domain_cleanup(void) {
   struct nhdp_domain *domain, *d_it;
   struct nhdp_domain_listener *listener, *l_it;
+  struct nhdp_neighbor *neigh, *n_it;
   int i;
 
+  oonf_timer_stop(&_change_timer);
+  list_for_each_element_safe(&_changed_neighbors, neigh, _domain_changed_node, n_it) {
+    list_remove(&neigh->_domain_changed_node);
+  }
+  _neighborhood_changed = false;
+
   list_for_each_element_safe(&nhdp_domain_list, domain, _node, d_it) {
     /* free allocated TLVs */
     for (i=0; i<4; i++) {
@@ -146,6 +186,8 @@ nhdp_domain_cleanup(void) {
     rfc5444_writer_unregister_addrtlvtype(
         &_protocol->writer, &domain->_mpr_addrtlv);
 
+    _remove_domain_extensions(domain);
+
     /* remove domain */
     list_remove(&domain->_node);
     oonf_class_free(&_domain_class, domain);
@@ -154,6 +196,7 @@ nhdp_domain_cleanup(void) {
   list_for_each_element_safe(&nhdp_domain_listener_list, listener, _node, l_it) {
     nhdp_domain_listener_remove(listener);
   }
+  oonf_timer_remove(&_change_timer_info);
   oonf_class_remove(&_domain_class);
 }
 
@@ -165,6 +208,17 @@ nhdp_domain_get_count(void) {
   return _domain_counter;
 }
 
+/**
+ * Get the current best link generation. The generation changes
+ * every time a neighbor selects a different best link (or outgoing
+ * interface) in any domain.
+ * @return best link generation
+ */
+uint32_t
+nhdp_domain_get_best_link_generation(void) {
+  return _best_link_generation;
+}
+
 /**
  * Add a new metric handler to nhdp
  * @param metric pointer to NHDP link metric
@@ -367,6 +421,19 @@ nhdp_domain_init_neighbor(struct nhdp_neighbor *neigh) {
     data->willingness = domain->mpr->willingness;
     data->local_is_mpr = domain->mpr->mprs_start;
     data->neigh_is_mpr = domain->mpr->mpr_start;
+    data->_last_neigh_is_mpr = data->neigh_is_mpr;
+  }
+}
+
+/**
+ * Remove a neighbor from the domain processing before it is removed
+ * from the nhdp database
+ * @param neigh pointer to nhdp neighbor
+ */
+void
+nhdp_domain_cleanup_neighbor(struct nhdp_neighbor *neigh) {
+  if (list_is_node_added(&neigh->_domain_changed_node)) {
+    list_remove(&neigh->_domain_changed_node);
   }
 }
 
@@ -416,57 +483,86 @@ nhdp_domain_process_metric_2hoptlv(struct nhdp_domain *domain,
 
 /**
  * Neighborhood changed in terms of metrics or connectivity.
- * This will trigger a MPR set recalculation.
+ * The neighbor metrics are recalculated right away, the MPR sets
+ * and the domain listeners are updated after all messages of the
+ * current scheduler iteration have been processed.
  */
 void
 nhdp_domain_neighborhood_changed(void) {
-  struct nhdp_domain_listener *listener;
   struct nhdp_domain *domain;
   struct nhdp_neighbor *neigh;
 
   list_for_each_element(&nhdp_domain_list, domain, _node) {
     list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
       _recalculate_neighbor_metric(domain, neigh);
-      domain->metric_changed = true;
-    }
-
-    if (domain->mpr->update_mpr != NULL) {
-      domain->mpr->update_mpr();
     }
   }
 
-  // TODO: flooding mpr ?
-
-  list_for_each_element(&nhdp_domain_listener_list, listener, _node) {
-    if (listener->update) {
-      listener->update(NULL);
-    }
-  }
+  _neighborhood_changed = true;
+  _schedule_changes();
 }
 
 /**
  * One neighbor changed in terms of metrics or connectivity.
- * This will trigger a MPR set recalculation.
+ * The metric of the neighbor is recalculated right away, the MPR sets
+ * and the domain listeners are updated after all messages of the
+ * current scheduler iteration have been processed. A neighbor
+ * changing multiple times is only processed once.
  * @param neigh neighbor where the changed happened
  */
 void
 nhdp_domain_neighbor_changed(struct nhdp_neighbor *neigh) {
-  struct nhdp_domain_listener *listener;
   struct nhdp_domain *domain;
 
   list_for_each_element(&nhdp_domain_list, domain, _node) {
     _recalculate_neighbor_metric(domain, neigh);
+  }
 
-    if (domain->mpr->update_mpr != NULL) {
-      domain->mpr->update_mpr();
-    }
+  if (!list_is_node_added(&neigh->_domain_changed_node)) {
+    list_add_tail(&_changed_neighbors, &neigh->_domain_changed_node);
+  }
+  _schedule_changes();
+}
+
+/**
+ * Recalculate the MPR sets for all changed neighbors
+ * and inform the domain listeners about them.
+ */
+void
+nhdp_domain_process_changes(void) {
+  struct nhdp_domain_listener *listener;
+  struct nhdp_neighbor *neigh, *n_it;
+  bool all;
+
+  oonf_timer_stop(&_change_timer);
+
+  all = _neighborhood_changed;
+  _neighborhood_changed = false;
+
+  if (!all && list_is_empty(&_changed_neighbors)) {
+    return;
   }
 
-  // TODO: flooding mpr ?
+  _update_mprs(all);
+  _check_mpr_changes();
 
-  list_for_each_element(&nhdp_domain_listener_list, listener, _node) {
-    if (listener->update) {
-      listener->update(neigh);
+  list_for_each_element_safe(&_changed_neighbors, neigh, _domain_changed_node, n_it) {
+    list_remove(&neigh->_domain_changed_node);
+
+    if (!all) {
+      list_for_each_element(&nhdp_domain_listener_list, listener, _node) {
+        if (listener->update) {
+          listener->update(neigh);
+        }
+      }
+    }
+  }
+
+  if (all) {
+    list_for_each_element(&nhdp_domain_listener_list, listener, _node) {
+      if (listener->update) {
+        listener->update(NULL);
+      }
     }
   }
 }
@@ -501,7 +597,7 @@ void
 nhdp_domain_process_willingness_tlv(struct nhdp_domain *domain,
     uint8_t tlvvalue) {
   /* copy routing willingness */
-  domain->mpr->_tmp_willingness =
+  domain->_tmp_willingness =
       tlvvalue & RFC5444_WILLINGNESS_ROUTING_MASK;
 
   if (domain->ext == _flooding_ext) {
@@ -510,6 +606,27 @@ nhdp_domain_process_willingness_tlv(struct nhdp_domain *domain,
   }
 }
 
+/**
+ * Copy the willingness values of the last parsed HELLO from the
+ * temporary storage into a neighbor
+ * @param neigh pointer to NHDP neighbor
+ */
+void
+nhdp_domain_store_willingness(struct nhdp_neighbor *neigh) {
+  struct nhdp_domain *domain;
+
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    if (!domain->mpr->no_default_handling) {
+      nhdp_domain_get_neighbordata(domain, neigh)->willingness =
+          domain->_tmp_willingness;
+    }
+  }
+
+  if (!_flooding_mpr->no_default_handling) {
+    neigh->flooding_willingness = _flooding_mpr->_tmp_willingness;
+  }
+}
+
 /**
  * Calculates the tlvvalue of a Willingness tlv
  * @param domain domain of the Willingness tlv
@@ -606,11 +723,15 @@ _recalculate_neighbor_metric(
   struct nhdp_link_domaindata *linkdata;
   struct nhdp_neighbor_domaindata *neighdata;
   struct nhdp_metric oldmetric;
+  struct nhdp_link *oldlink;
+  unsigned oldindex;
 
   neighdata = nhdp_domain_get_neighbordata(domain, neigh);
 
-  /* copy old metric value */
+  /* copy old metric value and best link */
   memcpy(&oldmetric, &neighdata->metric, sizeof(oldmetric));
+  oldlink = neighdata->best_link;
+  oldindex = neighdata->best_link_ifindex;
 
   /* reset metric */
   neighdata->metric.in = RFC5444_METRIC_INFINITE;
@@ -637,17 +758,121 @@ _recalculate_neighbor_metric(
         nhdp_interface_get_coreif(neighdata->best_link->local_if)->data.index;
   }
 
-  if (memcmp(&oldmetric, &neighdata->metric, sizeof(oldmetric)) != 0) {
-    /* mark metric as updated */
+  if (neighdata->best_link != oldlink
+      || neighdata->best_link_ifindex != oldindex) {
+    /* routes through this neighbor use a different next hop */
+    _best_link_generation++;
+  }
+
+  if (neighdata->neigh_is_mpr
+      && (rfc5444_metric_encode(oldmetric.in)
+            != rfc5444_metric_encode(neighdata->metric.in)
+          || rfc5444_metric_encode(oldmetric.out)
+            != rfc5444_metric_encode(neighdata->metric.out))) {
+    /* mark advertised metric as updated */
     domain->metric_changed = true;
   }
 }
 
 /**
- * Add a new domain to the NHDP system
+ * Start the timer for processing neighborhood changes
+ */
+static void
+_schedule_changes(void) {
+  if (!oonf_timer_is_active(&_change_timer)) {
+    oonf_timer_set(&_change_timer, NHDP_DOMAIN_CHANGE_DELAY);
+  }
+}
+
+/**
+ * Callback to process the collected neighborhood changes
+ * @param ptr not used
+ */
+static void
+_cb_process_changes(void *ptr __attribute__((unused))) {
+  nhdp_domain_process_changes();
+}
+
+/**
+ * Recalculate the routing MPRs of all domains and the flooding MPRs.
+ * Handlers with incremental support only process the changed
+ * neighbors, the others recalculate their MPR set once.
+ * @param all true if the whole neighborhood might have changed
+ */
+static void
+_update_mprs(bool all) {
+  struct nhdp_domain *domain;
+  struct nhdp_neighbor *neigh;
+
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    if (!all && domain->mpr->update_neighbor_mpr != NULL) {
+      list_for_each_element(&_changed_neighbors, neigh, _domain_changed_node) {
+        domain->mpr->update_neighbor_mpr(domain, neigh);
+      }
+    }
+    else if (domain->mpr->update_mpr != NULL) {
+      domain->mpr->update_mpr(domain);
+    }
+  }
+
+  domain = nhdp_domain_get_by_ext(_flooding_ext);
+  if (domain == NULL) {
+    return;
+  }
+
+  if (!all && _flooding_mpr->update_neighbor_flooding_mpr != NULL) {
+    list_for_each_element(&_changed_neighbors, neigh, _domain_changed_node) {
+      _flooding_mpr->update_neighbor_flooding_mpr(domain, neigh);
+    }
+  }
+  else if (_flooding_mpr->update_flooding_mpr != NULL) {
+    _flooding_mpr->update_flooding_mpr(domain);
+  }
+}
+
+/**
+ * Check which neighbors changed their MPR status during the last
+ * MPR calculation. The neighbors selected as MPRs are advertised
+ * in TCs, so a change of this set is a change of the domain.
+ */
+static void
+_check_mpr_changes(void) {
+  struct nhdp_neighbor_domaindata *data;
+  struct nhdp_domain *domain;
+  struct nhdp_neighbor *neigh;
+
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
+      data = nhdp_domain_get_neighbordata(domain, neigh);
+      if (data->neigh_is_mpr != data->_last_neigh_is_mpr) {
+        data->_last_neigh_is_mpr = data->neigh_is_mpr;
+        domain->metric_changed = true;
+      }
+    }
+  }
+}
+
+/**
+ * Check if a domain can be used by the configuration. New domains
+ * can only be added before the NHDP database is in use.
+ * @param ext TLV extension type of domain
+ * @return true if domain exists or can be added, false otherwise
+ */
+bool
+nhdp_domain_can_add(uint8_t ext) {
+  if (!nhdp_db_is_in_use() && _domain_counter < NHDP_MAXIMUM_DOMAINS) {
+    return true;
+  }
+  return nhdp_domain_get_by_ext(ext) != NULL;
+}
+
+/**
+ * Add a new domain to the NHDP system. New domains can only be added
+ * before the first NHDP link, neighbor or twohop neighbor is allocated.
  * @param ext TLV extension type used for new domain
- * @return pointer to new domain, NULL, if out of memory or
- *   maximum number of domains has been reached.
+ * @return pointer to new domain, NULL, if out of memory,
+ *   maximum number of domains has been reached or the NHDP
+ *   database is already in use.
  */
 struct nhdp_domain *
 nhdp_domain_add(uint8_t ext) {
@@ -671,6 +896,14 @@ nhdp_domain_add(uint8_t ext) {
     return NULL;
   }
 
+  /* reserve storage for the domain data in the NHDP database objects */
+  if (_add_domain_extensions(domain)) {
+    OONF_WARN(LOG_NHDP, "Cannot add NHDP domain %u,"
+        " database is already in use", ext);
+    oonf_class_free(&_domain_class, domain);
+    return NULL;
+  }
+
   domain->ext = ext;
   domain->index = _domain_counter++;
   domain->metric = &_no_metric;
@@ -700,6 +933,54 @@ nhdp_domain_add(uint8_t ext) {
   return domain;
 }
 
+/**
+ * Add the class extensions that store the domain data of
+ * NHDP links, neighbors and twohop neighbors. This only works
+ * as long as no database object has been allocated, so the
+ * memory of these objects is fixed after startup.
+ * @param domain pointer to NHDP domain
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_add_domain_extensions(struct nhdp_domain *domain) {
+  domain->_link_ext.name = NHDP_CLASS_DOMAIN;
+  domain->_link_ext.class_name = NHDP_CLASS_LINK;
+  domain->_link_ext.size = sizeof(struct nhdp_link_domaindata);
+
+  domain->_neigh_ext.name = NHDP_CLASS_DOMAIN;
+  domain->_neigh_ext.class_name = NHDP_CLASS_NEIGHBOR;
+  domain->_neigh_ext.size = sizeof(struct nhdp_neighbor_domaindata);
+
+  domain->_l2hop_ext.name = NHDP_CLASS_DOMAIN;
+  domain->_l2hop_ext.class_name = NHDP_CLASS_LINK_2HOP;
+  domain->_l2hop_ext.size = sizeof(struct nhdp_l2hop_domaindata);
+
+  if (oonf_class_extension_add(&domain->_link_ext)) {
+    return -1;
+  }
+  if (oonf_class_extension_add(&domain->_neigh_ext)) {
+    oonf_class_extension_remove(&domain->_link_ext);
+    return -1;
+  }
+  if (oonf_class_extension_add(&domain->_l2hop_ext)) {
+    oonf_class_extension_remove(&domain->_link_ext);
+    oonf_class_extension_remove(&domain->_neigh_ext);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Remove the class extensions of a NHDP domain
+ * @param domain pointer to NHDP domain
+ */
+static void
+_remove_domain_extensions(struct nhdp_domain *domain) {
+  oonf_class_extension_remove(&domain->_link_ext);
+  oonf_class_extension_remove(&domain->_neigh_ext);
+  oonf_class_extension_remove(&domain->_l2hop_ext);
+}
+
 /**
  * Configure a NHDP domain to a metric and a MPR algorithm
  * @param ext TLV extension type used for new domain
@@ -45,6 +45,7 @@
 #include "common/common_types.h"
 #include "common/list.h"
 #include "rfc5444/rfc5444_writer.h"
+#include "subsystems/oonf_class.h"
 #include "subsystems/oonf_rfc5444.h"
 
 #include "nhdp/nhdp_db.h"
@@ -92,8 +93,21 @@ struct nhdp_domain_mpr {
   /* name of handler */
   const char *name;
 
-  /* calculate MPR set */
-  void (*update_mpr)(void);
+  /* calculate routing MPR set of a domain */
+  void (*update_mpr)(struct nhdp_domain *);
+
+  /* calculate flooding MPR set, domain is the one transporting it */
+  void (*update_flooding_mpr)(struct nhdp_domain *);
+
+  /*
+   * update routing MPR set of a domain after a change of a single
+   * neighbor, NULL if the handler only supports complete calculations
+   */
+  void (*update_neighbor_mpr)(struct nhdp_domain *, struct nhdp_neighbor *);
+
+  /* update flooding MPR set after a change of a single neighbor */
+  void (*update_neighbor_flooding_mpr)(
+      struct nhdp_domain *, struct nhdp_neighbor *);
 
   /* routing willingness */
   enum rfc5444_willingness_values willingness;
@@ -110,7 +124,7 @@ struct nhdp_domain_mpr {
   /* backpointer to domain */
   struct nhdp_domain *domain;
 
-  /* temporary storage of willingness during message parsing */
+  /* temporary storage of flooding willingness during message parsing */
   uint8_t _tmp_willingness;
 
   /* node for tree of MPR algorithms */
@@ -132,14 +146,17 @@ struct nhdp_domain {
   struct nhdp_domain_mpr *mpr;
 
   /*
-   * true if a neighbor metric of this domain has changed
-   * since the last reset of this variable
+   * true if an advertised neighbor metric or the MPR set of this
+   * domain has changed since the last reset of this variable
    */
   bool metric_changed;
 
   /* tlv extension */
   uint8_t ext;
 
+  /* temporary storage of routing willingness during message parsing */
+  uint8_t _tmp_willingness;
+
   /* index in the metric array */
   int index;
 
@@ -149,6 +166,11 @@ struct nhdp_domain {
   /* storage for the additional mpr tlv */
   struct rfc5444_writer_tlvtype _mpr_addrtlv;
 
+  /* class extensions for the domain data of links, neighbors and 2-hop neighbors */
+  struct oonf_class_extension _link_ext;
+  struct oonf_class_extension _neigh_ext;
+  struct oonf_class_extension _l2hop_ext;
+
   /* list of nhdp domains */
   struct list_entity _node;
 };
@@ -167,6 +189,8 @@ void nhdp_domain_init(struct oonf_rfc5444_protocol *);
 void nhdp_domain_cleanup(void);
 
 EXPORT size_t nhdp_domain_get_count(void);
+EXPORT uint32_t nhdp_domain_get_best_link_generation(void);
+EXPORT bool nhdp_domain_can_add(uint8_t ext);
 EXPORT struct nhdp_domain *nhdp_domain_add(uint8_t ext);
 EXPORT struct nhdp_domain *nhdp_domain_configure(
     uint8_t ext, const char *metric_name, const char *mpr_name);
@@ -188,6 +212,7 @@ EXPORT struct nhdp_domain *nhdp_domain_get_by_ext(uint8_t);
 EXPORT void nhdp_domain_init_link(struct nhdp_link *);
 EXPORT void nhdp_domain_init_l2hop(struct nhdp_l2hop *);
 EXPORT void nhdp_domain_init_neighbor(struct nhdp_neighbor *);
+EXPORT void nhdp_domain_cleanup_neighbor(struct nhdp_neighbor *);
 
 EXPORT void nhdp_domain_process_metric_linktlv(struct nhdp_domain *,
     struct nhdp_link *lnk, uint16_t tlvvalue);
@@ -196,11 +221,13 @@ EXPORT void nhdp_domain_process_metric_2hoptlv(struct nhdp_domain *d,
 
 EXPORT void nhdp_domain_neighborhood_changed(void);
 EXPORT void nhdp_domain_neighbor_changed(struct nhdp_neighbor *neigh);
+EXPORT void nhdp_domain_process_changes(void);
 
 EXPORT void nhdp_domain_process_mpr_tlv(struct nhdp_domain *,
     struct nhdp_link *lnk, uint8_t tlvvalue);
 EXPORT void nhdp_domain_process_willingness_tlv(
     struct nhdp_domain *, uint8_t tlvvalue);
+EXPORT void nhdp_domain_store_willingness(struct nhdp_neighbor *);
 EXPORT uint8_t nhdp_domain_get_willingness_tlvvalue(
     struct nhdp_domain *);
 EXPORT uint8_t nhdp_domain_get_mpr_tlvvalue(
@@ -216,7 +243,7 @@ EXPORT void nhdp_domain_set_incoming_metric(
  */
 static INLINE struct nhdp_link_domaindata *
 nhdp_domain_get_linkdata(struct nhdp_domain *domain, struct nhdp_link *lnk) {
-  return &lnk->_domaindata[domain->index];
+  return oonf_class_get_extension(&domain->_link_ext, lnk);
 }
 
 /**
@@ -227,7 +254,7 @@ nhdp_domain_get_linkdata(struct nhdp_domain *domain, struct nhdp_link *lnk) {
 static INLINE struct nhdp_neighbor_domaindata *
 nhdp_domain_get_neighbordata(
     struct nhdp_domain *domain, struct nhdp_neighbor *neigh) {
-  return &neigh->_domaindata[domain->index];
+  return oonf_class_get_extension(&domain->_neigh_ext, neigh);
 }
 
 /**
@@ -238,7 +265,7 @@ nhdp_domain_get_neighbordata(
 static INLINE struct nhdp_l2hop_domaindata *
 nhdp_domain_get_l2hopdata(
     struct nhdp_domain *domain, struct nhdp_l2hop *l2hop) {
-  return &l2hop->_domaindata[domain->index];
+  return oonf_class_get_extension(&domain->_l2hop_ext, l2hop);
 }
 
 #endif /* NHDP_DOMAIN_H_ */
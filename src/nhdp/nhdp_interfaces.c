@@ -63,6 +63,7 @@
 static void _addr_add(struct nhdp_interface *, struct netaddr *addr);
 static void _addr_remove(struct nhdp_interface_addr *addr, uint64_t vtime);
 static void _cb_remove_addr(void *ptr);
+static void _reset_hello_hashes(void);
 
 static int avl_comp_ifaddr(const void *k1, const void *k2);
 
@@ -150,12 +151,12 @@ nhdp_interface_update_status(struct nhdp_interface *interf) {
     }
 
     /* originator can be AF_UNSPEC, so we cannot use "else" */
-    if (netaddr_get_address_family(&lnk->neigh->originator) == AF_INET
+    if (netaddr_get_address_family(nhdp_db_neighbor_get_originator(lnk->neigh)) == AF_INET
         && lnk->dualstack_partner == NULL) {
       /* ipv4 neighbor without dualstack */
       interf->use_ipv4_for_flooding = true;
     }
-    if (netaddr_get_address_family(&lnk->neigh->originator) == AF_INET6
+    if (netaddr_get_address_family(nhdp_db_neighbor_get_originator(lnk->neigh)) == AF_INET6
         || lnk->dualstack_partner != NULL) {
       /* ipv6 neighbor or dualstack neighbor */
       interf->use_ipv6_for_flooding = true;
@@ -204,10 +205,10 @@ nhdp_interface_add(const char *name) {
     list_init_head(&interf->_links);
 
     /* init link address tree */
-    avl_init(&interf->_link_addresses, avl_comp_netaddr, false);
+    avl_init(&interf->_link_addresses, avl_comp_uint32, false);
 
     /* init originator tree */
-    avl_init(&interf->_link_originators, avl_comp_netaddr, false);
+    avl_init(&interf->_link_originators, avl_comp_uint32, false);
 
     /* trigger event */
     oonf_class_event(&_interface_info, interf, OONF_OBJECT_ADDED);
@@ -302,11 +303,15 @@ _addr_add(struct nhdp_interface *interf, struct netaddr *addr) {
 
     /* trigger event */
     oonf_class_event(&_addr_info, if_addr, OONF_OBJECT_ADDED);
+    _reset_hello_hashes();
   }
   else {
     oonf_timer_stop(&if_addr->_vtime);
     if_addr->_to_be_removed = false;
-    if_addr->removed = false;
+    if (if_addr->removed) {
+      if_addr->removed = false;
+      _reset_hello_hashes();
+    }
   }
   return;
 }
@@ -327,6 +332,8 @@ _addr_remove(struct nhdp_interface_addr *addr, uint64_t vtime) {
 
   addr->removed = true;
   oonf_timer_set(&addr->_vtime, vtime);
+
+  _reset_hello_hashes();
 }
 
 /**
@@ -349,6 +356,19 @@ _cb_remove_addr(void *ptr) {
   oonf_class_free(&_addr_info, addr);
 }
 
+/**
+ * Forget the HELLO fingerprints of all links, local addresses
+ * change the processing of the addresses in a HELLO
+ */
+static void
+_reset_hello_hashes(void) {
+  struct nhdp_link *lnk;
+
+  list_for_each_element(&nhdp_link_list, lnk, _global_node) {
+    lnk->hello_hash = 0;
+  }
+}
+
 /**
  * AVL tree comparator for netaddr objects.
  * @param k1 pointer to key 1
@@ -226,6 +226,18 @@ nhdp_interface_remove_laddr(struct nhdp_laddr *laddr) {
   avl_remove(&laddr->link->local_if->_link_addresses, &laddr->_if_node);
 }
 
+/**
+ * @param interf local nhdp interface
+ * @param id interned address id
+ * @return link address object fitting the address id, NULL if not found
+ */
+static INLINE struct nhdp_laddr *
+nhdp_interface_get_link_addr_by_id(const struct nhdp_interface *interf, uint32_t id) {
+  struct nhdp_laddr *laddr;
+
+  return avl_find_element(&interf->_link_addresses, &id, laddr, _if_node);
+}
+
 /**
  * @param interf local nhdp interface
  * @param addr network address
@@ -233,9 +245,7 @@ nhdp_interface_remove_laddr(struct nhdp_laddr *laddr) {
  */
 static INLINE struct nhdp_laddr *
 nhdp_interface_get_link_addr(const struct nhdp_interface *interf, const struct netaddr *addr) {
-  struct nhdp_laddr *laddr;
-
-  return avl_find_element(&interf->_link_addresses, addr, laddr, _if_node);
+  return nhdp_interface_get_link_addr_by_id(interf, nhdp_addr_id_lookup(addr));
 }
 
 /**
@@ -247,7 +257,8 @@ static INLINE struct nhdp_link *
 nhdp_interface_link_get_by_originator(
     const struct nhdp_interface *interf, const struct netaddr *originator) {
   struct nhdp_link *lnk;
-  return avl_find_element(&interf->_link_originators, originator, lnk, _originator_node);
+  uint32_t id = nhdp_addr_id_lookup(originator);
+  return avl_find_element(&interf->_link_originators, &id, lnk, _originator_node);
 }
 
 /**
@@ -0,0 +1,232 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#include <stdlib.h>
+
+#include "common/common_types.h"
+#include "common/netaddr.h"
+
+#include "nhdp/nhdp_netaddr_hash.h"
+
+/* smallest number of slots of a non-empty hash index */
+#define NHDP_NETADDR_HASH_MIN_SIZE 16
+
+static uint32_t _hash(const struct netaddr *addr);
+static int _resize(struct nhdp_netaddr_hash *, uint32_t size);
+static void _insert(struct nhdp_netaddr_hash *,
+    const struct netaddr *key, uint32_t hash);
+
+/**
+ * Initialize an empty hash index, no memory is allocated
+ * before the first key is added
+ * @param hash pointer to hash index
+ */
+void
+nhdp_netaddr_hash_init(struct nhdp_netaddr_hash *hash) {
+  hash->_slots = NULL;
+  hash->_mask = 0;
+  hash->count = 0;
+}
+
+/**
+ * Free the memory of a hash index, the keys are not touched
+ * @param hash pointer to hash index
+ */
+void
+nhdp_netaddr_hash_cleanup(struct nhdp_netaddr_hash *hash) {
+  free(hash->_slots);
+  nhdp_netaddr_hash_init(hash);
+}
+
+/**
+ * Add a key to a hash index. The key must stay valid and unchanged
+ * until it is removed again and must not be in the index yet.
+ * @param hash pointer to hash index
+ * @param key pointer to key
+ * @return -1 if out of memory, 0 otherwise
+ */
+int
+nhdp_netaddr_hash_add(struct nhdp_netaddr_hash *hash,
+    const struct netaddr *key) {
+  uint32_t size;
+
+  /* keep load factor at or below one half */
+  size = hash->_slots == NULL ? 0 : hash->_mask + 1;
+  if ((hash->count + 1) * 2 > size) {
+    if (_resize(hash, size == 0 ? NHDP_NETADDR_HASH_MIN_SIZE : size * 2)) {
+      return -1;
+    }
+  }
+
+  _insert(hash, key, _hash(key));
+  hash->count++;
+  return 0;
+}
+
+/**
+ * Remove a key from a hash index
+ * @param hash pointer to hash index
+ * @param key pointer to the key that was added to the index
+ */
+void
+nhdp_netaddr_hash_remove(struct nhdp_netaddr_hash *hash,
+    const struct netaddr *key) {
+  struct nhdp_netaddr_hash_slot *slots;
+  uint32_t i, j, home;
+
+  if (hash->count == 0) {
+    return;
+  }
+
+  slots = hash->_slots;
+  for (i = _hash(key) & hash->_mask; slots[i].key != key;
+      i = (i + 1) & hash->_mask) {
+    if (slots[i].key == NULL) {
+      /* key is not in index */
+      return;
+    }
+  }
+
+  /* shift following entries of the probe sequence back into the gap */
+  for (j = (i + 1) & hash->_mask; slots[j].key != NULL;
+      j = (j + 1) & hash->_mask) {
+    home = slots[j].hash & hash->_mask;
+
+    /* move entry if its home slot is not between the gap and itself */
+    if (((j - home) & hash->_mask) >= ((j - i) & hash->_mask)) {
+      slots[i] = slots[j];
+      i = j;
+    }
+  }
+  slots[i].key = NULL;
+  hash->count--;
+
+  /* shrink sparse index, keep current slots if this fails */
+  if (hash->count * 8 < hash->_mask + 1
+      && hash->_mask + 1 > NHDP_NETADDR_HASH_MIN_SIZE) {
+    _resize(hash, (hash->_mask + 1) / 2);
+  }
+}
+
+/**
+ * Lookup an address in a hash index
+ * @param hash pointer to hash index
+ * @param addr pointer to address
+ * @return pointer to key equal to the address, NULL if not found
+ */
+const struct netaddr *
+nhdp_netaddr_hash_get(const struct nhdp_netaddr_hash *hash,
+    const struct netaddr *addr) {
+  const struct nhdp_netaddr_hash_slot *slots;
+  uint32_t h, i;
+
+  if (hash->count == 0) {
+    return NULL;
+  }
+
+  slots = hash->_slots;
+  h = _hash(addr);
+  for (i = h & hash->_mask; slots[i].key != NULL; i = (i + 1) & hash->_mask) {
+    if (slots[i].hash == h && netaddr_cmp(slots[i].key, addr) == 0) {
+      return slots[i].key;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Calculate the hash value of an address, all bytes compared
+ * by netaddr_cmp() are used
+ * @param addr pointer to address
+ * @return 32 bit FNV-1a hash
+ */
+static uint32_t
+_hash(const struct netaddr *addr) {
+  return nhdp_hash_fnv1a_add(NHDP_HASH_FNV1A_INIT, addr, sizeof(*addr));
+}
+
+/**
+ * Move all keys of a hash index into a new array of slots
+ * @param hash pointer to hash index
+ * @param size new number of slots, must be a power of two
+ * @return -1 if out of memory, 0 otherwise
+ */
+static int
+_resize(struct nhdp_netaddr_hash *hash, uint32_t size) {
+  struct nhdp_netaddr_hash_slot *old_slots;
+  uint32_t i, old_size;
+
+  old_slots = hash->_slots;
+  old_size = old_slots == NULL ? 0 : hash->_mask + 1;
+
+  hash->_slots = calloc(size, sizeof(*hash->_slots));
+  if (hash->_slots == NULL) {
+    hash->_slots = old_slots;
+    return -1;
+  }
+  hash->_mask = size - 1;
+
+  for (i=0; i<old_size; i++) {
+    if (old_slots[i].key != NULL) {
+      _insert(hash, old_slots[i].key, old_slots[i].hash);
+    }
+  }
+  free(old_slots);
+  return 0;
+}
+
+/**
+ * Put a key into the first free slot of its probe sequence
+ * @param hash pointer to hash index
+ * @param key pointer to key
+ * @param h hash value of key
+ */
+static void
+_insert(struct nhdp_netaddr_hash *hash,
+    const struct netaddr *key, uint32_t h) {
+  uint32_t i;
+
+  for (i = h & hash->_mask; hash->_slots[i].key != NULL;
+      i = (i + 1) & hash->_mask);
+
+  hash->_slots[i].key = key;
+  hash->_slots[i].hash = h;
+}
@@ -0,0 +1,118 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#ifndef NHDP_NETADDR_HASH_H_
+#define NHDP_NETADDR_HASH_H_
+
+#include "common/common_types.h"
+#include "common/container_of.h"
+#include "common/netaddr.h"
+
+/*
+ * Open addressing hash index over netaddr keys embedded into
+ * user data structures (similar to the avl_node key). The index
+ * does not own the data, it only stores pointers to the keys.
+ */
+
+/* start value of a FNV-1a hash */
+#define NHDP_HASH_FNV1A_INIT 2166136261u
+
+/* slot of a hash index */
+struct nhdp_netaddr_hash_slot {
+  /* pointer to key, NULL if slot is empty */
+  const struct netaddr *key;
+
+  /* hash value of key */
+  uint32_t hash;
+};
+
+/* hash index with linear probing */
+struct nhdp_netaddr_hash {
+  /* array of slots, number of slots is a power of two */
+  struct nhdp_netaddr_hash_slot *_slots;
+
+  /* number of slots minus one */
+  uint32_t _mask;
+
+  /* number of keys in index */
+  uint32_t count;
+};
+
+/**
+ * @param hash pointer to hash index
+ * @param addr pointer to address
+ * @param element pointer to a helper variable of the element type
+ * @param key_member name of the netaddr key inside the element
+ * @return pointer to element with the key, NULL if not found
+ */
+#define nhdp_netaddr_hash_get_element(hash, addr, element, key_member) \
+    container_of_if_notnull(nhdp_netaddr_hash_get(hash, addr), \
+        __typeof__(*(element)), key_member)
+
+void nhdp_netaddr_hash_init(struct nhdp_netaddr_hash *);
+void nhdp_netaddr_hash_cleanup(struct nhdp_netaddr_hash *);
+int nhdp_netaddr_hash_add(struct nhdp_netaddr_hash *,
+    const struct netaddr *key);
+void nhdp_netaddr_hash_remove(struct nhdp_netaddr_hash *,
+    const struct netaddr *key);
+const struct netaddr *nhdp_netaddr_hash_get(
+    const struct nhdp_netaddr_hash *, const struct netaddr *addr);
+
+/**
+ * Add a block of data to a FNV-1a hash
+ * @param h current hash value, NHDP_HASH_FNV1A_INIT for a new hash
+ * @param data pointer to data
+ * @param len length of data
+ * @return new hash value
+ */
+static INLINE uint32_t
+nhdp_hash_fnv1a_add(uint32_t h, const void *data, size_t len) {
+  const uint8_t *ptr = data;
+  size_t i;
+
+  for (i=0; i<len; i++) {
+    h ^= ptr[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+#endif /* NHDP_NETADDR_HASH_H_ */
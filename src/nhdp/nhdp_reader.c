@@ -52,6 +52,7 @@
 #include "nhdp/nhdp_db.h"
 #include "nhdp/nhdp_hysteresis.h"
 #include "nhdp/nhdp_interfaces.h"
+#include "nhdp/nhdp_netaddr_hash.h"
 #include "nhdp/nhdp_domain.h"
 #include "nhdp/nhdp_reader.h"
 
@@ -72,6 +73,9 @@ enum {
 enum {
   IDX_ADDRTLV1_LOCAL_IF,
   IDX_ADDRTLV1_LINK_STATUS,
+  IDX_ADDRTLV1_OTHER_NEIGHB,
+  IDX_ADDRTLV1_MPR,
+  IDX_ADDRTLV1_LINKMETRIC,
 };
 
 /* NHDP address TLV array index pass 2 */
@@ -87,6 +91,7 @@ enum {
 static void _cleanup_error(void);
 static enum rfc5444_result _pass2_process_localif(struct netaddr *addr, uint8_t local_if);
 static void _handle_originator(struct rfc5444_reader_tlvblock_context *context);
+static void _process_leftover_addresses(void);
 
 static enum rfc5444_result
 _cb_messagetlvs(struct rfc5444_reader_tlvblock_context *context);
@@ -134,6 +139,13 @@ static struct rfc5444_reader_tlvblock_consumer_entry _nhdp_address_pass1_tlvs[]
       .min_length = 1, .match_length = true },
   [IDX_ADDRTLV1_LINK_STATUS] = { .type = RFC5444_ADDRTLV_LINK_STATUS, .type_ext = 0, .match_type_ext = true,
       .min_length = 1, .match_length = true },
+
+  /* only used for the fingerprint of the HELLO */
+  [IDX_ADDRTLV1_OTHER_NEIGHB] = { .type = RFC5444_ADDRTLV_OTHER_NEIGHB, .type_ext = 0, .match_type_ext = true,
+      .min_length = 1, .match_length = true },
+  [IDX_ADDRTLV1_MPR] = { .type = RFC5444_ADDRTLV_MPR,
+      .min_length = 1, .match_length = true },
+  [IDX_ADDRTLV1_LINKMETRIC] = { .type = RFC5444_ADDRTLV_LINK_METRIC, .min_length = 2, .match_length = true },
 };
 
 static struct rfc5444_reader_tlvblock_consumer _nhdp_message_pass2_consumer = {
@@ -180,9 +192,18 @@ static struct {
 
   bool originator_in_addrblk;
 
+  /* true if the HELLO has the same content as the last one of the link */
+  bool refresh;
+
+  /* fingerprint of the HELLO content */
+  uint32_t hello_hash;
+
   uint64_t vtime, itime;
 } _current;
 
+/* statistics of HELLO processing */
+static struct nhdp_reader_statistics _stats;
+
 /**
  * Initialize nhdp reader
  */
@@ -218,6 +239,14 @@ nhdp_reader_cleanup(void) {
       &_protocol->reader, &_nhdp_message_pass1_consumer);
 }
 
+/**
+ * @return pointer to statistics of HELLO processing
+ */
+const struct nhdp_reader_statistics *
+nhdp_reader_get_statistics(void) {
+  return &_stats;
+}
+
 /**
  * An error happened during processing and the message was dropped.
  * Make sure that there are no uninitialized datastructures left.
@@ -359,6 +388,7 @@ _cb_messagetlvs(struct rfc5444_reader_tlvblock_context *context) {
   struct nhdp_neighbor *neigh;
   struct nhdp_link *lnk;
   struct nhdp_domain *domain;
+  size_t domain_count;
 #ifdef OONF_LOG_DEBUG_INFO
   struct netaddr_str buf;
 #endif
@@ -397,13 +427,33 @@ _cb_messagetlvs(struct rfc5444_reader_tlvblock_context *context) {
         _nhdp_message_tlvs[IDX_TLV_ITIME].tlv->single_value[0]);
   }
 
-  /* extract willingness */
+  /* extract willingness, a missing TLV means 'never' */
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    nhdp_domain_process_willingness_tlv(domain, RFC5444_WILLINGNESS_NEVER);
+  }
+
+  /*
+   * start the fingerprint of the HELLO with the content which is only
+   * stored during address processing. The domain count is part of
+   * the hash because TLVs of unknown domains are ignored.
+   */
+  domain_count = nhdp_domain_get_count();
+  _current.hello_hash = nhdp_hash_fnv1a_add(NHDP_HASH_FNV1A_INIT,
+      &domain_count, sizeof(domain_count));
+  _current.hello_hash = nhdp_hash_fnv1a_add(_current.hello_hash,
+      _protocol->input_address, sizeof(*_protocol->input_address));
+
   tlv = _nhdp_message_tlvs[IDX_TLV_WILLINGNESS].tlv;
   while (tlv) {
     domain = nhdp_domain_get_by_ext(tlv->type_ext);
     if (domain != NULL && !domain->mpr->no_default_handling) {
       nhdp_domain_process_willingness_tlv(domain, tlv->single_value[0]);
     }
+
+    _current.hello_hash = nhdp_hash_fnv1a_add(_current.hello_hash,
+        &tlv->type_ext, sizeof(tlv->type_ext));
+    _current.hello_hash = nhdp_hash_fnv1a_add(_current.hello_hash,
+        tlv->single_value, tlv->length);
     tlv = tlv->next_entry;
   }
 
@@ -448,13 +498,29 @@ _cb_messagetlvs(struct rfc5444_reader_tlvblock_context *context) {
  */
 static enum rfc5444_result
 _cb_addresstlvs_pass1(struct rfc5444_reader_tlvblock_context *context) {
+  struct rfc5444_reader_tlvblock_entry *tlv;
   uint8_t local_if, link_status;
   struct nhdp_naddr *naddr;
   struct nhdp_laddr *laddr;
+  size_t i;
 #ifdef OONF_LOG_DEBUG_INFO
   struct netaddr_str buf;
 #endif
 
+  /* hash address and TLV values */
+  _current.hello_hash = nhdp_hash_fnv1a_add(_current.hello_hash,
+      &context->addr, sizeof(context->addr));
+  for (i=0; i<ARRAYSIZE(_nhdp_address_pass1_tlvs); i++) {
+    for (tlv = _nhdp_address_pass1_tlvs[i].tlv; tlv; tlv = tlv->next_entry) {
+      _current.hello_hash = nhdp_hash_fnv1a_add(_current.hello_hash,
+          &tlv->type, sizeof(tlv->type));
+      _current.hello_hash = nhdp_hash_fnv1a_add(_current.hello_hash,
+          &tlv->type_ext, sizeof(tlv->type_ext));
+      _current.hello_hash = nhdp_hash_fnv1a_add(_current.hello_hash,
+          tlv->single_value, tlv->length);
+    }
+  }
+
   local_if = 255;
   link_status = 255;
 
@@ -565,6 +631,18 @@ _cb_addresstlvs_pass1_end(struct rfc5444_reader_tlvblock_context *context, bool
     _handle_originator(context);
   }
 
+  /*
+   * a HELLO with the same content as the last one of the link
+   * does not change any address, so the link is only refreshed
+   */
+  if (_current.hello_hash == 0) {
+    /* 0 is reserved for 'unknown' */
+    _current.hello_hash = 1;
+  }
+  _current.refresh = _current.neighbor != NULL && _current.link != NULL
+      && _current.link->neigh == _current.neighbor
+      && _current.link->hello_hash == _current.hello_hash;
+
   /* allocate neighbor and link if necessary */
   if (_current.neighbor == NULL) {
     OONF_DEBUG(LOG_NHDP_R, "Create new neighbor");
@@ -573,10 +651,10 @@ _cb_addresstlvs_pass1_end(struct rfc5444_reader_tlvblock_context *context, bool
       return RFC5444_DROP_MESSAGE;
     }
   }
-  else {
+  else if (!_current.refresh) {
     /* mark existing neighbor addresses */
     avl_for_each_element(&_current.neighbor->_neigh_addresses, naddr, _neigh_node) {
-      if (netaddr_get_binlength(&naddr->neigh_addr) == context->addr_len) {
+      if (netaddr_get_binlength(nhdp_db_neighbor_addr_get_netaddr(naddr)) == context->addr_len) {
         naddr->_might_be_removed = true;
       }
     }
@@ -590,7 +668,7 @@ _cb_addresstlvs_pass1_end(struct rfc5444_reader_tlvblock_context *context, bool
       return RFC5444_DROP_MESSAGE;
     }
   }
-  else {
+  else if (!_current.refresh) {
     /* mark existing link addresses */
     avl_for_each_element(&_current.link->_addresses, laddr, _link_node) {
       laddr->_might_be_removed = true;
@@ -598,7 +676,7 @@ _cb_addresstlvs_pass1_end(struct rfc5444_reader_tlvblock_context *context, bool
   }
 
   /* copy interface address of link */
-  memcpy(&_current.link->if_addr, _protocol->input_address, sizeof(struct netaddr));
+  nhdp_db_link_set_ifaddr(_current.link, _protocol->input_address);
 
   /* copy mac address */
   if (netaddr_get_address_family(&_current.mac) == AF_MAC48) {
@@ -716,12 +794,8 @@ _process_domainspecific_linkdata(struct netaddr *addr __attribute__((unused))) {
     tlv = tlv->next_entry;
   }
 
-  /* process willingness TLVs stored from message TLV processing */
-  list_for_each_element(&nhdp_domain_list, domain, _node) {
-    if (!domain->mpr->no_default_handling) {
-      nhdp_domain_process_willingness_tlv(domain, domain->mpr->_tmp_willingness);
-    }
-  }
+  /* store willingness TLVs from message TLV processing */
+  nhdp_domain_store_willingness(_current.neighbor);
 }
 
 /**
@@ -784,6 +858,11 @@ _cb_addr_pass2_block(struct rfc5444_reader_tlvblock_context *context) {
   struct netaddr_str buf;
 #endif
 
+  if (_current.refresh) {
+    /* nothing changed since the last HELLO of the link */
+    return RFC5444_OKAY;
+  }
+
   local_if = 255;
   link_status = 255;
   other_neigh = 255;
@@ -844,23 +923,14 @@ _cb_addr_pass2_block(struct rfc5444_reader_tlvblock_context *context) {
 }
 
 /**
- * Finalize changes of the database and update the status of the link
- * @param consumer
- * @param context
- * @param dropped
- * @return
+ * Remove link addresses and mark neighbor addresses as lost which
+ * have not been part of the HELLO anymore
  */
-static enum rfc5444_result
-_cb_msg_pass2_end(struct rfc5444_reader_tlvblock_context *context, bool dropped) {
+static void
+_process_leftover_addresses(void) {
   struct nhdp_naddr *naddr;
   struct nhdp_laddr *laddr, *la_it;
   struct nhdp_l2hop *twohop, *twohop_it;
-  uint64_t t;
-
-  if (dropped) {
-    _cleanup_error();
-    return RFC5444_OKAY;
-  }
 
   /* remove leftover link addresses */
   avl_for_each_element_safe(&_current.link->_addresses, laddr, _link_node, la_it) {
@@ -877,7 +947,7 @@ _cb_msg_pass2_end(struct rfc5444_reader_tlvblock_context *context, bool dropped)
 
       /* section 12.6.1: remove all similar n2 addresses */
       // TODO: not nice, replace with new iteration macro
-      twohop_it = avl_find_element(&_current.link->_2hop, &naddr->neigh_addr, twohop_it, _link_node);
+      twohop_it = avl_find_element(&_current.link->_2hop, &naddr->neigh_addr_id, twohop_it, _link_node);
       while (twohop_it) {
         twohop = twohop_it;
         twohop_it = avl_next_element_safe(&_current.link->_2hop, twohop_it, _link_node);
@@ -889,16 +959,49 @@ _cb_msg_pass2_end(struct rfc5444_reader_tlvblock_context *context, bool dropped)
       }
     }
   }
+}
+
+/**
+ * Finalize changes of the database and update the status of the link
+ * @param consumer
+ * @param context
+ * @param dropped
+ * @return
+ */
+static enum rfc5444_result
+_cb_msg_pass2_end(struct rfc5444_reader_tlvblock_context *context, bool dropped) {
+  struct nhdp_l2hop *twohop;
+  enum nhdp_link_status status;
+  uint64_t t;
+
+  if (dropped) {
+    _cleanup_error();
+    return RFC5444_OKAY;
+  }
+
+  _stats.hellos++;
+
+  if (_current.refresh) {
+    _stats.hello_refreshes++;
+
+    /* the same two-hop neighbors have been announced again */
+    avl_for_each_element(&_current.link->_2hop, twohop, _link_node) {
+      nhdp_db_link_2hop_set_vtime(twohop, _current.vtime);
+    }
+  }
+  else {
+    _process_leftover_addresses();
+  }
 
   /* Section 12.5.4: update link */
   if (_current.link_heard) {
     /* Section 12.5.4.1.1: we have been heard, so the link is symmetric */
-    oonf_timer_set(&_current.link->sym_time, _current.vtime);
+    nhdp_timer_set(&_current.link->sym_time, _current.vtime);
   }
   else if (_current.link_lost) {
     /* Section 12.5.4.1.2 */
-    if (oonf_timer_is_active(&_current.link->sym_time)) {
-      oonf_timer_stop(&_current.link->sym_time);
+    if (nhdp_timer_is_active(&_current.link->sym_time)) {
+      nhdp_timer_stop(&_current.link->sym_time);
 
       /*
        * the stop timer might have modified to link status, but do not trigger
@@ -911,11 +1014,11 @@ _cb_msg_pass2_end(struct rfc5444_reader_tlvblock_context *context, bool dropped)
   }
 
   /* Section 12.5.4.3 */
-  t = oonf_timer_get_due(&_current.link->sym_time);
-  if (!oonf_timer_is_active(&_current.link->sym_time) || t < _current.vtime) {
+  t = nhdp_timer_get_due(&_current.link->sym_time);
+  if (!nhdp_timer_is_active(&_current.link->sym_time) || t < _current.vtime) {
     t = _current.vtime;
   }
-  oonf_timer_set(&_current.link->heard_time, t);
+  nhdp_timer_set(&_current.link->heard_time, t);
 
   /* Section 12.5.4.4: link status pending is not influenced by the code above */
   if (_current.link->status != NHDP_LINK_PENDING) {
@@ -923,22 +1026,36 @@ _cb_msg_pass2_end(struct rfc5444_reader_tlvblock_context *context, bool dropped)
   }
 
   /* Section 12.5.4.5 */
-  if (!oonf_timer_is_active(&_current.link->vtime)
-      || (int64_t)t > oonf_timer_get_due(&_current.link->vtime)) {
-    oonf_timer_set(&_current.link->vtime, t);
+  if (!nhdp_timer_is_active(&_current.link->vtime)
+      || (int64_t)t > nhdp_timer_get_due(&_current.link->vtime)) {
+    nhdp_timer_set(&_current.link->vtime, t);
   }
 
   /* overwrite originator of neighbor entry */
   nhdp_db_neighbor_set_originator(_current.neighbor, &context->orig_addr);
 
-  /* update MPR sets and link metrics */
-  nhdp_domain_neighbor_changed(_current.neighbor);
+  if (!_current.refresh) {
+    /* update MPR sets and link metrics */
+    nhdp_domain_neighbor_changed(_current.neighbor);
+
+    /*
+     * remember content of the HELLO, a status change of the link
+     * below will reset the hash again
+     */
+    _current.link->hello_hash = _current.hello_hash;
+  }
 
   /* update ip flooding settings */
   nhdp_interface_update_status(_current.localif);
 
   /* update link status */
+  status = _current.link->status;
   nhdp_db_link_update_status(_current.link);
 
+  if (_current.refresh && status != _current.link->status) {
+    /* update MPR sets and link metrics */
+    nhdp_domain_neighbor_changed(_current.neighbor);
+  }
+
   return RFC5444_OKAY;
 }
@@ -45,7 +45,18 @@
 #include "common/common_types.h"
 #include "subsystems/oonf_rfc5444.h"
 
+/* statistics of the HELLO processing */
+struct nhdp_reader_statistics {
+  /* number of processed HELLOs */
+  uint32_t hellos;
+
+  /* number of HELLOs with unchanged content that only refreshed a link */
+  uint32_t hello_refreshes;
+};
+
 void nhdp_reader_init(struct oonf_rfc5444_protocol *);
 void nhdp_reader_cleanup(void);
 
+EXPORT const struct nhdp_reader_statistics *nhdp_reader_get_statistics(void);
+
 #endif /* NHDP_INCOMING_H_ */
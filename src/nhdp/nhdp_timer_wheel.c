@@ -0,0 +1,483 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#include "common/common_types.h"
+#include "common/list.h"
+#include "subsystems/oonf_clock.h"
+#include "subsystems/oonf_timer.h"
+
+#include "nhdp/nhdp_timer_wheel.h"
+
+/* the occupied slot bitmaps have one bit per slot */
+#if NHDP_TIMER_WHEEL_SLOTS != 64
+#error "NHDP timer wheel needs 64 slots per level"
+#endif
+
+/* mask for slot index of a level */
+#define SLOT_MASK (NHDP_TIMER_WHEEL_SLOTS - 1)
+
+/* prototypes */
+static void _add_to_slot(struct nhdp_timer_wheel *, struct nhdp_timer_entry *,
+    uint64_t tick, uint64_t base);
+static void _remove_from_slot(struct nhdp_timer_wheel *,
+    struct nhdp_timer_entry *);
+static void _process_tick(struct nhdp_timer_wheel *, uint64_t tick);
+static uint64_t _get_next_tick(struct nhdp_timer_wheel *);
+static uint64_t _get_tick(uint64_t clock);
+static void _schedule(uint64_t now);
+static void _cb_wheel_timer(void *);
+
+/* timer which processes the global wheel */
+static struct oonf_timer_info _wheel_timer_info = {
+  .name = "NHDP timer wheel",
+  .callback = _cb_wheel_timer,
+};
+
+static struct oonf_timer_entry _wheel_timer = {
+  .info = &_wheel_timer_info,
+};
+
+/* absolute time the wheel timer will fire, 0 if not running */
+static uint64_t _wheel_timer_clock;
+
+/* global wheel for NHDP and OLSRv2 protocol timers */
+static struct nhdp_timer_wheel _wheel;
+
+/* list of timer classes */
+static struct list_entity _timer_info_list;
+
+/**
+ * Initialize an empty timer wheel
+ * @param wheel pointer to timer wheel
+ * @param now current time
+ */
+void
+nhdp_timer_wheel_init(struct nhdp_timer_wheel *wheel, uint64_t now) {
+  int level, slot;
+
+  memset(wheel, 0, sizeof(*wheel));
+  for (level=0; level<NHDP_TIMER_WHEEL_LEVELS; level++) {
+    for (slot=0; slot<NHDP_TIMER_WHEEL_SLOTS; slot++) {
+      list_init_head(&wheel->_slots[level][slot]);
+    }
+  }
+  wheel->_tick = now >> NHDP_TIMER_WHEEL_TICK_BITS;
+}
+
+/**
+ * Start a timer or change its expiration time. A running timer
+ * re-armed to a later time is not moved inside the wheel.
+ * @param wheel pointer to timer wheel
+ * @param timer pointer to timer
+ * @param now current time
+ * @param clock absolute time when the timer should fire
+ */
+void
+nhdp_timer_wheel_set(struct nhdp_timer_wheel *wheel,
+    struct nhdp_timer_entry *timer, uint64_t now, uint64_t clock) {
+  uint64_t tick;
+
+  tick = _get_tick(clock);
+  timer->info->changes++;
+
+  if (timer->_clock != 0) {
+    timer->_clock = clock;
+    if (tick >= timer->_tick) {
+      /* timer will be moved when its current slot is processed */
+      wheel->lazy_rearms++;
+      return;
+    }
+
+    _remove_from_slot(wheel, timer);
+    wheel->moves++;
+  }
+  else {
+    if (wheel->count == 0) {
+      /* skip the time the wheel was empty */
+      wheel->_tick = now >> NHDP_TIMER_WHEEL_TICK_BITS;
+    }
+
+    timer->_clock = clock;
+    timer->info->usage++;
+    wheel->count++;
+  }
+
+  _add_to_slot(wheel, timer, tick, wheel->_tick + 1);
+}
+
+/**
+ * Stop a timer
+ * @param wheel pointer to timer wheel
+ * @param timer pointer to timer
+ */
+void
+nhdp_timer_wheel_stop(struct nhdp_timer_wheel *wheel,
+    struct nhdp_timer_entry *timer) {
+  if (timer->_clock == 0) {
+    return;
+  }
+
+  _remove_from_slot(wheel, timer);
+  timer->_clock = 0;
+
+  timer->info->usage--;
+  timer->info->changes++;
+  wheel->count--;
+}
+
+/**
+ * Fire all timers of a wheel which expired until a point in time
+ * @param wheel pointer to timer wheel
+ * @param now current time
+ */
+void
+nhdp_timer_wheel_process(struct nhdp_timer_wheel *wheel, uint64_t now) {
+  uint64_t now_tick, tick;
+
+  now_tick = now >> NHDP_TIMER_WHEEL_TICK_BITS;
+  while (wheel->_tick < now_tick) {
+    /* skip all ticks without timers to fire or move */
+    tick = _get_next_tick(wheel);
+    if (tick > now_tick) {
+      wheel->_tick = now_tick;
+      break;
+    }
+
+    wheel->_tick = tick;
+    _process_tick(wheel, tick);
+  }
+}
+
+/**
+ * @param wheel pointer to timer wheel
+ * @return absolute time the wheel has to be processed next,
+ *   0 if no timer is running
+ */
+uint64_t
+nhdp_timer_wheel_get_next_event(struct nhdp_timer_wheel *wheel) {
+  uint64_t tick;
+
+  tick = _get_next_tick(wheel);
+  if (tick == UINT64_MAX) {
+    return 0;
+  }
+  return tick << NHDP_TIMER_WHEEL_TICK_BITS;
+}
+
+/**
+ * Initialize the global timer wheel
+ */
+void
+nhdp_timer_init(void) {
+  list_init_head(&_timer_info_list);
+  nhdp_timer_wheel_init(&_wheel, oonf_clock_getNow());
+
+  oonf_timer_add(&_wheel_timer_info);
+  _wheel_timer_clock = 0;
+}
+
+/**
+ * Cleanup the global timer wheel
+ */
+void
+nhdp_timer_cleanup(void) {
+  struct nhdp_timer_info *info, *it;
+
+  list_for_each_element_safe(&_timer_info_list, info, _node, it) {
+    nhdp_timer_remove(info);
+  }
+
+  oonf_timer_stop(&_wheel_timer);
+  oonf_timer_remove(&_wheel_timer_info);
+}
+
+/**
+ * Add a new timer class
+ * @param info pointer to timer class
+ */
+void
+nhdp_timer_add(struct nhdp_timer_info *info) {
+  list_add_tail(&_timer_info_list, &info->_node);
+}
+
+/**
+ * Remove a timer class and stop all of its running timers
+ * @param info pointer to timer class
+ */
+void
+nhdp_timer_remove(struct nhdp_timer_info *info) {
+  struct nhdp_timer_entry *timer, *it;
+  int level, slot;
+
+  for (level=0; info->usage > 0 && level<NHDP_TIMER_WHEEL_LEVELS; level++) {
+    for (slot=0; slot<NHDP_TIMER_WHEEL_SLOTS; slot++) {
+      list_for_each_element_safe(&_wheel._slots[level][slot], timer, _node, it) {
+        if (timer->info == info) {
+          nhdp_timer_wheel_stop(&_wheel, timer);
+        }
+      }
+    }
+  }
+  list_remove(&info->_node);
+}
+
+/**
+ * Start a timer of the global wheel or change its expiration time
+ * @param timer pointer to timer
+ * @param rel_time time until the timer fires in milliseconds,
+ *   0 to stop the timer
+ */
+void
+nhdp_timer_set(struct nhdp_timer_entry *timer, uint64_t rel_time) {
+  uint64_t now;
+
+  if (rel_time == 0) {
+    nhdp_timer_stop(timer);
+    return;
+  }
+
+  now = oonf_clock_getNow();
+  nhdp_timer_wheel_set(&_wheel, timer, now, now + rel_time);
+  _schedule(now);
+}
+
+/**
+ * Stop a timer of the global wheel
+ * @param timer pointer to timer
+ */
+void
+nhdp_timer_stop(struct nhdp_timer_entry *timer) {
+  /* the wheel timer might fire once without work afterwards */
+  nhdp_timer_wheel_stop(&_wheel, timer);
+}
+
+/**
+ * Add a timer to the slot of a wheel matching its expiration tick
+ * @param wheel pointer to timer wheel
+ * @param timer pointer to timer
+ * @param tick expiration tick
+ * @param base first tick that will be processed
+ */
+static void
+_add_to_slot(struct nhdp_timer_wheel *wheel, struct nhdp_timer_entry *timer,
+    uint64_t tick, uint64_t base) {
+  uint64_t delta;
+  int level, slot;
+
+  if (tick < base) {
+    tick = base;
+  }
+  delta = tick - base;
+
+  /* the level covers the distance to the base with its slots */
+  for (level=0; level<NHDP_TIMER_WHEEL_LEVELS-1; level++) {
+    if (delta < (1ull << (NHDP_TIMER_WHEEL_SLOT_BITS * (level+1)))) {
+      break;
+    }
+  }
+
+  if (delta >= (1ull << (NHDP_TIMER_WHEEL_SLOT_BITS * NHDP_TIMER_WHEEL_LEVELS))) {
+    /* put timer into the last slot, it will be moved there */
+    tick = base
+        + (1ull << (NHDP_TIMER_WHEEL_SLOT_BITS * NHDP_TIMER_WHEEL_LEVELS)) - 1;
+  }
+
+  slot = (tick >> (NHDP_TIMER_WHEEL_SLOT_BITS * level)) & SLOT_MASK;
+
+  timer->_tick = tick;
+  timer->_slot = level * NHDP_TIMER_WHEEL_SLOTS + slot;
+  list_add_tail(&wheel->_slots[level][slot], &timer->_node);
+  wheel->_occupied[level] |= 1ull << slot;
+}
+
+/**
+ * Remove a timer from its wheel slot
+ * @param wheel pointer to timer wheel
+ * @param timer pointer to timer
+ */
+static void
+_remove_from_slot(struct nhdp_timer_wheel *wheel, struct nhdp_timer_entry *timer) {
+  int level, slot;
+
+  level = timer->_slot / NHDP_TIMER_WHEEL_SLOTS;
+  slot = timer->_slot % NHDP_TIMER_WHEEL_SLOTS;
+
+  list_remove(&timer->_node);
+  if (list_is_empty(&wheel->_slots[level][slot])) {
+    wheel->_occupied[level] &= ~(1ull << slot);
+  }
+}
+
+/**
+ * Move the timers of all higher level slots starting at a tick
+ * to lower levels, then fire the expired timers of the tick
+ * @param wheel pointer to timer wheel
+ * @param tick tick to process
+ */
+static void
+_process_tick(struct nhdp_timer_wheel *wheel, uint64_t tick) {
+  struct nhdp_timer_entry *timer;
+  struct list_entity list;
+  int level, slot, shift;
+
+  list_init_head(&list);
+
+  for (level=NHDP_TIMER_WHEEL_LEVELS-1; level>0; level--) {
+    shift = NHDP_TIMER_WHEEL_SLOT_BITS * level;
+    if ((tick & ((1ull << shift) - 1)) != 0) {
+      continue;
+    }
+
+    slot = (tick >> shift) & SLOT_MASK;
+    list_merge(&list, &wheel->_slots[level][slot]);
+    wheel->_occupied[level] &= ~(1ull << slot);
+
+    while (!list_is_empty(&list)) {
+      timer = list_first_element(&list, timer, _node);
+      list_remove(&timer->_node);
+
+      _add_to_slot(wheel, timer, _get_tick(timer->_clock), tick);
+      wheel->cascades++;
+    }
+  }
+
+  slot = tick & SLOT_MASK;
+  list_merge(&list, &wheel->_slots[0][slot]);
+  wheel->_occupied[0] &= ~(1ull << slot);
+
+  /* callbacks might stop other timers of this list */
+  while (!list_is_empty(&list)) {
+    timer = list_first_element(&list, timer, _node);
+    list_remove(&timer->_node);
+
+    if (_get_tick(timer->_clock) > tick) {
+      /* timer was re-armed to a later time */
+      _add_to_slot(wheel, timer, _get_tick(timer->_clock), tick + 1);
+      wheel->cascades++;
+      continue;
+    }
+
+    timer->_clock = 0;
+    timer->info->usage--;
+    wheel->count--;
+    wheel->fired++;
+
+    timer->info->callback(timer->cb_context);
+  }
+}
+
+/**
+ * @param wheel pointer to timer wheel
+ * @return next tick with timers to fire or move, UINT64_MAX if none
+ */
+static uint64_t
+_get_next_tick(struct nhdp_timer_wheel *wheel) {
+  uint64_t bits, tick, result;
+  int level, shift, rotate;
+
+  result = UINT64_MAX;
+  for (level=0; level<NHDP_TIMER_WHEEL_LEVELS; level++) {
+    if (wheel->_occupied[level] == 0) {
+      continue;
+    }
+
+    /* rotate bitmap so that bit 0 is the slot after the current one */
+    shift = NHDP_TIMER_WHEEL_SLOT_BITS * level;
+    rotate = ((wheel->_tick >> shift) + 1) & SLOT_MASK;
+    bits = wheel->_occupied[level];
+    if (rotate != 0) {
+      bits = (bits >> rotate) | (bits << (NHDP_TIMER_WHEEL_SLOTS - rotate));
+    }
+
+    tick = ((wheel->_tick >> shift) + __builtin_ctzll(bits) + 1) << shift;
+    if (tick < result) {
+      result = tick;
+    }
+  }
+  return result;
+}
+
+/**
+ * @param clock absolute time
+ * @return first tick at or after the time
+ */
+static uint64_t
+_get_tick(uint64_t clock) {
+  return (clock + (1ull << NHDP_TIMER_WHEEL_TICK_BITS) - 1)
+      >> NHDP_TIMER_WHEEL_TICK_BITS;
+}
+
+/**
+ * Make sure the wheel timer fires for the next event of the
+ * global wheel
+ * @param now current time
+ */
+static void
+_schedule(uint64_t now) {
+  uint64_t next;
+
+  next = nhdp_timer_wheel_get_next_event(&_wheel);
+  if (next == 0) {
+    oonf_timer_stop(&_wheel_timer);
+    _wheel_timer_clock = 0;
+    return;
+  }
+
+  if (_wheel_timer_clock != 0 && _wheel_timer_clock <= next) {
+    /* timer fires early enough */
+    return;
+  }
+
+  oonf_timer_set(&_wheel_timer, next > now ? next - now : 1);
+  _wheel_timer_clock = next;
+}
+
+/**
+ * Callback to process the global timer wheel
+ * @param ptr unused
+ */
+static void
+_cb_wheel_timer(void *ptr __attribute__((unused))) {
+  _wheel_timer_clock = 0;
+
+  nhdp_timer_wheel_process(&_wheel, oonf_clock_getNow());
+  _schedule(oonf_clock_getNow());
+}
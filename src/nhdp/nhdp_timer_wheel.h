@@ -0,0 +1,168 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#ifndef NHDP_TIMER_WHEEL_H_
+#define NHDP_TIMER_WHEEL_H_
+
+#include "common/common_types.h"
+#include "common/list.h"
+#include "subsystems/oonf_clock.h"
+
+/*
+ * Hierarchical timer wheel for coarse protocol timers (validity
+ * and hold times) which are re-armed on most received messages.
+ *
+ * A timer is sorted into a slot of the wheel by its expiration
+ * tick. Re-arming a timer to a later time only updates its clock,
+ * the entry is moved when its old slot is processed.
+ */
+
+/* duration of a wheel tick is 2^NHDP_TIMER_WHEEL_TICK_BITS ms */
+#define NHDP_TIMER_WHEEL_TICK_BITS 6
+
+/* number of slots per level is 2^NHDP_TIMER_WHEEL_SLOT_BITS */
+#define NHDP_TIMER_WHEEL_SLOT_BITS 6
+#define NHDP_TIMER_WHEEL_SLOTS     (1 << NHDP_TIMER_WHEEL_SLOT_BITS)
+
+/* number of levels, covers 2^(6*4) ticks (about 12 days) */
+#define NHDP_TIMER_WHEEL_LEVELS    4
+
+/* class of timers with a common callback */
+struct nhdp_timer_info {
+  /* name of timer class */
+  const char *name;
+
+  /* callback when timer fires */
+  void (*callback) (void *);
+
+  /* number of running timers of this class */
+  uint32_t usage;
+
+  /* number of timer set and stop calls */
+  uint32_t changes;
+
+  /* hook into list of timer classes */
+  struct list_entity _node;
+};
+
+/* a single timer */
+struct nhdp_timer_entry {
+  /* timer class, must be initialized before use */
+  struct nhdp_timer_info *info;
+
+  /* context pointer for callback */
+  void *cb_context;
+
+  /* absolute time when the timer fires, 0 if not running */
+  uint64_t _clock;
+
+  /* tick of the slot the timer is stored in */
+  uint64_t _tick;
+
+  /* level and slot index of the timer inside the wheel */
+  uint16_t _slot;
+
+  /* hook into slot of wheel */
+  struct list_entity _node;
+};
+
+/* a hierarchical timer wheel */
+struct nhdp_timer_wheel {
+  /* slots of all levels */
+  struct list_entity _slots[NHDP_TIMER_WHEEL_LEVELS][NHDP_TIMER_WHEEL_SLOTS];
+
+  /* bitmap of non-empty slots of each level */
+  uint64_t _occupied[NHDP_TIMER_WHEEL_LEVELS];
+
+  /* last processed tick */
+  uint64_t _tick;
+
+  /* number of running timers */
+  uint32_t count;
+
+  /* number of timers re-armed to a later time without moving them */
+  uint32_t lazy_rearms;
+
+  /* number of timers moved to another slot by a set call */
+  uint32_t moves;
+
+  /* number of timers moved to another slot while processing the wheel */
+  uint32_t cascades;
+
+  /* number of fired timers */
+  uint32_t fired;
+};
+
+void nhdp_timer_wheel_init(struct nhdp_timer_wheel *, uint64_t now);
+void nhdp_timer_wheel_set(struct nhdp_timer_wheel *,
+    struct nhdp_timer_entry *, uint64_t now, uint64_t clock);
+void nhdp_timer_wheel_stop(struct nhdp_timer_wheel *,
+    struct nhdp_timer_entry *);
+void nhdp_timer_wheel_process(struct nhdp_timer_wheel *, uint64_t now);
+uint64_t nhdp_timer_wheel_get_next_event(struct nhdp_timer_wheel *);
+
+void nhdp_timer_init(void);
+void nhdp_timer_cleanup(void);
+
+void nhdp_timer_add(struct nhdp_timer_info *);
+void nhdp_timer_remove(struct nhdp_timer_info *);
+void nhdp_timer_set(struct nhdp_timer_entry *, uint64_t rel_time);
+void nhdp_timer_stop(struct nhdp_timer_entry *);
+
+/**
+ * @param timer pointer to timer
+ * @return true if timer is running, false otherwise
+ */
+static INLINE bool
+nhdp_timer_is_active(const struct nhdp_timer_entry *timer) {
+  return timer->_clock != 0;
+}
+
+/**
+ * @param timer pointer to timer
+ * @return time until the timer fires in milliseconds
+ */
+static INLINE int64_t
+nhdp_timer_get_due(const struct nhdp_timer_entry *timer) {
+  return oonf_clock_get_relative(timer->_clock);
+}
+
+#endif /* NHDP_TIMER_WHEEL_H_ */
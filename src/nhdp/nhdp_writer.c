@@ -352,17 +352,20 @@ _add_localif_address(struct rfc5444_writer *writer, struct rfc5444_writer_conten
 static void
 _add_link_address(struct rfc5444_writer *writer, struct rfc5444_writer_content_provider *prv,
     struct nhdp_interface *interf, struct nhdp_naddr *naddr) {
+  const struct netaddr *neigh_addr;
   struct nhdp_domain *domain;
   struct rfc5444_writer_address *address;
   struct nhdp_laddr *laddr;
   struct netaddr_str buf;
   uint8_t linkstatus, otherneigh, mpr;
 
+  neigh_addr = nhdp_db_neighbor_addr_get_netaddr(naddr);
+
   /* initialize flags for default (lost address) address */
   linkstatus = 255;
   otherneigh = RFC5444_OTHERNEIGHB_LOST;
 
-  laddr = nhdp_interface_get_link_addr(interf, &naddr->neigh_addr);
+  laddr = nhdp_interface_get_link_addr_by_id(interf, naddr->neigh_addr_id);
   if (!nhdp_db_neighbor_addr_is_lost(naddr)) {
     if (laddr != NULL && laddr->link->local_if == interf
         && laddr->link->status != NHDP_LINK_PENDING) {
@@ -377,10 +380,10 @@ _add_link_address(struct rfc5444_writer *writer, struct rfc5444_writer_content_p
 
   /* generate RFC5444 address */
   address = rfc5444_writer_add_address(writer, prv->creator,
-      netaddr_get_binptr(&naddr->neigh_addr), netaddr_get_prefix_length(&naddr->neigh_addr), true);
+      netaddr_get_binptr(neigh_addr), netaddr_get_prefix_length(neigh_addr), true);
   if (address == NULL) {
     OONF_WARN(LOG_NHDP_W, "Could not add address %s to NHDP hello",
-        netaddr_to_string(&buf, &naddr->neigh_addr));
+        netaddr_to_string(&buf, neigh_addr));
     return;
   }
 
@@ -390,7 +393,7 @@ _add_link_address(struct rfc5444_writer *writer, struct rfc5444_writer_content_p
           &linkstatus, sizeof(linkstatus), false);
 
     OONF_DEBUG(LOG_NHDP_W, "Add %s (linkstatus=%d) to NHDP hello",
-        netaddr_to_string(&buf, &naddr->neigh_addr), laddr->link->status);
+        netaddr_to_string(&buf, neigh_addr), laddr->link->status);
   }
 
   if (otherneigh != 255) {
@@ -399,7 +402,7 @@ _add_link_address(struct rfc5444_writer *writer, struct rfc5444_writer_content_p
         &otherneigh, sizeof(otherneigh), false);
 
     OONF_DEBUG(LOG_NHDP_W, "Add %s (otherneigh=%d) to NHDP hello",
-        netaddr_to_string(&buf, &naddr->neigh_addr), otherneigh);
+        netaddr_to_string(&buf, neigh_addr), otherneigh);
   }
 
   /* add MPR tlvs */
@@ -415,7 +418,7 @@ _add_link_address(struct rfc5444_writer *writer, struct rfc5444_writer_content_p
             &domain->_mpr_addrtlv, &mpr, sizeof(mpr), false);
 
         OONF_DEBUG(LOG_NHDP_W, "Add %s (mpr=%d, etx=%d) to NHDP hello",
-            netaddr_to_string(&buf, &naddr->neigh_addr), mpr, domain->ext);
+            netaddr_to_string(&buf, neigh_addr), mpr, domain->ext);
       }
     }
   }
@@ -555,7 +558,7 @@ _cb_addAddresses(struct rfc5444_writer *writer) {
 
   /* then transmit neighbor addresses */
   avl_for_each_element(&nhdp_naddr_tree, naddr, _global_node) {
-    if (netaddr_get_address_family(&naddr->neigh_addr)
+    if (netaddr_get_address_family(nhdp_db_neighbor_addr_get_netaddr(naddr))
         == netaddr_get_address_family(&target->dst)) {
       _add_link_address(writer, &_nhdp_msgcontent_provider, interf, naddr);
     }
@@ -63,6 +63,7 @@
 #include "olsrv2/olsrv2_lan.h"
 #include "olsrv2/olsrv2_originator.h"
 #include "olsrv2/olsrv2_reader.h"
+#include "olsrv2/olsrv2_restart.h"
 #include "olsrv2/olsrv2_tc.h"
 #include "olsrv2/olsrv2_writer.h"
 
@@ -78,6 +79,20 @@ struct _config {
   uint64_t p_hold_time;
   struct netaddr_acl routable;
 
+  /* configuration for dijkstra */
+  bool spf_incremental;
+  bool spf_verify;
+  uint64_t spf_initial_delay;
+  uint64_t spf_secondary_wait;
+  uint64_t spf_max_hold;
+
+  /* maximum number of routes in kernel processing */
+  int routing_window;
+
+  /* configuration for warm restart */
+  char restart_file[OLSRV2_RESTART_FILE_MAXLEN];
+  uint64_t restart_hold;
+
   /* configuration for originator set */
   struct netaddr_acl originator_v4_acl;
   struct netaddr_acl originator_v6_acl;
@@ -107,12 +122,22 @@ static void _cb_cfg_domain_changed(void);
 
 #ifdef USE_TELNET
 /* prototypes */
-static enum oonf_telnet_result _cb_topology(struct oonf_telnet_data *con);
-
-/* nhdp telnet commands */
+static enum oonf_telnet_result _cb_olsrv2(struct oonf_telnet_data *con);
+static enum oonf_telnet_result _telnet_olsrv2_topology(
+    struct oonf_telnet_data *con);
+static enum oonf_telnet_result _telnet_olsrv2_routing(
+    struct oonf_telnet_data *con);
+static enum oonf_telnet_result _telnet_olsrv2_routes(
+    struct oonf_telnet_data *con);
+
+/* olsrv2 telnet commands */
 static struct oonf_telnet_command _cmds[] = {
-    TELNET_CMD("olsrv2", _cb_topology,
-        "OLSRV2 database information command\n"),
+    TELNET_CMD("olsrv2", _cb_olsrv2,
+        "OLSRV2 database information command\n"
+        "\"olsrv2\" or \"olsrv2 topology\": shows the topology database\n"
+        "\"olsrv2 routing\": shows statistics of the routing calculation\n"
+        "\"olsrv2 routes\": shows the routing set including"
+        " loop free alternate next hops\n"),
 };
 #endif
 
@@ -126,6 +151,9 @@ static struct cfg_schema_entry _rt_domain_entries[] = {
       "Routing table number for routes", 1, 254),
   CFG_MAP_INT_MINMAX(olsrv2_routing_domain, distance, "distance", "2",
       "Metric Distance to be used in routing table", 1, 255),
+  CFG_MAP_BOOL(olsrv2_routing_domain, use_lfa, "lfa", "no",
+      "Precalculate loop free alternate next hops to switch routes"
+      " immediately when a neighbor is lost"),
 };
 
 static struct cfg_schema_section _rt_domain_section = {
@@ -149,6 +177,29 @@ static struct cfg_schema_entry _olsrv2_entries[] = {
   CFG_MAP_ACL_V46(_config, routable, "routable",
       OLSRV2_ROUTABLE_IPV4 OLSRV2_ROUTABLE_IPV6 ACL_DEFAULT_ACCEPT,
     "Filter to decide which addresses are considered routable"),
+  CFG_MAP_BOOL(_config, spf_incremental, "spf_incremental", "true",
+    "Update the shortest path trees incrementally after topology changes"),
+  CFG_MAP_BOOL(_config, spf_verify, "spf_verify", "false",
+    "Check incremental shortest path trees for consistency and"
+    " recalculate them if necessary"),
+  CFG_MAP_CLOCK_MIN(_config, spf_initial_delay, "spf_initial_delay", "0.010",
+    "Delay between the first topology change after a quiet period"
+    " and the dijkstra run", 1),
+  CFG_MAP_CLOCK_MIN(_config, spf_secondary_wait, "spf_secondary_wait", "0.250",
+    "Hold time after a dijkstra run, doubled for each further run"
+    " while the topology keeps changing", 1),
+  CFG_MAP_CLOCK_MIN(_config, spf_max_hold, "spf_max_hold", "5.0",
+    "Maximum hold time after a dijkstra run", 1),
+  CFG_MAP_INT_MINMAX(_config, routing_window, "routing_window", "0",
+    "Maximum number of routes handed to the kernel at the same time,"
+    " 0 for no limit", 0, 65535),
+  CFG_MAP_STRING_ARRAY(_config, restart_file, "restart_file", "",
+    "File to store topology and kernel routes at shutdown for a warm"
+    " restart, empty to remove all routes at shutdown",
+    OLSRV2_RESTART_FILE_MAXLEN),
+  CFG_MAP_CLOCK_MIN(_config, restart_hold, "restart_hold", "10.0",
+    "Maximum time to keep the routes of a warm restart until the"
+    " neighbors of the previous instance are symmetric again", 100),
 
   CFG_VALIDATE_LAN(_LOCAL_ATTACHED_NETWORK_KEY, "",
     "locally attached network, a combination of an"
@@ -245,6 +296,7 @@ _init(void) {
   olsrv2_reader_init(_protocol);
   olsrv2_tc_init();
   olsrv2_routing_init();
+  olsrv2_restart_init();
 
   /* initialize timer */
   oonf_timer_add(&_tc_timer_class);
@@ -260,12 +312,18 @@ _init(void) {
 
 /**
  * Begin shutdown by deactivating reader and writer. Also flush all routes
+ * unless they have been stored for a warm restart
  */
 static void
 _initiate_shutdown(void) {
+  bool keep_routes;
+
   olsrv2_writer_cleanup();
   olsrv2_reader_cleanup();
-  olsrv2_routing_initiate_shutdown();
+
+  /* routes stay in the kernel if the next instance can take them over */
+  keep_routes = olsrv2_restart_write() == 0;
+  olsrv2_routing_initiate_shutdown(keep_routes);
 }
 
 /**
@@ -291,6 +349,7 @@ _cleanup(void) {
   netaddr_acl_remove(&_olsrv2_config.originator_v6_acl);
 
   /* cleanup all parts of olsrv2 */
+  olsrv2_restart_cleanup();
   olsrv2_routing_cleanup();
   olsrv2_originator_cleanup();
   olsrv2_tc_cleanup();
@@ -316,6 +375,73 @@ olsrv2_get_tc_validity(void) {
   return _olsrv2_config.tc_validity;
 }
 
+/**
+ * @return true if shortest path trees should be updated incrementally
+ */
+bool
+olsrv2_get_spf_incremental(void) {
+  return _olsrv2_config.spf_incremental;
+}
+
+/**
+ * @return true if incremental shortest path trees should be verified
+ */
+bool
+olsrv2_get_spf_verify(void) {
+  return _olsrv2_config.spf_verify;
+}
+
+/**
+ * @return delay of the first dijkstra after a quiet period
+ */
+uint64_t
+olsrv2_get_spf_initial_delay(void) {
+  return _olsrv2_config.spf_initial_delay;
+}
+
+/**
+ * @return initial hold time after a dijkstra run
+ */
+uint64_t
+olsrv2_get_spf_secondary_wait(void) {
+  return _olsrv2_config.spf_secondary_wait;
+}
+
+/**
+ * @return maximum hold time after a dijkstra run
+ */
+uint64_t
+olsrv2_get_spf_max_hold(void) {
+  if (_olsrv2_config.spf_max_hold < _olsrv2_config.spf_secondary_wait) {
+    return _olsrv2_config.spf_secondary_wait;
+  }
+  return _olsrv2_config.spf_max_hold;
+}
+
+/**
+ * @return maximum number of routes in kernel processing, 0 for no limit
+ */
+int
+olsrv2_get_routing_window(void) {
+  return _olsrv2_config.routing_window;
+}
+
+/**
+ * @return name of the warm restart file, empty string if disabled
+ */
+const char *
+olsrv2_get_restart_file(void) {
+  return _olsrv2_config.restart_file;
+}
+
+/**
+ * @return maximum time to wait for the neighbors after a warm restart
+ */
+uint64_t
+olsrv2_get_restart_hold(void) {
+  return _olsrv2_config.restart_hold;
+}
+
 /**
  * @return acl for checking if an address is routable
  */
@@ -686,13 +812,35 @@ _cb_generate_tc(void *ptr __attribute__((unused))) {
 
 #ifdef USE_TELNET
 /**
- * Telnet command to output topology
+ * Telnet command to output olsrv2 database information
  * @param con
  * @return
  */
 static enum oonf_telnet_result
-_cb_topology(struct oonf_telnet_data *con) {
+_cb_olsrv2(struct oonf_telnet_data *con) {
   /* TODO: move this command (or a similar one) to a plugin */
+  if (con->parameter == NULL || *con->parameter == 0
+      || str_hasnextword(con->parameter, "topology")) {
+    return _telnet_olsrv2_topology(con);
+  }
+  if (str_hasnextword(con->parameter, "routing")) {
+    return _telnet_olsrv2_routing(con);
+  }
+  if (str_hasnextword(con->parameter, "routes")) {
+    return _telnet_olsrv2_routes(con);
+  }
+
+  abuf_appendf(con->out, "Wrong parameter in command: %s", con->parameter);
+  return TELNET_RESULT_ACTIVE;
+}
+
+/**
+ * handle the "olsrv2 topology" command
+ * @param con
+ * @return
+ */
+static enum oonf_telnet_result
+_telnet_olsrv2_topology(struct oonf_telnet_data *con) {
   struct olsrv2_tc_node *node;
   struct olsrv2_tc_edge *edge;
   struct olsrv2_tc_attachment *end;
@@ -702,37 +850,133 @@ _cb_topology(struct oonf_telnet_data *con) {
 
   avl_for_each_element(&olsrv2_tc_tree, node, _originator_node) {
     abuf_appendf(con->out, "Node originator %s: vtime=%s ansn=%u\n",
-        netaddr_to_string(&nbuf, &node->target.addr),
+        netaddr_to_string(&nbuf, olsrv2_tc_target_get_netaddr(&node->target)),
         oonf_clock_toIntervalString(&tbuf,
-            oonf_timer_get_due(&node->_validity_time)),
+            nhdp_timer_get_due(&node->_validity_time)),
         node->ansn);
 
     avl_for_each_element(&node->_edges, edge, _node) {
       abuf_appendf(con->out, "\tlink to %s%s: (ansn=%u)\n",
-          netaddr_to_string(&nbuf, &edge->dst->target.addr),
+          netaddr_to_string(&nbuf, olsrv2_tc_target_get_netaddr(&edge->dst->target)),
           edge->virtual ? " (virtual)" : "",
           edge->ansn);
 
       list_for_each_element(&nhdp_domain_list, domain, _node) {
         abuf_appendf(con->out, "\t\tmetric '%s': %d\n",
-            domain->metric->name, edge->cost[domain->index]);
+            domain->metric->name,
+            olsrv2_tc_edge_get_cost(edge, domain->index));
       }
     }
 
     avl_for_each_element(&node->_endpoints, end, _src_node) {
       abuf_appendf(con->out, "\tlink to endpoint %s: (ansn=%u)\n",
-          netaddr_to_string(&nbuf, &end->dst->target.addr),
+          netaddr_to_string(&nbuf, olsrv2_tc_target_get_netaddr(&end->dst->target)),
           end->ansn);
 
         list_for_each_element(&nhdp_domain_list, domain, _node) {
           abuf_appendf(con->out, "\t\tmetric '%s': %d\n",
-              domain->metric->name, end->cost[domain->index]);
+              domain->metric->name,
+              olsrv2_tc_endpoint_get_cost(end, domain->index));
         }
     }
   }
 
   return TELNET_RESULT_ACTIVE;
 }
+
+/**
+ * handle the "olsrv2 routing" command
+ * @param con
+ * @return
+ */
+static enum oonf_telnet_result
+_telnet_olsrv2_routing(struct oonf_telnet_data *con) {
+  const struct olsrv2_routing_statistics *stats;
+  const struct olsrv2_tc_statistics *tc_stats;
+  const struct olsrv2_writer_statistics *writer_stats;
+  struct fraction_str tbuf;
+
+  stats = olsrv2_routing_get_statistics();
+
+  abuf_appendf(con->out, "Dijkstra runs: %u\n", stats->spf_runs);
+  abuf_appendf(con->out, "Dijkstra runs avoided (unchanged TC): %u\n",
+      stats->spf_avoided);
+  abuf_appendf(con->out, "Dijkstra triggers deferred: %u\n",
+      stats->spf_deferred);
+  abuf_appendf(con->out, "Dijkstra hold time: %s\n",
+      oonf_clock_toIntervalString(&tbuf, stats->spf_backoff));
+  abuf_appendf(con->out, "Topology generation: %u\n",
+      olsrv2_routing_get_topology_generation());
+  abuf_appendf(con->out, "Kernel routes queued: %u\n",
+      stats->kernel_queued);
+  abuf_appendf(con->out, "Kernel routes in processing: %u\n",
+      stats->kernel_in_flight);
+  abuf_appendf(con->out, "Kernel route errors: %u\n",
+      stats->kernel_errors);
+  abuf_appendf(con->out, "Routing entries touched by last run: %u\n",
+      stats->routes_touched);
+  abuf_appendf(con->out, "Routing entries scanned by last run: %u\n",
+      stats->routes_scanned);
+  abuf_appendf(con->out, "Routing entries changed by last run: %u\n",
+      stats->routes_changed);
+  abuf_appendf(con->out, "Routes with loop free alternate: %u\n",
+      stats->lfa_routes);
+  abuf_appendf(con->out, "Loop free alternate failovers: %u\n",
+      stats->lfa_failovers);
+
+  tc_stats = olsrv2_tc_get_statistics();
+  abuf_appendf(con->out, "TC edge pairs: %u (%u unused)\n",
+      tc_stats->edge_pairs, tc_stats->edge_pairs_free);
+  abuf_appendf(con->out, "TC edge slabs: %u (%u allocated, %u released)\n",
+      tc_stats->edge_slabs, tc_stats->slab_allocations,
+      tc_stats->slab_releases);
+  abuf_appendf(con->out, "TC cost columns: %u (%u edge rows, %u attachment rows)\n",
+      tc_stats->cost_columns, tc_stats->edge_cost_rows,
+      tc_stats->attachment_cost_rows);
+  abuf_appendf(con->out, "TC fragments: %u (%u answer sets timed out)\n",
+      tc_stats->tc_fragments, tc_stats->fragment_timeouts);
+  abuf_appendf(con->out, "TC refreshes without changes: %u\n",
+      tc_stats->tc_refreshes);
+
+  writer_stats = olsrv2_writer_get_statistics();
+  abuf_appendf(con->out, "TC content cache: %u hits, %u misses\n",
+      writer_stats->tc_cache_hits, writer_stats->tc_cache_misses);
+  return TELNET_RESULT_ACTIVE;
+}
+
+/**
+ * handle the "olsrv2 routes" command
+ * @param con
+ * @return
+ */
+static enum oonf_telnet_result
+_telnet_olsrv2_routes(struct oonf_telnet_data *con) {
+  struct olsrv2_routing_entry *rtentry;
+  struct nhdp_domain *domain;
+  struct netaddr_str nbuf1, nbuf2;
+
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    abuf_appendf(con->out, "Domain '%s':\n", domain->metric->name);
+
+    avl_for_each_element(&olsrv2_routing_tree[domain->index], rtentry, _node) {
+      if (!rtentry->set) {
+        continue;
+      }
+
+      abuf_appendf(con->out, "\t%s via %s (if %u): cost=%u\n",
+          netaddr_to_string(&nbuf1, &rtentry->route.dst),
+          netaddr_to_string(&nbuf2, &rtentry->route.gw),
+          rtentry->route.if_index, rtentry->cost);
+
+      if (netaddr_get_address_family(&rtentry->lfa.gw) != AF_UNSPEC) {
+        abuf_appendf(con->out, "\t\tloop free alternate via %s (if %u)\n",
+            netaddr_to_string(&nbuf1, &rtentry->lfa.gw),
+            rtentry->lfa.if_index);
+      }
+    }
+  }
+  return TELNET_RESULT_ACTIVE;
+}
 #endif
 
 /**
@@ -829,6 +1073,12 @@ _cb_cfg_olsrv2_changed(void) {
 
   /* run through all post-update LAN entries and add them */
   _parse_lan_array(_olsrv2_section.post, true);
+
+  /* the routable ACL might have changed the content of the TCs */
+  olsrv2_writer_flush_tc_cache();
+
+  /* take over the state of the previous instance after startup */
+  olsrv2_restart_schedule_load();
 }
 
 /**
@@ -854,6 +1104,7 @@ _cb_cfg_domain_changed(void) {
 
   domain = nhdp_domain_add(ext);
   if (domain == NULL) {
+    OONF_WARN(LOG_OLSRV2, "Cannot add routing domain %d", ext);
     return;
   }
 
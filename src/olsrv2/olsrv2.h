@@ -65,6 +65,14 @@ EXPORT extern enum oonf_log_source LOG_OLSRV2_W;
 EXPORT uint64_t olsrv2_get_tc_interval(void);
 EXPORT uint64_t olsrv2_get_tc_validity(void);
 EXPORT const struct netaddr_acl *olsrv2_get_routable(void);
+EXPORT bool olsrv2_get_spf_incremental(void);
+EXPORT bool olsrv2_get_spf_verify(void);
+EXPORT uint64_t olsrv2_get_spf_initial_delay(void);
+EXPORT uint64_t olsrv2_get_spf_secondary_wait(void);
+EXPORT uint64_t olsrv2_get_spf_max_hold(void);
+EXPORT int olsrv2_get_routing_window(void);
+EXPORT const char *olsrv2_get_restart_file(void);
+EXPORT uint64_t olsrv2_get_restart_hold(void);
 EXPORT bool olsrv2_mpr_shall_process(
     struct rfc5444_reader_tlvblock_context *, uint64_t vtime);
 EXPORT bool olsrv2_mpr_shall_forwarding(
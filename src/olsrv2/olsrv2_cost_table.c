@@ -0,0 +1,224 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/common_types.h"
+#include "rfc5444/rfc5444.h"
+
+#include "olsrv2/olsrv2_cost_table.h"
+
+/* number of rows of the first allocation of a cost table */
+#define OLSRV2_COST_TABLE_MIN_SIZE 64
+
+static int _grow(struct olsrv2_cost_table *, uint32_t size);
+static void _clear_rows(struct olsrv2_cost_table *,
+    size_t domain, uint32_t first, uint32_t last);
+
+/**
+ * Initialize an empty cost table, no memory is allocated
+ * before the first row or column is added
+ * @param table pointer to cost table
+ * @param distance true if table should store hopcount distances
+ */
+void
+olsrv2_cost_table_init(struct olsrv2_cost_table *table, bool distance) {
+  memset(table, 0, sizeof(*table));
+  table->has_distance = distance;
+}
+
+/**
+ * Free all memory of a cost table
+ * @param table pointer to cost table
+ */
+void
+olsrv2_cost_table_cleanup(struct olsrv2_cost_table *table) {
+  size_t i;
+
+  for (i=0; i<table->columns; i++) {
+    free(table->cost[i]);
+    free(table->distance[i]);
+  }
+  free(table->_free_rows);
+
+  olsrv2_cost_table_init(table, table->has_distance);
+}
+
+/**
+ * Make sure a cost table has columns for a number of domains.
+ * New columns are initialized with infinite costs.
+ * @param table pointer to cost table
+ * @param domains number of domains
+ * @return -1 if out of memory, 0 otherwise
+ */
+int
+olsrv2_cost_table_add_columns(struct olsrv2_cost_table *table,
+    size_t domains) {
+  if (domains > NHDP_MAXIMUM_DOMAINS) {
+    domains = NHDP_MAXIMUM_DOMAINS;
+  }
+
+  while (table->columns < domains) {
+    if (table->size > 0) {
+      table->cost[table->columns] =
+          malloc(table->size * sizeof(uint32_t));
+      if (table->cost[table->columns] == NULL) {
+        return -1;
+      }
+
+      if (table->has_distance) {
+        table->distance[table->columns] = malloc(table->size);
+        if (table->distance[table->columns] == NULL) {
+          free(table->cost[table->columns]);
+          table->cost[table->columns] = NULL;
+          return -1;
+        }
+      }
+      _clear_rows(table, table->columns, 0, table->size);
+    }
+    table->columns++;
+  }
+  return 0;
+}
+
+/**
+ * Allocate a row of a cost table, the costs of the row are
+ * initialized to infinite in all columns.
+ * @param table pointer to cost table
+ * @param row pointer to storage for row index
+ * @return -1 if out of memory, 0 otherwise
+ */
+int
+olsrv2_cost_table_alloc_row(struct olsrv2_cost_table *table,
+    uint32_t *row) {
+  size_t i;
+
+  if (table->_free_count > 0) {
+    /* reuse released rows first to keep the columns dense */
+    *row = table->_free_rows[--table->_free_count];
+  }
+  else {
+    if (table->_high_water == table->size
+        && _grow(table, table->size == 0
+            ? OLSRV2_COST_TABLE_MIN_SIZE : table->size * 2)) {
+      return -1;
+    }
+    *row = table->_high_water++;
+  }
+
+  for (i=0; i<table->columns; i++) {
+    _clear_rows(table, i, *row, *row + 1);
+  }
+  table->count++;
+  return 0;
+}
+
+/**
+ * Release a row of a cost table
+ * @param table pointer to cost table
+ * @param row row index
+ */
+void
+olsrv2_cost_table_free_row(struct olsrv2_cost_table *table, uint32_t row) {
+  /* the free row stack has the same size as the columns */
+  table->_free_rows[table->_free_count++] = row;
+  table->count--;
+}
+
+/**
+ * Resize all columns and the free row stack of a cost table.
+ * The table is unchanged if an allocation fails.
+ * @param table pointer to cost table
+ * @param size new number of rows
+ * @return -1 if out of memory, 0 otherwise
+ */
+static int
+_grow(struct olsrv2_cost_table *table, uint32_t size) {
+  void *ptr;
+  size_t i;
+
+  /* larger columns keep their content, so the size is only set at the end */
+  ptr = realloc(table->_free_rows, size * sizeof(uint32_t));
+  if (ptr == NULL) {
+    return -1;
+  }
+  table->_free_rows = ptr;
+
+  for (i=0; i<table->columns; i++) {
+    ptr = realloc(table->cost[i], size * sizeof(uint32_t));
+    if (ptr == NULL) {
+      return -1;
+    }
+    table->cost[i] = ptr;
+
+    if (table->has_distance) {
+      ptr = realloc(table->distance[i], size);
+      if (ptr == NULL) {
+        return -1;
+      }
+      table->distance[i] = ptr;
+    }
+  }
+
+  table->size = size;
+  return 0;
+}
+
+/**
+ * Set a range of rows of a column to infinite costs
+ * @param table pointer to cost table
+ * @param domain index of column
+ * @param first first row
+ * @param last first row behind the range
+ */
+static void
+_clear_rows(struct olsrv2_cost_table *table,
+    size_t domain, uint32_t first, uint32_t last) {
+  uint32_t i;
+
+  for (i=first; i<last; i++) {
+    table->cost[domain][i] = RFC5444_METRIC_INFINITE;
+  }
+  if (table->has_distance) {
+    memset(&table->distance[domain][first], 0, last - first);
+  }
+}
@@ -0,0 +1,176 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#ifndef OLSRV2_COST_TABLE_H_
+#define OLSRV2_COST_TABLE_H_
+
+#include "common/common_types.h"
+#include "rfc5444/rfc5444.h"
+
+#include "nhdp/nhdp_domain.h"
+
+/*
+ * Link costs of topology objects stored as structure of arrays.
+ * Each object owns a row index, each domain has its own column
+ * of costs (and optional hopcount distances). Columns are only
+ * allocated for domains that exist at runtime, so a dijkstra run
+ * for one domain only touches the memory of this domain.
+ */
+struct olsrv2_cost_table {
+  /* cost column of each domain, NULL if not allocated */
+  uint32_t *cost[NHDP_MAXIMUM_DOMAINS];
+
+  /* hopcount distance column of each domain, NULL if not allocated */
+  uint8_t *distance[NHDP_MAXIMUM_DOMAINS];
+
+  /* true if the table stores hopcount distances */
+  bool has_distance;
+
+  /* number of domains with allocated columns */
+  size_t columns;
+
+  /* number of rows in use */
+  uint32_t count;
+
+  /* number of allocated rows in each column */
+  uint32_t size;
+
+  /* number of rows that have been handed out at least once */
+  uint32_t _high_water;
+
+  /* stack of released row indices */
+  uint32_t *_free_rows;
+
+  /* number of entries on the free row stack */
+  uint32_t _free_count;
+};
+
+void olsrv2_cost_table_init(struct olsrv2_cost_table *, bool distance);
+void olsrv2_cost_table_cleanup(struct olsrv2_cost_table *);
+int olsrv2_cost_table_add_columns(struct olsrv2_cost_table *, size_t domains);
+int olsrv2_cost_table_alloc_row(struct olsrv2_cost_table *, uint32_t *row);
+void olsrv2_cost_table_free_row(struct olsrv2_cost_table *, uint32_t row);
+
+/**
+ * @param table pointer to cost table
+ * @param domain_index index of nhdp domain
+ * @param row row index of topology object
+ * @return link cost of object, infinite if domain has no column
+ */
+static INLINE uint32_t
+olsrv2_cost_table_get_cost(const struct olsrv2_cost_table *table,
+    int domain_index, uint32_t row) {
+  if ((size_t)domain_index >= table->columns) {
+    return RFC5444_METRIC_INFINITE;
+  }
+  return table->cost[domain_index][row];
+}
+
+/**
+ * @param table pointer to cost table with distances
+ * @param domain_index index of nhdp domain
+ * @param row row index of topology object
+ * @return hopcount distance of object, 0 if domain has no column
+ */
+static INLINE uint8_t
+olsrv2_cost_table_get_distance(const struct olsrv2_cost_table *table,
+    int domain_index, uint32_t row) {
+  if ((size_t)domain_index >= table->columns) {
+    return 0;
+  }
+  return table->distance[domain_index][row];
+}
+
+/**
+ * @param table pointer to cost table
+ * @param domain_index index of nhdp domain
+ * @return cost column of domain, NULL if not allocated
+ */
+static INLINE const uint32_t *
+olsrv2_cost_table_get_column(const struct olsrv2_cost_table *table,
+    int domain_index) {
+  if ((size_t)domain_index >= table->columns) {
+    return NULL;
+  }
+  return table->cost[domain_index];
+}
+
+/**
+ * @param table pointer to cost table with distances
+ * @param domain_index index of nhdp domain
+ * @return hopcount distance column of domain, NULL if not allocated
+ */
+static INLINE const uint8_t *
+olsrv2_cost_table_get_distances(const struct olsrv2_cost_table *table,
+    int domain_index) {
+  if ((size_t)domain_index >= table->columns) {
+    return NULL;
+  }
+  return table->distance[domain_index];
+}
+
+/**
+ * Set the link cost (and hopcount distance) of a topology object,
+ * the column of the domain is allocated if necessary.
+ * @param table pointer to cost table
+ * @param domain_index index of nhdp domain
+ * @param row row index of topology object
+ * @param cost new link cost
+ * @param distance new hopcount distance, ignored if the table
+ *   has no distances
+ * @return -1 if out of memory, 0 otherwise
+ */
+static INLINE int
+olsrv2_cost_table_set(struct olsrv2_cost_table *table,
+    int domain_index, uint32_t row, uint32_t cost, uint8_t distance) {
+  if ((size_t)domain_index >= table->columns
+      && olsrv2_cost_table_add_columns(table, domain_index + 1)) {
+    return -1;
+  }
+
+  table->cost[domain_index][row] = cost;
+  if (table->has_distance) {
+    table->distance[domain_index][row] = distance;
+  }
+  return 0;
+}
+
+#endif /* OLSRV2_COST_TABLE_H_ */
@@ -0,0 +1,242 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#include "common/common_types.h"
+
+#include "olsrv2/olsrv2_heap.h"
+
+static struct olsrv2_heap_node *_meld(
+    struct olsrv2_heap_node *, struct olsrv2_heap_node *);
+static struct olsrv2_heap_node *_merge_pairs(struct olsrv2_heap_node *);
+static void _cut(struct olsrv2_heap_node *);
+static void _clear(struct olsrv2_heap_node *);
+
+/**
+ * Initialize a pairing heap
+ * @param heap pointer to pairing heap
+ */
+void
+olsrv2_heap_init(struct olsrv2_heap *heap) {
+  heap->_root = NULL;
+  heap->count = 0;
+}
+
+/**
+ * Add a node to a pairing heap. The key pointer of the
+ * node must be initialized.
+ * @param heap pointer to pairing heap
+ * @param node pointer to heap node
+ */
+void
+olsrv2_heap_insert(struct olsrv2_heap *heap, struct olsrv2_heap_node *node) {
+  _clear(node);
+
+  heap->_root = _meld(heap->_root, node);
+  heap->count++;
+}
+
+/**
+ * Reorder a node of a pairing heap after its key has been lowered.
+ * @param heap pointer to pairing heap
+ * @param node pointer to heap node, must be part of the heap
+ */
+void
+olsrv2_heap_decrease_key(struct olsrv2_heap *heap,
+    struct olsrv2_heap_node *node) {
+  if (node == heap->_root) {
+    /* root cannot move up */
+    return;
+  }
+
+  /* detach subtree and meld it into root */
+  _cut(node);
+  heap->_root = _meld(heap->_root, node);
+}
+
+/**
+ * Remove an arbitrary node from a pairing heap
+ * @param heap pointer to pairing heap
+ * @param node pointer to heap node, must be part of the heap
+ */
+void
+olsrv2_heap_remove(struct olsrv2_heap *heap, struct olsrv2_heap_node *node) {
+  if (node == heap->_root) {
+    olsrv2_heap_extract_min(heap);
+    return;
+  }
+
+  _cut(node);
+  if (node->_child) {
+    heap->_root = _meld(heap->_root, _merge_pairs(node->_child));
+  }
+  _clear(node);
+  heap->count--;
+}
+
+/**
+ * Remove the node with the smallest key from a pairing heap
+ * @param heap pointer to pairing heap
+ * @return removed node, NULL if heap was empty
+ */
+struct olsrv2_heap_node *
+olsrv2_heap_extract_min(struct olsrv2_heap *heap) {
+  struct olsrv2_heap_node *root;
+
+  root = heap->_root;
+  if (root == NULL) {
+    return NULL;
+  }
+
+  heap->_root = NULL;
+  if (root->_child) {
+    heap->_root = _merge_pairs(root->_child);
+  }
+  _clear(root);
+  heap->count--;
+  return root;
+}
+
+/**
+ * Combine two heap-ordered trees
+ * @param a root of first tree, might be NULL
+ * @param b root of second tree, might be NULL
+ * @return root of combined tree
+ */
+static struct olsrv2_heap_node *
+_meld(struct olsrv2_heap_node *a, struct olsrv2_heap_node *b) {
+  struct olsrv2_heap_node *tmp;
+
+  if (a == NULL) {
+    return b;
+  }
+  if (b == NULL) {
+    return a;
+  }
+
+  if (*b->key < *a->key) {
+    tmp = a;
+    a = b;
+    b = tmp;
+  }
+
+  /* b becomes the first child of a */
+  b->_prev = a;
+  b->_next = a->_child;
+  if (a->_child) {
+    a->_child->_prev = b;
+  }
+  a->_child = b;
+  a->_next = NULL;
+  a->_prev = NULL;
+  return a;
+}
+
+/**
+ * Combine a list of sibling trees into one tree with the
+ * standard two-pass pairing strategy.
+ * @param first first tree of the sibling list
+ * @return root of combined tree
+ */
+static struct olsrv2_heap_node *
+_merge_pairs(struct olsrv2_heap_node *first) {
+  struct olsrv2_heap_node *a, *b, *next, *stack, *result;
+
+  /* first pass: meld pairs from left to right, remember them in a stack */
+  stack = NULL;
+  while (first) {
+    a = first;
+    b = a->_next;
+    next = b ? b->_next : NULL;
+
+    a->_next = NULL;
+    a->_prev = NULL;
+    if (b) {
+      b->_next = NULL;
+      b->_prev = NULL;
+      a = _meld(a, b);
+    }
+
+    a->_next = stack;
+    stack = a;
+    first = next;
+  }
+
+  /* second pass: meld trees from right to left */
+  result = NULL;
+  while (stack) {
+    next = stack->_next;
+    stack->_next = NULL;
+    result = _meld(result, stack);
+    stack = next;
+  }
+  return result;
+}
+
+/**
+ * Detach a (non-root) node and its subtree from its parent
+ * @param node pointer to heap node
+ */
+static void
+_cut(struct olsrv2_heap_node *node) {
+  if (node->_prev->_child == node) {
+    /* first child */
+    node->_prev->_child = node->_next;
+  }
+  else {
+    node->_prev->_next = node->_next;
+  }
+  if (node->_next) {
+    node->_next->_prev = node->_prev;
+  }
+  node->_next = NULL;
+  node->_prev = NULL;
+}
+
+/**
+ * Reset the heap pointers of a node
+ * @param node pointer to heap node
+ */
+static void
+_clear(struct olsrv2_heap_node *node) {
+  node->_child = NULL;
+  node->_next = NULL;
+  node->_prev = NULL;
+}
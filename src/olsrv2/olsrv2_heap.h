@@ -0,0 +1,111 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#ifndef OLSRV2_HEAP_H_
+#define OLSRV2_HEAP_H_
+
+#include "common/common_types.h"
+
+/*
+ * Minimal pairing heap with O(1) insert and decrease-key,
+ * ordered by an external uint32_t key (similar to the avl_node key).
+ */
+
+/* node of a pairing heap, embedded into the user data structure */
+struct olsrv2_heap_node {
+  /* pointer to the key of the node */
+  const uint32_t *key;
+
+  /* first child of this node */
+  struct olsrv2_heap_node *_child;
+
+  /* next sibling of this node */
+  struct olsrv2_heap_node *_next;
+
+  /* previous sibling or parent if this is the first child */
+  struct olsrv2_heap_node *_prev;
+};
+
+/* root of a pairing heap */
+struct olsrv2_heap {
+  /* node with the smallest key */
+  struct olsrv2_heap_node *_root;
+
+  /* number of nodes in heap */
+  unsigned count;
+};
+
+void olsrv2_heap_init(struct olsrv2_heap *);
+void olsrv2_heap_insert(struct olsrv2_heap *, struct olsrv2_heap_node *);
+void olsrv2_heap_decrease_key(struct olsrv2_heap *, struct olsrv2_heap_node *);
+void olsrv2_heap_remove(struct olsrv2_heap *, struct olsrv2_heap_node *);
+struct olsrv2_heap_node *olsrv2_heap_extract_min(struct olsrv2_heap *);
+
+/**
+ * @param heap pointer to pairing heap
+ * @return true if heap is empty, false otherwise
+ */
+static INLINE bool
+olsrv2_heap_is_empty(struct olsrv2_heap *heap) {
+  return heap->_root == NULL;
+}
+
+/**
+ * @param heap pointer to pairing heap
+ * @param node pointer to heap node
+ * @return true if node is part of the heap, false otherwise
+ */
+static INLINE bool
+olsrv2_heap_is_node_added(struct olsrv2_heap *heap,
+    struct olsrv2_heap_node *node) {
+  return node->_prev != NULL || heap->_root == node;
+}
+
+/**
+ * @param heap pointer to pairing heap
+ * @return node with the smallest key, NULL if heap is empty
+ */
+static INLINE struct olsrv2_heap_node *
+olsrv2_heap_first(struct olsrv2_heap *heap) {
+  return heap->_root;
+}
+
+#endif /* OLSRV2_HEAP_H_ */
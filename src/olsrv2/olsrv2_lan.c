@@ -63,6 +63,9 @@ static struct oonf_class _lan_class = {
 /* global tree of originator set entries */
 struct avl_tree olsrv2_lan_tree;
 
+/* number of changes of the LAN set */
+static uint32_t _generation;
+
 /**
  * Initialize olsrv2 lan set
  */
@@ -127,6 +130,8 @@ olsrv2_lan_add(struct nhdp_domain *domain,
   entry->data[domain->index].distance = distance;
   entry->data[domain->index].active = true;
 
+  _generation++;
+
   return entry;
 }
 
@@ -147,6 +152,7 @@ olsrv2_lan_remove(struct nhdp_domain *domain,
   }
 
   entry->data[domain->index].active = false;
+  _generation++;
 
   for (i=0; i<NHDP_MAXIMUM_DOMAINS; i++) {
     if (entry->data[i].active) {
@@ -157,6 +163,15 @@ olsrv2_lan_remove(struct nhdp_domain *domain,
   _remove(entry);
 }
 
+/**
+ * @return number of changes of the LAN set, used to detect
+ *   modifications between two queries
+ */
+uint32_t
+olsrv2_lan_get_generation(void) {
+  return _generation;
+}
+
 /**
  * Remove a local attached network entry
  * @param entry LAN entry
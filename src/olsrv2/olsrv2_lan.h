@@ -74,6 +74,7 @@ EXPORT struct olsrv2_lan_entry *olsrv2_lan_add(
     uint32_t metric, uint8_t distance);
 EXPORT void olsrv2_lan_remove(struct nhdp_domain *,
     struct netaddr *prefix);
+EXPORT uint32_t olsrv2_lan_get_generation(void);
 
 EXPORT int olsrv2_lan_validate(const struct cfg_schema_entry *entry,
     const char *section_name, const char *value, struct autobuf *out);
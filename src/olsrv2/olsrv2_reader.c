@@ -49,6 +49,8 @@
 #include "subsystems/oonf_duplicate_set.h"
 #include "subsystems/oonf_rfc5444.h"
 
+#include "nhdp/nhdp_netaddr_hash.h"
+
 #include "olsrv2/olsrv2.h"
 #include "olsrv2/olsrv2_originator.h"
 #include "olsrv2/olsrv2_reader.h"
@@ -68,7 +70,7 @@ enum {
   IDX_TLV_CONT_SEQ_NUM,
 };
 
-/* NHDP address TLV array index pass 1 */
+/* NHDP address TLV array index */
 enum {
   IDX_ADDRTLV_LINK_METRIC,
   IDX_ADDRTLV_NBR_ADDR_TYPE,
@@ -79,24 +81,42 @@ enum {
 struct _olsrv2_data {
   struct olsrv2_tc_node *node;
   uint64_t vtime;
+  uint64_t itime;
   bool complete_tc;
+
+  /* true if the TC started a new answer set */
+  bool new_set;
+
+  /* topology generation before the TC was processed */
+  uint32_t generation;
+
+  /* true if the TC only refreshes the stored answer set */
+  bool refresh;
+
+  /* hash over the address blocks of the TC */
+  uint32_t content_hash;
 };
 
 /* Prototypes */
 static enum rfc5444_result
 _cb_messagetlvs(struct rfc5444_reader_tlvblock_context *context);
 
+static enum rfc5444_result
+_cb_addresstlvs_pass1(struct rfc5444_reader_tlvblock_context *context);
+static enum rfc5444_result _cb_addresstlvs_pass1_end(
+    struct rfc5444_reader_tlvblock_context *context, bool dropped);
+
 static enum rfc5444_result
 _cb_addresstlvs(struct rfc5444_reader_tlvblock_context *context);
 static enum rfc5444_result _cb_messagetlvs_end(
     struct rfc5444_reader_tlvblock_context *context, bool dropped);
 
 /* definition of the RFC5444 reader components */
-static struct rfc5444_reader_tlvblock_consumer _olsrv2_message_consumer = {
+static struct rfc5444_reader_tlvblock_consumer _olsrv2_message_pass1_consumer = {
   .order = RFC5444_MAIN_PARSER_PRIORITY,
   .msg_id = RFC5444_MSGTYPE_TC,
   .block_callback = _cb_messagetlvs,
-  .end_callback = _cb_messagetlvs_end,
+  .end_callback = _cb_addresstlvs_pass1_end,
 };
 
 static struct rfc5444_reader_tlvblock_consumer_entry _olsrv2_message_tlvs[] = {
@@ -108,10 +128,33 @@ static struct rfc5444_reader_tlvblock_consumer_entry _olsrv2_message_tlvs[] = {
       .mandatory = true, .min_length = 2, .match_length = true },
 };
 
-static struct rfc5444_reader_tlvblock_consumer _olsrv2_address_consumer = {
+static struct rfc5444_reader_tlvblock_consumer _olsrv2_address_pass1_consumer = {
   .order = RFC5444_MAIN_PARSER_PRIORITY,
   .msg_id = RFC5444_MSGTYPE_TC,
   .addrblock_consumer = true,
+  .block_callback = _cb_addresstlvs_pass1,
+};
+
+/* only used for the fingerprint of the TC */
+static struct rfc5444_reader_tlvblock_consumer_entry _olsrv2_address_pass1_tlvs[] = {
+  [IDX_ADDRTLV_LINK_METRIC] = { .type = RFC5444_ADDRTLV_LINK_METRIC,
+    .min_length = 2, .match_length = true },
+  [IDX_ADDRTLV_NBR_ADDR_TYPE] = { .type = RFC5444_ADDRTLV_NBR_ADDR_TYPE,
+    .min_length = 1, .match_length = true },
+  [IDX_ADDRTLV_GATEWAY] = { .type = RFC5444_ADDRTLV_GATEWAY,
+    .min_length = 1, .match_length = true },
+};
+
+static struct rfc5444_reader_tlvblock_consumer _olsrv2_message_pass2_consumer = {
+  .order = RFC5444_MAIN_PARSER_PRIORITY + 1,
+  .msg_id = RFC5444_MSGTYPE_TC,
+  .end_callback = _cb_messagetlvs_end,
+};
+
+static struct rfc5444_reader_tlvblock_consumer _olsrv2_address_pass2_consumer = {
+  .order = RFC5444_MAIN_PARSER_PRIORITY + 1,
+  .msg_id = RFC5444_MSGTYPE_TC,
+  .addrblock_consumer = true,
   .block_callback = _cb_addresstlvs,
 };
 
@@ -137,10 +180,15 @@ olsrv2_reader_init(struct oonf_rfc5444_protocol *p) {
   _protocol = p;
 
   rfc5444_reader_add_message_consumer(
-      &_protocol->reader, &_olsrv2_message_consumer,
+      &_protocol->reader, &_olsrv2_message_pass1_consumer,
       _olsrv2_message_tlvs, ARRAYSIZE(_olsrv2_message_tlvs));
   rfc5444_reader_add_message_consumer(
-      &_protocol->reader, &_olsrv2_address_consumer,
+      &_protocol->reader, &_olsrv2_address_pass1_consumer,
+      _olsrv2_address_pass1_tlvs, ARRAYSIZE(_olsrv2_address_pass1_tlvs));
+  rfc5444_reader_add_message_consumer(
+      &_protocol->reader, &_olsrv2_message_pass2_consumer, NULL, 0);
+  rfc5444_reader_add_message_consumer(
+      &_protocol->reader, &_olsrv2_address_pass2_consumer,
       _olsrv2_address_tlvs, ARRAYSIZE(_olsrv2_address_tlvs));
 }
 
@@ -150,9 +198,13 @@ olsrv2_reader_init(struct oonf_rfc5444_protocol *p) {
 void
 olsrv2_reader_cleanup(void) {
   rfc5444_reader_remove_message_consumer(
-      &_protocol->reader, &_olsrv2_address_consumer);
+      &_protocol->reader, &_olsrv2_address_pass2_consumer);
   rfc5444_reader_remove_message_consumer(
-      &_protocol->reader, &_olsrv2_message_consumer);
+      &_protocol->reader, &_olsrv2_message_pass2_consumer);
+  rfc5444_reader_remove_message_consumer(
+      &_protocol->reader, &_olsrv2_address_pass1_consumer);
+  rfc5444_reader_remove_message_consumer(
+      &_protocol->reader, &_olsrv2_message_pass1_consumer);
 }
 
 /**
@@ -162,13 +214,16 @@ olsrv2_reader_cleanup(void) {
  */
 static enum rfc5444_result
 _cb_messagetlvs(struct rfc5444_reader_tlvblock_context *context) {
-  uint64_t itime;
+  size_t domain_count;
   uint16_t ansn;
   uint8_t tmp;
 #ifdef OONF_LOG_DEBUG_INFO
   struct netaddr_str buf;
 #endif
 
+  /* clear session data */
+  memset(&_current, 0, sizeof(_current));
+
   OONF_DEBUG(LOG_OLSRV2_R, "Received TC from %s",
       netaddr_to_string(&buf, _protocol->input_address));
 
@@ -186,9 +241,6 @@ _cb_messagetlvs(struct rfc5444_reader_tlvblock_context *context) {
   OONF_DEBUG(LOG_OLSRV2_R, "Originator: %s   Seqno: %u",
       netaddr_to_string(&buf, &context->orig_addr), context->seqno);
 
-  /* clear session data */
-  memset(&_current, 0, sizeof(_current));
-
   /* get cont_seq_num extension */
   tmp = _olsrv2_message_tlvs[IDX_TLV_CONT_SEQ_NUM].type_ext;
   if (tmp != RFC5444_CONT_SEQ_NUM_COMPLETE
@@ -216,10 +268,7 @@ _cb_messagetlvs(struct rfc5444_reader_tlvblock_context *context) {
         _olsrv2_message_tlvs[IDX_TLV_ITIME].tlv->single_value,
         _olsrv2_message_tlvs[IDX_TLV_ITIME].tlv->length,
         context->hopcount);
-    itime = rfc5444_timetlv_decode(tmp);
-  }
-  else {
-    itime = 0;
+    _current.itime = rfc5444_timetlv_decode(tmp);
   }
 
   /* test if we already forwarded the message */
@@ -234,6 +283,9 @@ _cb_messagetlvs(struct rfc5444_reader_tlvblock_context *context) {
     return RFC5444_DROP_MESSAGE;
   }
 
+  /* remember topology state to detect changes by this TC */
+  _current.generation = olsrv2_routing_get_topology_generation();
+
   /* get tc node */
   _current.node = olsrv2_tc_node_add(
       &context->orig_addr, _current.vtime, ansn);
@@ -250,23 +302,90 @@ _cb_messagetlvs(struct rfc5444_reader_tlvblock_context *context) {
   }
 
   /* overwrite old ansn */
+  _current.new_set = ansn != _current.node->ansn;
   _current.node->ansn = ansn;
 
-  /* reset validity time and interval time */
-  oonf_timer_set(&_current.node->_validity_time, _current.vtime);
-  _current.node->interval_time = itime;
+  /*
+   * a complete TC with the ANSN of a complete answer set normally
+   * carries the same content, the address blocks are hashed in the
+   * first pass to verify this. The domain count is part of the hash
+   * because TLVs of unknown domains are ignored.
+   */
+  _current.refresh = !_current.new_set && _current.complete_tc
+      && _current.node->content_hash != 0;
+  domain_count = nhdp_domain_get_count();
+  _current.content_hash = nhdp_hash_fnv1a_add(NHDP_HASH_FNV1A_INIT,
+      &domain_count, sizeof(domain_count));
 
   /* continue parsing the message */
   return RFC5444_OKAY;
 }
 
+/**
+ * Callback that hashes the address TLVs of TC
+ * @param context
+ * @return
+ */
+static enum rfc5444_result
+_cb_addresstlvs_pass1(struct rfc5444_reader_tlvblock_context *context) {
+  struct rfc5444_reader_tlvblock_entry *tlv;
+
+  if (_current.node == NULL) {
+    return RFC5444_OKAY;
+  }
+
+  /* hash address and TLV values */
+  _current.content_hash = nhdp_hash_fnv1a_add(_current.content_hash,
+      &context->addr, sizeof(context->addr));
+  for (size_t i=0; i<ARRAYSIZE(_olsrv2_address_pass1_tlvs); i++) {
+    for (tlv = _olsrv2_address_pass1_tlvs[i].tlv; tlv; tlv = tlv->next_entry) {
+      _current.content_hash = nhdp_hash_fnv1a_add(_current.content_hash,
+          &tlv->type, sizeof(tlv->type));
+      _current.content_hash = nhdp_hash_fnv1a_add(_current.content_hash,
+          &tlv->type_ext, sizeof(tlv->type_ext));
+      _current.content_hash = nhdp_hash_fnv1a_add(_current.content_hash,
+          tlv->single_value, tlv->length);
+    }
+  }
+  return RFC5444_OKAY;
+}
+
+/**
+ * Handle end of message for pass1 processing. Refresh the node
+ * if the TC carried the stored answer set again, otherwise the
+ * TC is processed completely in the second pass.
+ * @param context
+ * @param dropped
+ * @return
+ */
+static enum rfc5444_result
+_cb_addresstlvs_pass1_end(struct rfc5444_reader_tlvblock_context *context __attribute__((unused)),
+    bool dropped) {
+  if (_current.node == NULL || dropped) {
+    return RFC5444_OKAY;
+  }
+
+  if (_current.content_hash == 0) {
+    /* 0 is reserved for 'unknown' */
+    _current.content_hash = 1;
+  }
+
+  if (_current.refresh
+      && !olsrv2_tc_node_refresh(_current.node, _current.content_hash)) {
+    OONF_INFO(LOG_OLSRV2_R, "TC content changed without new ANSN %u",
+        _current.node->ansn);
+    _current.refresh = false;
+  }
+  return RFC5444_OKAY;
+}
+
 /**
  * Callback that parses address TLVs of TC
  * @param context
  * @return
  */
 static enum rfc5444_result
-_cb_addresstlvs(struct rfc5444_reader_tlvblock_context *context __attribute__((unused))) {
+_cb_addresstlvs(struct rfc5444_reader_tlvblock_context *context) {
   struct rfc5444_reader_tlvblock_entry *tlv;
   struct nhdp_domain *domain;
   struct olsrv2_tc_edge *edge;
@@ -278,7 +397,8 @@ _cb_addresstlvs(struct rfc5444_reader_tlvblock_context *context __attribute__((u
   struct netaddr_str buf;
 #endif
 
-  if (_current.node == NULL) {
+  if (_current.node == NULL || _current.refresh) {
+    /* nothing changed since the last TC of the node */
     return RFC5444_OKAY;
   }
 
@@ -329,10 +449,10 @@ _cb_addresstlvs(struct rfc5444_reader_tlvblock_context *context __attribute__((u
             _current.node->ansn,
             cost_out[domain->index], cost_in[domain->index]);
         edge->ansn = _current.node->ansn;
-        edge->cost[domain->index] = cost_out[domain->index];
+        olsrv2_tc_edge_set_cost(edge, domain, cost_out[domain->index]);
 
         if (edge->inverse->virtual) {
-          edge->inverse->cost[domain->index] = cost_in[domain->index];
+          olsrv2_tc_edge_set_cost(edge->inverse, domain, cost_in[domain->index]);
         }
       }
     }
@@ -346,7 +466,8 @@ _cb_addresstlvs(struct rfc5444_reader_tlvblock_context *context __attribute__((u
             _current.node->ansn,
             cost_out[domain->index]);
         end->ansn = _current.node->ansn;
-        end->cost[domain->index] = cost_out[domain->index];
+        olsrv2_tc_endpoint_set_cost(end, domain, cost_out[domain->index],
+            olsrv2_tc_endpoint_get_distance(end, domain->index));
       }
     }
   }
@@ -368,8 +489,8 @@ _cb_addresstlvs(struct rfc5444_reader_tlvblock_context *context __attribute__((u
           cost_out[domain->index],
           tlv->single_value[0]);
       end->ansn = _current.node->ansn;
-      end->cost[domain->index] = cost_out[domain->index];
-      end->distance[domain->index] = tlv->single_value[0];
+      olsrv2_tc_endpoint_set_cost(end, domain, cost_out[domain->index],
+          tlv->single_value[0]);
     }
   }
   return RFC5444_OKAY;
@@ -384,30 +505,47 @@ _cb_addresstlvs(struct rfc5444_reader_tlvblock_context *context __attribute__((u
 static enum rfc5444_result
 _cb_messagetlvs_end(struct rfc5444_reader_tlvblock_context *context __attribute__((unused)),
     bool dropped) {
-  /* cleanup everything that is not the current ANSN */
-  struct olsrv2_tc_edge *edge, *edge_it;
-  struct olsrv2_tc_attachment *end, *end_it;
+  struct olsrv2_tc_node *node;
+  uint64_t hold_time;
 
-  if (dropped || _current.node == NULL) {
+  node = _current.node;
+  _current.node = NULL;
+
+  if (node == NULL || (dropped && !_current.new_set)) {
     return RFC5444_OKAY;
   }
 
-  avl_for_each_element_safe(&_current.node->_edges, edge, _node, edge_it) {
-    if (edge->ansn != _current.node->ansn) {
-      olsrv2_tc_edge_remove(edge);
-    }
+  if (!dropped) {
+    /* reset validity time and interval time of the accepted TC */
+    nhdp_timer_set(&node->_validity_time, _current.vtime);
+    node->interval_time = _current.itime;
   }
 
-  avl_for_each_element_safe(&_current.node->_endpoints, end, _src_node, end_it) {
-    if (end->ansn != _current.node->ansn) {
-      olsrv2_tc_endpoint_remove(end);
-    }
+  if (_current.refresh) {
+    /* the TC only refreshed the stored answer set */
+    olsrv2_routing_trigger_topology_update(_current.generation);
+    return RFC5444_OKAY;
   }
 
-  _current.node = NULL;
+  if (_current.complete_tc && !dropped) {
+    /* cleanup everything that is not the current ANSN */
+    olsrv2_tc_node_set_complete(node, _current.content_hash);
+  }
+  else {
+    /*
+     * keep the older entries until the other fragments of the answer
+     * set had time to arrive, a dropped TC with a new ANSN is handled
+     * like a fragment
+     */
+    hold_time = node->interval_time;
+    if (hold_time == 0 || hold_time > _current.vtime) {
+      hold_time = _current.vtime;
+    }
+    olsrv2_tc_node_add_fragment(node, _current.new_set, hold_time);
+  }
 
-  /* recalculate routing table */
-  olsrv2_routing_trigger_update();
+  /* recalculate routing table if the TC changed the topology */
+  olsrv2_routing_trigger_topology_update(_current.generation);
 
   return RFC5444_OKAY;
 }
@@ -0,0 +1,1011 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "common/avl.h"
+#include "common/avl_comp.h"
+#include "common/common_types.h"
+#include "common/netaddr.h"
+#include "core/oonf_logging.h"
+#include "subsystems/oonf_class.h"
+#include "subsystems/oonf_timer.h"
+#include "subsystems/os_routing.h"
+
+#include "nhdp/nhdp_db.h"
+#include "nhdp/nhdp_domain.h"
+
+#include "olsrv2/olsrv2.h"
+#include "olsrv2/olsrv2_restart.h"
+#include "olsrv2/olsrv2_routing.h"
+#include "olsrv2/olsrv2_tc.h"
+
+/* neighbor of the previous instance that has not been heard again */
+struct _expected_neighbor {
+  /* originator address of neighbor */
+  struct netaddr originator;
+
+  /* node for tree of expected neighbors */
+  struct avl_node _node;
+};
+
+/* prototypes */
+static uint64_t _get_wallclock(void);
+static void _to_restart_addr(struct olsrv2_restart_addr *dst,
+    const struct netaddr *src);
+static int _from_restart_addr(struct netaddr *dst,
+    const struct olsrv2_restart_addr *src);
+static size_t _fill_header(struct olsrv2_restart_header *header);
+static void _fill_sections(uint8_t *data);
+static void _fill_edge(struct olsrv2_restart_edge *r_edge, uint32_t *costs,
+    uint32_t edge_count, uint32_t src_idx, struct olsrv2_tc_edge *edge,
+    struct olsrv2_tc_edge *cost_edge);
+static int _write_file(const char *file, const void *data, size_t len);
+static const void *_get_section(const struct olsrv2_restart_header *header,
+    enum olsrv2_restart_section_id id);
+static int _validate(const uint8_t *data, size_t len);
+static void _restore(const uint8_t *data);
+static void _restore_topology(const struct olsrv2_restart_header *header,
+    struct nhdp_domain **domains, uint64_t elapsed);
+static void _restore_routes(const struct olsrv2_restart_header *header,
+    struct nhdp_domain **domains);
+static void _restore_neighbors(const struct olsrv2_restart_header *header);
+static void _release_hold(void);
+static void _check_neighbor(struct _expected_neighbor *expected);
+
+static void _cb_load(void *);
+static void _cb_hold_timeout(void *);
+static void _cb_nhdp_update(struct nhdp_neighbor *);
+
+/* size of the entries of each section */
+static const size_t _section_entry_size[OLSRV2_RESTART_SECTION_COUNT] = {
+  [OLSRV2_RESTART_DOMAINS]              = sizeof(uint32_t),
+  [OLSRV2_RESTART_NODES]                = sizeof(struct olsrv2_restart_node),
+  [OLSRV2_RESTART_EDGES]                = sizeof(struct olsrv2_restart_edge),
+  [OLSRV2_RESTART_EDGE_COSTS]           = sizeof(uint32_t),
+  [OLSRV2_RESTART_ATTACHMENTS]          = sizeof(struct olsrv2_restart_attachment),
+  [OLSRV2_RESTART_ATTACHMENT_COSTS]     = sizeof(uint32_t),
+  [OLSRV2_RESTART_ATTACHMENT_DISTANCES] = sizeof(uint8_t),
+  [OLSRV2_RESTART_NEIGHBORS]            = sizeof(struct olsrv2_restart_neighbor),
+  [OLSRV2_RESTART_ROUTES]               = sizeof(struct olsrv2_restart_route),
+};
+
+static struct oonf_class _expected_neighbor_class = {
+  .name = "olsrv2 restart neighbor",
+  .size = sizeof(struct _expected_neighbor),
+};
+
+/* timer to load the restart file after the configuration is applied */
+static struct oonf_timer_info _load_timer_info = {
+  .name = "olsrv2 restart load",
+  .callback = _cb_load,
+};
+
+static struct oonf_timer_entry _load_timer = {
+  .info = &_load_timer_info,
+};
+
+/* timer to stop waiting for the neighbors of the previous instance */
+static struct oonf_timer_info _hold_timer_info = {
+  .name = "olsrv2 restart hold",
+  .callback = _cb_hold_timeout,
+};
+
+static struct oonf_timer_entry _hold_timer = {
+  .info = &_hold_timer_info,
+};
+
+static struct nhdp_domain_listener _nhdp_listener = {
+  .update = _cb_nhdp_update,
+};
+
+/* neighbors of the previous instance that are not symmetric yet */
+static struct avl_tree _expected_neighbors;
+
+/* true if the restart file has been checked after startup */
+static bool _load_scheduled = false;
+
+/**
+ * Initialize warm restart handling
+ */
+void
+olsrv2_restart_init(void) {
+  oonf_class_add(&_expected_neighbor_class);
+  oonf_timer_add(&_load_timer_info);
+  oonf_timer_add(&_hold_timer_info);
+
+  avl_init(&_expected_neighbors, avl_comp_netaddr, false);
+  nhdp_domain_listener_add(&_nhdp_listener);
+}
+
+/**
+ * Cleanup warm restart handling
+ */
+void
+olsrv2_restart_cleanup(void) {
+  struct _expected_neighbor *expected, *e_it;
+
+  nhdp_domain_listener_remove(&_nhdp_listener);
+
+  avl_for_each_element_safe(&_expected_neighbors, expected, _node, e_it) {
+    avl_remove(&_expected_neighbors, &expected->_node);
+    oonf_class_free(&_expected_neighbor_class, expected);
+  }
+
+  oonf_timer_stop(&_hold_timer);
+  oonf_timer_stop(&_load_timer);
+
+  oonf_timer_remove(&_hold_timer_info);
+  oonf_timer_remove(&_load_timer_info);
+  oonf_class_remove(&_expected_neighbor_class);
+}
+
+/**
+ * Write the tc database, the symmetric neighbors and the kernel
+ * routes into the restart file. The file is replaced atomically.
+ * @return -1 if warm restart is disabled or an error happened,
+ *   0 if the file was written
+ */
+int
+olsrv2_restart_write(void) {
+  struct olsrv2_restart_header header;
+  const char *file;
+  uint8_t *data;
+  size_t len;
+  int result;
+
+  file = olsrv2_get_restart_file();
+  if (*file == 0) {
+    /* warm restart is disabled */
+    return -1;
+  }
+
+  len = _fill_header(&header);
+  data = calloc(1, len);
+  if (data == NULL) {
+    OONF_WARN(LOG_OLSRV2, "Not enough memory for restart file (%zu bytes)",
+        len);
+    return -1;
+  }
+
+  memcpy(data, &header, sizeof(header));
+  _fill_sections(data);
+
+  result = _write_file(file, data, len);
+  free(data);
+
+  if (result == 0) {
+    OONF_INFO(LOG_OLSRV2, "Wrote restart file %s: %u nodes, %u routes",
+        file, header.sections[OLSRV2_RESTART_NODES].count,
+        header.sections[OLSRV2_RESTART_ROUTES].count);
+  }
+  return result;
+}
+
+/**
+ * Load the restart file as soon as the configuration has been
+ * applied completely. Only the first call after startup has
+ * an effect.
+ */
+void
+olsrv2_restart_schedule_load(void) {
+  if (_load_scheduled) {
+    return;
+  }
+
+  _load_scheduled = true;
+  oonf_timer_set(&_load_timer, 1);
+}
+
+/**
+ * @return current wall clock time in milliseconds
+ */
+static uint64_t
+_get_wallclock(void) {
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return (uint64_t)tv.tv_sec * 1000ull + (uint64_t)tv.tv_usec / 1000ull;
+}
+
+/**
+ * Convert a network address into its restart file representation
+ * @param dst pointer to restart file address
+ * @param src pointer to network address
+ */
+static void
+_to_restart_addr(struct olsrv2_restart_addr *dst, const struct netaddr *src) {
+  memset(dst, 0, sizeof(*dst));
+
+  switch (netaddr_get_address_family(src)) {
+    case AF_INET:
+      dst->version = 4;
+      break;
+    case AF_INET6:
+      dst->version = 6;
+      break;
+    default:
+      return;
+  }
+
+  memcpy(dst->addr, netaddr_get_binptr(src), netaddr_get_binlength(src));
+  dst->prefix_len = netaddr_get_prefix_length(src);
+}
+
+/**
+ * Convert a restart file address into a network address
+ * @param dst pointer to network address
+ * @param src pointer to restart file address
+ * @return -1 if the address was invalid, 0 otherwise
+ */
+static int
+_from_restart_addr(struct netaddr *dst, const struct olsrv2_restart_addr *src) {
+  switch (src->version) {
+    case 0:
+      netaddr_invalidate(dst);
+      return 0;
+    case 4:
+      return netaddr_from_binary_prefix(dst, src->addr, 4,
+          AF_INET, src->prefix_len);
+    case 6:
+      return netaddr_from_binary_prefix(dst, src->addr, 16,
+          AF_INET6, src->prefix_len);
+    default:
+      return -1;
+  }
+}
+
+/**
+ * Count the entries of all sections and calculate the layout
+ * of the restart file
+ * @param header pointer to header of restart file
+ * @return size of restart file
+ */
+static size_t
+_fill_header(struct olsrv2_restart_header *header) {
+  struct olsrv2_routing_entry *rtentry;
+  struct olsrv2_tc_edge *edge;
+  struct olsrv2_tc_node *node;
+  struct nhdp_neighbor *neigh;
+  struct nhdp_domain *domain;
+  uint32_t counts[OLSRV2_RESTART_SECTION_COUNT];
+  size_t offset;
+  int i;
+
+  memset(counts, 0, sizeof(counts));
+
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    counts[OLSRV2_RESTART_DOMAINS]++;
+
+    avl_for_each_element(&olsrv2_routing_tree[domain->index], rtentry, _node) {
+      if (olsrv2_routing_is_in_kernel(rtentry)) {
+        counts[OLSRV2_RESTART_ROUTES]++;
+      }
+    }
+  }
+
+  avl_for_each_element(&olsrv2_tc_tree, node, _originator_node) {
+    if (!nhdp_timer_is_active(&node->_validity_time)) {
+      /* virtual nodes are created again by the edges */
+      continue;
+    }
+
+    counts[OLSRV2_RESTART_NODES]++;
+    counts[OLSRV2_RESTART_ATTACHMENTS] += node->_endpoints.count;
+
+    avl_for_each_element(&node->_edges, edge, _node) {
+      if (!edge->virtual) {
+        counts[OLSRV2_RESTART_EDGES]++;
+      }
+      if (edge->inverse->virtual) {
+        counts[OLSRV2_RESTART_EDGES]++;
+      }
+    }
+  }
+  counts[OLSRV2_RESTART_EDGE_COSTS] =
+      counts[OLSRV2_RESTART_DOMAINS] * counts[OLSRV2_RESTART_EDGES];
+  counts[OLSRV2_RESTART_ATTACHMENT_COSTS] =
+      counts[OLSRV2_RESTART_DOMAINS] * counts[OLSRV2_RESTART_ATTACHMENTS];
+  counts[OLSRV2_RESTART_ATTACHMENT_DISTANCES] =
+      counts[OLSRV2_RESTART_ATTACHMENT_COSTS];
+
+  list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
+    if (neigh->symmetric > 0
+        && neigh->originator_id != NHDP_ADDR_ID_NONE) {
+      counts[OLSRV2_RESTART_NEIGHBORS]++;
+    }
+  }
+
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, OLSRV2_RESTART_MAGIC, sizeof(header->magic));
+  header->version = OLSRV2_RESTART_VERSION;
+  header->byte_order = OLSRV2_RESTART_BYTE_ORDER;
+  header->timestamp = _get_wallclock();
+  header->domain_count = counts[OLSRV2_RESTART_DOMAINS];
+
+  /* sections follow the header, each one 4 byte aligned */
+  offset = sizeof(*header);
+  for (i=0; i<OLSRV2_RESTART_SECTION_COUNT; i++) {
+    header->sections[i].offset = offset;
+    header->sections[i].count = counts[i];
+
+    offset += (counts[i] * _section_entry_size[i] + 3) & ~(size_t)3;
+  }
+  return offset;
+}
+
+/**
+ * Copy the databases into the sections of the restart file,
+ * in the same order as they were counted by _fill_header()
+ * @param data pointer to restart file with filled header
+ */
+static void
+_fill_sections(uint8_t *data) {
+  const struct olsrv2_restart_header *header;
+  struct olsrv2_restart_attachment *r_attachment;
+  struct olsrv2_restart_neighbor *r_neighbor;
+  struct olsrv2_restart_route *r_route;
+  struct olsrv2_restart_edge *r_edge;
+  struct olsrv2_restart_node *r_node;
+  struct olsrv2_routing_entry *rtentry;
+  struct olsrv2_tc_attachment *net;
+  struct olsrv2_tc_edge *edge;
+  struct olsrv2_tc_node *node;
+  struct nhdp_neighbor *neigh;
+  struct nhdp_domain *domain;
+  uint32_t *ext, *edge_costs, *net_costs;
+  uint8_t *net_distances;
+  uint32_t node_idx, edge_idx, net_idx, edge_count, net_count, d;
+  int64_t vtime;
+
+  header = (const struct olsrv2_restart_header *)data;
+
+#define _SECTION(id) (data + header->sections[id].offset)
+  ext = (uint32_t *)_SECTION(OLSRV2_RESTART_DOMAINS);
+  r_node = (struct olsrv2_restart_node *)_SECTION(OLSRV2_RESTART_NODES);
+  r_edge = (struct olsrv2_restart_edge *)_SECTION(OLSRV2_RESTART_EDGES);
+  edge_costs = (uint32_t *)_SECTION(OLSRV2_RESTART_EDGE_COSTS);
+  r_attachment = (struct olsrv2_restart_attachment *)
+      _SECTION(OLSRV2_RESTART_ATTACHMENTS);
+  net_costs = (uint32_t *)_SECTION(OLSRV2_RESTART_ATTACHMENT_COSTS);
+  net_distances = _SECTION(OLSRV2_RESTART_ATTACHMENT_DISTANCES);
+  r_neighbor = (struct olsrv2_restart_neighbor *)
+      _SECTION(OLSRV2_RESTART_NEIGHBORS);
+  r_route = (struct olsrv2_restart_route *)_SECTION(OLSRV2_RESTART_ROUTES);
+#undef _SECTION
+
+  edge_count = header->sections[OLSRV2_RESTART_EDGES].count;
+  net_count = header->sections[OLSRV2_RESTART_ATTACHMENTS].count;
+
+  /* topology, costs are stored in one column per domain */
+  node_idx = 0;
+  edge_idx = 0;
+  net_idx = 0;
+  avl_for_each_element(&olsrv2_tc_tree, node, _originator_node) {
+    if (!nhdp_timer_is_active(&node->_validity_time)) {
+      continue;
+    }
+
+    vtime = nhdp_timer_get_due(&node->_validity_time);
+    _to_restart_addr(&r_node[node_idx].originator,
+        olsrv2_tc_target_get_netaddr(&node->target));
+    r_node[node_idx].vtime = vtime < 0 ? 0
+        : vtime > UINT32_MAX ? UINT32_MAX : (uint32_t)vtime;
+    r_node[node_idx].ansn = node->ansn;
+
+    avl_for_each_element(&node->_edges, edge, _node) {
+      /* virtual edges are stored with the real edge they belong to */
+      if (!edge->virtual) {
+        _fill_edge(&r_edge[edge_idx], edge_costs + edge_idx, edge_count,
+            node_idx, edge, edge);
+        edge_idx++;
+      }
+      if (edge->inverse->virtual) {
+        _fill_edge(&r_edge[edge_idx], edge_costs + edge_idx, edge_count,
+            node_idx, edge, edge->inverse);
+        edge_idx++;
+      }
+    }
+
+    avl_for_each_element(&node->_endpoints, net, _src_node) {
+      r_attachment[net_idx].src = node_idx;
+      _to_restart_addr(&r_attachment[net_idx].prefix,
+          olsrv2_tc_target_get_netaddr(&net->dst->target));
+      r_attachment[net_idx].ansn = net->ansn;
+      r_attachment[net_idx].mesh =
+          net->dst->target.type == OONFV2_ADDRESS_TARGET ? 1 : 0;
+
+      d = 0;
+      list_for_each_element(&nhdp_domain_list, domain, _node) {
+        net_costs[d * net_count + net_idx] =
+            olsrv2_tc_endpoint_get_cost(net, domain->index);
+        net_distances[d * net_count + net_idx] =
+            olsrv2_tc_endpoint_get_distance(net, domain->index);
+        d++;
+      }
+      net_idx++;
+    }
+    node_idx++;
+  }
+
+  /* symmetric neighbors */
+  list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
+    if (neigh->symmetric > 0
+        && neigh->originator_id != NHDP_ADDR_ID_NONE) {
+      _to_restart_addr(&r_neighbor->originator, nhdp_db_neighbor_get_originator(neigh));
+      r_neighbor++;
+    }
+  }
+
+  /* domains and kernel routes */
+  d = 0;
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    ext[d] = domain->ext;
+
+    avl_for_each_element(&olsrv2_routing_tree[domain->index], rtentry, _node) {
+      if (!olsrv2_routing_is_in_kernel(rtentry)) {
+        continue;
+      }
+
+      _to_restart_addr(&r_route->dst, &rtentry->route.dst);
+      _to_restart_addr(&r_route->gw, &rtentry->route.gw);
+      _to_restart_addr(&r_route->src, &rtentry->route.src);
+      r_route->if_index = rtentry->route.if_index;
+      r_route->cost = rtentry->cost;
+      r_route->metric = rtentry->route.metric;
+      r_route->domain = d;
+      r_route->table = rtentry->route.table;
+      r_route->protocol = rtentry->route.protocol;
+      r_route++;
+    }
+    d++;
+  }
+}
+
+/**
+ * Copy a tc edge into the restart file
+ * @param r_edge pointer to edge record
+ * @param costs pointer to cost of the edge in the first column
+ * @param edge_count number of edges, the length of a cost column
+ * @param src_idx index of the source of the real edge
+ * @param edge pointer to real tc edge
+ * @param cost_edge pointer to edge whose costs should be stored,
+ *   either the real edge or its virtual inverse
+ */
+static void
+_fill_edge(struct olsrv2_restart_edge *r_edge, uint32_t *costs,
+    uint32_t edge_count, uint32_t src_idx, struct olsrv2_tc_edge *edge,
+    struct olsrv2_tc_edge *cost_edge) {
+  struct nhdp_domain *domain;
+  uint32_t d;
+
+  r_edge->src = src_idx;
+  _to_restart_addr(&r_edge->dst, olsrv2_tc_target_get_netaddr(&edge->dst->target));
+  r_edge->ansn = cost_edge->ansn;
+  r_edge->virtual = cost_edge->virtual ? 1 : 0;
+
+  d = 0;
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    costs[d * edge_count] = olsrv2_tc_edge_get_cost(cost_edge, domain->index);
+    d++;
+  }
+}
+
+/**
+ * Write a file atomically by writing a temporary file first
+ * and renaming it afterwards
+ * @param file name of file
+ * @param data pointer to file content
+ * @param len length of file content
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_write_file(const char *file, const void *data, size_t len) {
+  char tmpfile[OLSRV2_RESTART_FILE_MAXLEN + 4];
+  const uint8_t *ptr;
+  ssize_t written;
+  int fd;
+
+  snprintf(tmpfile, sizeof(tmpfile), "%s.tmp", file);
+
+  fd = open(tmpfile, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) {
+    OONF_WARN(LOG_OLSRV2, "Cannot create restart file %s: %s (%d)",
+        tmpfile, strerror(errno), errno);
+    return -1;
+  }
+
+  for (ptr = data; len > 0; ptr += written, len -= written) {
+    written = write(fd, ptr, len);
+    if (written < 0) {
+      if (errno == EINTR) {
+        written = 0;
+        continue;
+      }
+
+      OONF_WARN(LOG_OLSRV2, "Cannot write restart file %s: %s (%d)",
+          tmpfile, strerror(errno), errno);
+      close(fd);
+      unlink(tmpfile);
+      return -1;
+    }
+  }
+
+  if (fsync(fd) || close(fd) || rename(tmpfile, file)) {
+    OONF_WARN(LOG_OLSRV2, "Cannot store restart file %s: %s (%d)",
+        file, strerror(errno), errno);
+    unlink(tmpfile);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @param header pointer to validated header of restart file
+ * @param id section id
+ * @return pointer to first entry of section
+ */
+static const void *
+_get_section(const struct olsrv2_restart_header *header,
+    enum olsrv2_restart_section_id id) {
+  return (const uint8_t *)header + header->sections[id].offset;
+}
+
+/**
+ * Check the header of a restart file and make sure all sections
+ * are inside of the file
+ * @param data pointer to restart file
+ * @param len length of restart file
+ * @return -1 if the file cannot be used, 0 otherwise
+ */
+static int
+_validate(const uint8_t *data, size_t len) {
+  const struct olsrv2_restart_header *header;
+  const struct olsrv2_restart_section *section;
+  uint64_t domains;
+  int i;
+
+  if (len < sizeof(*header)) {
+    return -1;
+  }
+
+  header = (const struct olsrv2_restart_header *)data;
+  if (memcmp(header->magic, OLSRV2_RESTART_MAGIC, sizeof(header->magic)) != 0
+      || header->version != OLSRV2_RESTART_VERSION
+      || header->byte_order != OLSRV2_RESTART_BYTE_ORDER) {
+    return -1;
+  }
+
+  for (i=0; i<OLSRV2_RESTART_SECTION_COUNT; i++) {
+    section = &header->sections[i];
+    if ((section->offset & 3) != 0
+        || section->offset < sizeof(*header)
+        || section->offset > len
+        || (uint64_t)section->count * _section_entry_size[i]
+            > len - section->offset) {
+      return -1;
+    }
+  }
+
+  domains = header->sections[OLSRV2_RESTART_DOMAINS].count;
+  if (header->domain_count != domains
+      || header->sections[OLSRV2_RESTART_EDGE_COSTS].count
+          != domains * header->sections[OLSRV2_RESTART_EDGES].count
+      || header->sections[OLSRV2_RESTART_ATTACHMENT_COSTS].count
+          != domains * header->sections[OLSRV2_RESTART_ATTACHMENTS].count
+      || header->sections[OLSRV2_RESTART_ATTACHMENT_DISTANCES].count
+          != domains * header->sections[OLSRV2_RESTART_ATTACHMENTS].count) {
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Restore the databases from a validated restart file
+ * @param data pointer to restart file
+ */
+static void
+_restore(const uint8_t *data) {
+  const struct olsrv2_restart_header *header;
+  struct nhdp_domain **domains;
+  const uint32_t *ext;
+  uint64_t now, elapsed;
+  uint32_t d;
+
+  header = (const struct olsrv2_restart_header *)data;
+
+  now = _get_wallclock();
+  elapsed = now > header->timestamp ? now - header->timestamp : 0;
+
+  /* map the domains of the file to the configured domains */
+  domains = calloc(header->domain_count + 1, sizeof(*domains));
+  if (domains == NULL) {
+    OONF_WARN(LOG_OLSRV2, "Not enough memory to load restart file");
+    return;
+  }
+
+  ext = _get_section(header, OLSRV2_RESTART_DOMAINS);
+  for (d=0; d<header->domain_count; d++) {
+    domains[d] = ext[d] > 255 ? NULL : nhdp_domain_get_by_ext(ext[d]);
+  }
+
+  _restore_topology(header, domains, elapsed);
+  _restore_routes(header, domains);
+  _restore_neighbors(header);
+
+  free(domains);
+
+  OONF_INFO(LOG_OLSRV2, "Restored %u nodes and %u routes, %u neighbors"
+      " expected, restart file was %" PRIu64 " ms old",
+      olsrv2_tc_tree.count, header->sections[OLSRV2_RESTART_ROUTES].count,
+      _expected_neighbors.count, elapsed);
+}
+
+/**
+ * Restore the tc database with the remaining validity times
+ * @param header pointer to header of validated restart file
+ * @param domains nhdp domain of each cost column, NULL if
+ *   the domain does not exist anymore
+ * @param elapsed time since the restart file was written
+ */
+static void
+_restore_topology(const struct olsrv2_restart_header *header,
+    struct nhdp_domain **domains, uint64_t elapsed) {
+  const struct olsrv2_restart_attachment *r_attachment;
+  const struct olsrv2_restart_edge *r_edge;
+  const struct olsrv2_restart_node *r_node;
+  const uint32_t *edge_costs, *net_costs;
+  const uint8_t *net_distances;
+  struct olsrv2_tc_attachment *net;
+  struct olsrv2_tc_node **nodes, *dst;
+  struct olsrv2_tc_edge *edge;
+  struct netaddr addr;
+  uint32_t i, d, node_count, edge_count, net_count;
+  int pass;
+
+  node_count = header->sections[OLSRV2_RESTART_NODES].count;
+  edge_count = header->sections[OLSRV2_RESTART_EDGES].count;
+  net_count = header->sections[OLSRV2_RESTART_ATTACHMENTS].count;
+
+  r_node = _get_section(header, OLSRV2_RESTART_NODES);
+  r_edge = _get_section(header, OLSRV2_RESTART_EDGES);
+  edge_costs = _get_section(header, OLSRV2_RESTART_EDGE_COSTS);
+  r_attachment = _get_section(header, OLSRV2_RESTART_ATTACHMENTS);
+  net_costs = _get_section(header, OLSRV2_RESTART_ATTACHMENT_COSTS);
+  net_distances = _get_section(header, OLSRV2_RESTART_ATTACHMENT_DISTANCES);
+
+  nodes = calloc(node_count + 1, sizeof(*nodes));
+  if (nodes == NULL) {
+    OONF_WARN(LOG_OLSRV2, "Not enough memory to restore topology");
+    return;
+  }
+
+  for (i=0; i<node_count; i++) {
+    if (r_node[i].vtime <= elapsed
+        || _from_restart_addr(&addr, &r_node[i].originator)
+        || olsrv2_tc_node_get(&addr) != NULL) {
+      /* node expired or is already known by this instance */
+      continue;
+    }
+    nodes[i] = olsrv2_tc_node_add(&addr, r_node[i].vtime - elapsed,
+        r_node[i].ansn);
+  }
+
+  /* add real edges first, they create the virtual inverse edges */
+  for (pass = 0; pass < 2; pass++) {
+    for (i=0; i<edge_count; i++) {
+      if (r_edge[i].src >= node_count || nodes[r_edge[i].src] == NULL
+          || r_edge[i].virtual != pass
+          || _from_restart_addr(&addr, &r_edge[i].dst)) {
+        continue;
+      }
+
+      if (pass == 0) {
+        edge = olsrv2_tc_edge_add(nodes[r_edge[i].src], &addr);
+      }
+      else {
+        /* record holds the costs of the virtual inverse edge */
+        dst = olsrv2_tc_node_get(&addr);
+        edge = NULL;
+        if (dst != NULL) {
+          edge = olsrv2_tc_edge_get(nodes[r_edge[i].src], dst);
+        }
+        if (edge != NULL) {
+          edge = edge->inverse->virtual ? edge->inverse : NULL;
+        }
+      }
+      if (edge == NULL) {
+        continue;
+      }
+
+      edge->ansn = r_edge[i].ansn;
+      for (d=0; d<header->domain_count; d++) {
+        if (domains[d]) {
+          olsrv2_tc_edge_set_cost(edge, domains[d],
+              edge_costs[d * edge_count + i]);
+        }
+      }
+    }
+  }
+
+  for (i=0; i<net_count; i++) {
+    if (r_attachment[i].src >= node_count
+        || nodes[r_attachment[i].src] == NULL
+        || _from_restart_addr(&addr, &r_attachment[i].prefix)) {
+      continue;
+    }
+
+    net = olsrv2_tc_endpoint_add(nodes[r_attachment[i].src], &addr,
+        r_attachment[i].mesh != 0);
+    if (net == NULL) {
+      continue;
+    }
+
+    net->ansn = r_attachment[i].ansn;
+    for (d=0; d<header->domain_count; d++) {
+      if (domains[d]) {
+        olsrv2_tc_endpoint_set_cost(net, domains[d],
+            net_costs[d * net_count + i], net_distances[d * net_count + i]);
+      }
+    }
+  }
+
+  free(nodes);
+}
+
+/**
+ * Take over the kernel routes of the previous instance
+ * @param header pointer to header of validated restart file
+ * @param domains nhdp domain of each domain index of the file
+ */
+static void
+_restore_routes(const struct olsrv2_restart_header *header,
+    struct nhdp_domain **domains) {
+  const struct olsrv2_restart_route *r_route;
+  struct os_route route;
+  uint32_t i;
+
+  r_route = _get_section(header, OLSRV2_RESTART_ROUTES);
+  for (i=0; i<header->sections[OLSRV2_RESTART_ROUTES].count; i++) {
+    memset(&route, 0, sizeof(route));
+    if (r_route[i].domain >= header->domain_count
+        || domains[r_route[i].domain] == NULL
+        || _from_restart_addr(&route.dst, &r_route[i].dst)
+        || _from_restart_addr(&route.gw, &r_route[i].gw)
+        || _from_restart_addr(&route.src, &r_route[i].src)) {
+      continue;
+    }
+
+    route.family = netaddr_get_address_family(&route.dst);
+    route.if_index = r_route[i].if_index;
+    route.metric = r_route[i].metric;
+    route.table = r_route[i].table;
+    route.protocol = r_route[i].protocol;
+
+    if (olsrv2_routing_restore_route(
+        domains[r_route[i].domain], &route, r_route[i].cost)) {
+      OONF_WARN(LOG_OLSRV2, "Not enough memory to restore routes");
+      return;
+    }
+  }
+}
+
+/**
+ * Hold the dijkstra until the symmetric neighbors of the previous
+ * instance are symmetric again or the hold time is over
+ * @param header pointer to header of validated restart file
+ */
+static void
+_restore_neighbors(const struct olsrv2_restart_header *header) {
+  const struct olsrv2_restart_neighbor *r_neighbor;
+  struct _expected_neighbor *expected, *e_it;
+  struct netaddr addr;
+  uint32_t i;
+
+  r_neighbor = _get_section(header, OLSRV2_RESTART_NEIGHBORS);
+  for (i=0; i<header->sections[OLSRV2_RESTART_NEIGHBORS].count; i++) {
+    if (_from_restart_addr(&addr, &r_neighbor[i].originator)
+        || avl_find(&_expected_neighbors, &addr) != NULL) {
+      continue;
+    }
+
+    expected = oonf_class_malloc(&_expected_neighbor_class);
+    if (expected == NULL) {
+      break;
+    }
+
+    memcpy(&expected->originator, &addr, sizeof(addr));
+    expected->_node.key = &expected->originator;
+    avl_insert(&_expected_neighbors, &expected->_node);
+  }
+
+  /* some neighbors might have been heard already */
+  avl_for_each_element_safe(&_expected_neighbors, expected, _node, e_it) {
+    _check_neighbor(expected);
+  }
+
+  if (_expected_neighbors.count == 0) {
+    _release_hold();
+    return;
+  }
+
+  olsrv2_routing_set_restart_hold(true);
+  oonf_timer_set(&_hold_timer, olsrv2_get_restart_hold());
+}
+
+/**
+ * Stop waiting for the neighbors of the previous instance
+ * and let the dijkstra reconcile the restored routes
+ */
+static void
+_release_hold(void) {
+  struct _expected_neighbor *expected, *e_it;
+
+  avl_for_each_element_safe(&_expected_neighbors, expected, _node, e_it) {
+    avl_remove(&_expected_neighbors, &expected->_node);
+    oonf_class_free(&_expected_neighbor_class, expected);
+  }
+
+  oonf_timer_stop(&_hold_timer);
+
+  /* trigger a dijkstra to reconcile the restored routes */
+  olsrv2_routing_set_restart_hold(false);
+}
+
+/**
+ * Remove an expected neighbor if it is symmetric again
+ * @param expected pointer to expected neighbor
+ */
+static void
+_check_neighbor(struct _expected_neighbor *expected) {
+  struct nhdp_neighbor *neigh;
+
+  neigh = nhdp_db_neighbor_get_by_originator(&expected->originator);
+  if (neigh != NULL && neigh->symmetric > 0) {
+    avl_remove(&_expected_neighbors, &expected->_node);
+    oonf_class_free(&_expected_neighbor_class, expected);
+  }
+}
+
+/**
+ * Callback to load the restart file after startup
+ * @param ptr unused
+ */
+static void
+_cb_load(void *ptr __attribute__((unused))) {
+  const char *file;
+  struct stat st;
+  void *data;
+  int fd;
+
+  file = olsrv2_get_restart_file();
+  if (*file == 0) {
+    /* warm restart is disabled */
+    return;
+  }
+
+  fd = open(file, O_RDONLY);
+  if (fd < 0) {
+    if (errno != ENOENT) {
+      OONF_WARN(LOG_OLSRV2, "Cannot open restart file %s: %s (%d)",
+          file, strerror(errno), errno);
+    }
+    return;
+  }
+
+  if (fstat(fd, &st) || st.st_size <= 0) {
+    OONF_WARN(LOG_OLSRV2, "Restart file %s is empty", file);
+    close(fd);
+    unlink(file);
+    return;
+  }
+
+  data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    OONF_WARN(LOG_OLSRV2, "Cannot map restart file %s: %s (%d)",
+        file, strerror(errno), errno);
+    return;
+  }
+
+  if (_validate(data, st.st_size)) {
+    OONF_WARN(LOG_OLSRV2, "Ignoring incompatible restart file %s", file);
+  }
+  else {
+    _restore(data);
+  }
+
+  munmap(data, st.st_size);
+
+  /* the data is only valid for one restart */
+  unlink(file);
+}
+
+/**
+ * Callback when the neighbors of the previous instance
+ * did not come back in time
+ * @param ptr unused
+ */
+static void
+_cb_hold_timeout(void *ptr __attribute__((unused))) {
+  OONF_INFO(LOG_OLSRV2, "%u neighbors did not come back after restart",
+      _expected_neighbors.count);
+  _release_hold();
+}
+
+/**
+ * Callback for changes of the nhdp neighborhood
+ * @param neigh changed neighbor, NULL if all neighbors might have changed
+ */
+static void
+_cb_nhdp_update(struct nhdp_neighbor *neigh) {
+  struct _expected_neighbor *expected, *e_it;
+
+  if (_expected_neighbors.count == 0) {
+    return;
+  }
+
+  if (neigh) {
+    expected = avl_find_element(&_expected_neighbors,
+        nhdp_db_neighbor_get_originator(neigh), expected, _node);
+    if (expected) {
+      _check_neighbor(expected);
+    }
+  }
+  else {
+    avl_for_each_element_safe(&_expected_neighbors, expected, _node, e_it) {
+      _check_neighbor(expected);
+    }
+  }
+
+  if (_expected_neighbors.count == 0) {
+    _release_hold();
+  }
+}
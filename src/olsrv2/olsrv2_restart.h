@@ -0,0 +1,233 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#ifndef OLSRV2_RESTART_H_
+#define OLSRV2_RESTART_H_
+
+#include "common/common_types.h"
+
+/*
+ * Layout of the warm restart file. All values are stored in host
+ * byte order, all records are 4 byte aligned so the file can be
+ * used directly after mapping it into memory.
+ */
+#define OLSRV2_RESTART_MAGIC   "OLSRV2WR"
+#define OLSRV2_RESTART_VERSION 1
+
+/* maximum length of the filename of the restart file */
+#define OLSRV2_RESTART_FILE_MAXLEN 256
+
+/* value of the byte order field written by the local host */
+#define OLSRV2_RESTART_BYTE_ORDER 0x01020304
+
+/* sections of the restart file */
+enum olsrv2_restart_section_id {
+  /* uint32_t tlv extension of each domain */
+  OLSRV2_RESTART_DOMAINS,
+
+  /* struct olsrv2_restart_node */
+  OLSRV2_RESTART_NODES,
+
+  /* struct olsrv2_restart_edge */
+  OLSRV2_RESTART_EDGES,
+
+  /* uint32_t edge costs, one column of edges for each domain */
+  OLSRV2_RESTART_EDGE_COSTS,
+
+  /* struct olsrv2_restart_attachment */
+  OLSRV2_RESTART_ATTACHMENTS,
+
+  /* uint32_t attachment costs, one column for each domain */
+  OLSRV2_RESTART_ATTACHMENT_COSTS,
+
+  /* uint8_t attachment distances, one column for each domain */
+  OLSRV2_RESTART_ATTACHMENT_DISTANCES,
+
+  /* struct olsrv2_restart_neighbor */
+  OLSRV2_RESTART_NEIGHBORS,
+
+  /* struct olsrv2_restart_route */
+  OLSRV2_RESTART_ROUTES,
+
+  /* number of sections */
+  OLSRV2_RESTART_SECTION_COUNT,
+};
+
+/* position of a section in the restart file */
+struct olsrv2_restart_section {
+  /* byte offset from the start of the file */
+  uint32_t offset;
+
+  /* number of entries */
+  uint32_t count;
+};
+
+/* header at the start of the restart file */
+struct olsrv2_restart_header {
+  /* OLSRV2_RESTART_MAGIC without the terminating zero */
+  char magic[8];
+
+  /* OLSRV2_RESTART_VERSION */
+  uint32_t version;
+
+  /* OLSRV2_RESTART_BYTE_ORDER in the byte order of the writer */
+  uint32_t byte_order;
+
+  /* wall clock time when the file was written in milliseconds */
+  uint64_t timestamp;
+
+  /* number of domains, the length of each cost column */
+  uint32_t domain_count;
+
+  /* unused, zero */
+  uint32_t _reserved;
+
+  /* sections of the file */
+  struct olsrv2_restart_section sections[OLSRV2_RESTART_SECTION_COUNT];
+};
+
+/* network address or prefix */
+struct olsrv2_restart_addr {
+  /* binary address, padded with zeros */
+  uint8_t addr[16];
+
+  /* 4 for IPv4, 6 for IPv6, 0 for an unset address */
+  uint8_t version;
+
+  /* prefix length */
+  uint8_t prefix_len;
+
+  /* unused, zero */
+  uint8_t _reserved[2];
+};
+
+/* tc node with a running validity timer */
+struct olsrv2_restart_node {
+  /* originator address of node */
+  struct olsrv2_restart_addr originator;
+
+  /* remaining validity time in milliseconds */
+  uint32_t vtime;
+
+  /* answer set number of node */
+  uint16_t ansn;
+
+  /* unused, zero */
+  uint16_t _reserved;
+};
+
+/*
+ * tc edge, the costs are stored in OLSRV2_RESTART_EDGE_COSTS.
+ * Virtual edges are stored as the inverse of the real edge
+ * that created them.
+ */
+struct olsrv2_restart_edge {
+  /* index of source of the real edge in OLSRV2_RESTART_NODES */
+  uint32_t src;
+
+  /* originator address of destination of the real edge */
+  struct olsrv2_restart_addr dst;
+
+  /* answer set number which set this edge */
+  uint16_t ansn;
+
+  /* 1 if the costs belong to the virtual inverse edge, 0 otherwise */
+  uint8_t virtual;
+
+  /* unused, zero */
+  uint8_t _reserved;
+};
+
+/* tc attachment, the costs are stored in OLSRV2_RESTART_ATTACHMENT_* */
+struct olsrv2_restart_attachment {
+  /* index of source in OLSRV2_RESTART_NODES */
+  uint32_t src;
+
+  /* prefix of the endpoint */
+  struct olsrv2_restart_addr prefix;
+
+  /* answer set number which set this attachment */
+  uint16_t ansn;
+
+  /* 1 if the endpoint is an interface of a mesh node, 0 otherwise */
+  uint8_t mesh;
+
+  /* unused, zero */
+  uint8_t _reserved;
+};
+
+/* symmetric nhdp neighbor */
+struct olsrv2_restart_neighbor {
+  /* originator address of neighbor */
+  struct olsrv2_restart_addr originator;
+};
+
+/* route installed into the kernel */
+struct olsrv2_restart_route {
+  /* destination prefix, gateway and source address of route */
+  struct olsrv2_restart_addr dst, gw, src;
+
+  /* interface index of route */
+  uint32_t if_index;
+
+  /* path cost of route */
+  uint32_t cost;
+
+  /* metric value of route */
+  int32_t metric;
+
+  /* index of the domain in OLSRV2_RESTART_DOMAINS */
+  uint8_t domain;
+
+  /* routing table and protocol of route */
+  uint8_t table, protocol;
+
+  /* unused, zero */
+  uint8_t _reserved;
+};
+
+void olsrv2_restart_init(void);
+void olsrv2_restart_cleanup(void);
+
+int olsrv2_restart_write(void);
+void olsrv2_restart_schedule_load(void);
+
+#endif /* OLSRV2_RESTART_H_ */
@@ -39,6 +39,12 @@
  *
  */
 
+#include <stdlib.h>
+
+#ifdef OLSRV2_SPF_THREADS
+#include <pthread.h>
+#endif
+
 #include "common/avl.h"
 #include "common/avl_comp.h"
 #include "common/common_types.h"
@@ -49,29 +55,220 @@
 #include "subsystems/oonf_timer.h"
 #include "rfc5444/rfc5444.h"
 
+#include "nhdp/nhdp_addr_id.h"
 #include "nhdp/nhdp_db.h"
 #include "nhdp/nhdp_domain.h"
 
+#include "olsrv2/olsrv2_heap.h"
 #include "olsrv2/olsrv2_originator.h"
+#include "olsrv2/olsrv2_spf_graph.h"
 #include "olsrv2/olsrv2_tc.h"
 #include "olsrv2/olsrv2_routing.h"
 #include "olsrv2/olsrv2.h"
 
+/* per-domain state of the shortest path calculation */
+struct _spf_domain {
+  /* nhdp domain of the calculation */
+  struct nhdp_domain *domain;
+
+  /* working queue of the dijkstra */
+#ifdef OLSRV2_DIJKSTRA_HEAP
+  struct olsrv2_heap queue;
+#else
+  struct avl_tree queue;
+#endif
+
+  /* dijkstra nodes whose path was touched by the current run */
+  struct list_entity affected;
+
+  /* false if the dijkstra data of the domain could not be allocated */
+  bool active;
+
+  /* true if the shortest path tree can be updated incrementally */
+  bool valid;
+
+  /* true if all routing entries must be recalculated */
+  bool refresh;
+
+  /* true if the current run should be incremental */
+  bool incremental;
+
+  /* true if the incremental run failed verification */
+  bool inconsistent;
+
+};
+
+/* per-target state of the loop free alternate calculation */
+struct _lfa_target {
+  /* hook into the working queue of the neighbor dijkstra */
+  struct olsrv2_heap_node _node;
+
+  /* path cost from the current neighbor to the target */
+  uint32_t dist;
+
+  /* cost of the best loop free alternate path found so far */
+  uint64_t lfa_cost;
+
+  /* routing entry of the target, NULL if not calculated by dijkstra */
+  struct olsrv2_routing_entry *rtentry;
+
+  /* first hop of the best loop free alternate path found so far */
+  struct nhdp_neighbor *lfa_hop;
+};
+
+/* routing entries using a nhdp neighbor as a hop, in all domains */
+struct _hop_routes {
+  /* nhdp neighbor, key of the tree */
+  struct nhdp_neighbor *neigh;
+
+  /* routing entries with the neighbor as first hop */
+  struct list_entity first_hop;
+
+  /* routing entries with the neighbor as loop free alternate */
+  struct list_entity lfa_hop;
+
+  /* hook into tree of neighbors */
+  struct avl_node _node;
+};
+
+/* path costs of the loop free alternate calculation of a domain */
+struct _lfa_cache {
+  /* topology generation the path costs were calculated for */
+  uint32_t generation;
+
+  /* true if the cache belongs to the topology generation */
+  bool valid;
+
+  /* vector number + 1 for each tc node of the snapshot, 0 if unknown */
+  uint32_t *vector;
+
+  /* path costs from tc nodes to all targets of the snapshot */
+  uint32_t *dist;
+
+  /* number of calculated vectors */
+  uint32_t count;
+
+  /* number of allocated path costs */
+  size_t size;
+};
+
+#ifdef OLSRV2_SPF_THREADS
+/* worker threads calculating the shortest path trees of the domains */
+struct _spf_pool {
+  /* worker threads, started once at initialization */
+  pthread_t threads[NHDP_MAXIMUM_DOMAINS - 1];
+  size_t thread_count;
+
+  /* protects all other fields of the pool */
+  pthread_mutex_t lock;
+
+  /* signalled when jobs are waiting or the pool is shut down */
+  pthread_cond_t work;
+
+  /* signalled when the last job of a run is finished */
+  pthread_cond_t done;
+
+  /* domains waiting for a calculation */
+  struct _spf_domain *jobs[NHDP_MAXIMUM_DOMAINS];
+  size_t job_count;
+
+  /* number of jobs of the current run not finished yet */
+  size_t running;
+
+  /* true if the workers should terminate */
+  bool shutdown;
+};
+
+/* the logging core is not thread safe, workers stay silent */
+static __thread bool _spf_worker = false;
+
+#define SPF_DEBUG(...) do { if (!_spf_worker) { OONF_DEBUG(__VA_ARGS__); } } while (0)
+#else
+#define SPF_DEBUG(...) OONF_DEBUG(__VA_ARGS__)
+#endif
+
 /* Prototypes */
 static struct olsrv2_routing_entry *_add_entry(
-    struct nhdp_domain *, struct netaddr *prefix);
+    struct nhdp_domain *, const struct netaddr *prefix);
 static void _remove_entry(struct olsrv2_routing_entry *);
-static void _insert_into_working_tree(struct olsrv2_tc_target *target,
+static void _set_first_hop(struct olsrv2_routing_entry *,
+    struct nhdp_neighbor *);
+static void _set_lfa_hop(struct olsrv2_routing_entry *,
+    struct nhdp_neighbor *);
+static struct _hop_routes *_get_hop_routes(struct nhdp_neighbor *);
+static void _release_hop_routes(struct nhdp_neighbor *);
+static int _avl_comp_pointer(const void *k1, const void *k2);
+static struct olsrv2_dijkstra_node *_get_dijkstra(
+    struct nhdp_domain *, struct olsrv2_tc_target *);
+static void _init_dijkstra_nodes(struct olsrv2_tc_target *,
+    size_t first, size_t last);
+static int _grow_dijkstra_domains(void);
+static int _grow_dijkstra_target(struct olsrv2_tc_target *, size_t count);
+static void _record_node(struct _spf_domain *, struct olsrv2_dijkstra_node *);
+static bool _is_node_changed(const struct olsrv2_dijkstra_node *);
+static void _working_queue_init(struct _spf_domain *);
+static bool _working_queue_is_empty(struct _spf_domain *);
+static void _working_queue_add(struct _spf_domain *,
+    struct olsrv2_dijkstra_node *);
+static struct olsrv2_dijkstra_node *_working_queue_pop(struct _spf_domain *);
+static void _insert_into_working_tree(struct nhdp_domain *domain,
+    struct olsrv2_tc_target *target, struct olsrv2_tc_node *parent,
     struct nhdp_neighbor *neigh, uint32_t linkcost,
     uint32_t pathcost, uint8_t distance, bool single_hop);
-static void _prepare_routes(struct nhdp_domain *);
+static void _touch_entry(struct olsrv2_routing_entry *);
+static bool _is_entry_changed(struct olsrv2_routing_entry *);
+static void _journal_entry(struct olsrv2_routing_entry *);
+static void _mark_entry(struct olsrv2_routing_entry *);
+static void _refresh_entries(struct nhdp_domain *);
+static void _refresh_entry(struct nhdp_domain *, struct olsrv2_routing_entry *);
+static void _select_dijkstra_path(struct nhdp_domain *,
+    struct olsrv2_tc_target *, struct olsrv2_dijkstra_node **best);
+static bool _is_path_usable(struct nhdp_domain *,
+    const struct olsrv2_dijkstra_node *);
+static void _prepare_dijkstra(struct nhdp_domain *);
+static void _calculate_spt(struct _spf_domain *);
+#ifdef OLSRV2_SPF_THREADS
+static void _spf_pool_init(void);
+static void _spf_pool_cleanup(void);
+static void _spf_pool_run(void);
+static void *_cb_spf_worker(void *);
+#endif
+static void _run_dijkstra(struct nhdp_domain *);
+static void _run_incremental_dijkstra(struct nhdp_domain *);
+static bool _is_path_valid(struct nhdp_domain *, struct olsrv2_tc_target *);
+static void _invalidate_subtree(struct nhdp_domain *, struct olsrv2_tc_target *);
+static void _relax_predecessors(struct nhdp_domain *, struct olsrv2_tc_target *);
+static bool _verify_dijkstra(struct nhdp_domain *);
+static bool _verify_target(struct nhdp_domain *, struct olsrv2_tc_target *);
 static void _handle_working_queue(struct nhdp_domain *);
+static void _add_dijkstra_routes(struct nhdp_domain *);
+static void _add_dijkstra_route(struct nhdp_domain *,
+    struct olsrv2_dijkstra_node *);
 static void _handle_nhdp_routes(struct nhdp_domain *);
+static void _add_nhdp_route(struct nhdp_domain *, const struct netaddr *prefix,
+    struct nhdp_neighbor *neigh, uint32_t cost, bool single_hop);
+static void _calculate_lfa(struct nhdp_domain *);
+static void _add_lfa_target(struct _lfa_target *lfa,
+    struct olsrv2_tc_target *, struct olsrv2_routing_entry *);
+static void _run_lfa_dijkstra(struct nhdp_domain *,
+    struct _lfa_target *lfa, uint32_t start);
+static int _lfa_cache_reset(struct _lfa_cache *);
+static const uint32_t *_lfa_cache_get(struct nhdp_domain *,
+    struct _lfa_target *lfa, uint32_t start);
+static void _lfa_cache_free(struct _lfa_cache *);
+static uint32_t _get_neighbor_cost(struct nhdp_domain *,
+    struct nhdp_neighbor *);
+static void _mark_neighbor_changed(struct nhdp_neighbor *);
+static bool _check_originators(void);
+static bool _check_best_links(void);
+static void _invalidate_all_trees(void);
 static void _add_route_to_kernel_queue(struct olsrv2_routing_entry *rtentry);
-static void _process_dijkstra_result(struct nhdp_domain *);
+static void _process_dijkstra_result(void);
 static void _process_kernel_queue(void);
 static void _cb_trigger_dijkstra(void *);
 static void _cb_nhdp_update(struct nhdp_neighbor *);
+static void _cb_neigh_changed(void *);
+static void _cb_neigh_removed(void *);
 static void _cb_route_finished(struct os_route *route, int error);
 
 /* Domain parameter of dijkstra algorithm */
@@ -83,6 +280,12 @@ static struct oonf_class _rtset_entry = {
   .size = sizeof(struct olsrv2_routing_entry),
 };
 
+/* memory class for the routing entries of a hop */
+static struct oonf_class _hop_routes_class = {
+  .name = "Olsrv2 Routing Hop",
+  .size = sizeof(struct _hop_routes),
+};
+
 /* rate limitation for dijkstra algorithm */
 static struct oonf_timer_info _dijkstra_timer_info = {
   .name = "Dijkstra rate limit timer",
@@ -98,16 +301,92 @@ static struct nhdp_domain_listener _nhdp_listener = {
   .update = _cb_nhdp_update,
 };
 
+/* listener for NHDP neighbor originator changes and removal */
+static struct oonf_class_extension _neigh_listener = {
+  .name = "olsrv2 routing",
+  .class_name = NHDP_CLASS_NEIGHBOR,
+
+  .cb_change = _cb_neigh_changed,
+  .cb_remove = _cb_neigh_removed,
+};
+
 static bool _trigger_dijkstra = false;
 
+/* true if the timer is running the hold time after a dijkstra */
+static bool _spf_holding = false;
+
+/* current hold time between two dijkstra runs */
+static uint64_t _spf_backoff = 0;
+
 /* global datastructures for routing */
 struct avl_tree olsrv2_routing_tree[NHDP_MAXIMUM_DOMAINS];
-static struct avl_tree _dijkstra_working_tree;
 static struct list_entity _kernel_queue;
+static bool _kernel_queue_active = false;
+
+/* routes that changed while the kernel still processes their last change */
+static struct list_entity _kernel_waiting;
+
+/* routing entries of each domain to recalculate after the next run */
+static struct list_entity _domain_refresh[NHDP_MAXIMUM_DOMAINS];
+
+/* routing entries of each domain with a route through the neighborhood */
+static struct list_entity _domain_nhdp[NHDP_MAXIMUM_DOMAINS];
+
+/* routing entries that might have been changed by the current run */
+static struct list_entity _route_journal;
+
+/* number of the current dijkstra run */
+static uint32_t _route_stamp;
+
+/* shortest path calculation of each domain */
+static struct _spf_domain _spf[NHDP_MAXIMUM_DOMAINS];
+
+/* snapshot of the tc database for full dijkstra runs */
+static struct olsrv2_spf_graph _spf_graph;
+
+/* path costs from the neighbors for loop free alternates of each domain */
+static struct _lfa_cache _lfa[NHDP_MAXIMUM_DOMAINS];
+
+#ifdef OLSRV2_SPF_THREADS
+/* worker threads for the shortest path trees */
+static struct _spf_pool _spf_pool;
+#endif
+
+/* per-target buffer of the loop free alternate calculation */
+static struct _lfa_target *_lfa_targets;
+static uint32_t _lfa_target_size;
+
+/* routing entries indexed by their first hop and alternate */
+static struct avl_tree _hop_tree;
+
+/* number of domains with dijkstra data in the tc targets */
+static size_t _dijkstra_domains;
+
+/* number of tc targets with dijkstra data */
+static uint32_t _target_count;
+
+/* tc targets that changed since the last dijkstra run */
+static struct list_entity _changed_targets;
+static uint32_t _changed_count;
+
+/* incremented for every change of the tc database relevant for routing */
+static uint32_t _topology_generation;
+
+/* statistics of the routing code */
+static struct olsrv2_routing_statistics _statistics;
+
+/* originators used for the current shortest path trees */
+static struct netaddr _spt_originator_v4, _spt_originator_v6;
+
+/* best link generation of nhdp used for the current routing entries */
+static uint32_t _spt_best_link_generation;
 
 static enum oonf_log_source LOG_OONFV2_ROUTING = LOG_MAIN;
 static bool _initiate_shutdown = false;
 
+/* true while routes of a warm restart wait for the neighborhood */
+static bool _restart_hold = false;
+
 /**
  * Initialize olsrv2 dijkstra and routing code
  */
@@ -118,28 +397,50 @@ olsrv2_routing_init(void) {
   LOG_OONFV2_ROUTING = oonf_log_register_source("olsrv2_routing");
 
   oonf_class_add(&_rtset_entry);
+  oonf_class_add(&_hop_routes_class);
   oonf_timer_add(&_dijkstra_timer_info);
 
   for (i=0; i<NHDP_MAXIMUM_DOMAINS; i++) {
     avl_init(&olsrv2_routing_tree[i], avl_comp_netaddr, false);
+
+    _working_queue_init(&_spf[i]);
+    list_init_head(&_spf[i].affected);
+    list_init_head(&_domain_refresh[i]);
+    list_init_head(&_domain_nhdp[i]);
   }
-  avl_init(&_dijkstra_working_tree, avl_comp_uint32, true);
   list_init_head(&_kernel_queue);
+  list_init_head(&_kernel_waiting);
+  list_init_head(&_route_journal);
+  list_init_head(&_changed_targets);
+  avl_init(&_hop_tree, _avl_comp_pointer, false);
+  olsrv2_spf_graph_init(&_spf_graph);
 
   nhdp_domain_listener_add(&_nhdp_listener);
+  oonf_class_extension_add(&_neigh_listener);
+
+#ifdef OLSRV2_SPF_THREADS
+  _spf_pool_init();
+#endif
 }
 
 /**
  * Trigger cleanup of olsrv2 dijkstra and routing code
+ * @param keep_routes true to leave the routes in the kernel
+ *   for a warm restart
  */
 void
-olsrv2_routing_initiate_shutdown(void) {
+olsrv2_routing_initiate_shutdown(bool keep_routes) {
   struct olsrv2_routing_entry *entry, *e_it;
   int i;
 
   /* remember we are in shutdown */
   _initiate_shutdown = true;
 
+  if (keep_routes) {
+    /* the next instance takes over the kernel routes */
+    return;
+  }
+
   /* remove all routes */
   for (i=0; i<NHDP_MAXIMUM_DOMAINS; i++) {
     avl_for_each_element_safe(&olsrv2_routing_tree[i], entry, _node, e_it) {
@@ -160,6 +461,11 @@ olsrv2_routing_cleanup(void) {
   struct olsrv2_routing_entry *entry, *e_it;
   int i;
 
+#ifdef OLSRV2_SPF_THREADS
+  _spf_pool_cleanup();
+#endif
+
+  oonf_class_extension_remove(&_neigh_listener);
   nhdp_domain_listener_remove(&_nhdp_listener);
 
   oonf_timer_stop(&_rate_limit_timer);
@@ -174,7 +480,16 @@ olsrv2_routing_cleanup(void) {
       _remove_entry(entry);
     }
   }
+  olsrv2_spf_graph_free(&_spf_graph);
+  for (i=0; i<NHDP_MAXIMUM_DOMAINS; i++) {
+    _lfa_cache_free(&_lfa[i]);
+  }
+  free(_lfa_targets);
+  _lfa_targets = NULL;
+  _lfa_target_size = 0;
+
   oonf_timer_remove(&_dijkstra_timer_info);
+  oonf_class_remove(&_hop_routes_class);
   oonf_class_remove(&_rtset_entry);
 }
 
@@ -184,34 +499,141 @@ olsrv2_routing_cleanup(void) {
  */
 void
 olsrv2_routing_trigger_update(void) {
+  _trigger_dijkstra = true;
+
   if (oonf_timer_is_active(&_rate_limit_timer)) {
     /* we are in the delay interval between two dijkstras */
-    _trigger_dijkstra = true;
+    _statistics.spf_deferred++;
+  }
+  else {
+    /* first change after a quiet period, wait the initial delay */
+    _spf_holding = false;
+    oonf_timer_set(&_rate_limit_timer, olsrv2_get_spf_initial_delay());
+  }
+}
+
+/**
+ * Get the current topology generation. The generation changes with
+ * every modification of the tc database that is relevant for routing.
+ * @return topology generation
+ */
+uint32_t
+olsrv2_routing_get_topology_generation(void) {
+  return _topology_generation;
+}
+
+/**
+ * Trigger a new dijkstra if the tc database changed since
+ * a topology generation was stored.
+ * @param generation topology generation before the change
+ */
+void
+olsrv2_routing_trigger_topology_update(uint32_t generation) {
+  if (generation != _topology_generation) {
+    olsrv2_routing_trigger_update();
   }
   else {
-    /* trigger as soon as we hit the next time slice */
-    oonf_timer_set(&_rate_limit_timer, 1);
+    _statistics.spf_avoided++;
+  }
+}
+
+/**
+ * Add a routing entry for a route that a previous instance of the
+ * daemon left in the kernel. The route is kept until a dijkstra run
+ * replaces or removes it.
+ * @param domain nhdp domain of route
+ * @param route pointer to kernel route
+ * @param cost path cost of route
+ * @return -1 if out of memory, 0 otherwise
+ */
+int
+olsrv2_routing_restore_route(struct nhdp_domain *domain,
+    const struct os_route *route, uint32_t cost) {
+  struct olsrv2_routing_entry *rtentry;
+  struct netaddr dst;
+
+  rtentry = avl_find_element(
+      &olsrv2_routing_tree[domain->index], &route->dst, rtentry, _node);
+  if (rtentry) {
+    /* the current instance already knows a route */
+    return 0;
+  }
+
+  memcpy(&dst, &route->dst, sizeof(dst));
+  rtentry = _add_entry(domain, &dst);
+  if (rtentry == NULL) {
+    return -1;
+  }
+
+  memcpy(&rtentry->route.gw, &route->gw, sizeof(route->gw));
+  memcpy(&rtentry->route.src, &route->src, sizeof(route->src));
+  rtentry->route.if_index = route->if_index;
+  rtentry->route.metric = route->metric;
+  rtentry->route.table = route->table;
+  rtentry->route.protocol = route->protocol;
+  rtentry->cost = cost;
+
+  /* route is already in the kernel */
+  rtentry->set = true;
+  rtentry->_sent_set = true;
+  rtentry->_in_kernel = true;
+
+  /* next dijkstra run replaces or removes it */
+  _mark_entry(rtentry);
+  return 0;
+}
+
+/**
+ * Stop or allow dijkstra runs while restored routes of a warm restart
+ * wait for the neighborhood to come back. Releasing the hold
+ * always triggers a dijkstra.
+ * @param hold true to hold dijkstra runs, false to release them
+ */
+void
+olsrv2_routing_set_restart_hold(bool hold) {
+  _restart_hold = hold;
+  if (!hold) {
+    olsrv2_routing_trigger_update();
   }
 }
 
+/**
+ * @return statistics of the dijkstra and routing code
+ */
+const struct olsrv2_routing_statistics *
+olsrv2_routing_get_statistics(void) {
+  return &_statistics;
+}
+
 /**
  * Trigger dijkstra and routing update now
  * @param skip_wait true to ignore rate limitation timer
  */
 void
 olsrv2_routing_force_update(bool skip_wait) {
+  struct olsrv2_tc_target *target, *t_it;
   struct nhdp_domain *domain;
+  struct _spf_domain *spf;
+  bool incremental, full_run;
 
   if (_initiate_shutdown) {
     /* no dijkstra anymore when in shutdown */
     return;
   }
 
+  if (_restart_hold) {
+    /* keep restored routes until the neighborhood is back */
+    _trigger_dijkstra = true;
+    _statistics.spf_deferred++;
+    return;
+  }
+
   /* handle dijkstra rate limitation timer */
   if (oonf_timer_is_active(&_rate_limit_timer)) {
     if (!skip_wait) {
       /* trigger dijkstra later */
       _trigger_dijkstra = true;
+      _statistics.spf_deferred++;
 
       OONF_DEBUG(LOG_OONFV2_ROUTING, "Delay Dijkstra");
       return;
@@ -221,37 +643,213 @@ olsrv2_routing_force_update(bool skip_wait) {
 
 
   OONF_DEBUG(LOG_OONFV2_ROUTING, "Run Dijkstra");
+  _statistics.spf_runs++;
+
+  if (_check_originators() || _check_best_links()) {
+    /* the local node or next hops changed, all trees must be recalculated */
+    _invalidate_all_trees();
+  }
+
+  if (_grow_dijkstra_domains()) {
+    OONF_WARN(LOG_OONFV2_ROUTING,
+        "Not enough memory for dijkstra data of new domains");
+  }
+
+  /* a large number of changes is faster handled by a full dijkstra */
+  incremental = olsrv2_get_spf_incremental()
+      && _changed_count <= (olsrv2_tc_tree.count
+          + olsrv2_tc_endpoint_tree.count) / 4;
+
+  full_run = false;
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    spf = &_spf[domain->index];
+    spf->domain = domain;
+    spf->active = domain->index < _dijkstra_domains;
+    if (!spf->active) {
+      /* domain was registered, but its dijkstra data is missing */
+      OONF_WARN(LOG_OONFV2_ROUTING,
+          "No routes for domain %u, dijkstra data could not be allocated",
+          domain->index);
+      continue;
+    }
+
+    spf->incremental = incremental && spf->valid;
+    full_run |= !spf->incremental;
+  }
+
+  /* routing entries not updated by this run will be removed */
+  _route_stamp++;
+  _statistics.routes_touched = 0;
+  _statistics.routes_scanned = 0;
+  _statistics.routes_changed = 0;
+
+  /* full dijkstra runs work on a snapshot of the tc database */
+  if (full_run
+      && olsrv2_spf_graph_update(&_spf_graph, _topology_generation)) {
+    OONF_WARN(LOG_OONFV2_ROUTING,
+        "Not enough memory for topology snapshot, using tc database");
+  }
 
+  /*
+   * calculate the shortest path trees, the topology database
+   * is not modified until all calculations are finished
+   */
+#ifdef OLSRV2_SPF_THREADS
+  /* calculate the domains in the worker pool */
+  _spf_pool_run();
+#else
   list_for_each_element(&nhdp_domain_list, domain, _node) {
-    /* initialize dijkstra specific fields */
-    _prepare_routes(domain);
+    spf = &_spf[domain->index];
+    if (spf->active) {
+      _calculate_spt(spf);
+    }
+  }
+#endif
 
-    /* run dijkstra */
-    while (!avl_is_empty(&_dijkstra_working_tree)) {
-      _handle_working_queue(domain);
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    spf = &_spf[domain->index];
+    if (!spf->active) {
+      continue;
+    }
+    if (spf->inconsistent) {
+      OONF_WARN(LOG_OONFV2_ROUTING,
+          "Incremental dijkstra of domain %u was inconsistent", domain->index);
     }
+    spf->valid = true;
+
+    /* collect routing entries of the changed part of the tree */
+    _add_dijkstra_routes(domain);
 
     /* check if direct one-hop routes are quicker */
     _handle_nhdp_routes(domain);
 
+    /* update or remove the collected routing entries */
+    _refresh_entries(domain);
+
+    if (_domain_parameter[domain->index].use_lfa) {
+      /* precalculate alternates for neighbor loss */
+      _calculate_lfa(domain);
+    }
+
     /* update kernel routes */
-    _process_dijkstra_result(domain);
+    _process_dijkstra_result();
+  }
+
+  /* all changes have been processed */
+  list_for_each_element_safe(&_changed_targets, target, _changed_node, t_it) {
+    list_remove(&target->_changed_node);
   }
+  _changed_count = 0;
 
   _process_kernel_queue();
 
   /* make sure dijkstra is not called too often */
-  oonf_timer_set(&_rate_limit_timer, 250);
+  if (_spf_backoff == 0) {
+    _spf_backoff = olsrv2_get_spf_secondary_wait();
+  }
+  _statistics.spf_backoff = _spf_backoff;
+
+  _spf_holding = true;
+  oonf_timer_set(&_rate_limit_timer, _spf_backoff);
 }
 
 /**
- * Initialize the dijkstra code part of a tc node.
+ * Initialize the dijkstra code part of a tc target.
  * Should normally not be called by other parts of OLSRv2.
- * @param dijkstra pointer to dijkstra node
+ * @param target pointer to tc target, address and type must be set
+ * @return -1 if out of memory, 0 otherwise
+ */
+int
+olsrv2_routing_target_init(struct olsrv2_tc_target *target) {
+  if (_target_count == 0) {
+    /* all targets have data for the domains registered now */
+    _dijkstra_domains = nhdp_domain_get_count();
+  }
+
+  if (_dijkstra_domains > 0) {
+    target->_dijkstra = calloc(_dijkstra_domains, sizeof(*target->_dijkstra));
+    if (target->_dijkstra == NULL) {
+      return -1;
+    }
+  }
+  _target_count++;
+
+  _init_dijkstra_nodes(target, 0, _dijkstra_domains);
+
+  /* new target might be reachable */
+  olsrv2_routing_target_changed(target);
+  return 0;
+}
+
+/**
+ * Remember that the incoming edges or attachments of a tc target changed.
+ * Should normally not be called by other parts of OLSRv2.
+ * @param target pointer to tc target
+ */
+void
+olsrv2_routing_target_changed(struct olsrv2_tc_target *target) {
+  _topology_generation++;
+
+  if (!list_is_node_added(&target->_changed_node)) {
+    list_add_tail(&_changed_targets, &target->_changed_node);
+    _changed_count++;
+  }
+}
+
+/**
+ * Remove the dijkstra code part of a tc target before it is freed.
+ * Should normally not be called by other parts of OLSRv2.
+ * @param target pointer to tc target
+ */
+void
+olsrv2_routing_target_remove(struct olsrv2_tc_target *target) {
+  struct olsrv2_routing_entry *rtentry;
+  size_t i;
+
+  _topology_generation++;
+
+  if (list_is_node_added(&target->_changed_node)) {
+    list_remove(&target->_changed_node);
+    _changed_count--;
+  }
+
+  for (i=0; i<_dijkstra_domains; i++) {
+    if (target->_dijkstra[i].first_hop == NULL || _initiate_shutdown) {
+      continue;
+    }
+
+    /* the route of the target must be recalculated without it */
+    rtentry = avl_find_element(&olsrv2_routing_tree[i],
+        olsrv2_tc_target_get_netaddr(target), rtentry, _node);
+    if (rtentry) {
+      _mark_entry(rtentry);
+    }
+  }
+
+  free(target->_dijkstra);
+  target->_dijkstra = NULL;
+  _target_count--;
+}
+
+/**
+ * Inform the dijkstra code that an edge or attachment between a tc node
+ * and a target has been removed from the database.
+ * Should normally not be called by other parts of OLSRv2.
+ * @param src pointer to source tc node
+ * @param dst pointer to target of the edge or attachment
  */
 void
-olsrv2_routing_dijkstra_node_init(struct olsrv2_dijkstra_node *dijkstra) {
-  dijkstra->_node.key = &dijkstra->path_cost;
+olsrv2_routing_edge_removed(
+    struct olsrv2_tc_node *src, struct olsrv2_tc_target *dst) {
+  size_t i;
+
+  for (i=0; i<_dijkstra_domains; i++) {
+    if (dst->_dijkstra[i].parent == src) {
+      /* shortest path of target is gone */
+      dst->_dijkstra[i].parent = NULL;
+    }
+  }
+  olsrv2_routing_target_changed(dst);
 }
 
 /**
@@ -273,6 +871,10 @@ olsrv2_routing_set_domain_parameter(struct nhdp_domain *domain,
   /* copy parameters */
   memcpy(&_domain_parameter[domain->index], parameter, sizeof(*parameter));
 
+  /* all routes of the domain must be written again */
+  _spf[domain->index].valid = false;
+  _spf[domain->index].refresh = true;
+
   if (avl_is_empty(&olsrv2_routing_tree[domain->index])) {
     /* no routes present */
     return;
@@ -297,6 +899,7 @@ olsrv2_routing_set_domain_parameter(struct nhdp_domain *domain,
   /* trigger a dijkstra to write new routes in 100 milliseconds */
   oonf_timer_set(&_rate_limit_timer, 100);
   _trigger_dijkstra = true;
+  _spf_holding = false;
 }
 
 /**
@@ -306,7 +909,7 @@ olsrv2_routing_set_domain_parameter(struct nhdp_domain *domain,
  * @return pointer to routing entry, NULL if our of memory.
  */
 static struct olsrv2_routing_entry *
-_add_entry(struct nhdp_domain *domain, struct netaddr *prefix) {
+_add_entry(struct nhdp_domain *domain, const struct netaddr *prefix) {
   struct olsrv2_routing_entry *rtentry;
 
   rtentry = avl_find_element(
@@ -320,6 +923,12 @@ _add_entry(struct nhdp_domain *domain, struct netaddr *prefix) {
     return NULL;
   }
 
+  rtentry->dst_id = nhdp_addr_id_acquire(prefix);
+  if (rtentry->dst_id == NHDP_ADDR_ID_NONE) {
+    oonf_class_free(&_rtset_entry, rtentry);
+    return NULL;
+  }
+
   /* set key */
   memcpy(&rtentry->route.dst, prefix, sizeof(struct netaddr));
   rtentry->_node.key = &rtentry->route.dst;
@@ -342,292 +951,1695 @@ _add_entry(struct nhdp_domain *domain, struct netaddr *prefix) {
  */
 static void
 _remove_entry(struct olsrv2_routing_entry *entry) {
+  /* remove entry from kernel queue if its still waiting */
+  if (list_is_node_added(&entry->_working_node)) {
+    list_remove(&entry->_working_node);
+    _statistics.kernel_queued--;
+  }
+
+  /* remove entry from journal and domain lists */
+  if (list_is_node_added(&entry->_journal_node)) {
+    list_remove(&entry->_journal_node);
+  }
+  if (list_is_node_added(&entry->_refresh_node)) {
+    list_remove(&entry->_refresh_node);
+  }
+  if (list_is_node_added(&entry->_nhdp_node)) {
+    list_remove(&entry->_nhdp_node);
+  }
+
+  /* remove entry from the hop index */
+  _set_first_hop(entry, NULL);
+  _set_lfa_hop(entry, NULL);
+
   /* remove entry from database if its still there */
   if (list_is_node_added(&entry->_node.list)) {
     avl_remove(&olsrv2_routing_tree[entry->domain->index], &entry->_node);
   }
+  nhdp_addr_id_release(entry->dst_id);
   oonf_class_free(&_rtset_entry, entry);
 }
 
 /**
- * Insert a new entry into the dijkstra working queue
- * @param target pointer to tc target
- * @param neigh next hop through which the target can be reached
- * @param linkcost cost of the last hop of the path towards the target
- * @param pathcost remainder of the cost to the target
- * @param distance hopcount to be used for the route to the target
- * @param single_hop true if this is a single-hop route, false otherwise
+ * Set the first hop of a routing entry and update the hop index
+ * @param rtentry pointer to routing entry
+ * @param neigh new first hop, NULL to remove it
  */
 static void
-_insert_into_working_tree(struct olsrv2_tc_target *target,
-    struct nhdp_neighbor *neigh, uint32_t linkcost,
-    uint32_t pathcost, uint8_t distance, bool single_hop) {
-  struct olsrv2_dijkstra_node *node;
-#ifdef OONF_LOG_DEBUG_INFO
-  struct netaddr_str buf;
-#endif
-  if (linkcost >= RFC5444_METRIC_INFINITE) {
+_set_first_hop(struct olsrv2_routing_entry *rtentry,
+    struct nhdp_neighbor *neigh) {
+  struct _hop_routes *hop;
+
+  if (rtentry->_first_hop == neigh) {
     return;
   }
 
-  node = &target->_dijkstra;
-  if (node->first_hop != NULL) {
-    /* already hooked into dijkstra ! */
-    avl_remove(&_dijkstra_working_tree, &node->_node);
-    node->first_hop = NULL;
+  if (rtentry->_first_hop != NULL) {
+    list_remove(&rtentry->_first_hop_node);
+    _release_hop_routes(rtentry->_first_hop);
+    rtentry->_first_hop = NULL;
   }
 
-  /* calculate new total pathcost */
-  pathcost += linkcost;
+  if (neigh != NULL && (hop = _get_hop_routes(neigh)) != NULL) {
+    rtentry->_first_hop = neigh;
+    list_add_tail(&hop->first_hop, &rtentry->_first_hop_node);
+  }
+}
+
+/**
+ * Set the loop free alternate hop of a routing entry
+ * and update the hop index
+ * @param rtentry pointer to routing entry
+ * @param neigh new alternate hop, NULL to remove it
+ */
+static void
+_set_lfa_hop(struct olsrv2_routing_entry *rtentry,
+    struct nhdp_neighbor *neigh) {
+  struct _hop_routes *hop;
 
-  if (node->path_cost <= pathcost || node->local) {
-    /* current target is better or it is ourselves */
+  if (rtentry->_lfa_hop == neigh) {
     return;
   }
 
-  OONF_DEBUG(LOG_OONFV2_ROUTING, "Add dst %s with pastcost %u to dijstra tree",
-      netaddr_to_string(&buf, &target->addr), pathcost);
-
-  node->path_cost = pathcost;
-  node->first_hop = neigh;
-  node->distance = distance;
-  node->single_hop = single_hop;
+  if (rtentry->_lfa_hop != NULL) {
+    list_remove(&rtentry->_lfa_hop_node);
+    _release_hop_routes(rtentry->_lfa_hop);
+    rtentry->_lfa_hop = NULL;
+  }
 
-  avl_insert(&_dijkstra_working_tree, &node->_node);
+  if (neigh != NULL && (hop = _get_hop_routes(neigh)) != NULL) {
+    rtentry->_lfa_hop = neigh;
+    list_add_tail(&hop->lfa_hop, &rtentry->_lfa_hop_node);
+  }
 }
 
 /**
- * Initialize a routing entry with the result of the dijkstra calculation
- * @param rtentry pointer to routing entry
- * @param domain nhdp domain
- * @param first_hop nhdp neighbor for first hop to target
- * @param distance hopcount distance that should be used for route
- * @param pathcost pathcost to target
- * @param single_hop true if route is single hop
+ * Get the routing entries of a hop, allocate them if necessary
+ * @param neigh nhdp neighbor
+ * @return routing entries of the hop, NULL if out of memory
  */
-static void
-_update_routing_entry(struct olsrv2_routing_entry *rtentry,
-    struct nhdp_domain *domain,
-    struct nhdp_neighbor *first_hop,
-    uint8_t distance, uint32_t pathcost,
-    bool single_hop) {
-  struct nhdp_neighbor_domaindata *neighdata;
-#ifdef OONF_LOG_DEBUG_INFO
-  struct netaddr_str buf;
-#endif
+static struct _hop_routes *
+_get_hop_routes(struct nhdp_neighbor *neigh) {
+  struct _hop_routes *hop;
+
+  hop = avl_find_element(&_hop_tree, neigh, hop, _node);
+  if (hop) {
+    return hop;
+  }
+
+  hop = oonf_class_malloc(&_hop_routes_class);
+  if (hop == NULL) {
+    OONF_WARN(LOG_OONFV2_ROUTING,
+        "Not enough memory for the routes of a first hop");
+    return NULL;
+  }
+
+  hop->neigh = neigh;
+  list_init_head(&hop->first_hop);
+  list_init_head(&hop->lfa_hop);
+
+  hop->_node.key = neigh;
+  avl_insert(&_hop_tree, &hop->_node);
+  return hop;
+}
+
+/**
+ * Free the routing entries of a hop if no entry uses it anymore
+ * @param neigh nhdp neighbor
+ */
+static void
+_release_hop_routes(struct nhdp_neighbor *neigh) {
+  struct _hop_routes *hop;
+
+  hop = avl_find_element(&_hop_tree, neigh, hop, _node);
+  if (hop == NULL
+      || !list_is_empty(&hop->first_hop) || !list_is_empty(&hop->lfa_hop)) {
+    return;
+  }
+
+  avl_remove(&_hop_tree, &hop->_node);
+  oonf_class_free(&_hop_routes_class, hop);
+}
+
+/**
+ * AVL comparator for pointers
+ * @param k1 first pointer
+ * @param k2 second pointer
+ * @return -1 if k1 < k2, 1 if k1 > k2, 0 otherwise
+ */
+static int
+_avl_comp_pointer(const void *k1, const void *k2) {
+  if (k1 < k2) {
+    return -1;
+  }
+  return k1 > k2 ? 1 : 0;
+}
+
+/**
+ * Initialize a range of dijkstra nodes of a tc target
+ * @param target pointer to tc target
+ * @param first index of first domain to initialize
+ * @param last index after the last domain to initialize
+ */
+static void
+_init_dijkstra_nodes(struct olsrv2_tc_target *target,
+    size_t first, size_t last) {
+  struct olsrv2_dijkstra_node *dijkstra;
+  bool local;
+  size_t i;
+
+  local = target->type == OONFV2_NODE_TARGET
+      && olsrv2_originator_is_local(olsrv2_tc_target_get_netaddr(target));
+
+  for (i=first; i<last; i++) {
+    dijkstra = &target->_dijkstra[i];
+
+    memset(dijkstra, 0, sizeof(*dijkstra));
+    dijkstra->_node.key = &dijkstra->path_cost;
+    dijkstra->path_cost = RFC5444_METRIC_INFINITE_PATH;
+    dijkstra->target = target;
+    dijkstra->local = local;
+  }
+}
+
+/**
+ * Extend the dijkstra data of all tc targets for nhdp domains
+ * that were registered after the targets had been created.
+ * Must not be called while a dijkstra is running.
+ * @return -1 if out of memory, 0 otherwise
+ */
+static int
+_grow_dijkstra_domains(void) {
+  struct olsrv2_tc_endpoint *end;
+  struct olsrv2_tc_node *node;
+  size_t count;
+
+  count = nhdp_domain_get_count();
+  if (count <= _dijkstra_domains) {
+    return 0;
+  }
+
+  avl_for_each_element(&olsrv2_tc_tree, node, _originator_node) {
+    if (_grow_dijkstra_target(&node->target, count)) {
+      return -1;
+    }
+  }
+  avl_for_each_element(&olsrv2_tc_endpoint_tree, end, _node) {
+    if (_grow_dijkstra_target(&end->target, count)) {
+      return -1;
+    }
+  }
+
+  OONF_INFO(LOG_OONFV2_ROUTING,
+      "Dijkstra data extended from %zu to %zu domains",
+      _dijkstra_domains, count);
+  _dijkstra_domains = count;
+  return 0;
+}
+
+/**
+ * Reallocate the dijkstra nodes of a tc target for more domains
+ * @param target pointer to tc target
+ * @param count new number of domains
+ * @return -1 if out of memory, 0 otherwise
+ */
+static int
+_grow_dijkstra_target(struct olsrv2_tc_target *target, size_t count) {
+  struct olsrv2_dijkstra_node *dijkstra;
+  size_t i;
+
+  dijkstra = realloc(target->_dijkstra, count * sizeof(*dijkstra));
+  if (dijkstra == NULL) {
+    return -1;
+  }
+  target->_dijkstra = dijkstra;
+
+  /* nodes of the existing domains moved, repair the pointers to them */
+  for (i=0; i<_dijkstra_domains; i++) {
+    dijkstra = &target->_dijkstra[i];
+
+    dijkstra->_node.key = &dijkstra->path_cost;
+    if (dijkstra->_affected) {
+      dijkstra->_affected_node.prev->next = &dijkstra->_affected_node;
+      dijkstra->_affected_node.next->prev = &dijkstra->_affected_node;
+    }
+  }
+
+  _init_dijkstra_nodes(target, _dijkstra_domains, count);
+  return 0;
+}
+
+/**
+ * @param domain nhdp domain
+ * @param target pointer to tc target
+ * @return dijkstra data of the target for the domain
+ */
+static struct olsrv2_dijkstra_node *
+_get_dijkstra(struct nhdp_domain *domain, struct olsrv2_tc_target *target) {
+  return &target->_dijkstra[domain->index];
+}
+
+/**
+ * Remember the path of a dijkstra node before the current run
+ * modifies it for the first time.
+ * @param spf shortest path calculation of domain
+ * @param node pointer to dijkstra node
+ */
+static void
+_record_node(struct _spf_domain *spf, struct olsrv2_dijkstra_node *node) {
+  if (node->_affected) {
+    return;
+  }
+
+  node->_affected = true;
+  node->_old_path_cost = node->path_cost;
+  node->_old_first_hop = node->first_hop;
+  node->_old_distance = node->distance;
+  node->_old_single_hop = node->single_hop;
+  list_add_tail(&spf->affected, &node->_affected_node);
+}
+
+/**
+ * @param node pointer to dijkstra node recorded by the current run
+ * @return true if the path of the node differs from the path
+ *   before the current run
+ */
+static bool
+_is_node_changed(const struct olsrv2_dijkstra_node *node) {
+  return node->path_cost != node->_old_path_cost
+      || node->first_hop != node->_old_first_hop
+      || node->distance != node->_old_distance
+      || node->single_hop != node->_old_single_hop;
+}
+
+/**
+ * Initialize the dijkstra working queue of a domain
+ * @param spf shortest path calculation of domain
+ */
+static void
+_working_queue_init(struct _spf_domain *spf) {
+#ifdef OLSRV2_DIJKSTRA_HEAP
+  olsrv2_heap_init(&spf->queue);
+#else
+  avl_init(&spf->queue, avl_comp_uint32, true);
+#endif
+}
+
+/**
+ * @param spf shortest path calculation of domain
+ * @return true if dijkstra working queue is empty
+ */
+static bool
+_working_queue_is_empty(struct _spf_domain *spf) {
+#ifdef OLSRV2_DIJKSTRA_HEAP
+  return olsrv2_heap_is_empty(&spf->queue);
+#else
+  return avl_is_empty(&spf->queue);
+#endif
+}
+
+/**
+ * Add a dijkstra node to the working queue or move it forward
+ * if it is already queued and its path cost was lowered.
+ * @param spf shortest path calculation of domain
+ * @param node pointer to dijkstra node
+ */
+static void
+_working_queue_add(struct _spf_domain *spf,
+    struct olsrv2_dijkstra_node *node) {
+#ifdef OLSRV2_DIJKSTRA_HEAP
+  if (olsrv2_heap_is_node_added(&spf->queue, &node->_node)) {
+    olsrv2_heap_decrease_key(&spf->queue, &node->_node);
+  }
+  else {
+    olsrv2_heap_insert(&spf->queue, &node->_node);
+  }
+#else
+  if (list_is_node_added(&node->_node.list)) {
+    avl_remove(&spf->queue, &node->_node);
+  }
+  avl_insert(&spf->queue, &node->_node);
+#endif
+}
+
+/**
+ * Remove the node with the lowest path cost from the working queue
+ * @param spf shortest path calculation of domain
+ * @return pointer to dijkstra node
+ */
+static struct olsrv2_dijkstra_node *
+_working_queue_pop(struct _spf_domain *spf) {
+  struct olsrv2_dijkstra_node *node;
+
+#ifdef OLSRV2_DIJKSTRA_HEAP
+  node = container_of(olsrv2_heap_extract_min(&spf->queue),
+      struct olsrv2_dijkstra_node, _node);
+#else
+  node = avl_first_element(&spf->queue, node, _node);
+  avl_remove(&spf->queue, &node->_node);
+#endif
+  return node;
+}
+
+/**
+ * Insert a new entry into the dijkstra working queue
+ * @param domain nhdp domain
+ * @param target pointer to tc target
+ * @param parent tc node the target is reached from,
+ *   NULL if target is a one-hop neighbor
+ * @param neigh next hop through which the target can be reached
+ * @param linkcost cost of the last hop of the path towards the target
+ * @param pathcost remainder of the cost to the target
+ * @param distance hopcount to be used for the route to the target
+ * @param single_hop true if this is a single-hop route, false otherwise
+ */
+static void
+_insert_into_working_tree(struct nhdp_domain *domain,
+    struct olsrv2_tc_target *target, struct olsrv2_tc_node *parent,
+    struct nhdp_neighbor *neigh, uint32_t linkcost,
+    uint32_t pathcost, uint8_t distance, bool single_hop) {
+  struct olsrv2_dijkstra_node *node;
+#ifdef OONF_LOG_DEBUG_INFO
+  struct netaddr_str buf;
+#endif
+  if (linkcost >= RFC5444_METRIC_INFINITE) {
+    return;
+  }
+
+  node = _get_dijkstra(domain, target);
+  if (node->local) {
+    /* it is ourselves */
+    return;
+  }
+
+  /* calculate new total pathcost */
+  pathcost += linkcost;
+
+  if (node->path_cost <= pathcost) {
+    /* current target is better */
+    return;
+  }
+
+  SPF_DEBUG(LOG_OONFV2_ROUTING, "Add dst %s with pastcost %u to dijstra tree",
+      netaddr_to_string(&buf, olsrv2_tc_target_get_netaddr(target)), pathcost);
+
+  _record_node(&_spf[domain->index], node);
+
+  node->path_cost = pathcost;
+  node->first_hop = neigh;
+  node->parent = parent;
+  node->distance = distance;
+  node->single_hop = single_hop;
+
+  _working_queue_add(&_spf[domain->index], node);
+}
+
+/**
+ * Initialize a routing entry with the result of the dijkstra calculation
+ * @param rtentry pointer to routing entry
+ * @param domain nhdp domain
+ * @param first_hop nhdp neighbor for first hop to target
+ * @param pathcost pathcost to target
+ * @param single_hop true if route is single hop
+ */
+static void
+_update_routing_entry(struct olsrv2_routing_entry *rtentry,
+    struct nhdp_domain *domain,
+    struct nhdp_neighbor *first_hop,
+    uint32_t pathcost, bool single_hop) {
+  struct nhdp_neighbor_domaindata *neighdata;
+#ifdef OONF_LOG_DEBUG_INFO
+  struct netaddr_str buf;
+#endif
 
   neighdata = nhdp_domain_get_neighbordata(domain, first_hop);
   OONF_DEBUG(LOG_OONFV2_ROUTING, "Add dst %s with pastcost %u to working queue",
       netaddr_to_string(&buf, &rtentry->route.dst), pathcost);
 
+  /* remember state of entry before this run */
+  _touch_entry(rtentry);
+
   /* copy route parameters into data structure */
   rtentry->route.if_index = neighdata->best_link_ifindex;
   rtentry->cost = pathcost;
-  rtentry->route.metric = distance;
+  rtentry->route.table = _domain_parameter[domain->index].table;
+  rtentry->route.protocol = _domain_parameter[domain->index].protocol;
+  rtentry->route.metric = _domain_parameter[domain->index].distance;
+  _set_first_hop(rtentry, first_hop);
+  _set_lfa_hop(rtentry, NULL);
+  netaddr_invalidate(&rtentry->lfa.gw);
 
   /* mark route as set */
   rtentry->set = true;
 
+  // TODO: handle source ip
+
   /* copy gateway if necessary */
   if (single_hop
-      && netaddr_cmp(&neighdata->best_link->if_addr,
-          &rtentry->route.dst) == 0) {
+      && nhdp_addr_id_is_equal(neighdata->best_link->if_addr_id, rtentry->dst_id)) {
     netaddr_invalidate(&rtentry->route.gw);
   }
   else {
-    memcpy(&rtentry->route.gw, &neighdata->best_link->if_addr,
+    memcpy(&rtentry->route.gw, nhdp_db_link_get_ifaddr(neighdata->best_link),
         sizeof(struct netaddr));
   }
+
+  _journal_entry(rtentry);
+}
+
+/**
+ * Remember the state of a routing entry before its first update
+ * in the current dijkstra run
+ * @param rtentry pointer to routing entry
+ */
+static void
+_touch_entry(struct olsrv2_routing_entry *rtentry) {
+  if (rtentry->_stamp == _route_stamp) {
+    /* already updated by this run */
+    return;
+  }
+
+  rtentry->_stamp = _route_stamp;
+  rtentry->_old_set = rtentry->set;
+  rtentry->_old_if_index = rtentry->route.if_index;
+  rtentry->_old_distance = rtentry->route.metric;
+  memcpy(&rtentry->_old_next_hop, &rtentry->route.gw, sizeof(struct netaddr));
+
+  _statistics.routes_touched++;
+}
+
+/**
+ * @param rtentry pointer to routing entry
+ * @return true if the kernel route differs from the state before
+ *   the current dijkstra run
+ */
+static bool
+_is_entry_changed(struct olsrv2_routing_entry *rtentry) {
+  if (rtentry->set != rtentry->_old_set) {
+    return true;
+  }
+  return rtentry->set
+      && (rtentry->_old_if_index != rtentry->route.if_index
+          || rtentry->_old_distance != rtentry->route.metric
+          || netaddr_cmp(&rtentry->_old_next_hop, &rtentry->route.gw) != 0);
+}
+
+/**
+ * Add a routing entry to the change journal if it has been changed
+ * by the current dijkstra run
+ * @param rtentry pointer to routing entry
+ */
+static void
+_journal_entry(struct olsrv2_routing_entry *rtentry) {
+  if (list_is_node_added(&rtentry->_journal_node)
+      || !_is_entry_changed(rtentry)) {
+    /* already in journal or no change */
+    return;
+  }
+
+  list_add_tail(&_route_journal, &rtentry->_journal_node);
+}
+
+/**
+ * Remember that a routing entry must be recalculated after the
+ * next dijkstra run
+ * @param rtentry pointer to routing entry
+ */
+static void
+_mark_entry(struct olsrv2_routing_entry *rtentry) {
+  if (!list_is_node_added(&rtentry->_refresh_node)) {
+    list_add_tail(&_domain_refresh[rtentry->domain->index],
+        &rtentry->_refresh_node);
+  }
+}
+
+/**
+ * Recalculate all routing entries of a domain that have been marked
+ * by the current dijkstra run
+ * @param domain nhdp domain
+ */
+static void
+_refresh_entries(struct nhdp_domain *domain) {
+  struct olsrv2_routing_entry *rtentry, *rt_it;
+
+  list_for_each_element_safe(&_domain_refresh[domain->index],
+      rtentry, _refresh_node, rt_it) {
+    list_remove(&rtentry->_refresh_node);
+
+    _statistics.routes_scanned++;
+    _refresh_entry(domain, rtentry);
+  }
+}
+
+/**
+ * Set a routing entry to the best path of the shortest path tree
+ * and the neighborhood, remove it if there is no path anymore
+ * @param domain nhdp domain
+ * @param rtentry pointer to routing entry
+ */
+static void
+_refresh_entry(struct nhdp_domain *domain,
+    struct olsrv2_routing_entry *rtentry) {
+  struct olsrv2_dijkstra_node *best;
+  struct olsrv2_tc_endpoint *end;
+  struct olsrv2_tc_node *node;
+
+  /* tc nodes are preferred over endpoints with the same path cost */
+  best = NULL;
+  if ((node = olsrv2_tc_node_get_by_id(rtentry->dst_id)) != NULL) {
+    _select_dijkstra_path(domain, &node->target, &best);
+  }
+  if ((end = olsrv2_tc_endpoint_get(&rtentry->route.dst)) != NULL) {
+    _select_dijkstra_path(domain, &end->target, &best);
+  }
+
+  if (rtentry->_nhdp_stamp == _route_stamp
+      && (best == NULL || rtentry->_nhdp_cost < best->path_cost)) {
+    /* the neighborhood route is better than the dijkstra calculation */
+    _update_routing_entry(rtentry, domain, rtentry->_nhdp_hop,
+        rtentry->_nhdp_cost, rtentry->_nhdp_single_hop);
+    return;
+  }
+
+  if (best != NULL) {
+    /* fill routing entry with dijkstra result */
+    _update_routing_entry(rtentry, domain, best->first_hop,
+        best->path_cost, best->single_hop);
+    return;
+  }
+
+  if (rtentry->set) {
+    /* route is not part of the result anymore */
+    _touch_entry(rtentry);
+    rtentry->set = false;
+    _set_lfa_hop(rtentry, NULL);
+    netaddr_invalidate(&rtentry->lfa.gw);
+    _journal_entry(rtentry);
+  }
+  else if (!rtentry->_in_kernel && !rtentry->in_processing
+      && !list_is_node_added(&rtentry->_working_node)) {
+    /* route never reached the kernel */
+    _remove_entry(rtentry);
+  }
+}
+
+/**
+ * Select the path of a tc target if it is better than the
+ * best path found so far
+ * @param domain nhdp domain
+ * @param target pointer to tc target
+ * @param best pointer to best dijkstra node, NULL if none found yet
+ */
+static void
+_select_dijkstra_path(struct nhdp_domain *domain,
+    struct olsrv2_tc_target *target, struct olsrv2_dijkstra_node **best) {
+  struct olsrv2_dijkstra_node *dijkstra;
+
+  dijkstra = _get_dijkstra(domain, target);
+  if (_is_path_usable(domain, dijkstra)
+      && (*best == NULL || dijkstra->path_cost < (*best)->path_cost)) {
+    *best = dijkstra;
+  }
+}
+
+/**
+ * @param domain nhdp domain
+ * @param dijkstra pointer to dijkstra node
+ * @return true if the target is reachable and its first hop
+ *   still has a usable link
+ */
+static bool
+_is_path_usable(struct nhdp_domain *domain,
+    const struct olsrv2_dijkstra_node *dijkstra) {
+  return dijkstra->first_hop != NULL
+      && _get_neighbor_cost(domain, dijkstra->first_hop)
+          < RFC5444_METRIC_INFINITE;
+}
+
+/**
+ * Initialize internal fields for a full dijkstra calculation
+ * @param domain nhdp domain
+ */
+static void
+_prepare_dijkstra(struct nhdp_domain *domain) {
+  struct olsrv2_dijkstra_node *dijkstra;
+  struct olsrv2_tc_endpoint *end;
+  struct olsrv2_tc_node *node;
+  struct nhdp_neighbor *neigh;
+  struct _spf_domain *spf;
+
+  spf = &_spf[domain->index];
+
+  /*
+   * initialize private dijkstra data on nodes, only reachable nodes
+   * must be recorded, the others get recorded when a path is found
+   */
+  avl_for_each_element(&olsrv2_tc_tree, node, _originator_node) {
+    dijkstra = _get_dijkstra(domain, &node->target);
+    if (dijkstra->first_hop != NULL) {
+      _record_node(spf, dijkstra);
+    }
+
+    dijkstra->first_hop = NULL;
+    dijkstra->parent = NULL;
+    dijkstra->path_cost = RFC5444_METRIC_INFINITE_PATH;
+    dijkstra->local = olsrv2_originator_is_local(
+        olsrv2_tc_target_get_netaddr(&node->target));
+  }
+
+  /* initialize private dijkstra data on endpoints */
+  avl_for_each_element(&olsrv2_tc_endpoint_tree, end, _node) {
+    dijkstra = _get_dijkstra(domain, &end->target);
+    if (dijkstra->first_hop != NULL) {
+      _record_node(spf, dijkstra);
+    }
+
+    dijkstra->first_hop = NULL;
+    dijkstra->parent = NULL;
+    dijkstra->path_cost = RFC5444_METRIC_INFINITE_PATH;
+  }
+
+  /* initialize Dijkstra working queue with one-hop neighbors */
+  list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
+    if (neigh->symmetric > 0
+        && (node = olsrv2_tc_node_get_by_id(neigh->originator_id)) != NULL) {
+      /* found node for neighbor, add to worker list */
+      _insert_into_working_tree(domain, &node->target, NULL, neigh,
+          _get_neighbor_cost(domain, neigh), 0, 0, true);
+    }
+  }
+}
+
+/**
+ * Calculate the shortest path tree of a domain, either incremental
+ * or from scratch. Only modifies the dijkstra data of this domain,
+ * so it can run in parallel to the calculation of other domains.
+ * @param spf shortest path calculation of domain
+ */
+static void
+_calculate_spt(struct _spf_domain *spf) {
+  spf->inconsistent = false;
+
+  if (!spf->incremental) {
+    /* calculate shortest path tree from scratch */
+    _run_dijkstra(spf->domain);
+    return;
+  }
+
+  /* update shortest path tree */
+  _run_incremental_dijkstra(spf->domain);
+
+  if (olsrv2_get_spf_verify() && !_verify_dijkstra(spf->domain)) {
+    /* recalculate it */
+    spf->inconsistent = true;
+    _run_dijkstra(spf->domain);
+  }
+}
+
+#ifdef OLSRV2_SPF_THREADS
+/**
+ * Start the worker threads for the shortest path trees. If not all
+ * threads can be started, the main thread calculates more domains.
+ */
+static void
+_spf_pool_init(void) {
+  size_t i;
+
+  memset(&_spf_pool, 0, sizeof(_spf_pool));
+  pthread_mutex_init(&_spf_pool.lock, NULL);
+  pthread_cond_init(&_spf_pool.work, NULL);
+  pthread_cond_init(&_spf_pool.done, NULL);
+
+  for (i=0; i<ARRAYSIZE(_spf_pool.threads); i++) {
+    if (pthread_create(&_spf_pool.threads[i], NULL, _cb_spf_worker, NULL)) {
+      OONF_WARN(LOG_OONFV2_ROUTING,
+          "Could not start dijkstra worker thread %zu", i);
+      break;
+    }
+    _spf_pool.thread_count++;
+  }
+}
+
+/**
+ * Stop the worker threads for the shortest path trees
+ */
+static void
+_spf_pool_cleanup(void) {
+  size_t i;
+
+  pthread_mutex_lock(&_spf_pool.lock);
+  _spf_pool.shutdown = true;
+  pthread_cond_broadcast(&_spf_pool.work);
+  pthread_mutex_unlock(&_spf_pool.lock);
+
+  for (i=0; i<_spf_pool.thread_count; i++) {
+    pthread_join(_spf_pool.threads[i], NULL);
+  }
+  _spf_pool.thread_count = 0;
+
+  pthread_cond_destroy(&_spf_pool.done);
+  pthread_cond_destroy(&_spf_pool.work);
+  pthread_mutex_destroy(&_spf_pool.lock);
+}
+
+/**
+ * Calculate the shortest path trees of all active domains with
+ * the worker pool. The main thread takes jobs too and returns
+ * when all calculations are finished.
+ */
+static void
+_spf_pool_run(void) {
+  struct nhdp_domain *domain;
+  struct _spf_domain *spf;
+
+  pthread_mutex_lock(&_spf_pool.lock);
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    spf = &_spf[domain->index];
+    if (spf->active) {
+      _spf_pool.jobs[_spf_pool.job_count++] = spf;
+    }
+  }
+  _spf_pool.running = _spf_pool.job_count;
+  pthread_cond_broadcast(&_spf_pool.work);
+
+  while (_spf_pool.job_count > 0) {
+    spf = _spf_pool.jobs[--_spf_pool.job_count];
+    pthread_mutex_unlock(&_spf_pool.lock);
+
+    _calculate_spt(spf);
+
+    pthread_mutex_lock(&_spf_pool.lock);
+    _spf_pool.running--;
+  }
+
+  while (_spf_pool.running > 0) {
+    pthread_cond_wait(&_spf_pool.done, &_spf_pool.lock);
+  }
+  pthread_mutex_unlock(&_spf_pool.lock);
+}
+
+/**
+ * Thread function of the worker pool, calculates the shortest path
+ * trees of waiting domains until the pool is shut down
+ * @param ptr unused
+ * @return always NULL
+ */
+static void *
+_cb_spf_worker(void *ptr __attribute__((unused))) {
+  struct _spf_domain *spf;
+
+  _spf_worker = true;
+
+  pthread_mutex_lock(&_spf_pool.lock);
+  while (true) {
+    while (_spf_pool.job_count == 0 && !_spf_pool.shutdown) {
+      pthread_cond_wait(&_spf_pool.work, &_spf_pool.lock);
+    }
+    if (_spf_pool.shutdown) {
+      break;
+    }
+
+    spf = _spf_pool.jobs[--_spf_pool.job_count];
+    pthread_mutex_unlock(&_spf_pool.lock);
+
+    _calculate_spt(spf);
+
+    pthread_mutex_lock(&_spf_pool.lock);
+    if (--_spf_pool.running == 0) {
+      pthread_cond_signal(&_spf_pool.done);
+    }
+  }
+  pthread_mutex_unlock(&_spf_pool.lock);
+  return NULL;
+}
+#endif
+
+/**
+ * Calculate the shortest path tree of a domain from scratch
+ * @param domain nhdp domain
+ */
+static void
+_run_dijkstra(struct nhdp_domain *domain) {
+  /* initialize dijkstra specific fields */
+  _prepare_dijkstra(domain);
+
+  /* run dijkstra */
+  while (!_working_queue_is_empty(&_spf[domain->index])) {
+    _handle_working_queue(domain);
+  }
+}
+
+/**
+ * Update the shortest path tree of a domain with the targets
+ * that changed since the last dijkstra run.
+ * @param domain nhdp domain
+ */
+static void
+_run_incremental_dijkstra(struct nhdp_domain *domain) {
+  struct olsrv2_dijkstra_node *dijkstra, *last;
+  struct olsrv2_tc_target *target;
+  struct _spf_domain *spf;
+
+  spf = &_spf[domain->index];
+
+  SPF_DEBUG(LOG_OONFV2_ROUTING, "Incremental dijkstra for %u changed targets",
+      _changed_count);
+
+  /* invalidate all subtrees whose path is not valid anymore */
+  list_for_each_element(&_changed_targets, target, _changed_node) {
+    dijkstra = _get_dijkstra(domain, target);
+    if (dijkstra->first_hop != NULL && !dijkstra->_affected
+        && !_is_path_valid(domain, target)) {
+      _invalidate_subtree(domain, target);
+    }
+  }
+
+  /* the relaxation appends the improved nodes to the affected list */
+  last = NULL;
+  if (!list_is_empty(&spf->affected)) {
+    last = list_last_element(&spf->affected, last, _affected_node);
+  }
+
+  /* look for (better) paths through unaffected predecessors */
+  list_for_each_element(&_changed_targets, target, _changed_node) {
+    _relax_predecessors(domain, target);
+  }
+  if (last != NULL) {
+    list_for_each_element(&spf->affected, dijkstra, _affected_node) {
+      _relax_predecessors(domain, dijkstra->target);
+      if (dijkstra == last) {
+        /* all invalidated nodes have been relaxed */
+        break;
+      }
+    }
+  }
+
+  /* propagate changes through the shortest path tree */
+  while (!_working_queue_is_empty(spf)) {
+    _handle_working_queue(domain);
+  }
+}
+
+/**
+ * Check if the current shortest path to a target is still supported
+ * by the topology database.
+ * @param domain nhdp domain
+ * @param target pointer to tc target
+ * @return true if path is still valid, false otherwise
+ */
+static bool
+_is_path_valid(struct nhdp_domain *domain, struct olsrv2_tc_target *target) {
+  struct olsrv2_dijkstra_node *dijkstra, *parent;
+  struct olsrv2_tc_attachment *net;
+  struct olsrv2_tc_edge *edge;
+  struct nhdp_neighbor *neigh;
+  uint32_t cost;
+
+  dijkstra = _get_dijkstra(domain, target);
+
+  if (dijkstra->parent == NULL) {
+    if (!dijkstra->single_hop) {
+      /* path through tc node has been removed */
+      return false;
+    }
+
+    /* direct path to one-hop neighbor */
+    neigh = dijkstra->first_hop;
+    return neigh != NULL && nhdp_addr_id_is_equal(neigh->originator_id, target->addr_id)
+        && neigh->symmetric > 0
+        && _get_neighbor_cost(domain, neigh) == dijkstra->path_cost;
+  }
+
+  parent = _get_dijkstra(domain, &dijkstra->parent->target);
+  if (parent->first_hop == NULL) {
+    /* parent is not reachable anymore */
+    return false;
+  }
+
+  if (target->type == OONFV2_NODE_TARGET) {
+    edge = avl_find_element(&dijkstra->parent->_edges,
+        &target->addr_id, edge, _node);
+    if (edge == NULL) {
+      return false;
+    }
+    cost = olsrv2_tc_edge_get_cost(edge, domain->index);
+    return cost < RFC5444_METRIC_INFINITE
+        && parent->path_cost + cost == dijkstra->path_cost;
+  }
+
+  net = avl_find_element(&dijkstra->parent->_endpoints,
+      &target->addr_id, net, _src_node);
+  if (net == NULL) {
+    return false;
+  }
+  cost = olsrv2_tc_endpoint_get_cost(net, domain->index);
+  return cost < RFC5444_METRIC_INFINITE
+      && parent->path_cost + cost == dijkstra->path_cost
+      && olsrv2_tc_endpoint_get_distance(net, domain->index)
+          == dijkstra->distance;
+}
+
+/**
+ * Reset the path of a target and of all targets reached through it
+ * in the shortest path tree.
+ * @param domain nhdp domain
+ * @param target pointer to root of the subtree
+ */
+static void
+_invalidate_subtree(struct nhdp_domain *domain,
+    struct olsrv2_tc_target *target) {
+  struct olsrv2_dijkstra_node *current, *child;
+  struct olsrv2_tc_attachment *net;
+  struct olsrv2_tc_edge *edge;
+  struct olsrv2_tc_node *tc_node;
+  struct _spf_domain *spf;
+
+  spf = &_spf[domain->index];
+
+  current = _get_dijkstra(domain, target);
+  _record_node(spf, current);
+
+  /* walk the subtree breadth first, the list is extended while walking */
+  while (current != NULL) {
+    /* reset path */
+    current->first_hop = NULL;
+    current->parent = NULL;
+    current->single_hop = false;
+    current->path_cost = RFC5444_METRIC_INFINITE_PATH;
+
+    if (current->target->type == OONFV2_NODE_TARGET) {
+      tc_node = container_of(current->target, struct olsrv2_tc_node, target);
+
+      avl_for_each_element(&tc_node->_edges, edge, _node) {
+        child = _get_dijkstra(domain, &edge->dst->target);
+        if (!child->_affected && child->parent == tc_node) {
+          _record_node(spf, child);
+        }
+      }
+      avl_for_each_element(&tc_node->_endpoints, net, _src_node) {
+        child = _get_dijkstra(domain, &net->dst->target);
+        if (!child->_affected && child->parent == tc_node) {
+          _record_node(spf, child);
+        }
+      }
+    }
+
+    if (list_is_last(&spf->affected, &current->_affected_node)) {
+      current = NULL;
+    }
+    else {
+      current = list_next_element(current, _affected_node);
+    }
+  }
+}
+
+/**
+ * Try to find a better path to a target through all its predecessors
+ * that have a known path and add it to the working queue.
+ * @param domain nhdp domain
+ * @param target pointer to tc target
+ */
+static void
+_relax_predecessors(struct nhdp_domain *domain,
+    struct olsrv2_tc_target *target) {
+  struct olsrv2_dijkstra_node *pred;
+  struct olsrv2_tc_attachment *net;
+  struct olsrv2_tc_endpoint *end;
+  struct olsrv2_tc_edge *edge;
+  struct olsrv2_tc_node *tc_node;
+  struct nhdp_neighbor *neigh;
+
+  if (_get_dijkstra(domain, target)->local) {
+    return;
+  }
+
+  if (target->type == OONFV2_NODE_TARGET) {
+    tc_node = container_of(target, struct olsrv2_tc_node, target);
+
+    /* direct path to one-hop neighbor */
+    neigh = nhdp_db_neighbor_get_by_originator_id(target->addr_id);
+    if (neigh != NULL && neigh->symmetric > 0) {
+      _insert_into_working_tree(domain, target, NULL, neigh,
+          _get_neighbor_cost(domain, neigh), 0, 0, true);
+    }
+
+    /* the inverse of each edge points towards this node */
+    avl_for_each_element(&tc_node->_edges, edge, _node) {
+      pred = _get_dijkstra(domain, &edge->dst->target);
+      if (pred->first_hop != NULL) {
+        _insert_into_working_tree(domain, target, edge->dst,
+            pred->first_hop,
+            olsrv2_tc_edge_get_cost(edge->inverse, domain->index),
+            pred->path_cost, 0, false);
+      }
+    }
+  }
+  else {
+    end = container_of(target, struct olsrv2_tc_endpoint, target);
+
+    avl_for_each_element(&end->_attached_networks, net, _endpoint_node) {
+      pred = _get_dijkstra(domain, &net->src->target);
+      if (pred->first_hop != NULL) {
+        _insert_into_working_tree(domain, target, net->src,
+            pred->first_hop,
+            olsrv2_tc_endpoint_get_cost(net, domain->index), pred->path_cost,
+            olsrv2_tc_endpoint_get_distance(net, domain->index), false);
+      }
+    }
+  }
+}
+
+/**
+ * Check the shortest path tree of a domain for consistency with
+ * the topology database (each path cost must be the minimum over
+ * all predecessors).
+ * @param domain nhdp domain
+ * @return true if shortest path tree is consistent, false otherwise
+ */
+static bool
+_verify_dijkstra(struct nhdp_domain *domain) {
+  struct olsrv2_tc_endpoint *end;
+  struct olsrv2_tc_node *node;
+
+  avl_for_each_element(&olsrv2_tc_tree, node, _originator_node) {
+    if (!_verify_target(domain, &node->target)) {
+      return false;
+    }
+  }
+  avl_for_each_element(&olsrv2_tc_endpoint_tree, end, _node) {
+    if (!_verify_target(domain, &end->target)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Check if the path cost of a single target is the minimum
+ * over all its predecessors.
+ * @param domain nhdp domain
+ * @param target pointer to tc target
+ * @return true if path cost is consistent, false otherwise
+ */
+static bool
+_verify_target(struct nhdp_domain *domain, struct olsrv2_tc_target *target) {
+  struct olsrv2_dijkstra_node *dijkstra, *pred;
+  struct olsrv2_tc_attachment *net;
+  struct olsrv2_tc_endpoint *end;
+  struct olsrv2_tc_edge *edge;
+  struct olsrv2_tc_node *tc_node;
+  struct nhdp_neighbor *neigh;
+  uint32_t best, cost;
+#ifdef OONF_LOG_DEBUG_INFO
+  struct netaddr_str buf;
+#endif
+
+  dijkstra = _get_dijkstra(domain, target);
+  best = RFC5444_METRIC_INFINITE_PATH;
+
+  if (target->type == OONFV2_NODE_TARGET && !dijkstra->local) {
+    tc_node = container_of(target, struct olsrv2_tc_node, target);
+
+    neigh = nhdp_db_neighbor_get_by_originator_id(target->addr_id);
+    if (neigh != NULL && neigh->symmetric > 0) {
+      cost = _get_neighbor_cost(domain, neigh);
+      if (cost < RFC5444_METRIC_INFINITE && cost < best) {
+        best = cost;
+      }
+    }
+
+    avl_for_each_element(&tc_node->_edges, edge, _node) {
+      pred = _get_dijkstra(domain, &edge->dst->target);
+      cost = olsrv2_tc_edge_get_cost(edge->inverse, domain->index);
+      if (pred->first_hop != NULL && cost < RFC5444_METRIC_INFINITE
+          && pred->path_cost + cost < best) {
+        best = pred->path_cost + cost;
+      }
+    }
+  }
+  else if (target->type != OONFV2_NODE_TARGET) {
+    end = container_of(target, struct olsrv2_tc_endpoint, target);
+
+    avl_for_each_element(&end->_attached_networks, net, _endpoint_node) {
+      pred = _get_dijkstra(domain, &net->src->target);
+      cost = olsrv2_tc_endpoint_get_cost(net, domain->index);
+      if (pred->first_hop != NULL && cost < RFC5444_METRIC_INFINITE
+          && pred->path_cost + cost < best) {
+        best = pred->path_cost + cost;
+      }
+    }
+  }
+
+  if (best != dijkstra->path_cost) {
+    SPF_DEBUG(LOG_OONFV2_ROUTING, "Dijkstra cost of %s is %u, should be %u",
+        netaddr_to_string(&buf, olsrv2_tc_target_get_netaddr(target)),
+        dijkstra->path_cost, best);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Remove item from dijkstra working queue and process it
+ * @param domain nhdp domain
+ */
+static void
+_handle_working_queue(struct nhdp_domain *domain) {
+  struct olsrv2_dijkstra_node *dijkstra;
+  struct olsrv2_tc_target *target;
+
+  struct olsrv2_tc_node *tc_node;
+  struct olsrv2_tc_edge *tc_edge;
+  struct olsrv2_tc_attachment *tc_attached;
+
+  const uint32_t *costs;
+  const uint8_t *distances;
+  uint32_t link, link_end;
+
+#ifdef OONF_LOG_DEBUG_INFO
+  struct netaddr_str buf;
+#endif
+
+  /* get tc target and remove it from working queue */
+  dijkstra = _working_queue_pop(&_spf[domain->index]);
+  target = dijkstra->target;
+
+  SPF_DEBUG(LOG_OONFV2_ROUTING, "Remove node %s from dijkstra tree",
+      netaddr_to_string(&buf, olsrv2_tc_target_get_netaddr(target)));
+
+  if (target->type != OONFV2_NODE_TARGET) {
+    /* endpoints do not spawn new edges */
+    return;
+  }
+
+  /* calculate pointer of olsrv2_tc_node */
+  tc_node = container_of(target, struct olsrv2_tc_node, target);
+
+  if (olsrv2_spf_graph_is_current(&_spf_graph, _topology_generation)) {
+    costs = olsrv2_spf_graph_get_costs(&_spf_graph, domain->index);
+    distances = olsrv2_spf_graph_get_distances(&_spf_graph, domain->index);
+
+    /* iterate over edges and attached networks of the snapshot */
+    link_end = _spf_graph.link_start[target->_graph_index + 1];
+    for (link = _spf_graph.link_start[target->_graph_index];
+        link < link_end; link++) {
+      if (costs[link] < RFC5444_METRIC_INFINITE) {
+        _insert_into_working_tree(domain,
+            _spf_graph.targets[_spf_graph.link_dst[link]], tc_node,
+            dijkstra->first_hop, costs[link],
+            dijkstra->path_cost, distances[link], false);
+      }
+    }
+    return;
+  }
+
+  /* only the cost columns of this domain are touched */
+  costs = olsrv2_cost_table_get_column(&olsrv2_tc_edge_costs, domain->index);
+  if (costs != NULL) {
+    /* iterate over edges */
+    avl_for_each_element(&tc_node->_edges, tc_edge, _node) {
+      if (costs[tc_edge->_cost_index] < RFC5444_METRIC_INFINITE) {
+        /* add new tc_node to working tree */
+        _insert_into_working_tree(domain, &tc_edge->dst->target, tc_node,
+            dijkstra->first_hop, costs[tc_edge->_cost_index],
+            dijkstra->path_cost, 0, false);
+      }
+    }
+  }
+
+  costs = olsrv2_cost_table_get_column(
+      &olsrv2_tc_attachment_costs, domain->index);
+  distances = olsrv2_cost_table_get_distances(
+      &olsrv2_tc_attachment_costs, domain->index);
+  if (costs != NULL) {
+    /* iterate over attached networks and addresses */
+    avl_for_each_element(&tc_node->_endpoints, tc_attached, _src_node) {
+      if (costs[tc_attached->_cost_index] < RFC5444_METRIC_INFINITE) {
+        /* add attached network or address to working tree */
+        _insert_into_working_tree(domain, &tc_attached->dst->target, tc_node,
+            dijkstra->first_hop, costs[tc_attached->_cost_index],
+            dijkstra->path_cost, distances[tc_attached->_cost_index], false);
+      }
+    }
+  }
+}
+
+/**
+ * Mark the routing entries of all dijkstra nodes whose path
+ * was changed by the current run for recalculation
+ * @param domain nhdp domain
+ */
+static void
+_add_dijkstra_routes(struct nhdp_domain *domain) {
+  struct olsrv2_dijkstra_node *dijkstra, *d_it;
+  struct olsrv2_routing_entry *rtentry;
+  struct _spf_domain *spf;
+  bool refresh;
+
+  spf = &_spf[domain->index];
+
+  refresh = spf->refresh;
+  if (refresh) {
+    /* all entries must be written again */
+    avl_for_each_element(&olsrv2_routing_tree[domain->index], rtentry, _node) {
+      _mark_entry(rtentry);
+    }
+    spf->refresh = false;
+  }
+
+  list_for_each_element_safe(&spf->affected, dijkstra, _affected_node, d_it) {
+    dijkstra->_affected = false;
+    list_remove(&dijkstra->_affected_node);
+
+    if (refresh || _is_node_changed(dijkstra)) {
+      _add_dijkstra_route(domain, dijkstra);
+    }
+  }
+}
+
+/**
+ * Mark the routing entry of a single dijkstra node for recalculation
+ * @param domain nhdp domain
+ * @param dijkstra pointer to dijkstra node
+ */
+static void
+_add_dijkstra_route(struct nhdp_domain *domain,
+    struct olsrv2_dijkstra_node *dijkstra) {
+  struct olsrv2_routing_entry *rtentry;
+
+  if (_is_path_usable(domain, dijkstra)) {
+    rtentry = _add_entry(domain, olsrv2_tc_target_get_netaddr(dijkstra->target));
+  }
+  else {
+    /* target is not reachable or first hop lost its last link */
+    rtentry = avl_find_element(&olsrv2_routing_tree[domain->index],
+        olsrv2_tc_target_get_netaddr(dijkstra->target), rtentry, _node);
+  }
+
+  if (rtentry != NULL) {
+    _mark_entry(rtentry);
+  }
+}
+
+/**
+ * Add routes learned from nhdp to dijkstra results
+ * @param domain nhdp domain
+ */
+static void
+_handle_nhdp_routes(struct nhdp_domain *domain) {
+  struct olsrv2_routing_entry *rtentry, *rt_it;
+  struct nhdp_neighbor *neigh;
+  struct nhdp_naddr *naddr;
+  struct nhdp_l2hop *l2hop;
+  struct nhdp_link *lnk;
+  uint32_t neighcost;
+  uint32_t l2hop_pathcost;
+
+  list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
+
+    /* get linkcost to neighbor */
+    neighcost = _get_neighbor_cost(domain, neigh);
+
+    if (neighcost >= RFC5444_METRIC_INFINITE) {
+      /* neighbor is not reachable or has no usable link yet */
+      continue;
+    }
+
+    /* make sure all addresses of the neighbor are better than our direct link */
+    avl_for_each_element(&neigh->_neigh_addresses, naddr, _neigh_node) {
+      if (!netaddr_acl_check_accept(olsrv2_get_routable(),
+          nhdp_db_neighbor_addr_get_netaddr(naddr))) {
+        /* not a routable address, check the next one */
+        continue;
+      }
+
+      _add_nhdp_route(domain, nhdp_db_neighbor_addr_get_netaddr(naddr),
+          neigh, neighcost, true);
+    }
+
+    list_for_each_element(&neigh->_links, lnk, _neigh_node) {
+      avl_for_each_element(&lnk->_2hop, l2hop, _link_node) {
+        /* get new pathcost to 2hop neighbor */
+        l2hop_pathcost = nhdp_domain_get_l2hopdata(domain, l2hop)->metric.out;
+        if (l2hop_pathcost >= RFC5444_METRIC_INFINITE) {
+          continue;
+        }
+
+        if (!netaddr_acl_check_accept(olsrv2_get_routable(),
+            nhdp_db_link_2hop_get_netaddr(l2hop))) {
+          /* not a routable address, check the next one */
+          continue;
+        }
+
+        _add_nhdp_route(domain, nhdp_db_link_2hop_get_netaddr(l2hop), neigh,
+            l2hop_pathcost + neighcost, false);
+      }
+    }
+  }
+
+  /* recalculate all entries with a neighborhood route, old or new */
+  list_for_each_element_safe(&_domain_nhdp[domain->index],
+      rtentry, _nhdp_node, rt_it) {
+    if (rtentry->_nhdp_stamp != _route_stamp) {
+      /* neighborhood route is gone */
+      list_remove(&rtentry->_nhdp_node);
+    }
+    _mark_entry(rtentry);
+  }
+}
+
+/**
+ * Remember a route through the neighborhood for a routing entry
+ * if it is better than the routes found before in this run
+ * @param domain nhdp domain
+ * @param prefix destination of route
+ * @param neigh first hop of route
+ * @param cost path cost of route
+ * @param single_hop true if route is single hop
+ */
+static void
+_add_nhdp_route(struct nhdp_domain *domain, const struct netaddr *prefix,
+    struct nhdp_neighbor *neigh, uint32_t cost, bool single_hop) {
+  struct olsrv2_routing_entry *rtentry;
+
+  rtentry = _add_entry(domain, prefix);
+  if (rtentry == NULL
+      || (rtentry->_nhdp_stamp == _route_stamp && rtentry->_nhdp_cost <= cost)) {
+    /* error in rtentry creation or existing route is better */
+    return;
+  }
+
+  rtentry->_nhdp_stamp = _route_stamp;
+  rtentry->_nhdp_cost = cost;
+  rtentry->_nhdp_hop = neigh;
+  rtentry->_nhdp_single_hop = single_hop;
+
+  if (!list_is_node_added(&rtentry->_nhdp_node)) {
+    list_add_tail(&_domain_nhdp[domain->index], &rtentry->_nhdp_node);
+  }
 }
 
 /**
- * Initialize internal fields for dijkstra calculation
+ * Calculate a loop free alternate first hop (RFC 5286) for the
+ * routing entries of a domain. Needs a dijkstra rooted at each
+ * neighbor, which runs on the topology snapshot. The results are
+ * kept until the topology generation changes.
  * @param domain nhdp domain
  */
 static void
-_prepare_routes(struct nhdp_domain *domain) {
+_calculate_lfa(struct nhdp_domain *domain) {
+  struct nhdp_neighbor_domaindata *neighdata;
   struct olsrv2_routing_entry *rtentry;
   struct olsrv2_tc_endpoint *end;
-  struct olsrv2_tc_node *node;
+  struct olsrv2_tc_node *tc_node;
   struct nhdp_neighbor *neigh;
-
-  /* prepare all existing routing entries and put them into the working queue */
-  avl_for_each_element(&olsrv2_routing_tree[domain->index], rtentry, _node) {
-    rtentry->set = false;
-    rtentry->_old_if_index = rtentry->route.if_index;
-    rtentry->_old_distance = rtentry->route.metric;
-    memcpy(&rtentry->_old_next_hop, &rtentry->route.gw, sizeof(struct netaddr));
+  struct _lfa_cache *cache;
+  struct _lfa_target *lfa;
+  const uint32_t *dist;
+  uint64_t dist_ns, cost;
+  uint32_t i, count;
+
+  cache = &_lfa[domain->index];
+  if (!cache->valid || cache->generation != _topology_generation) {
+    if (olsrv2_spf_graph_update(&_spf_graph, _topology_generation)
+        || _lfa_cache_reset(cache)) {
+      OONF_WARN(LOG_OONFV2_ROUTING,
+          "Not enough memory for topology snapshot, no loop free alternates");
+      return;
+    }
   }
 
-  /* initialize private dijkstra data on nodes */
-  avl_for_each_element(&olsrv2_tc_tree, node, _originator_node) {
-    node->target._dijkstra.first_hop = NULL;
-    node->target._dijkstra.path_cost = RFC5444_METRIC_INFINITE_PATH;
-    node->target._dijkstra.local =
-        olsrv2_originator_is_local(&node->target.addr);
+  count = _spf_graph.target_count;
+  if (count == 0) {
+    return;
   }
 
-  /* initialize private dijkstra data on endpoints */
-  avl_for_each_element(&olsrv2_tc_endpoint_tree, end, _node) {
-    end->target._dijkstra.first_hop = NULL;
-    end->target._dijkstra.path_cost = RFC5444_METRIC_INFINITE_PATH;
+  /* the target buffer is kept for the next calculation */
+  if (count > _lfa_target_size) {
+    lfa = realloc(_lfa_targets, count * sizeof(*lfa));
+    if (lfa == NULL) {
+      OONF_WARN(LOG_OONFV2_ROUTING,
+          "Not enough memory for loop free alternate calculation");
+      return;
+    }
+    _lfa_targets = lfa;
+    _lfa_target_size = count;
   }
+  lfa = _lfa_targets;
+  memset(lfa, 0, count * sizeof(*lfa));
 
-  /* initialize Dijkstra working queue with one-hop neighbors */
-  list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
-    if (neigh->symmetric > 0
-        && netaddr_get_address_family(&neigh->originator) != AF_UNSPEC
-        && (node = olsrv2_tc_node_get(&neigh->originator)) != NULL) {
-      /* found node for neighbor, add to worker list */
-      _insert_into_working_tree(&node->target, neigh,
-          nhdp_domain_get_neighbordata(domain, neigh)->metric.out,
-          0, 0, true);
+  /* connect the routing entries with their targets of the snapshot */
+  avl_for_each_element(&olsrv2_routing_tree[domain->index], rtentry, _node) {
+    if (!rtentry->set || rtentry->_first_hop == NULL) {
+      continue;
+    }
+
+    /* entries not changed by this run still have an old alternate */
+    _set_lfa_hop(rtentry, NULL);
+    netaddr_invalidate(&rtentry->lfa.gw);
+
+    tc_node = olsrv2_tc_node_get_by_id(rtentry->dst_id);
+    if (tc_node) {
+      _add_lfa_target(lfa, &tc_node->target, rtentry);
+    }
+    end = olsrv2_tc_endpoint_get_by_id(rtentry->dst_id);
+    if (end) {
+      _add_lfa_target(lfa, &end->target, rtentry);
     }
   }
-}
 
-/**
- * Remove item from dijkstra working queue and process it
- * @param domain nhdp domain
- */
-static void
-_handle_working_queue(struct nhdp_domain *domain) {
-  struct olsrv2_routing_entry *rtentry;
-  struct olsrv2_tc_target *target;
-  struct nhdp_neighbor *first_hop;
+  list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
+    neighdata = nhdp_domain_get_neighbordata(domain, neigh);
+    if (neigh->symmetric == 0
+        || _get_neighbor_cost(domain, neigh) >= RFC5444_METRIC_INFINITE
+        || (tc_node = olsrv2_tc_node_get_by_id(neigh->originator_id)) == NULL
+        || tc_node->target._graph_index >= _spf_graph.node_count
+        || _spf_graph.targets[tc_node->target._graph_index] != &tc_node->target) {
+      /* we do not know the topology as seen by this neighbor */
+      continue;
+    }
 
-  struct olsrv2_tc_node *tc_node;
-  struct olsrv2_tc_edge *tc_edge;
-  struct olsrv2_tc_attachment *tc_attached;
+    dist = _lfa_cache_get(domain, lfa, tc_node->target._graph_index);
+    if (dist == NULL) {
+      OONF_WARN(LOG_OONFV2_ROUTING,
+          "Not enough memory for loop free alternate calculation");
+      break;
+    }
 
-#ifdef OONF_LOG_DEBUG_INFO
-  struct netaddr_str buf;
-#endif
+    /* path cost from neighbor back to us */
+    dist_ns = RFC5444_METRIC_INFINITE_PATH;
+    for (i=0; i<_spf_graph.node_count; i++) {
+      if (_get_dijkstra(domain, _spf_graph.targets[i])->local
+          && dist[i] < dist_ns) {
+        dist_ns = dist[i];
+      }
+    }
 
-  /* get tc target */
-  target = avl_first_element(&_dijkstra_working_tree, target, _dijkstra._node);
+    for (i=0; i<count; i++) {
+      rtentry = lfa[i].rtentry;
+      if (rtentry == NULL || rtentry->_first_hop == neigh
+          || dist[i] >= RFC5444_METRIC_INFINITE_PATH) {
+        continue;
+      }
 
-  /* remove current node from working tree */
-  OONF_DEBUG(LOG_OONFV2_ROUTING, "Remove node %s from dijkstra tree",
-      netaddr_to_string(&buf, &target->addr));
-  avl_remove(&_dijkstra_working_tree, &target->_dijkstra._node);
+      /* loop free criterion: D(N,D) < D(N,S) + D(S,D) */
+      if ((uint64_t)dist[i] >= dist_ns + rtentry->cost) {
+        continue;
+      }
 
-  /* add routing entry */
-  rtentry = _add_entry(domain, &target->addr);
-  if (rtentry == NULL) {
-    return;
+      cost = (uint64_t)neighdata->metric.out + dist[i];
+      if (cost < lfa[i].lfa_cost) {
+        lfa[i].lfa_cost = cost;
+        lfa[i].lfa_hop = neigh;
+      }
+    }
   }
 
-  /* fill routing entry with dijkstra result */
-  _update_routing_entry(rtentry, domain,
-      target->_dijkstra.first_hop,
-      target->_dijkstra.distance,
-      target->_dijkstra.path_cost,
-      target->_dijkstra.single_hop);
+  /* remember next hops of the alternates */
+  _statistics.lfa_routes = 0;
+  for (i=0; i<count; i++) {
+    rtentry = lfa[i].rtentry;
+    if (rtentry == NULL || lfa[i].lfa_hop == NULL) {
+      continue;
+    }
 
-  if (target->type == OONFV2_NODE_TARGET) {
-    /* get neighbor and its domain specific data */
-    first_hop = target->_dijkstra.first_hop;
+    _set_lfa_hop(rtentry, lfa[i].lfa_hop);
+    if (rtentry->_lfa_hop == NULL) {
+      /* out of memory */
+      continue;
+    }
 
-    /* calculate pointer of olsrv2_tc_node */
-    tc_node = container_of(target, struct olsrv2_tc_node, target);
+    neighdata = nhdp_domain_get_neighbordata(domain, rtentry->_lfa_hop);
+    rtentry->lfa.if_index = neighdata->best_link_ifindex;
+    memcpy(&rtentry->lfa.gw, nhdp_db_link_get_ifaddr(neighdata->best_link),
+        sizeof(rtentry->lfa.gw));
+    _statistics.lfa_routes++;
+  }
+}
 
-    /* iterate over edges */
-    avl_for_each_element(&tc_node->_edges, tc_edge, _node) {
-      if (tc_edge->cost[domain->index] < RFC5444_METRIC_INFINITE) {
-        /* add new tc_node to working tree */
-        _insert_into_working_tree(&tc_edge->dst->target, first_hop,
-            tc_edge->cost[domain->index], target->_dijkstra.path_cost,
-            0, false);
-      }
-    }
+/**
+ * Connect a target of the topology snapshot with its routing entry
+ * @param lfa array of loop free alternate targets
+ * @param target pointer to tc target
+ * @param rtentry routing entry of the target
+ */
+static void
+_add_lfa_target(struct _lfa_target *lfa,
+    struct olsrv2_tc_target *target, struct olsrv2_routing_entry *rtentry) {
+  uint32_t idx;
 
-    /* iterate over attached networks and addresses */
-    avl_for_each_element(&tc_node->_endpoints, tc_attached, _src_node) {
-      if (tc_attached->cost[domain->index] < RFC5444_METRIC_INFINITE) {
-        /* add attached network or address to working tree */
-        _insert_into_working_tree(&tc_attached->dst->target, first_hop,
-            tc_attached->cost[domain->index], target->_dijkstra.path_cost,
-            tc_attached->distance[domain->index], false);
-      }
-    }
+  idx = target->_graph_index;
+  if (idx >= _spf_graph.target_count || _spf_graph.targets[idx] != target) {
+    /* target is not part of the snapshot */
+    return;
   }
 
-  /* cleanup temporary dijkstra data */
-  target->_dijkstra.first_hop = NULL;
+  lfa[idx].rtentry = rtentry;
+  lfa[idx].lfa_cost = UINT64_MAX;
 }
 
 /**
- * Add routes learned from nhdp to dijkstra results
+ * Calculate the path costs from a tc node to all targets
+ * of the topology snapshot
  * @param domain nhdp domain
+ * @param lfa array of loop free alternate targets
+ * @param start snapshot index of the tc node
  */
 static void
-_handle_nhdp_routes(struct nhdp_domain *domain) {
-  struct olsrv2_routing_entry *rtentry;
-  struct nhdp_neighbor_domaindata *neigh_data;
-  struct nhdp_neighbor *neigh;
-  struct nhdp_naddr *naddr;
-  struct nhdp_l2hop *l2hop;
-  struct nhdp_link *lnk;
-  uint32_t neighcost;
-  uint32_t l2hop_pathcost;
-
-  list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
+_run_lfa_dijkstra(struct nhdp_domain *domain,
+    struct _lfa_target *lfa, uint32_t start) {
+  struct olsrv2_heap_node *heap_node;
+  struct _lfa_target *current, *dst;
+  struct olsrv2_heap queue;
+  const uint32_t *costs;
+  uint32_t i, idx, link, link_end, cost;
+
+  costs = olsrv2_spf_graph_get_costs(&_spf_graph, domain->index);
+
+  for (i=0; i<_spf_graph.target_count; i++) {
+    memset(&lfa[i]._node, 0, sizeof(lfa[i]._node));
+    lfa[i]._node.key = &lfa[i].dist;
+    lfa[i].dist = RFC5444_METRIC_INFINITE_PATH;
+  }
 
-    /* get linkcost to neighbor */
-    neigh_data = nhdp_domain_get_neighbordata(domain, neigh);
-    neighcost = neigh_data->metric.out;
+  olsrv2_heap_init(&queue);
+  lfa[start].dist = 0;
+  olsrv2_heap_insert(&queue, &lfa[start]._node);
 
-    if (neighcost >= RFC5444_METRIC_INFINITE) {
+  while ((heap_node = olsrv2_heap_extract_min(&queue)) != NULL) {
+    current = container_of(heap_node, struct _lfa_target, _node);
+    idx = current - lfa;
+    if (idx >= _spf_graph.node_count) {
+      /* endpoints do not spawn new edges */
       continue;
     }
 
-    /* make sure all addresses of the neighbor are better than our direct link */
-    avl_for_each_element(&neigh->_neigh_addresses, naddr, _neigh_node) {
-      if (!netaddr_acl_check_accept(olsrv2_get_routable(), &naddr->neigh_addr)) {
-        /* not a routable address, check the next one */
+    link_end = _spf_graph.link_start[idx + 1];
+    for (link = _spf_graph.link_start[idx]; link < link_end; link++) {
+      if (costs[link] >= RFC5444_METRIC_INFINITE) {
         continue;
       }
 
-      rtentry = _add_entry(domain, &naddr->neigh_addr);
-      if (rtentry == NULL || (rtentry->set && rtentry->cost <= neighcost)) {
-        /*
-         * error in rtentry creation or existing entry is better than
-         * the new one, check next neighbor address
-         */
+      dst = &lfa[_spf_graph.link_dst[link]];
+      cost = current->dist + costs[link];
+      if (cost >= dst->dist) {
         continue;
       }
 
-      /* the direct link is better than the dijkstra calculation */
-      _update_routing_entry(rtentry, domain, neigh, 0, neighcost, true);
+      dst->dist = cost;
+      if (olsrv2_heap_is_node_added(&queue, &dst->_node)) {
+        olsrv2_heap_decrease_key(&queue, &dst->_node);
+      }
+      else {
+        olsrv2_heap_insert(&queue, &dst->_node);
+      }
     }
+  }
+}
 
-    list_for_each_element(&neigh->_links, lnk, _neigh_node) {
-      avl_for_each_element(&lnk->_2hop, l2hop, _link_node) {
-        /* get new pathcost to 2hop neighbor */
-        l2hop_pathcost = nhdp_domain_get_l2hopdata(domain, l2hop)->metric.out;
-        if (l2hop_pathcost >= RFC5444_METRIC_INFINITE) {
-          continue;
-        }
-
-        if (!netaddr_acl_check_accept(olsrv2_get_routable(), &l2hop->twohop_addr)) {
-          /* not a routable address, check the next one */
-          continue;
-        }
+/**
+ * Clear the path costs of the loop free alternate calculation
+ * and bind the cache to the current topology snapshot
+ * @param cache pointer to cache
+ * @return -1 if out of memory, 0 otherwise
+ */
+static int
+_lfa_cache_reset(struct _lfa_cache *cache) {
+  uint32_t *vector;
+  size_t count;
+
+  cache->valid = false;
+  cache->count = 0;
+
+  count = _spf_graph.node_count > 0 ? _spf_graph.node_count : 1;
+  vector = realloc(cache->vector, count * sizeof(*vector));
+  if (vector == NULL) {
+    return -1;
+  }
+  memset(vector, 0, count * sizeof(*vector));
 
-        l2hop_pathcost += neighcost;
+  cache->vector = vector;
+  cache->generation = _topology_generation;
+  cache->valid = true;
+  return 0;
+}
 
-        rtentry = _add_entry(domain, &l2hop->twohop_addr);
-        if (rtentry == NULL || (rtentry->set && rtentry->cost <= l2hop_pathcost)) {
-          /* next 2hop address */
-          continue;
-        }
+/**
+ * Get the path costs from a tc node to all targets of the
+ * topology snapshot, run a dijkstra if they are not known yet
+ * @param domain nhdp domain
+ * @param lfa array of loop free alternate targets
+ * @param start snapshot index of the tc node
+ * @return array of path costs, NULL if out of memory
+ */
+static const uint32_t *
+_lfa_cache_get(struct nhdp_domain *domain,
+    struct _lfa_target *lfa, uint32_t start) {
+  struct _lfa_cache *cache;
+  uint32_t *dist;
+  size_t size;
+  uint32_t i, count;
+
+  cache = &_lfa[domain->index];
+  count = _spf_graph.target_count;
+
+  if (cache->vector[start] != 0) {
+    return &cache->dist[(size_t)(cache->vector[start] - 1) * count];
+  }
 
-        /* the 2-hop route is better than the dijkstra calculation */
-        _update_routing_entry(rtentry, domain, neigh, 0, l2hop_pathcost, false);
-      }
+  size = (size_t)(cache->count + 1) * count;
+  if (size > cache->size) {
+    if (size < cache->size * 2) {
+      size = cache->size * 2;
+    }
+    dist = realloc(cache->dist, size * sizeof(*dist));
+    if (dist == NULL) {
+      return NULL;
     }
+    cache->dist = dist;
+    cache->size = size;
+  }
+
+  _run_lfa_dijkstra(domain, lfa, start);
+
+  dist = &cache->dist[(size_t)cache->count * count];
+  for (i=0; i<count; i++) {
+    dist[i] = lfa[i].dist;
   }
+
+  cache->vector[start] = ++cache->count;
+  return dist;
+}
+
+/**
+ * Free the memory of a loop free alternate cache
+ * @param cache pointer to cache
+ */
+static void
+_lfa_cache_free(struct _lfa_cache *cache) {
+  free(cache->vector);
+  free(cache->dist);
+  memset(cache, 0, sizeof(*cache));
 }
 
 /**
@@ -641,6 +2653,20 @@ _add_route_to_kernel_queue(struct olsrv2_routing_entry *rtentry) {
   struct netaddr_str nbuf;
 #endif
 
+  if (list_is_node_added(&rtentry->_working_node)) {
+    /* entry is still waiting for the kernel, queue it again */
+    list_remove(&rtentry->_working_node);
+  }
+  else {
+    _statistics.kernel_queued++;
+  }
+
+  if (rtentry->in_processing) {
+    /* queue it after the kernel has finished the last change */
+    list_add_tail(&_kernel_waiting, &rtentry->_working_node);
+    return;
+  }
+
   if (rtentry->set) {
     OONF_INFO(LOG_OONFV2_ROUTING,
         "Set route %s (%u %u %s)",
@@ -675,86 +2701,297 @@ _add_route_to_kernel_queue(struct olsrv2_routing_entry *rtentry) {
 }
 
 /**
- * process the results of a dijkstra run and add them to the kernel
- * processing queue
- * @param domain nhdp domain
+ * process the change journal of a dijkstra run and add the changed
+ * routes to the kernel processing queue
  */
 static void
-_process_dijkstra_result(struct nhdp_domain *domain) {
-  struct olsrv2_routing_entry *rtentry;
-  avl_for_each_element(&olsrv2_routing_tree[domain->index], rtentry, _node) {
-    /* initialize rest of route parameters */
-    rtentry->route.table = _domain_parameter[rtentry->domain->index].table;
-    rtentry->route.protocol = _domain_parameter[rtentry->domain->index].protocol;
-    rtentry->route.metric = _domain_parameter[rtentry->domain->index].distance;
-
-    // TODO: handle source ip
-
-    if (rtentry->set
-        && rtentry->_old_if_index == rtentry->route.if_index
-        && rtentry->_old_distance == rtentry->route.metric
-        && netaddr_cmp(&rtentry->_old_next_hop, &rtentry->route.gw) == 0) {
-      /* no change, ignore this entry */
+_process_dijkstra_result(void) {
+  struct olsrv2_routing_entry *rtentry, *rt_it;
+
+  list_for_each_element_safe(&_route_journal, rtentry, _journal_node, rt_it) {
+    list_remove(&rtentry->_journal_node);
+    _statistics.routes_scanned++;
+
+    if (!_is_entry_changed(rtentry)) {
+      /* entry changed back during the run, ignore it */
       continue;
     }
+
+    _statistics.routes_changed++;
     _add_route_to_kernel_queue(rtentry);
   }
 }
 
 /**
- * Process all entries in kernel processing queue and send them to the kernel
+ * Send entries of the kernel processing queue to the kernel
+ * until the processing window is full. Routes still processed
+ * by the kernel wait in a separate list, so the queue is always
+ * sent from its head and never scanned twice.
  */
 static void
 _process_kernel_queue(void) {
   struct olsrv2_routing_entry *rtentry, *rt_it;
   struct os_route_str rbuf;
+  uint32_t window;
+  int result;
+
+  if (_kernel_queue_active) {
+    /* called from a route callback while sending the queue */
+    return;
+  }
+
+  /* all routes must be removed during shutdown */
+  window = _initiate_shutdown ? 0 : (uint32_t)olsrv2_get_routing_window();
 
+  _kernel_queue_active = true;
   list_for_each_element_safe(&_kernel_queue, rtentry, _working_node, rt_it) {
+    if (window > 0 && _statistics.kernel_in_flight >= window) {
+      /* wait for the kernel to finish some routes */
+      break;
+    }
+
+    if (!rtentry->set && !rtentry->_in_kernel) {
+      /* route never reached the kernel, nothing to remove */
+      _remove_entry(rtentry);
+      continue;
+    }
+
     /* remove from routing queue */
     list_remove(&rtentry->_working_node);
+    _statistics.kernel_queued--;
 
     /* mark route as in kernel processing */
     rtentry->in_processing = true;
+    rtentry->_sent_set = rtentry->set;
+    _statistics.kernel_in_flight++;
 
     if (rtentry->set) {
       /* add to kernel */
-      if (os_routing_set(&rtentry->route, true, true)) {
+      result = os_routing_set(&rtentry->route, true, true);
+      if (result) {
         OONF_WARN(LOG_OONFV2_ROUTING, "Could not set route %s",
             os_routing_to_string(&rbuf, &rtentry->route));
       }
     }
     else  {
       /* remove from kernel */
-      if (os_routing_set(&rtentry->route, false, false)) {
+      result = os_routing_set(&rtentry->route, false, false);
+      if (result) {
         OONF_WARN(LOG_OONFV2_ROUTING, "Could not remove route %s",
             os_routing_to_string(&rbuf, &rtentry->route));
       }
     }
+
+    if (result && rtentry->in_processing) {
+      /* no callback will come for this route */
+      rtentry->in_processing = false;
+      _statistics.kernel_in_flight--;
+      _statistics.kernel_errors++;
+    }
   }
+  _kernel_queue_active = false;
 }
 
 /**
  * Callback for checking if dijkstra was triggered during
- * rate limitation time
+ * rate limitation time. Changes during the hold time of
+ * a dijkstra double the next hold time (up to the maximum),
+ * a hold time without changes resets it.
  * @param unused
  */
 static void
 _cb_trigger_dijkstra(void *unused __attribute__((unused))) {
-  if (_trigger_dijkstra) {
-    _trigger_dijkstra = false;
-    olsrv2_routing_force_update(false);
+  uint64_t max_hold;
+
+  if (!_trigger_dijkstra) {
+    /* network is quiet again */
+    _spf_backoff = olsrv2_get_spf_secondary_wait();
+    _statistics.spf_backoff = _spf_backoff;
+    return;
+  }
+
+  if (_spf_holding) {
+    /* topology keeps changing, wait longer after this run */
+    max_hold = olsrv2_get_spf_max_hold();
+
+    _spf_backoff *= 2;
+    if (_spf_backoff > max_hold) {
+      _spf_backoff = max_hold;
+    }
+  }
+
+  _trigger_dijkstra = false;
+  olsrv2_routing_force_update(false);
+}
+
+/**
+ * @param domain nhdp domain
+ * @param neigh nhdp neighbor
+ * @return outgoing metric of the neighbor, infinite if the neighbor
+ *   has no link that could be used for routing
+ */
+static uint32_t
+_get_neighbor_cost(struct nhdp_domain *domain, struct nhdp_neighbor *neigh) {
+  struct nhdp_neighbor_domaindata *neighdata;
+
+  neighdata = nhdp_domain_get_neighbordata(domain, neigh);
+  if (neighdata->best_link == NULL) {
+    return RFC5444_METRIC_INFINITE;
+  }
+  return neighdata->metric.out;
+}
+
+/**
+ * Remember that the one-hop path to the tc node of a neighbor might
+ * have changed
+ * @param neigh nhdp neighbor
+ */
+static void
+_mark_neighbor_changed(struct nhdp_neighbor *neigh) {
+  struct olsrv2_tc_node *node;
+
+  node = olsrv2_tc_node_get_by_id(neigh->originator_id);
+  if (node != NULL) {
+    olsrv2_routing_target_changed(&node->target);
+  }
+}
+
+/**
+ * Check if the local originators changed since the last dijkstra run
+ * @return true if originators changed, false otherwise
+ */
+static bool
+_check_originators(void) {
+  const struct netaddr *v4, *v6;
+
+  v4 = olsrv2_originator_get(AF_INET);
+  v6 = olsrv2_originator_get(AF_INET6);
+
+  if (memcmp(v4, &_spt_originator_v4, sizeof(*v4)) == 0
+      && memcmp(v6, &_spt_originator_v6, sizeof(*v6)) == 0) {
+    return false;
+  }
+
+  memcpy(&_spt_originator_v4, v4, sizeof(*v4));
+  memcpy(&_spt_originator_v6, v6, sizeof(*v6));
+  return true;
+}
+
+/**
+ * Check if any nhdp neighbor selected a different best link since
+ * the last dijkstra run
+ * @return true if best links changed, false otherwise
+ */
+static bool
+_check_best_links(void) {
+  uint32_t generation;
+
+  generation = nhdp_domain_get_best_link_generation();
+  if (generation == _spt_best_link_generation) {
+    return false;
+  }
+
+  _spt_best_link_generation = generation;
+  return true;
+}
+
+/**
+ * Force a full dijkstra run for all domains and recalculate
+ * all routing entries
+ */
+static void
+_invalidate_all_trees(void) {
+  int i;
+
+  for (i=0; i<NHDP_MAXIMUM_DOMAINS; i++) {
+    _spf[i].valid = false;
+    _spf[i].refresh = true;
   }
 }
 
 /**
  * Callback triggered when neighbor metrics are updates
- * @param neigh
+ * @param neigh nhdp neighbor, NULL if all neighbors might have changed
  */
 static void
-_cb_nhdp_update(struct nhdp_neighbor *neigh __attribute__((unused))) {
+_cb_nhdp_update(struct nhdp_neighbor *neigh) {
+  if (neigh) {
+    _mark_neighbor_changed(neigh);
+  }
+  else {
+    list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
+      _mark_neighbor_changed(neigh);
+    }
+  }
   olsrv2_routing_trigger_update();
 }
 
+/**
+ * Callback triggered when the originator of a nhdp neighbor changes
+ * or the neighbor is removed. First hop pointers of the
+ * shortest path trees cannot be trusted anymore.
+ * @param ptr nhdp neighbor
+ */
+static void
+_cb_neigh_changed(void *ptr __attribute__((unused))) {
+  _invalidate_all_trees();
+}
+
+/**
+ * Callback triggered when a nhdp neighbor is removed. Routes through
+ * the neighbor are switched to their loop free alternate before
+ * the next dijkstra run recalculates them.
+ * @param ptr nhdp neighbor
+ */
+static void
+_cb_neigh_removed(void *ptr) {
+  struct olsrv2_routing_entry *rtentry;
+  struct _hop_routes *hop;
+  struct nhdp_neighbor *neigh;
+
+  neigh = ptr;
+
+  /*
+   * the hop is freed together with its last routing entry,
+   * so it must be looked up again after each change
+   */
+  while ((hop = avl_find_element(&_hop_tree, neigh, hop, _node)) != NULL
+      && !list_is_empty(&hop->lfa_hop)) {
+    /* alternate is not available anymore */
+    rtentry = list_first_element(&hop->lfa_hop, rtentry, _lfa_hop_node);
+    _set_lfa_hop(rtentry, NULL);
+    netaddr_invalidate(&rtentry->lfa.gw);
+  }
+
+  while ((hop = avl_find_element(&_hop_tree, neigh, hop, _node)) != NULL) {
+    rtentry = list_first_element(&hop->first_hop, rtentry, _first_hop_node);
+    if (!rtentry->set || rtentry->_lfa_hop == NULL || _initiate_shutdown) {
+      _set_first_hop(rtentry, NULL);
+      continue;
+    }
+
+    /* switch route to precalculated alternate */
+    rtentry->route.if_index = rtentry->lfa.if_index;
+    memcpy(&rtentry->route.gw, &rtentry->lfa.gw, sizeof(rtentry->route.gw));
+    _set_first_hop(rtentry, rtentry->_lfa_hop);
+    _set_lfa_hop(rtentry, NULL);
+    netaddr_invalidate(&rtentry->lfa.gw);
+
+    _add_route_to_kernel_queue(rtentry);
+
+    if (!rtentry->in_processing) {
+      /* repair routes before all other kernel changes */
+      list_remove(&rtentry->_working_node);
+      list_add_head(&_kernel_queue, &rtentry->_working_node);
+    }
+
+    _statistics.lfa_failovers++;
+  }
+
+  _process_kernel_queue();
+  _invalidate_all_trees();
+}
+
 /**
  * Callback for kernel route processing results
  * @param route pointer to kernel route
@@ -769,34 +3006,59 @@ _cb_route_finished(struct os_route *route, int error) {
 
   /* kernel is not processing this route anymore */
   rtentry->in_processing = false;
+  _statistics.kernel_in_flight--;
+
+  if (list_is_node_added(&rtentry->_working_node)) {
+    /* route changed while the kernel was busy, move it to the queue */
+    _add_route_to_kernel_queue(rtentry);
+  }
 
   if (error) {
     /* an error happened, try again later */
     if (error != -1) {
       /* do not display a os_routing_interrupt() caused error */
       OONF_WARN(LOG_OONFV2_ROUTING, "Error in route %s %s: %s (%d)",
-          rtentry->set ? "setting" : "removal",
+          rtentry->_sent_set ? "setting" : "removal",
               os_routing_to_string(&rbuf, &rtentry->route),
               strerror(error), error);
+      _statistics.kernel_errors++;
     }
 
-    /* revert attempted change */
-    if (rtentry->set) {
-      _remove_entry(rtentry);
+    /* revert attempted change, the next dijkstra run tries again */
+    if (rtentry->_sent_set) {
+      rtentry->set = false;
+      rtentry->_in_kernel = false;
     }
-    else {
+    else if (!rtentry->set) {
       rtentry->set = true;
     }
-    return;
+    _mark_entry(rtentry);
   }
-  if (rtentry->set) {
+  else if (rtentry->_sent_set) {
     /* route was set/updated successfully */
     OONF_INFO(LOG_OONFV2_ROUTING, "Successfully set route %s",
         os_routing_to_string(&rbuf, &rtentry->route));
+    rtentry->_in_kernel = true;
+
+    if (!rtentry->set && !list_is_node_added(&rtentry->_working_node)) {
+      /* route was removed while the kernel was processing it */
+      _add_route_to_kernel_queue(rtentry);
+    }
   }
   else {
     OONF_INFO(LOG_OONFV2_ROUTING, "Successfully removed route %s",
         os_routing_to_string(&rbuf, &rtentry->route));
-    _remove_entry(rtentry);
+    rtentry->_in_kernel = false;
+
+    if (!rtentry->set) {
+      _remove_entry(rtentry);
+    }
+    else if (!list_is_node_added(&rtentry->_working_node)) {
+      /* route was set again while the kernel was removing it */
+      _add_route_to_kernel_queue(rtentry);
+    }
   }
+
+  /* a slot of the kernel processing window is free again */
+  _process_kernel_queue();
 }
@@ -53,10 +53,21 @@
 #include "nhdp/nhdp_db.h"
 #include "nhdp/nhdp_domain.h"
 
+#ifdef OLSRV2_DIJKSTRA_HEAP
+#include "olsrv2/olsrv2_heap.h"
+#endif
+
+struct olsrv2_tc_node;
+struct olsrv2_tc_target;
+
 /* representation of a node in the dijkstra tree */
 struct olsrv2_dijkstra_node {
   /* hook into the working list of the dijkstra */
+#ifdef OLSRV2_DIJKSTRA_HEAP
+  struct olsrv2_heap_node _node;
+#else
   struct avl_node _node;
+#endif
 
   /* total path cost */
   uint32_t path_cost;
@@ -67,11 +78,41 @@ struct olsrv2_dijkstra_node {
   /* pointer to nhpd neighbor that represents the first hop */
   struct nhdp_neighbor *first_hop;
 
+  /*
+   * tc node this target was reached from in the shortest path tree,
+   * NULL if the target is reached directly through first_hop
+   */
+  struct olsrv2_tc_node *parent;
+
+  /* back pointer to tc target this dijkstra node belongs to */
+  struct olsrv2_tc_target *target;
+
   /* true if route is single-hop */
   bool single_hop;
 
   /* true if this node is ourself */
   bool local;
+
+  /* true if the path was invalidated or changed by the current run */
+  bool _affected;
+
+  /* path before the current run, only valid if _affected is set */
+  uint32_t _old_path_cost;
+  struct nhdp_neighbor *_old_first_hop;
+  uint8_t _old_distance;
+  bool _old_single_hop;
+
+  /* hook into list of nodes whose path was touched by the current run */
+  struct list_entity _affected_node;
+};
+
+/* next hop of a route */
+struct olsrv2_routing_nexthop {
+  /* interface index of next hop */
+  unsigned if_index;
+
+  /* address of next hop */
+  struct netaddr gw;
 };
 
 /* representation of one target in the routing entry set */
@@ -79,12 +120,26 @@ struct olsrv2_routing_entry {
   /* Settings for the kernel route */
   struct os_route route;
 
+  /* interned id of route.dst */
+  uint32_t dst_id;
+
   /* nhdp domain of route */
   struct nhdp_domain *domain;
 
   /* path cost to reach the target */
   uint32_t cost;
 
+  /* loop free alternate next hop, gw is AF_UNSPEC if there is none */
+  struct olsrv2_routing_nexthop lfa;
+
+  /* nhdp neighbors of the current first hop and the loop free alternate */
+  struct nhdp_neighbor *_first_hop;
+  struct nhdp_neighbor *_lfa_hop;
+
+  /* hooks into the lists of entries using a neighbor as a hop */
+  struct list_entity _first_hop_node;
+  struct list_entity _lfa_hop_node;
+
   /*
    * true if the entry represents a route that should be in the kernel,
    * false if the entry should be removed from the kernel
@@ -94,14 +149,41 @@ struct olsrv2_routing_entry {
   /* true if this route is being processed by the kernel at the moment */
   bool in_processing;
 
+  /* true if the last kernel operation of this route was setting it */
+  bool _sent_set;
+
+  /* true if the route has been set successfully in the kernel */
+  bool _in_kernel;
+
   /* forwarding information before the current dijkstra run */
   unsigned _old_if_index;
   struct netaddr _old_next_hop;
   uint8_t _old_distance;
+  bool _old_set;
+
+  /* best route of the neighborhood, only valid if _nhdp_stamp is current */
+  uint32_t _nhdp_cost;
+  struct nhdp_neighbor *_nhdp_hop;
+  bool _nhdp_single_hop;
+
+  /* number of the last dijkstra run that found a neighborhood route */
+  uint32_t _nhdp_stamp;
+
+  /* number of the last dijkstra run that updated this entry */
+  uint32_t _stamp;
 
   /* hook into working queues */
   struct list_entity _working_node;
 
+  /* hook into journal of entries changed by the current dijkstra run */
+  struct list_entity _journal_node;
+
+  /* hook into list of domain entries to recalculate after the next run */
+  struct list_entity _refresh_node;
+
+  /* hook into list of domain entries with a neighborhood route */
+  struct list_entity _nhdp_node;
+
   /* global node */
   struct avl_node _node;
 };
@@ -119,23 +201,86 @@ struct olsrv2_routing_domain {
 
   /* metric value that should be used for routes */
   int distance;
+
+  /* true if loop free alternates should be calculated */
+  bool use_lfa;
+};
+
+/* statistics of the dijkstra and routing code */
+struct olsrv2_routing_statistics {
+  /* number of dijkstra runs */
+  uint32_t spf_runs;
+
+  /* number of triggers delayed by the hold time of the last run */
+  uint32_t spf_deferred;
+
+  /* current hold time after a dijkstra run */
+  uint64_t spf_backoff;
+
+  /* number of received TCs that did not trigger a dijkstra run */
+  uint32_t spf_avoided;
+
+  /* number of routes waiting for the kernel processing window */
+  uint32_t kernel_queued;
+
+  /* number of routes in kernel processing */
+  uint32_t kernel_in_flight;
+
+  /* number of routes the kernel failed to set or remove */
+  uint32_t kernel_errors;
+
+  /* number of routing entries updated by the last dijkstra run */
+  uint32_t routes_touched;
+
+  /* number of routing entries checked for changes by the last run */
+  uint32_t routes_scanned;
+
+  /* number of routing entries changed by the last run */
+  uint32_t routes_changed;
+
+  /* number of routes with a loop free alternate next hop */
+  uint32_t lfa_routes;
+
+  /* number of routes switched to their loop free alternate */
+  uint32_t lfa_failovers;
 };
 
 EXPORT extern struct avl_tree olsrv2_routing_tree[NHDP_MAXIMUM_DOMAINS];
 
 void olsrv2_routing_init(void);
-void olsrv2_routing_initiate_shutdown(void);
+void olsrv2_routing_initiate_shutdown(bool keep_routes);
 void olsrv2_routing_cleanup(void);
 
-void olsrv2_routing_dijkstra_node_init(struct olsrv2_dijkstra_node *);
+int olsrv2_routing_target_init(struct olsrv2_tc_target *);
+void olsrv2_routing_target_changed(struct olsrv2_tc_target *);
+void olsrv2_routing_target_remove(struct olsrv2_tc_target *);
+void olsrv2_routing_edge_removed(
+    struct olsrv2_tc_node *src, struct olsrv2_tc_target *dst);
 
 EXPORT void olsrv2_routing_set_domain_parameter(struct nhdp_domain *domain,
     struct olsrv2_routing_domain *parameter);
 
 EXPORT void olsrv2_routing_force_update(bool skip_wait);
 EXPORT void olsrv2_routing_trigger_update(void);
+EXPORT uint32_t olsrv2_routing_get_topology_generation(void);
+EXPORT void olsrv2_routing_trigger_topology_update(uint32_t generation);
+EXPORT int olsrv2_routing_restore_route(struct nhdp_domain *domain,
+    const struct os_route *route, uint32_t cost);
+EXPORT void olsrv2_routing_set_restart_hold(bool hold);
+
+EXPORT const struct olsrv2_routing_statistics *
+    olsrv2_routing_get_statistics(void);
 
 EXPORT const struct olsrv2_routing_domain *
     olsrv2_routing_get_parameters(struct nhdp_domain *);
 
+/**
+ * @param rtentry pointer to routing entry
+ * @return true if the route of the entry has been set in the kernel
+ */
+static INLINE bool
+olsrv2_routing_is_in_kernel(const struct olsrv2_routing_entry *rtentry) {
+  return rtentry->_in_kernel;
+}
+
 #endif /* OONFV2_ROUTING_SET_H_ */
@@ -0,0 +1,228 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#include <stdlib.h>
+
+#include "common/avl.h"
+#include "common/common_types.h"
+
+#include "nhdp/nhdp_domain.h"
+
+#include "olsrv2/olsrv2_spf_graph.h"
+#include "olsrv2/olsrv2_tc.h"
+
+static int _resize(struct olsrv2_spf_graph *, uint32_t targets,
+    uint32_t links, size_t domains);
+
+/**
+ * Initialize an empty topology snapshot
+ * @param graph pointer to topology snapshot
+ */
+void
+olsrv2_spf_graph_init(struct olsrv2_spf_graph *graph) {
+  memset(graph, 0, sizeof(*graph));
+}
+
+/**
+ * Release all memory of a topology snapshot
+ * @param graph pointer to topology snapshot
+ */
+void
+olsrv2_spf_graph_free(struct olsrv2_spf_graph *graph) {
+  free(graph->targets);
+  free(graph->link_start);
+  free(graph->link_dst);
+  free(graph->link_cost);
+  free(graph->link_distance);
+
+  olsrv2_spf_graph_init(graph);
+}
+
+/**
+ * Rebuild a topology snapshot from the tc database if the
+ * topology generation changed since it was created.
+ * @param graph pointer to topology snapshot
+ * @param generation current topology generation
+ * @return -1 if an error happened, 0 otherwise
+ */
+int
+olsrv2_spf_graph_update(struct olsrv2_spf_graph *graph, uint32_t generation) {
+  struct olsrv2_tc_endpoint *end;
+  struct olsrv2_tc_attachment *net;
+  struct olsrv2_tc_edge *edge;
+  struct olsrv2_tc_node *node;
+  uint32_t idx, link, links;
+  size_t domains, d;
+
+  domains = nhdp_domain_get_count();
+  if (olsrv2_spf_graph_is_current(graph, generation)
+      && graph->domain_count == domains) {
+    /* nothing changed */
+    return 0;
+  }
+
+  graph->valid = false;
+
+  /* count links */
+  links = 0;
+  avl_for_each_element(&olsrv2_tc_tree, node, _originator_node) {
+    links += node->_edges.count + node->_endpoints.count;
+  }
+
+  if (_resize(graph, olsrv2_tc_tree.count + olsrv2_tc_endpoint_tree.count,
+      links, domains)) {
+    return -1;
+  }
+
+  /* number all targets, tc nodes first */
+  idx = 0;
+  avl_for_each_element(&olsrv2_tc_tree, node, _originator_node) {
+    node->target._graph_index = idx;
+    graph->targets[idx++] = &node->target;
+  }
+  graph->node_count = idx;
+
+  avl_for_each_element(&olsrv2_tc_endpoint_tree, end, _node) {
+    end->target._graph_index = idx;
+    graph->targets[idx++] = &end->target;
+  }
+  graph->target_count = idx;
+
+  /* copy links, same order as the tc database */
+  link = 0;
+  for (idx = 0; idx < graph->node_count; idx++) {
+    node = container_of(graph->targets[idx], struct olsrv2_tc_node, target);
+    graph->link_start[idx] = link;
+
+    avl_for_each_element(&node->_edges, edge, _node) {
+      graph->link_dst[link] = edge->dst->target._graph_index;
+      for (d = 0; d < domains; d++) {
+        graph->link_cost[d * graph->_link_size + link] =
+            olsrv2_tc_edge_get_cost(edge, d);
+        graph->link_distance[d * graph->_link_size + link] = 0;
+      }
+      link++;
+    }
+
+    avl_for_each_element(&node->_endpoints, net, _src_node) {
+      graph->link_dst[link] = net->dst->target._graph_index;
+      for (d = 0; d < domains; d++) {
+        graph->link_cost[d * graph->_link_size + link] =
+            olsrv2_tc_endpoint_get_cost(net, d);
+        graph->link_distance[d * graph->_link_size + link] =
+            olsrv2_tc_endpoint_get_distance(net, d);
+      }
+      link++;
+    }
+  }
+  graph->link_start[graph->node_count] = link;
+  graph->link_count = link;
+
+  graph->generation = generation;
+  graph->domain_count = domains;
+  graph->valid = true;
+  return 0;
+}
+
+/**
+ * Make sure the arrays of a topology snapshot are large enough.
+ * Arrays grow with some additional space to reduce the number
+ * of reallocations while the topology is growing.
+ * @param graph pointer to topology snapshot
+ * @param targets number of targets
+ * @param links number of links
+ * @param domains number of domains
+ * @return -1 if out of memory, 0 otherwise
+ */
+static int
+_resize(struct olsrv2_spf_graph *graph, uint32_t targets,
+    uint32_t links, size_t domains) {
+  void *ptr;
+
+  if (targets > graph->_target_size) {
+    targets += targets / 4;
+
+    ptr = realloc(graph->targets, targets * sizeof(*graph->targets));
+    if (ptr == NULL) {
+      return -1;
+    }
+    graph->targets = ptr;
+
+    ptr = realloc(graph->link_start, (targets + 1) * sizeof(*graph->link_start));
+    if (ptr == NULL) {
+      return -1;
+    }
+    graph->link_start = ptr;
+    graph->_target_size = targets;
+  }
+
+  if (links <= graph->_link_size && domains == graph->domain_count) {
+    return 0;
+  }
+
+  /* cost columns must be relocated, so the size is only set at the end */
+  links += links / 4 + 1;
+  if (domains == 0) {
+    domains = 1;
+  }
+
+  ptr = realloc(graph->link_dst, links * sizeof(*graph->link_dst));
+  if (ptr == NULL) {
+    return -1;
+  }
+  graph->link_dst = ptr;
+
+  ptr = realloc(graph->link_cost, links * domains * sizeof(*graph->link_cost));
+  if (ptr == NULL) {
+    return -1;
+  }
+  graph->link_cost = ptr;
+
+  ptr = realloc(graph->link_distance,
+      links * domains * sizeof(*graph->link_distance));
+  if (ptr == NULL) {
+    return -1;
+  }
+  graph->link_distance = ptr;
+
+  graph->_link_size = links;
+  return 0;
+}
@@ -0,0 +1,130 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#ifndef OLSRV2_SPF_GRAPH_H_
+#define OLSRV2_SPF_GRAPH_H_
+
+#include "common/common_types.h"
+
+#include "olsrv2/olsrv2_tc.h"
+
+/*
+ * Read-only snapshot of the tc database in compressed sparse row
+ * format. Tc nodes get the indices 0 to node_count-1, endpoints
+ * are stored behind them. The links of tc node i are stored
+ * in the link arrays from link_start[i] to link_start[i+1]-1.
+ */
+struct olsrv2_spf_graph {
+  /* topology generation this snapshot was created from */
+  uint32_t generation;
+
+  /* number of domains with cost columns */
+  size_t domain_count;
+
+  /* true if snapshot contains valid data */
+  bool valid;
+
+  /* number of tc nodes */
+  uint32_t node_count;
+
+  /* number of tc nodes and endpoints */
+  uint32_t target_count;
+
+  /* number of links (edges and attachments) */
+  uint32_t link_count;
+
+  /* tc target for each index */
+  struct olsrv2_tc_target **targets;
+
+  /* index of first link of each tc node, node_count+1 entries */
+  uint32_t *link_start;
+
+  /* target index of the destination of each link */
+  uint32_t *link_dst;
+
+  /* link costs, one column of link_count entries per domain */
+  uint32_t *link_cost;
+
+  /* hopcount distance of links, one column per domain */
+  uint8_t *link_distance;
+
+  /* number of allocated targets and links */
+  uint32_t _target_size, _link_size;
+};
+
+void olsrv2_spf_graph_init(struct olsrv2_spf_graph *);
+void olsrv2_spf_graph_free(struct olsrv2_spf_graph *);
+int olsrv2_spf_graph_update(struct olsrv2_spf_graph *, uint32_t generation);
+
+/**
+ * @param graph pointer to topology snapshot
+ * @param generation current topology generation
+ * @return true if snapshot represents the current tc database
+ */
+static INLINE bool
+olsrv2_spf_graph_is_current(struct olsrv2_spf_graph *graph,
+    uint32_t generation) {
+  return graph->valid && graph->generation == generation;
+}
+
+/**
+ * @param graph pointer to topology snapshot
+ * @param domain_index index of nhdp domain
+ * @return pointer to link cost column of domain
+ */
+static INLINE const uint32_t *
+olsrv2_spf_graph_get_costs(struct olsrv2_spf_graph *graph,
+    int domain_index) {
+  return &graph->link_cost[(size_t)domain_index * graph->_link_size];
+}
+
+/**
+ * @param graph pointer to topology snapshot
+ * @param domain_index index of nhdp domain
+ * @return pointer to link distance column of domain
+ */
+static INLINE const uint8_t *
+olsrv2_spf_graph_get_distances(struct olsrv2_spf_graph *graph,
+    int domain_index) {
+  return &graph->link_distance[(size_t)domain_index * graph->_link_size];
+}
+
+#endif /* OLSRV2_SPF_GRAPH_H_ */
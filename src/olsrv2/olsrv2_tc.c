@@ -39,23 +39,84 @@
  *
  */
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "common/avl.h"
 #include "common/avl_comp.h"
 #include "common/common_types.h"
+#include "common/container_of.h"
 #include "common/netaddr.h"
 #include "rfc5444/rfc5444.h"
+#include "core/oonf_logging.h"
 #include "subsystems/oonf_class.h"
-#include "subsystems/oonf_timer.h"
 
+#include "nhdp/nhdp_addr_id.h"
 #include "nhdp/nhdp_domain.h"
 #include "nhdp/nhdp.h"
+#include "nhdp/nhdp_timer_wheel.h"
 
+#include "olsrv2/olsrv2.h"
 #include "olsrv2/olsrv2_routing.h"
 #include "olsrv2/olsrv2_tc.h"
 
+/* number of edge pairs allocated together in one slab */
+#define OLSRV2_TC_EDGE_SLAB_SIZE 64
+
+/* smallest number of entries of a non-empty target index */
+#define OLSRV2_TC_INDEX_MIN_SIZE 64
+
+struct _tc_edge_slab;
+
+/* a tc edge and its inverse, allocated as one unit */
+struct _tc_edge_pair {
+  /* edge which was added first */
+  struct olsrv2_tc_edge edge;
+
+  /* inverse of the first edge */
+  struct olsrv2_tc_edge inverse;
+
+  /* slab this pair belongs to */
+  struct _tc_edge_slab *slab;
+
+  /* hook into list of unused edge pairs */
+  struct list_entity _free_node;
+};
+
+/* block of edge pairs allocated with a single memory allocation */
+struct _tc_edge_slab {
+  /* number of edge pairs in use */
+  uint32_t used;
+
+  /* hook into list of slabs */
+  struct list_entity _node;
+
+  /* edge pairs of slab */
+  struct _tc_edge_pair pairs[OLSRV2_TC_EDGE_SLAB_SIZE];
+};
+
+/* tc targets indexed by the interned id of their address */
+struct _tc_target_index {
+  /* array of targets, NULL if no target has the id */
+  struct olsrv2_tc_target **targets;
+
+  /* number of entries of the array */
+  uint32_t size;
+};
+
 /* prototypes */
 static void _cb_tc_node_timeout(void *);
+static void _cb_fragment_timeout(void *);
+static void _remove_stale_entries(struct olsrv2_tc_node *node);
 static bool _remove_edge(struct olsrv2_tc_edge *edge, bool cleanup);
+static struct _tc_edge_pair *_alloc_edge_pair(void);
+static void _free_edge_pair(struct olsrv2_tc_edge *edge);
+static int _alloc_cost_row(struct olsrv2_cost_table *, uint32_t *row);
+static int _index_add(struct _tc_target_index *, struct olsrv2_tc_target *);
+static void _index_remove(struct _tc_target_index *, struct olsrv2_tc_target *);
+static void _index_cleanup(struct _tc_target_index *);
+static struct olsrv2_tc_target *_index_get(
+    const struct _tc_target_index *, uint32_t id);
 
 /* classes for topology data */
 static struct oonf_class _tc_node_class = {
@@ -63,11 +124,21 @@ static struct oonf_class _tc_node_class = {
   .size = sizeof(struct olsrv2_tc_node),
 };
 
+/*
+ * edges are allocated in pairs from slabs, this class is only used
+ * for events. The pairs have no room for extension data, so edges
+ * cannot be allocated once an extension with a size is registered.
+ */
 static struct oonf_class _tc_edge_class = {
   .name = "olsrv2 tc edge",
   .size = sizeof(struct olsrv2_tc_edge),
 };
 
+static struct oonf_class _tc_edge_slab_class = {
+  .name = "olsrv2 tc edge slab",
+  .size = sizeof(struct _tc_edge_slab),
+};
+
 static struct oonf_class _tc_attached_class = {
   .name = "olsrv2 tc attached network",
   .size = sizeof(struct olsrv2_tc_attachment),
@@ -79,15 +150,36 @@ static struct oonf_class _tc_endpoint_class = {
 };
 
 /* validity timer for tc nodes */
-static struct oonf_timer_info _validity_info = {
+static struct nhdp_timer_info _validity_info = {
   .name = "olsrv2 tc node validity",
   .callback = _cb_tc_node_timeout,
 };
 
+/* timer for answer sets received in multiple tc messages */
+static struct nhdp_timer_info _fragment_info = {
+  .name = "olsrv2 tc fragment hold",
+  .callback = _cb_fragment_timeout,
+};
+
 /* global trees for tc nodes and endpoints */
 struct avl_tree olsrv2_tc_tree;
 struct avl_tree olsrv2_tc_endpoint_tree;
 
+/* link costs of tc edges and attachments, one column per domain */
+struct olsrv2_cost_table olsrv2_tc_edge_costs;
+struct olsrv2_cost_table olsrv2_tc_attachment_costs;
+
+/* indices for lookups of tc nodes and endpoints by address id */
+static struct _tc_target_index _tc_node_index;
+static struct _tc_target_index _tc_endpoint_index;
+
+/* slabs of tc edge pairs and list of unused pairs */
+static struct list_entity _edge_slabs;
+static struct list_entity _free_edge_pairs;
+
+/* statistics of the tc edge allocator */
+static struct olsrv2_tc_statistics _stats;
+
 /**
  * Initialize tc database
  */
@@ -95,11 +187,19 @@ void
 olsrv2_tc_init(void) {
   oonf_class_add(&_tc_node_class);
   oonf_class_add(&_tc_edge_class);
+  oonf_class_add(&_tc_edge_slab_class);
   oonf_class_add(&_tc_attached_class);
   oonf_class_add(&_tc_endpoint_class);
+  nhdp_timer_add(&_validity_info);
+  nhdp_timer_add(&_fragment_info);
 
   avl_init(&olsrv2_tc_tree, avl_comp_netaddr, false);
   avl_init(&olsrv2_tc_endpoint_tree, avl_comp_netaddr, true);
+  olsrv2_cost_table_init(&olsrv2_tc_edge_costs, false);
+  olsrv2_cost_table_init(&olsrv2_tc_attachment_costs, true);
+
+  list_init_head(&_edge_slabs);
+  list_init_head(&_free_edge_pairs);
 }
 
 /**
@@ -108,65 +208,113 @@ olsrv2_tc_init(void) {
 void
 olsrv2_tc_cleanup(void) {
   struct olsrv2_tc_node *node, *n_it;
-  struct olsrv2_tc_edge *edge, *e_it;
+  struct olsrv2_tc_edge *edge;
   struct olsrv2_tc_attachment *a_end, *ae_it;
+  struct _tc_edge_slab *slab, *s_it;
 
+  /* announce all edges while both of their nodes still exist */
   avl_for_each_element(&olsrv2_tc_tree, node, _originator_node) {
-    avl_for_each_element_safe(&node->_edges, edge, _node, e_it) {
-      /* remove edge without cleaning up the node */
-      _remove_edge(edge, false);
+    avl_for_each_element(&node->_edges, edge, _node) {
+      if (!edge->virtual) {
+        oonf_class_event(&_tc_edge_class, edge, OONF_OBJECT_REMOVED);
+      }
     }
+  }
 
+  avl_for_each_element_safe(&olsrv2_tc_tree, node, _originator_node, n_it) {
     avl_for_each_element_safe(&node->_endpoints, a_end, _src_node, ae_it) {
       olsrv2_tc_endpoint_remove(a_end);
     }
+
+    /*
+     * the edges of the node are not unhooked one by one,
+     * they are released together with their slabs
+     */
+    oonf_class_event(&_tc_node_class, node, OONF_OBJECT_REMOVED);
+    nhdp_timer_stop(&node->_validity_time);
+    nhdp_timer_stop(&node->_fragment_time);
+
+    olsrv2_routing_target_remove(&node->target);
+    avl_remove(&olsrv2_tc_tree, &node->_originator_node);
+    nhdp_addr_id_release(node->target.addr_id);
+    oonf_class_free(&_tc_node_class, node);
   }
 
-  avl_for_each_element_safe(&olsrv2_tc_tree, node, _originator_node, n_it) {
-    olsrv2_tc_node_remove(node);
+  /* release all edge slabs and the edge cost rows at once */
+  list_for_each_element_safe(&_edge_slabs, slab, _node, s_it) {
+    list_remove(&slab->_node);
+    oonf_class_free(&_tc_edge_slab_class, slab);
   }
+  list_init_head(&_free_edge_pairs);
+  memset(&_stats, 0, sizeof(_stats));
 
+  olsrv2_cost_table_cleanup(&olsrv2_tc_attachment_costs);
+  olsrv2_cost_table_cleanup(&olsrv2_tc_edge_costs);
+  _index_cleanup(&_tc_endpoint_index);
+  _index_cleanup(&_tc_node_index);
+
+  nhdp_timer_remove(&_fragment_info);
+  nhdp_timer_remove(&_validity_info);
   oonf_class_remove(&_tc_endpoint_class);
   oonf_class_remove(&_tc_attached_class);
+  oonf_class_remove(&_tc_edge_slab_class);
   oonf_class_remove(&_tc_edge_class);
   oonf_class_remove(&_tc_node_class);
 }
 
 /**
- * Add a new tc node to the database
+ * Add a new tc node to the database. The validity time is only set
+ * for new and virtual nodes, the validity of an existing node is
+ * refreshed by the caller when its tc message has been accepted.
  * @param originator originator address of node
- * @param vtime validity time for node entry
+ * @param vtime validity time for new node entry
  * @param ansn answer set number of node
  * @return pointer to node, NULL if out of memory
  */
 struct olsrv2_tc_node *
-olsrv2_tc_node_add(struct netaddr *originator,
+olsrv2_tc_node_add(const struct netaddr *originator,
     uint64_t vtime, uint16_t ansn) {
   struct olsrv2_tc_node *node;
 
-  node = avl_find_element(
-      &olsrv2_tc_tree, originator, node, _originator_node);
+  node = olsrv2_tc_node_get(originator);
   if (!node) {
     node = oonf_class_malloc(&_tc_node_class);
     if (node == NULL) {
       return NULL;
     }
 
-    /* copy key and attach it to node */
-    memcpy(&node->target.addr, originator, sizeof(*originator));
-    node->_originator_node.key = &node->target.addr;
+    /* intern key and attach it to node */
+    node->target.addr_id = nhdp_addr_id_acquire(originator);
+    if (node->target.addr_id == NHDP_ADDR_ID_NONE) {
+      oonf_class_free(&_tc_node_class, node);
+      return NULL;
+    }
+    node->_originator_node.key = nhdp_addr_id_get_netaddr(node->target.addr_id);
+
+    if (_index_add(&_tc_node_index, &node->target)) {
+      nhdp_addr_id_release(node->target.addr_id);
+      oonf_class_free(&_tc_node_class, node);
+      return NULL;
+    }
 
     /* initialize node */
-    avl_init(&node->_edges, avl_comp_netaddr, false);
-    avl_init(&node->_endpoints, avl_comp_netaddr, false);
+    avl_init(&node->_edges, avl_comp_uint32, false);
+    avl_init(&node->_endpoints, avl_comp_uint32, false);
 
     node->_validity_time.info = &_validity_info;
     node->_validity_time.cb_context = node;
+    node->_fragment_time.info = &_fragment_info;
+    node->_fragment_time.cb_context = node;
 
     node->ansn = ansn;
 
     /* initialize dijkstra data */
-    olsrv2_routing_dijkstra_node_init(&node->target._dijkstra);
+    if (olsrv2_routing_target_init(&node->target)) {
+      _index_remove(&_tc_node_index, &node->target);
+      nhdp_addr_id_release(node->target.addr_id);
+      oonf_class_free(&_tc_node_class, node);
+      return NULL;
+    }
 
     /* hook into global tree */
     avl_insert(&olsrv2_tc_tree, &node->_originator_node);
@@ -174,14 +322,18 @@ olsrv2_tc_node_add(struct netaddr *originator,
     /* fire event */
     oonf_class_event(&_tc_node_class, node, OONF_OBJECT_ADDED);
   }
-  else if (!oonf_timer_is_active(&node->_validity_time)) {
+  else if (nhdp_timer_is_active(&node->_validity_time)) {
+    /* existing node */
+    return node;
+  }
+  else {
     /* node was virtual */
     node->ansn = ansn;
 
     /* fire event */
     oonf_class_event(&_tc_node_class, node, OONF_OBJECT_ADDED);
   }
-  oonf_timer_set(&node->_validity_time, vtime);
+  nhdp_timer_set(&node->_validity_time, vtime);
   return node;
 }
 
@@ -208,16 +360,81 @@ olsrv2_tc_node_remove(struct olsrv2_tc_node *node) {
     olsrv2_tc_endpoint_remove(net);
   }
 
-  /* stop validity timer */
-  oonf_timer_stop(&node->_validity_time);
+  /* stop timers */
+  nhdp_timer_stop(&node->_validity_time);
+  nhdp_timer_stop(&node->_fragment_time);
+
+  /* a virtual node has no answer set */
+  node->content_hash = 0;
 
   /* remove from global tree and free memory if node is not needed anymore*/
   if (node->_edges.count == 0) {
+    olsrv2_routing_target_remove(&node->target);
     avl_remove(&olsrv2_tc_tree, &node->_originator_node);
+    _index_remove(&_tc_node_index, &node->target);
+    nhdp_addr_id_release(node->target.addr_id);
     oonf_class_free(&_tc_node_class, node);
   }
 }
 
+/**
+ * Mark the current answer set of a tc node as complete and remove
+ * all edges and endpoints of older answer sets
+ * @param node pointer to tc node
+ * @param content_hash hash over the address blocks of the tc message,
+ *   0 if unknown
+ */
+void
+olsrv2_tc_node_set_complete(struct olsrv2_tc_node *node,
+    uint32_t content_hash) {
+  nhdp_timer_stop(&node->_fragment_time);
+  _remove_stale_entries(node);
+
+  node->content_hash = content_hash;
+}
+
+/**
+ * Register an incomplete tc message of a tc node. Edges and endpoints
+ * of older answer sets are kept until the hold time after the first
+ * fragment of the current answer set, so the fragments can replace
+ * them one by one.
+ * @param node pointer to tc node
+ * @param new_set true if the fragment started a new answer set
+ * @param hold_time time to wait for the other fragments of the set
+ */
+void
+olsrv2_tc_node_add_fragment(struct olsrv2_tc_node *node,
+    bool new_set, uint64_t hold_time) {
+  _stats.tc_fragments++;
+
+  /* the stored answer set is now spread over multiple messages */
+  node->content_hash = 0;
+
+  if (new_set) {
+    nhdp_timer_set(&node->_fragment_time, hold_time);
+  }
+}
+
+/**
+ * Check if a complete tc message with the current ANSN of a node
+ * carried the same content as the one which set the answer set.
+ * If not, the content hash is cleared and the tc message has to be
+ * processed completely.
+ * @param node pointer to tc node
+ * @param content_hash hash over the address blocks of the tc message
+ * @return true if the message only refreshed the stored answer set
+ */
+bool
+olsrv2_tc_node_refresh(struct olsrv2_tc_node *node, uint32_t content_hash) {
+  if (node->content_hash == 0 || node->content_hash != content_hash) {
+    node->content_hash = 0;
+    return false;
+  }
+
+  _stats.tc_refreshes++;
+  return true;
+}
+
 /**
  * Add a tc edge to the database
  * @param src pointer to source node
@@ -225,12 +442,15 @@ olsrv2_tc_node_remove(struct olsrv2_tc_node *node) {
  * @return pointer to TC edge, NULL if out of memory
  */
 struct olsrv2_tc_edge *
-olsrv2_tc_edge_add(struct olsrv2_tc_node *src, struct netaddr *addr) {
+olsrv2_tc_edge_add(struct olsrv2_tc_node *src, const struct netaddr *addr) {
   struct olsrv2_tc_edge *edge = NULL, *inverse = NULL;
   struct olsrv2_tc_node *dst = NULL;
-  int i;
+  struct _tc_edge_pair *pair;
 
-  edge = avl_find_element(&src->_edges, addr, edge, _node);
+  dst = olsrv2_tc_node_get(addr);
+  if (dst != NULL) {
+    edge = olsrv2_tc_edge_get(src, dst);
+  }
   if (edge != NULL) {
     edge->virtual = false;
 
@@ -239,27 +459,33 @@ olsrv2_tc_edge_add(struct olsrv2_tc_node *src, struct netaddr *addr) {
     return edge;
   }
 
-  /* allocate edge */
-  edge = oonf_class_malloc(&_tc_edge_class);
-  if (edge == NULL) {
+  /* allocate edge and inverse edge */
+  pair = _alloc_edge_pair();
+  if (pair == NULL) {
     return NULL;
   }
+  edge = &pair->edge;
+  inverse = &pair->inverse;
 
-  /* allocate inverse edge */
-  inverse = oonf_class_malloc(&_tc_edge_class);
-  if (inverse == NULL) {
-    oonf_class_free(&_tc_edge_class, edge);
+  /* allocate link costs for both directions */
+  if (_alloc_cost_row(&olsrv2_tc_edge_costs, &edge->_cost_index)) {
+    _free_edge_pair(edge);
+    return NULL;
+  }
+  if (_alloc_cost_row(&olsrv2_tc_edge_costs, &inverse->_cost_index)) {
+    olsrv2_cost_table_free_row(&olsrv2_tc_edge_costs, edge->_cost_index);
+    _free_edge_pair(edge);
     return NULL;
   }
 
-  /* find or allocate destination node */
-  dst = avl_find_element(&olsrv2_tc_tree, addr, dst, _originator_node);
+  /* allocate destination node if necessary */
   if (dst == NULL) {
     /* create virtual node */
     dst = olsrv2_tc_node_add(addr, 0, 0);
     if (dst == NULL) {
-      oonf_class_free(&_tc_edge_class, edge);
-      oonf_class_free(&_tc_edge_class, inverse);
+      olsrv2_cost_table_free_row(&olsrv2_tc_edge_costs, edge->_cost_index);
+      olsrv2_cost_table_free_row(&olsrv2_tc_edge_costs, inverse->_cost_index);
+      _free_edge_pair(edge);
       return NULL;
     }
   }
@@ -268,12 +494,9 @@ olsrv2_tc_edge_add(struct olsrv2_tc_node *src, struct netaddr *addr) {
   edge->src = src;
   edge->dst = dst;
   edge->inverse = inverse;
-  for (i=0; i<NHDP_MAXIMUM_DOMAINS; i++) {
-    edge->cost[i] = RFC5444_METRIC_INFINITE;
-  }
 
   /* hook edge into src node */
-  edge->_node.key = &dst->target.addr;
+  edge->_node.key = &dst->target.addr_id;
   avl_insert(&src->_edges, &edge->_node);
 
   /* initialize inverse (virtual) edge */
@@ -281,12 +504,9 @@ olsrv2_tc_edge_add(struct olsrv2_tc_node *src, struct netaddr *addr) {
   inverse->dst = src;
   inverse->inverse = edge;
   inverse->virtual = true;
-  for (i=0; i<NHDP_MAXIMUM_DOMAINS; i++) {
-    inverse->cost[i] = RFC5444_METRIC_INFINITE;
-  }
 
   /* hook inverse edge into dst node */
-  inverse->_node.key = &src->target.addr;
+  inverse->_node.key = &src->target.addr_id;
   avl_insert(&dst->_edges, &inverse->_node);
 
   /* fire event */
@@ -317,11 +537,13 @@ olsrv2_tc_endpoint_add(struct olsrv2_tc_node *node,
     struct netaddr *prefix, bool mesh) {
   struct olsrv2_tc_attachment *net;
   struct olsrv2_tc_endpoint *end;
-  int i;
 
-  net = avl_find_element(&node->_endpoints, prefix, net, _src_node);
-  if (net != NULL) {
-    return net;
+  end = olsrv2_tc_endpoint_get(prefix);
+  if (end != NULL) {
+    net = avl_find_element(&node->_endpoints, &end->target.addr_id, net, _src_node);
+    if (net != NULL) {
+      return net;
+    }
   }
 
   net = oonf_class_malloc(&_tc_attached_class);
@@ -329,22 +551,51 @@ olsrv2_tc_endpoint_add(struct olsrv2_tc_node *node,
     return NULL;
   }
 
-  end = avl_find_element(&olsrv2_tc_endpoint_tree, prefix, end, _node);
+  if (_alloc_cost_row(&olsrv2_tc_attachment_costs, &net->_cost_index)) {
+    oonf_class_free(&_tc_attached_class, net);
+    return NULL;
+  }
+
   if (end == NULL) {
     /* create new endpoint */
     end = oonf_class_malloc(&_tc_endpoint_class);
     if (end == NULL) {
+      olsrv2_cost_table_free_row(&olsrv2_tc_attachment_costs, net->_cost_index);
+      oonf_class_free(&_tc_attached_class, net);
+      return NULL;
+    }
+
+    end->target.addr_id = nhdp_addr_id_acquire(prefix);
+    if (end->target.addr_id == NHDP_ADDR_ID_NONE) {
+      oonf_class_free(&_tc_endpoint_class, end);
+      olsrv2_cost_table_free_row(&olsrv2_tc_attachment_costs, net->_cost_index);
+      oonf_class_free(&_tc_attached_class, net);
+      return NULL;
+    }
+    if (_index_add(&_tc_endpoint_index, &end->target)) {
+      nhdp_addr_id_release(end->target.addr_id);
+      oonf_class_free(&_tc_endpoint_class, end);
+      olsrv2_cost_table_free_row(&olsrv2_tc_attachment_costs, net->_cost_index);
       oonf_class_free(&_tc_attached_class, net);
       return NULL;
     }
 
     /* initialize endpoint */
     end->target.type = mesh ? OONFV2_ADDRESS_TARGET : OONFV2_NETWORK_TARGET;
-    avl_init(&end->_attached_networks, avl_comp_netaddr, false);
+    avl_init(&end->_attached_networks, avl_comp_uint32, false);
+
+    /* initialize dijkstra data */
+    if (olsrv2_routing_target_init(&end->target)) {
+      _index_remove(&_tc_endpoint_index, &end->target);
+      nhdp_addr_id_release(end->target.addr_id);
+      oonf_class_free(&_tc_endpoint_class, end);
+      olsrv2_cost_table_free_row(&olsrv2_tc_attachment_costs, net->_cost_index);
+      oonf_class_free(&_tc_attached_class, net);
+      return NULL;
+    }
 
     /* attach to global tree */
-    memcpy(&end->target.addr, prefix, sizeof(*prefix));
-    end->_node.key = &end->target.addr;
+    end->_node.key = nhdp_addr_id_get_netaddr(end->target.addr_id);
     avl_insert(&olsrv2_tc_endpoint_tree, &end->_node);
 
     oonf_class_event(&_tc_endpoint_class, end, OONF_OBJECT_ADDED);
@@ -353,21 +604,15 @@ olsrv2_tc_endpoint_add(struct olsrv2_tc_node *node,
   /* initialize attached network */
   net->src = node;
   net->dst = end;
-  for (i=0; i<NHDP_MAXIMUM_DOMAINS; i++) {
-    net->cost[i] = RFC5444_METRIC_INFINITE;
-  }
 
   /* hook into src node */
-  net->_src_node.key = &end->target;
+  net->_src_node.key = &end->target.addr_id;
   avl_insert(&node->_endpoints, &net->_src_node);
 
   /* hook into endpoint */
-  net->_endpoint_node.key = &node->target.addr;
+  net->_endpoint_node.key = &node->target.addr_id;
   avl_insert(&end->_attached_networks, &net->_endpoint_node);
 
-  /* initialize dijkstra data */
-  olsrv2_routing_dijkstra_node_init(&end->target._dijkstra);
-
   oonf_class_event(&_tc_attached_class, net, OONF_OBJECT_ADDED);
   return net;
 }
@@ -387,18 +632,117 @@ olsrv2_tc_endpoint_remove(
   /* remove from endpoint */
   avl_remove(&net->dst->_attached_networks, &net->_endpoint_node);
 
+  /* inform dijkstra that the attachment is gone */
+  olsrv2_routing_edge_removed(net->src, &net->dst->target);
+
   if (net->dst->_attached_networks.count == 0) {
     oonf_class_event(&_tc_endpoint_class, net->dst, OONF_OBJECT_REMOVED);
 
+    olsrv2_routing_target_remove(&net->dst->target);
+
     /* remove endpoint */
     avl_remove(&olsrv2_tc_endpoint_tree, &net->dst->_node);
+    _index_remove(&_tc_endpoint_index, &net->dst->target);
+    nhdp_addr_id_release(net->dst->target.addr_id);
     oonf_class_free(&_tc_endpoint_class, net->dst);
   }
 
   /* free attached network */
+  olsrv2_cost_table_free_row(&olsrv2_tc_attachment_costs, net->_cost_index);
   oonf_class_free(&_tc_attached_class, net);
 }
 
+/**
+ * @param originator originator address of a tc node
+ * @return pointer to tc node, NULL if not found
+ */
+struct olsrv2_tc_node *
+olsrv2_tc_node_get(const struct netaddr *originator) {
+  return olsrv2_tc_node_get_by_id(nhdp_addr_id_lookup(originator));
+}
+
+/**
+ * @param id interned originator address id of a tc node
+ * @return pointer to tc node, NULL if not found
+ */
+struct olsrv2_tc_node *
+olsrv2_tc_node_get_by_id(uint32_t id) {
+  return container_of_if_notnull(
+      _index_get(&_tc_node_index, id), struct olsrv2_tc_node, target);
+}
+
+/**
+ * @param id interned prefix id of a tc endpoint
+ * @return pointer to tc endpoint, NULL if not found
+ */
+struct olsrv2_tc_endpoint *
+olsrv2_tc_endpoint_get_by_id(uint32_t id) {
+  return container_of_if_notnull(
+      _index_get(&_tc_endpoint_index, id), struct olsrv2_tc_endpoint, target);
+}
+
+/**
+ * @param prefix network prefix of tc endpoint
+ * @return pointer to tc endpoint, NULL if not found
+ */
+struct olsrv2_tc_endpoint *
+olsrv2_tc_endpoint_get(const struct netaddr *prefix) {
+  return container_of_if_notnull(
+      _index_get(&_tc_endpoint_index, nhdp_addr_id_lookup(prefix)),
+      struct olsrv2_tc_endpoint, target);
+}
+
+/**
+ * @return statistics of the tc edge allocator
+ */
+const struct olsrv2_tc_statistics *
+olsrv2_tc_get_statistics(void) {
+  _stats.cost_columns = olsrv2_tc_edge_costs.columns;
+  _stats.edge_cost_rows = olsrv2_tc_edge_costs.size;
+  _stats.attachment_cost_rows = olsrv2_tc_attachment_costs.size;
+  return &_stats;
+}
+
+/**
+ * Remove all edges and endpoints of a tc node which do not belong
+ * to its current answer set
+ * @param node pointer to tc node
+ */
+static void
+_remove_stale_entries(struct olsrv2_tc_node *node) {
+  struct olsrv2_tc_edge *edge, *edge_it;
+  struct olsrv2_tc_attachment *end, *end_it;
+
+  avl_for_each_element_safe(&node->_edges, edge, _node, edge_it) {
+    if (edge->ansn != node->ansn) {
+      olsrv2_tc_edge_remove(edge);
+    }
+  }
+
+  avl_for_each_element_safe(&node->_endpoints, end, _src_node, end_it) {
+    if (end->ansn != node->ansn) {
+      olsrv2_tc_endpoint_remove(end);
+    }
+  }
+}
+
+/**
+ * Callback triggered when the fragments of an answer set
+ * have not been completed in time
+ * @param ptr pointer to tc node
+ */
+static void
+_cb_fragment_timeout(void *ptr) {
+  struct olsrv2_tc_node *node = ptr;
+  uint32_t generation;
+
+  _stats.fragment_timeouts++;
+
+  generation = olsrv2_routing_get_topology_generation();
+  _remove_stale_entries(node);
+  olsrv2_routing_trigger_topology_update(generation);
+}
+
 /**
  * Callback triggered when a tc node times out
  * @param ptr pointer to tc node
@@ -441,8 +785,12 @@ _remove_edge(struct olsrv2_tc_edge *edge, bool cleanup) {
   avl_remove(&edge->src->_edges, &edge->_node);
   avl_remove(&edge->dst->_edges, &edge->inverse->_node);
 
+  /* inform dijkstra that both directions are gone */
+  olsrv2_routing_edge_removed(edge->src, &edge->dst->target);
+  olsrv2_routing_edge_removed(edge->dst, &edge->src->target);
+
   if (edge->dst->_edges.count == 0 && cleanup
-      && !oonf_timer_is_active(&edge->dst->_validity_time)) {
+      && !nhdp_timer_is_active(&edge->dst->_validity_time)) {
     /*
      * node is already virtual and has no
      * incoming links anymore.
@@ -452,8 +800,184 @@ _remove_edge(struct olsrv2_tc_edge *edge, bool cleanup) {
     removed_node = true;
   }
 
-  oonf_class_free(&_tc_edge_class, edge->inverse);
-  oonf_class_free(&_tc_edge_class, edge);
+  olsrv2_cost_table_free_row(&olsrv2_tc_edge_costs, edge->_cost_index);
+  olsrv2_cost_table_free_row(&olsrv2_tc_edge_costs,
+      edge->inverse->_cost_index);
+  _free_edge_pair(edge);
 
   return removed_node;
 }
+
+/**
+ * Allocate an edge and its inverse, a new slab is allocated
+ * if all existing ones are full
+ * @return pointer to zeroed edge pair, NULL if out of memory
+ */
+static struct _tc_edge_pair *
+_alloc_edge_pair(void) {
+  static bool warned = false;
+  struct _tc_edge_slab *slab;
+  struct _tc_edge_pair *pair;
+  int i;
+
+  if (_tc_edge_class.total_size > _tc_edge_class.size) {
+    /* extension data would overwrite the next edge of the slab */
+    if (!warned) {
+      OONF_WARN(LOG_OLSRV2, "Class '%s' does not support extensions"
+          " with a size, no tc edges can be added", _tc_edge_class.name);
+      warned = true;
+    }
+    return NULL;
+  }
+
+  if (list_is_empty(&_free_edge_pairs)) {
+    slab = oonf_class_malloc(&_tc_edge_slab_class);
+    if (slab == NULL) {
+      return NULL;
+    }
+
+    for (i=0; i<OLSRV2_TC_EDGE_SLAB_SIZE; i++) {
+      slab->pairs[i].slab = slab;
+      list_add_tail(&_free_edge_pairs, &slab->pairs[i]._free_node);
+    }
+    list_add_tail(&_edge_slabs, &slab->_node);
+
+    _stats.edge_slabs++;
+    _stats.edge_pairs_free += OLSRV2_TC_EDGE_SLAB_SIZE;
+    _stats.slab_allocations++;
+  }
+
+  pair = list_first_element(&_free_edge_pairs, pair, _free_node);
+  list_remove(&pair->_free_node);
+
+  slab = pair->slab;
+  memset(pair, 0, sizeof(*pair));
+  pair->slab = slab;
+  slab->used++;
+
+  _stats.edge_pairs++;
+  _stats.edge_pairs_free--;
+  return pair;
+}
+
+/**
+ * Return an edge and its inverse to their slab, the slab is
+ * released if it becomes empty and other free pairs are left
+ * @param edge pointer to one of the edges of the pair
+ */
+static void
+_free_edge_pair(struct olsrv2_tc_edge *edge) {
+  struct _tc_edge_slab *slab;
+  struct _tc_edge_pair *pair;
+  int i;
+
+  /* the first edge of a pair has the lower address */
+  if (edge->inverse < edge) {
+    edge = edge->inverse;
+  }
+  pair = container_of(edge, struct _tc_edge_pair, edge);
+  slab = pair->slab;
+
+  list_add_head(&_free_edge_pairs, &pair->_free_node);
+  slab->used--;
+
+  _stats.edge_pairs--;
+  _stats.edge_pairs_free++;
+
+  if (slab->used > 0
+      || _stats.edge_pairs_free == OLSRV2_TC_EDGE_SLAB_SIZE) {
+    /* keep slab to avoid reallocation for the next edge */
+    return;
+  }
+
+  for (i=0; i<OLSRV2_TC_EDGE_SLAB_SIZE; i++) {
+    list_remove(&slab->pairs[i]._free_node);
+  }
+  list_remove(&slab->_node);
+  oonf_class_free(&_tc_edge_slab_class, slab);
+
+  _stats.edge_slabs--;
+  _stats.edge_pairs_free -= OLSRV2_TC_EDGE_SLAB_SIZE;
+  _stats.slab_releases++;
+}
+
+/**
+ * Allocate a row of a tc cost table and make sure the table
+ * has a cost column for each nhdp domain
+ * @param table pointer to cost table
+ * @param row pointer to storage for row index
+ * @return -1 if out of memory, 0 otherwise
+ */
+static int
+_alloc_cost_row(struct olsrv2_cost_table *table, uint32_t *row) {
+  if (olsrv2_cost_table_add_columns(table, nhdp_domain_get_count())) {
+    return -1;
+  }
+  return olsrv2_cost_table_alloc_row(table, row);
+}
+
+/**
+ * Add a tc target to an index, the index grows with the address ids
+ * @param index pointer to target index
+ * @param target pointer to tc target with interned address id
+ * @return -1 if out of memory, 0 otherwise
+ */
+static int
+_index_add(struct _tc_target_index *index, struct olsrv2_tc_target *target) {
+  struct olsrv2_tc_target **targets;
+  uint32_t size;
+
+  if (target->addr_id >= index->size) {
+    size = index->size == 0 ? OLSRV2_TC_INDEX_MIN_SIZE : index->size;
+    while (size <= target->addr_id) {
+      size *= 2;
+    }
+
+    targets = realloc(index->targets, size * sizeof(*targets));
+    if (targets == NULL) {
+      return -1;
+    }
+    memset(&targets[index->size], 0,
+        (size - index->size) * sizeof(*targets));
+
+    index->targets = targets;
+    index->size = size;
+  }
+
+  index->targets[target->addr_id] = target;
+  return 0;
+}
+
+/**
+ * Remove a tc target from an index
+ * @param index pointer to target index
+ * @param target pointer to tc target
+ */
+static void
+_index_remove(struct _tc_target_index *index, struct olsrv2_tc_target *target) {
+  index->targets[target->addr_id] = NULL;
+}
+
+/**
+ * Free the memory of a target index
+ * @param index pointer to target index
+ */
+static void
+_index_cleanup(struct _tc_target_index *index) {
+  free(index->targets);
+  index->targets = NULL;
+  index->size = 0;
+}
+
+/**
+ * @param index pointer to target index
+ * @param id interned address id
+ * @return tc target with the address id, NULL if not found
+ */
+static struct olsrv2_tc_target *
+_index_get(const struct _tc_target_index *index, uint32_t id) {
+  if (id >= index->size) {
+    return NULL;
+  }
+  return index->targets[id];
+}
@@ -46,11 +46,12 @@
 #include "common/common_types.h"
 #include "common/netaddr.h"
 
-#include "subsystems/oonf_timer.h"
-
+#include "nhdp/nhdp_addr_id.h"
 #include "nhdp/nhdp_domain.h"
 #include "nhdp/nhdp.h"
+#include "nhdp/nhdp_timer_wheel.h"
 
+#include "olsrv2/olsrv2_cost_table.h"
 #include "olsrv2/olsrv2_routing.h"
 
 enum olsrv2_target_type {
@@ -66,14 +67,20 @@ enum olsrv2_target_type {
  * network.
  */
 struct olsrv2_tc_target {
-  /* address or prefix of this node of the topology graph */
-  struct netaddr addr;
+  /* interned id of the address or prefix of this node of the topology graph */
+  uint32_t addr_id;
 
   /* type of target */
   enum olsrv2_target_type type;
 
-  /* internal data for dijkstra run */
-  struct olsrv2_dijkstra_node _dijkstra;
+  /* internal data for dijkstra run, one for each registered domain */
+  struct olsrv2_dijkstra_node *_dijkstra;
+
+  /* hook into list of targets changed since the last dijkstra run */
+  struct list_entity _changed_node;
+
+  /* index of target in the topology snapshot of the dijkstra */
+  uint32_t _graph_index;
 };
 
 /*
@@ -90,10 +97,22 @@ struct olsrv2_tc_node {
   /* reported interval time */
   uint64_t interval_time;
 
+  /*
+   * hash over the address block content of the last complete TC
+   * of the current answer set, 0 if unknown
+   */
+  uint32_t content_hash;
+
   /* time until this node has to be removed */
-  struct oonf_timer_entry _validity_time;
+  struct nhdp_timer_entry _validity_time;
 
-  /* tree of olsrv2_tc_edges */
+  /*
+   * time until entries of older answer sets are removed if the
+   * current answer set was only received in fragments
+   */
+  struct nhdp_timer_entry _fragment_time;
+
+  /* tree of olsrv2_tc_edges, key is the address id of the destination */
   struct avl_tree _edges;
 
   /* tree of olsrv2_tc_attached_networks */
@@ -114,8 +133,8 @@ struct olsrv2_tc_edge {
   /* pointer to inverse edge */
   struct olsrv2_tc_edge *inverse;
 
-  /* link cost of edge */
-  uint32_t cost[NHDP_MAXIMUM_DOMAINS];
+  /* row of the link costs in olsrv2_tc_edge_costs */
+  uint32_t _cost_index;
 
   /* answer set number which set this edge */
   uint16_t ansn;
@@ -141,11 +160,8 @@ struct olsrv2_tc_attachment {
   /* pointer to destination of edge */
   struct olsrv2_tc_endpoint *dst;
 
-  /* link cost of edge */
-  uint32_t cost[NHDP_MAXIMUM_DOMAINS];
-
-  /* distance to attached network */
-  uint8_t distance[NHDP_MAXIMUM_DOMAINS];
+  /* row of link cost and distance in olsrv2_tc_attachment_costs */
+  uint32_t _cost_index;
 
   /* answer set number which set this edge */
   uint16_t ansn;
@@ -174,18 +190,62 @@ struct olsrv2_tc_endpoint {
   struct avl_node _node;
 };
 
+/* statistics of the tc database */
+struct olsrv2_tc_statistics {
+  /* number of edge pairs (edge and inverse edge) in use */
+  uint32_t edge_pairs;
+
+  /* number of unused edge pairs in allocated slabs */
+  uint32_t edge_pairs_free;
+
+  /* number of allocated edge slabs */
+  uint32_t edge_slabs;
+
+  /* number of slab allocations */
+  uint32_t slab_allocations;
+
+  /* number of slabs released because they became empty */
+  uint32_t slab_releases;
+
+  /* number of domains with cost columns */
+  uint32_t cost_columns;
+
+  /* number of allocated rows of the edge cost table */
+  uint32_t edge_cost_rows;
+
+  /* number of allocated rows of the attachment cost table */
+  uint32_t attachment_cost_rows;
+
+  /* number of incomplete tc messages received */
+  uint32_t tc_fragments;
+
+  /* number of fragmented answer sets finished by timeout */
+  uint32_t fragment_timeouts;
+
+  /* number of tc messages that only refreshed the stored answer set */
+  uint32_t tc_refreshes;
+};
+
 EXPORT extern struct avl_tree olsrv2_tc_tree;
 EXPORT extern struct avl_tree olsrv2_tc_endpoint_tree;
+EXPORT extern struct olsrv2_cost_table olsrv2_tc_edge_costs;
+EXPORT extern struct olsrv2_cost_table olsrv2_tc_attachment_costs;
 
 void olsrv2_tc_init(void);
 void olsrv2_tc_cleanup(void);
 
 EXPORT struct olsrv2_tc_node *olsrv2_tc_node_add(
-    struct netaddr *, uint64_t vtime, uint16_t ansn);
+    const struct netaddr *, uint64_t vtime, uint16_t ansn);
 EXPORT void olsrv2_tc_node_remove(struct olsrv2_tc_node *);
+EXPORT void olsrv2_tc_node_set_complete(struct olsrv2_tc_node *,
+    uint32_t content_hash);
+EXPORT void olsrv2_tc_node_add_fragment(struct olsrv2_tc_node *,
+    bool new_set, uint64_t hold_time);
+EXPORT bool olsrv2_tc_node_refresh(struct olsrv2_tc_node *,
+    uint32_t content_hash);
 
 EXPORT struct olsrv2_tc_edge *olsrv2_tc_edge_add(
-    struct olsrv2_tc_node *, struct netaddr *);
+    struct olsrv2_tc_node *, const struct netaddr *);
 EXPORT bool olsrv2_tc_edge_remove(struct olsrv2_tc_edge *);
 
 EXPORT struct olsrv2_tc_attachment *olsrv2_tc_endpoint_add(
@@ -193,25 +253,101 @@ EXPORT struct olsrv2_tc_attachment *olsrv2_tc_endpoint_add(
 EXPORT void olsrv2_tc_endpoint_remove(
     struct olsrv2_tc_attachment *);
 
+EXPORT struct olsrv2_tc_node *olsrv2_tc_node_get(
+    const struct netaddr *originator);
+EXPORT struct olsrv2_tc_node *olsrv2_tc_node_get_by_id(uint32_t id);
+EXPORT struct olsrv2_tc_endpoint *olsrv2_tc_endpoint_get_by_id(uint32_t id);
+EXPORT struct olsrv2_tc_endpoint *olsrv2_tc_endpoint_get(
+    const struct netaddr *prefix);
+
+EXPORT const struct olsrv2_tc_statistics *olsrv2_tc_get_statistics(void);
+
 /**
- * @param originator originator address of a tc node
- * @return pointer to tc node, NULL if not found
+ * @param target pointer to tc target
+ * @return address or prefix of target
  */
-static INLINE struct olsrv2_tc_node *
-olsrv2_tc_node_get(struct netaddr *originator) {
-  struct olsrv2_tc_node *node;
+static INLINE const struct netaddr *
+olsrv2_tc_target_get_netaddr(const struct olsrv2_tc_target *target) {
+  return nhdp_addr_id_get_netaddr(target->addr_id);
+}
 
-  return avl_find_element(&olsrv2_tc_tree, originator, node, _originator_node);
+/**
+ * @param src pointer to source node
+ * @param dst pointer to destination node
+ * @return pointer to tc edge between the nodes, NULL if not found
+ */
+static INLINE struct olsrv2_tc_edge *
+olsrv2_tc_edge_get(struct olsrv2_tc_node *src, struct olsrv2_tc_node *dst) {
+  struct olsrv2_tc_edge *edge;
+  return avl_find_element(&src->_edges, &dst->target.addr_id, edge, _node);
 }
 
 /**
- * @param prefix network prefix of tc endpoint
- * @return pointer to tc endpoint, NULL if not found
+ * @param edge pointer to tc edge
+ * @param domain_index index of nhdp domain
+ * @return link cost of tc edge
  */
-static inline struct olsrv2_tc_endpoint *
-olsrv2_tc_endpoint_get(struct netaddr *prefix) {
-  struct olsrv2_tc_endpoint *end;
+static INLINE uint32_t
+olsrv2_tc_edge_get_cost(const struct olsrv2_tc_edge *edge, int domain_index) {
+  return olsrv2_cost_table_get_cost(
+      &olsrv2_tc_edge_costs, domain_index, edge->_cost_index);
+}
+
+/**
+ * @param net pointer to tc attachment
+ * @param domain_index index of nhdp domain
+ * @return link cost of tc attachment
+ */
+static INLINE uint32_t
+olsrv2_tc_endpoint_get_cost(const struct olsrv2_tc_attachment *net,
+    int domain_index) {
+  return olsrv2_cost_table_get_cost(
+      &olsrv2_tc_attachment_costs, domain_index, net->_cost_index);
+}
 
-  return avl_find_element(&olsrv2_tc_endpoint_tree, prefix, end, _node);
+/**
+ * @param net pointer to tc attachment
+ * @param domain_index index of nhdp domain
+ * @return hopcount distance of tc attachment
+ */
+static INLINE uint8_t
+olsrv2_tc_endpoint_get_distance(const struct olsrv2_tc_attachment *net,
+    int domain_index) {
+  return olsrv2_cost_table_get_distance(
+      &olsrv2_tc_attachment_costs, domain_index, net->_cost_index);
+}
+
+/**
+ * Set the link cost of a tc edge for a domain
+ * @param edge pointer to tc edge
+ * @param domain pointer to nhdp domain
+ * @param cost new link cost
+ */
+static INLINE void
+olsrv2_tc_edge_set_cost(struct olsrv2_tc_edge *edge,
+    struct nhdp_domain *domain, uint32_t cost) {
+  if (olsrv2_tc_edge_get_cost(edge, domain->index) != cost
+      && olsrv2_cost_table_set(&olsrv2_tc_edge_costs,
+          domain->index, edge->_cost_index, cost, 0) == 0) {
+    olsrv2_routing_target_changed(&edge->dst->target);
+  }
+}
+
+/**
+ * Set the link cost and hopcount distance of a tc attachment for a domain
+ * @param net pointer to tc attachment
+ * @param domain pointer to nhdp domain
+ * @param cost new link cost
+ * @param distance new hopcount distance
+ */
+static INLINE void
+olsrv2_tc_endpoint_set_cost(struct olsrv2_tc_attachment *net,
+    struct nhdp_domain *domain, uint32_t cost, uint8_t distance) {
+  if ((olsrv2_tc_endpoint_get_cost(net, domain->index) != cost
+        || olsrv2_tc_endpoint_get_distance(net, domain->index) != distance)
+      && olsrv2_cost_table_set(&olsrv2_tc_attachment_costs,
+          domain->index, net->_cost_index, cost, distance) == 0) {
+    olsrv2_routing_target_changed(&net->dst->target);
+  }
 }
 #endif /* OONFV2_TC_H_ */
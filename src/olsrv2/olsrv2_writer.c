@@ -39,6 +39,8 @@
  *
  */
 
+#include <stdlib.h>
+
 #include "common/avl.h"
 #include "common/common_types.h"
 #include "common/list.h"
@@ -69,6 +71,41 @@ enum {
   IDX_ADDRTLV_GATEWAY,
 };
 
+/* address of a TC with the values of its address TLVs */
+struct _tc_address {
+  /* address or prefix */
+  struct netaddr addr;
+
+  /* value of NBR_ADDR_TYPE TLV, 0 for a locally attached network */
+  uint8_t nbr_addrtype;
+
+  /* number of link metric TLVs per domain */
+  uint8_t metric_count[NHDP_MAXIMUM_DOMAINS];
+
+  /* link metric TLV values per domain as they are put into the TLVs */
+  uint16_t metric[NHDP_MAXIMUM_DOMAINS][2];
+
+  /* gateway distance per domain of a locally attached network */
+  uint8_t distance[NHDP_MAXIMUM_DOMAINS];
+};
+
+/* content of the last TC of an address family */
+struct _tc_cache {
+  /* array of addresses */
+  struct _tc_address *addresses;
+
+  /* number of used and allocated addresses */
+  size_t count, size;
+
+  /* ANSN, LAN set and neighbor address generation of the content */
+  uint16_t ansn;
+  uint32_t lan_generation;
+  uint32_t addr_generation;
+
+  /* true if the content can be reused */
+  bool valid;
+};
+
 /* Prototypes */
 static void _send_tc(int af_type);
 static bool _cb_tc_interface_selector(struct rfc5444_writer *,
@@ -80,6 +117,11 @@ static void _cb_addMessageHeader(
     struct rfc5444_writer *, struct rfc5444_writer_message *);
 static void _cb_addMessageTLVs(struct rfc5444_writer *);
 static void _cb_addAddresses(struct rfc5444_writer *);
+static int _build_tc_cache(struct _tc_cache *);
+static struct _tc_address *_add_tc_address(struct _tc_cache *,
+    const struct netaddr *addr);
+static void _add_cached_addresses(struct rfc5444_writer *,
+    struct _tc_cache *);
 static void _cb_finishMessageTLVs(struct rfc5444_writer *,
   struct rfc5444_writer_address *start,
   struct rfc5444_writer_address *end, bool complete);
@@ -111,6 +153,12 @@ static struct oonf_class_extension _domain_listener = {
 
 static int _send_msg_type;
 
+/* content of the last IPv4 and IPv6 TC */
+static struct _tc_cache _tc_cache[2];
+
+/* statistics of the TC generation */
+static struct olsrv2_writer_statistics _statistics;
+
 static struct oonf_rfc5444_protocol *_protocol;
 
 static bool _cleanedup = false;
@@ -170,6 +218,30 @@ olsrv2_writer_cleanup(void) {
       &_protocol->writer, &_olsrv2_msgcontent_provider,
       _olsrv2_addrtlvs, ARRAYSIZE(_olsrv2_addrtlvs));
   rfc5444_writer_unregister_message(&_protocol->writer, _olsrv2_message);
+
+  /* free TC content */
+  for (i=0; i<2; i++) {
+    free(_tc_cache[i].addresses);
+    memset(&_tc_cache[i], 0, sizeof(_tc_cache[i]));
+  }
+}
+
+/**
+ * Generate the content of the next TCs again, even if the
+ * ANSN did not change.
+ */
+void
+olsrv2_writer_flush_tc_cache(void) {
+  _tc_cache[0].valid = false;
+  _tc_cache[1].valid = false;
+}
+
+/**
+ * @return statistics of the TC generation
+ */
+const struct olsrv2_writer_statistics *
+olsrv2_writer_get_statistics(void) {
+  return &_statistics;
 }
 
 /**
@@ -216,6 +288,9 @@ _cb_initialize_gatewaytlv(void *ptr) {
 
   rfc5444_writer_register_addrtlvtype(&_protocol->writer,
       &_gateway_addrtlvs[domain->index], RFC5444_MSGTYPE_TC);
+
+  /* the new domain needs its own TLVs */
+  olsrv2_writer_flush_tc_cache();
 }
 
 /**
@@ -297,11 +372,11 @@ _cb_tc_interface_selector(struct rfc5444_writer *writer __attribute__((unused)),
       /* link is not symmetric */
       continue;
     }
-    if (netaddr_get_address_family(&lnk->neigh->originator) != target_af_type) {
+    if (netaddr_get_address_family(nhdp_db_neighbor_get_originator(lnk->neigh)) != target_af_type) {
       /* link cannot receive this targets address type */
       continue;
     }
-    if (netaddr_get_address_family(&lnk->neigh->originator) == _send_msg_type
+    if (netaddr_get_address_family(nhdp_db_neighbor_get_originator(lnk->neigh)) == _send_msg_type
         && lnk->dualstack_partner == NULL) {
       /* link type is right and node is not dualstack */
       OONF_DEBUG(LOG_OLSRV2_W, "Found link with AF %s which is not dualstack",
@@ -348,9 +423,54 @@ _cb_addMessageTLVs(struct rfc5444_writer *writer) {
  */
 static void
 _cb_addAddresses(struct rfc5444_writer *writer) {
+  struct _tc_cache *cache;
+  uint16_t ansn;
+  uint32_t lan_generation, addr_generation;
+
+  cache = &_tc_cache[_send_msg_type == AF_INET ? 0 : 1];
+
+  /*
+   * the advertised metrics and MPR selection only change together
+   * with the ANSN, the advertised addresses together with the
+   * LAN set or the neighbor addresses
+   */
+  ansn = olsrv2_update_ansn();
+  lan_generation = olsrv2_lan_get_generation();
+  addr_generation = nhdp_db_neighbor_get_address_generation();
+
+  if (!cache->valid || cache->ansn != ansn
+      || cache->lan_generation != lan_generation
+      || cache->addr_generation != addr_generation) {
+    _statistics.tc_cache_misses++;
+    if (_build_tc_cache(cache)) {
+      OONF_WARN(LOG_OLSRV2_W, "Out of memory error for olsrv2 TC cache");
+      return;
+    }
+    cache->ansn = ansn;
+    cache->lan_generation = lan_generation;
+    cache->addr_generation = addr_generation;
+    cache->valid = true;
+  }
+  else {
+    _statistics.tc_cache_hits++;
+    OONF_DEBUG(LOG_OLSRV2_W, "Reuse TC content of ANSN %u", ansn);
+  }
+
+  _add_cached_addresses(writer, cache);
+}
+
+/**
+ * Collect the advertised neighbor addresses and locally attached
+ * networks of the current address family with their TLV values
+ * @param cache pointer to TC cache of the address family
+ * @return -1 if out of memory, 0 otherwise
+ */
+static int
+_build_tc_cache(struct _tc_cache *cache) {
   const struct netaddr_acl *routable_acl;
-  struct rfc5444_writer_address *addr;
+  struct _tc_address *address;
   struct nhdp_neighbor *neigh;
+  const struct netaddr *neigh_addr;
   struct nhdp_naddr *naddr;
   struct nhdp_neighbor_domaindata *neigh_domain;
   struct nhdp_domain *domain;
@@ -365,6 +485,9 @@ _cb_addAddresses(struct rfc5444_writer *writer) {
 
   routable_acl = olsrv2_get_routable();
 
+  cache->valid = false;
+  cache->count = 0;
+
   /* iterate over neighbors */
   list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
     any_advertised = false;
@@ -384,43 +507,40 @@ _cb_addAddresses(struct rfc5444_writer *writer) {
 
     /* iterate over neighbors addresses */
     avl_for_each_element(&neigh->_neigh_addresses, naddr, _neigh_node) {
-      if (netaddr_get_address_family(&naddr->neigh_addr) != _send_msg_type) {
+      neigh_addr = nhdp_db_neighbor_addr_get_netaddr(naddr);
+      if (netaddr_get_address_family(neigh_addr) != _send_msg_type) {
         /* wrong address family */
         OONF_DEBUG(LOG_OLSRV2_W, "Wrong address type of neighbor %s",
-            netaddr_to_string(&buf, &naddr->neigh_addr));
+            netaddr_to_string(&buf, neigh_addr));
         continue;
       }
 
       nbr_addrtype_value = 0;
 
-      if (netaddr_acl_check_accept(routable_acl, &naddr->neigh_addr)) {
+      if (netaddr_acl_check_accept(routable_acl, neigh_addr)) {
         nbr_addrtype_value += RFC5444_NBR_ADDR_TYPE_ROUTABLE;
       }
-      if (netaddr_cmp(&neigh->originator, &naddr->neigh_addr) == 0) {
+      if (nhdp_addr_id_is_equal(neigh->originator_id, naddr->neigh_addr_id)) {
         nbr_addrtype_value += RFC5444_NBR_ADDR_TYPE_ORIGINATOR;
       }
 
       if (nbr_addrtype_value == 0) {
         /* skip this address */
         OONF_DEBUG(LOG_OLSRV2_W, "Address %s is neither routable"
-            " nor an originator", netaddr_to_string(&buf, &naddr->neigh_addr));
+            " nor an originator", netaddr_to_string(&buf, neigh_addr));
         continue;
       }
 
       OONF_DEBUG(LOG_OLSRV2_W, "Add address %s to TC",
-          netaddr_to_string(&buf, &naddr->neigh_addr));
-      addr = rfc5444_writer_add_address(writer, _olsrv2_msgcontent_provider.creator,
-          netaddr_get_binptr(&naddr->neigh_addr),
-          netaddr_get_prefix_length(&naddr->neigh_addr), false);
-      if (addr == NULL) {
-        OONF_WARN(LOG_OLSRV2_W, "Out of memory error for olsrv2 address");
-        return;
+          netaddr_to_string(&buf, neigh_addr));
+      address = _add_tc_address(cache, neigh_addr);
+      if (address == NULL) {
+        return -1;
       }
 
       /* add neighbor type TLV */
       OONF_DEBUG(LOG_OLSRV2_W, "Add NBRAddrType TLV with value %u", nbr_addrtype_value);
-      rfc5444_writer_add_addrtlv(writer, addr, &_olsrv2_addrtlvs[IDX_ADDRTLV_NBR_ADDR_TYPE],
-          &nbr_addrtype_value, sizeof(nbr_addrtype_value), false);
+      address->nbr_addrtype = nbr_addrtype_value;
 
       /* add linkmetric TLVs */
       list_for_each_element(&nhdp_domain_list, domain, _node) {
@@ -435,9 +555,8 @@ _cb_addAddresses(struct rfc5444_writer *writer) {
 
           OONF_DEBUG(LOG_OLSRV2_W, "Add Linkmetric (ext %u) TLV with value 0x%04x",
               domain->ext, metric_in);
-          metric_in = htons(metric_in);
-          rfc5444_writer_add_addrtlv(writer, addr, &domain->_metric_addrtlvs[0],
-              &metric_in, sizeof(metric_in), true);
+          address->metric[domain->index][0] = htons(metric_in);
+          address->metric_count[domain->index] = 1;
         }
         else if (metric_in == metric_out) {
           /* incoming and outgoing metric are the same */
@@ -446,9 +565,8 @@ _cb_addAddresses(struct rfc5444_writer *writer) {
 
           OONF_DEBUG(LOG_OLSRV2_W, "Add Linkmetric (ext %u) TLV with value 0x%04x",
               domain->ext, metric_in);
-          metric_in = htons(metric_in);
-          rfc5444_writer_add_addrtlv(writer, addr, &domain->_metric_addrtlvs[0],
-              &metric_in, sizeof(metric_in), true);
+          address->metric[domain->index][0] = htons(metric_in);
+          address->metric_count[domain->index] = 1;
         }
         else {
           /* different metrics for incoming and outgoing link */
@@ -457,15 +575,11 @@ _cb_addAddresses(struct rfc5444_writer *writer) {
 
           OONF_DEBUG(LOG_OLSRV2_W, "Add Linkmetric (ext %u) TLV with value 0x%04x",
               domain->ext, metric_in);
-          metric_in = htons(metric_in);
-          rfc5444_writer_add_addrtlv(writer, addr, &domain->_metric_addrtlvs[0],
-              &metric_in, sizeof(metric_in), true);
-
           OONF_DEBUG(LOG_OLSRV2_W, "Add Linkmetric (ext %u) TLV with value 0x%04x",
               domain->ext, metric_out);
-          metric_out = htons(metric_out);
-          rfc5444_writer_add_addrtlv(writer, addr, &domain->_metric_addrtlvs[1],
-              &metric_out, sizeof(metric_out), true);
+          address->metric[domain->index][0] = htons(metric_in);
+          address->metric[domain->index][1] = htons(metric_out);
+          address->metric_count[domain->index] = 2;
         }
       }
     }
@@ -480,12 +594,9 @@ _cb_addAddresses(struct rfc5444_writer *writer) {
 
     OONF_DEBUG(LOG_OLSRV2_W, "Add address %s to TC",
         netaddr_to_string(&buf, &lan->prefix));
-    addr = rfc5444_writer_add_address(writer, _olsrv2_msgcontent_provider.creator,
-        netaddr_get_binptr(&lan->prefix),
-        netaddr_get_prefix_length(&lan->prefix), false);
-    if (addr == NULL) {
-      OONF_WARN(LOG_OLSRV2_W, "Out of memory error for olsrv2 address");
-      return;
+    address = _add_tc_address(cache, &lan->prefix);
+    if (address == NULL) {
+      return -1;
     }
 
     /* add Gateway TLV and Metric TLV */
@@ -496,14 +607,90 @@ _cb_addAddresses(struct rfc5444_writer *writer) {
       /* add Metric TLV */
       OONF_DEBUG(LOG_OLSRV2_W, "Add Linkmetric (ext %u) TLV with value 0x%04x",
           domain->ext, metric_out);
-      rfc5444_writer_add_addrtlv(writer, addr, &domain->_metric_addrtlvs[0],
-          &metric_out, sizeof(metric_out), false);
+      address->metric[domain->index][0] = metric_out;
+      address->metric_count[domain->index] = 1;
 
       /* add Gateway TLV */
-      OONF_DEBUG(LOG_OLSRV2_W, "Add Gateway (ext %u) TLV with value 0x%04x",
-          domain->ext, metric_in);
-      rfc5444_writer_add_addrtlv(writer, addr, &_gateway_addrtlvs[domain->index],
-          &lan->data[domain->index]. distance, 1, false);
+      OONF_DEBUG(LOG_OLSRV2_W, "Add Gateway (ext %u) TLV with value %u",
+          domain->ext, lan->data[domain->index].distance);
+      address->distance[domain->index] = lan->data[domain->index].distance;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Append an address to a TC cache
+ * @param cache pointer to TC cache
+ * @param addr pointer to address
+ * @return pointer to initialized cache entry, NULL if out of memory
+ */
+static struct _tc_address *
+_add_tc_address(struct _tc_cache *cache, const struct netaddr *addr) {
+  struct _tc_address *addresses, *address;
+  size_t size;
+
+  if (cache->count == cache->size) {
+    size = cache->size == 0 ? 16 : cache->size * 2;
+    addresses = realloc(cache->addresses, size * sizeof(*addresses));
+    if (addresses == NULL) {
+      return NULL;
+    }
+    cache->addresses = addresses;
+    cache->size = size;
+  }
+
+  address = &cache->addresses[cache->count++];
+  memset(address, 0, sizeof(*address));
+  memcpy(&address->addr, addr, sizeof(*addr));
+  return address;
+}
+
+/**
+ * Add the addresses and address TLVs of a TC cache to a message
+ * @param writer rfc5444 writer
+ * @param cache pointer to TC cache
+ */
+static void
+_add_cached_addresses(struct rfc5444_writer *writer, struct _tc_cache *cache) {
+  struct rfc5444_writer_address *addr;
+  struct _tc_address *address;
+  struct nhdp_domain *domain;
+  size_t i;
+
+  for (i=0; i<cache->count; i++) {
+    address = &cache->addresses[i];
+
+    addr = rfc5444_writer_add_address(writer, _olsrv2_msgcontent_provider.creator,
+        netaddr_get_binptr(&address->addr),
+        netaddr_get_prefix_length(&address->addr), false);
+    if (addr == NULL) {
+      OONF_WARN(LOG_OLSRV2_W, "Out of memory error for olsrv2 address");
+      return;
+    }
+
+    if (address->nbr_addrtype != 0) {
+      /* neighbor address */
+      rfc5444_writer_add_addrtlv(writer, addr, &_olsrv2_addrtlvs[IDX_ADDRTLV_NBR_ADDR_TYPE],
+          &address->nbr_addrtype, sizeof(address->nbr_addrtype), false);
+
+      list_for_each_element(&nhdp_domain_list, domain, _node) {
+        rfc5444_writer_add_addrtlv(writer, addr, &domain->_metric_addrtlvs[0],
+            &address->metric[domain->index][0], sizeof(uint16_t), true);
+        if (address->metric_count[domain->index] > 1) {
+          rfc5444_writer_add_addrtlv(writer, addr, &domain->_metric_addrtlvs[1],
+              &address->metric[domain->index][1], sizeof(uint16_t), true);
+        }
+      }
+    }
+    else {
+      /* locally attached network */
+      list_for_each_element(&nhdp_domain_list, domain, _node) {
+        rfc5444_writer_add_addrtlv(writer, addr, &domain->_metric_addrtlvs[0],
+            &address->metric[domain->index][0], sizeof(uint16_t), false);
+        rfc5444_writer_add_addrtlv(writer, addr, &_gateway_addrtlvs[domain->index],
+            &address->distance[domain->index], 1, false);
+      }
     }
   }
 }
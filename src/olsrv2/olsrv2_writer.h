@@ -45,10 +45,22 @@
 #include "common/common_types.h"
 #include "subsystems/oonf_rfc5444.h"
 
+/* statistics of the TC generation */
+struct olsrv2_writer_statistics {
+  /* number of TCs that reused the content of the last TC */
+  uint32_t tc_cache_hits;
+
+  /* number of TCs whose content had to be generated again */
+  uint32_t tc_cache_misses;
+};
+
 int olsrv2_writer_init(struct oonf_rfc5444_protocol *)
   __attribute__((warn_unused_result));
 void olsrv2_writer_cleanup(void);
 
 EXPORT void olsrv2_writer_send_tc(void);
+EXPORT void olsrv2_writer_flush_tc_cache(void);
+EXPORT const struct olsrv2_writer_statistics *
+    olsrv2_writer_get_statistics(void);
 
 #endif /* OONFV2_WRITER_H_ */